@@ -10,6 +10,7 @@
 #include <QMessageAuthenticationCode>
 
 #include <exception>
+#include <memory>
 
 #include "global.h"
 #include "qtyaml.h"
@@ -121,6 +122,16 @@ void InstallationReport::addFiles(const QStringList &files)
     m_files << files;
 }
 
+QMap<QString, QString> InstallationReport::pooledFiles() const
+{
+    return m_pooledFiles;
+}
+
+void InstallationReport::setPooledFiles(const QMap<QString, QString> &pooledFiles)
+{
+    m_pooledFiles = pooledFiles;
+}
+
 bool InstallationReport::isValid() const
 {
     return PackageInfo::isValidApplicationId(m_packageId) && !m_digest.isEmpty() && !m_files.isEmpty();
@@ -133,6 +144,7 @@ void InstallationReport::deserialize(QIODevice *from)
 
     m_digest.clear();
     m_files.clear();
+    m_pooledFiles.clear();
 
     auto docs = YamlParser::parseAllDocuments(from->readAll());
     checkYamlFormat(docs, 3 /*number of expected docs*/, { { qSL("am-installation-report"), 3 } });
@@ -182,6 +194,14 @@ void InstallationReport::deserialize(QIODevice *from)
         if (m_files.isEmpty())
             throw Exception("No files");
 
+        const QVariantMap pooledFiles = root.value(qSL("pooledFiles")).toMap();
+        for (auto it = pooledFiles.cbegin(); it != pooledFiles.cend(); ++it) {
+            const QString key = it.value().toString();
+            if (key.isEmpty() || key.contains(qL1C('/')))
+                throw Exception("invalid content pool key for file %1").arg(it.key());
+            m_pooledFiles.insert(it.key(), key);
+        }
+
         // see if the file has been tampered with by checking the hmac
         QByteArray hmacFile = QByteArray::fromHex(docs[2].toMap().value(qSL("hmac")).toString().toLatin1());
         QByteArray hmacKey = QByteArray::fromRawData(reinterpret_cast<const char *>(privateHmacKeyData),
@@ -198,6 +218,7 @@ void InstallationReport::deserialize(QIODevice *from)
         m_digest.clear();
         m_diskSpaceUsed = 0;
         m_files.clear();
+        m_pooledFiles.clear();
 
         throw;
     }
@@ -228,6 +249,13 @@ bool InstallationReport::serialize(QIODevice *to) const
 
     root[qSL("files")] = files();
 
+    if (!m_pooledFiles.isEmpty()) {
+        QVariantMap pooledFiles;
+        for (auto it = m_pooledFiles.cbegin(); it != m_pooledFiles.cend(); ++it)
+            pooledFiles.insert(it.key(), it.value());
+        root[qSL("pooledFiles")] = pooledFiles;
+    }
+
     QVector<QVariant> docs;
     docs << header;
     docs << root;
@@ -246,4 +274,50 @@ bool InstallationReport::serialize(QIODevice *to) const
     return (to->write(out) == out.size());
 }
 
+quint32 InstallationReport::dataStreamVersion()
+{
+    return 2;
+}
+
+void InstallationReport::writeToDataStream(QDataStream &ds) const
+{
+    //NOTE: increment dataStreamVersion() above, if you make any changes here
+
+    ds << m_packageId
+       << m_digest
+       << m_diskSpaceUsed
+       << m_files
+       << m_pooledFiles
+       << m_developerSignature
+       << m_storeSignature
+       << m_extraMetaData
+       << m_extraSignedMetaData;
+}
+
+/*! \internal
+    Reads a report previously written via writeToDataStream(). In contrast to deserialize(), there
+    is no HMAC verification: the data stream is only meant to be used for caches that are validated
+    against the original YAML report file (see ConfigCache).
+*/
+InstallationReport *InstallationReport::readFromDataStream(QDataStream &ds)
+{
+    //NOTE: increment dataStreamVersion() above, if you make any changes here
+
+    auto report = std::make_unique<InstallationReport>();
+
+    ds >> report->m_packageId
+       >> report->m_digest
+       >> report->m_diskSpaceUsed
+       >> report->m_files
+       >> report->m_pooledFiles
+       >> report->m_developerSignature
+       >> report->m_storeSignature
+       >> report->m_extraMetaData
+       >> report->m_extraSignedMetaData;
+
+    if ((ds.status() != QDataStream::Ok) || !report->isValid())
+        return nullptr;
+    return report.release();
+}
+
 QT_END_NAMESPACE_AM
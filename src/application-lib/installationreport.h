@@ -9,9 +9,11 @@
 #include <QtCore/QStringList>
 #include <QtCore/QByteArray>
 #include <QtCore/QVariantMap>
+#include <QtCore/QMap>
 #include <QtAppManCommon/global.h>
 
 QT_FORWARD_DECLARE_CLASS(QIODevice)
+QT_FORWARD_DECLARE_CLASS(QDataStream)
 
 QT_BEGIN_NAMESPACE_AM
 
@@ -44,16 +46,25 @@ public:
     void addFile(const QString &file);
     void addFiles(const QStringList &files);
 
+    // files that are hard links into the installation's content pool: file -> pool key
+    QMap<QString, QString> pooledFiles() const;
+    void setPooledFiles(const QMap<QString, QString> &pooledFiles);
+
     bool isValid() const;
 
     void deserialize(QIODevice *from);
     bool serialize(QIODevice *to) const;
 
+    static quint32 dataStreamVersion();
+    void writeToDataStream(QDataStream &ds) const;
+    static InstallationReport *readFromDataStream(QDataStream &ds);
+
 private:
     QString m_packageId;
     QByteArray m_digest;
     quint64 m_diskSpaceUsed = 0;
     QStringList m_files;
+    QMap<QString, QString> m_pooledFiles;
     QByteArray m_developerSignature;
     QByteArray m_storeSignature;
     QVariantMap m_extraMetaData;
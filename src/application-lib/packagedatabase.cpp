@@ -41,6 +41,62 @@ public:
     void merge(PackageInfo *, const PackageInfo *) { }
 };
 
+// The appdb-installed cache does not only hold the info.yaml manifests, but also the installation
+// reports of all installed packages. Each entry is one of the two, depending on the source file.
+struct InstalledPackageFile
+{
+    std::unique_ptr<PackageInfo> package;
+    std::unique_ptr<InstallationReport> report;
+};
+
+static const QString installationReportFileName = qSL(".installation-report.yaml");
+
+template<> class ConfigCacheAdaptor<InstalledPackageFile>
+{
+public:
+    InstalledPackageFile *loadFromSource(QIODevice *source, const QString &fileName)
+    {
+        auto ipf = std::make_unique<InstalledPackageFile>();
+        const QFileInfo fi(fileName);
+
+        if (fi.fileName() == installationReportFileName) {
+            // the package-id has to match the directory name, same as for the manifest
+            ipf->report = std::make_unique<InstallationReport>(fi.dir().dirName());
+            try {
+                ipf->report->deserialize(source);
+            } catch (const Exception &e) {
+                throw Exception("Failed to deserialize the installation report %1: %2")
+                        .arg(fileName).arg(e.errorString());
+            }
+        } else {
+            ipf->package.reset(YamlPackageScanner().scan(source, fileName));
+        }
+        return ipf.release();
+    }
+    InstalledPackageFile *loadFromCache(QDataStream &ds)
+    {
+        auto ipf = std::make_unique<InstalledPackageFile>();
+        bool isReport = false;
+        ds >> isReport;
+        if (isReport)
+            ipf->report.reset(InstallationReport::readFromDataStream(ds));
+        else
+            ipf->package.reset(PackageInfo::readFromDataStream(ds));
+        return (ipf->report || ipf->package) ? ipf.release() : nullptr;
+    }
+    void saveToCache(QDataStream &ds, const InstalledPackageFile *ipf)
+    {
+        ds << bool(ipf->report);
+        if (ipf->report)
+            ipf->report->writeToDataStream(ds);
+        else
+            ipf->package->writeToDataStream(ds);
+    }
+
+    void preProcessSourceContent(QByteArray &, const QString &) { }
+    void merge(InstalledPackageFile *, const InstalledPackageFile *) { }
+};
+
 
 PackageDatabase::PackageDatabase(const QStringList &builtInPackagesDirs,
                                  const QString &installedPackagesDir, const QString &installedPackagesMountPoint)
@@ -83,6 +139,13 @@ void PackageDatabase::enableSaveToCache()
     m_saveToCache = true;
 }
 
+void PackageDatabase::enableFullCacheVerification()
+{
+    if (m_parsed)
+        qCWarning(LogSystem) << "PackageDatabase cannot change the caching mode after the initial load";
+    m_fullCacheVerification = true;
+}
+
 bool PackageDatabase::builtInHasRemovableUpdate(PackageInfo *packageInfo) const
 {
     if (!packageInfo || packageInfo->isBuiltIn() || !m_installedPackages.contains(packageInfo))
@@ -153,6 +216,8 @@ void PackageDatabase::parse(PackageLocations packageLocations)
             cacheOptions |= AbstractConfigCache::ClearCache;
         if (!m_loadFromCache && !m_saveToCache)
             cacheOptions |= AbstractConfigCache::NoCache;
+        if (m_fullCacheVerification)
+            cacheOptions |= AbstractConfigCache::FullVerify;
 
         if ((packageLocations & Builtin) && !(m_parsedPackageLocations & Builtin)) {
             QStringList manifestFiles;
@@ -236,16 +301,24 @@ void PackageDatabase::parseInstalled()
 {
     Q_ASSERT(m_parsed && !(m_parsedPackageLocations & Installed));
 
-    QStringList manifestFiles = findManifestsInDir(m_installedPackagesDir, false);
+    const QStringList manifestFiles = findManifestsInDir(m_installedPackagesDir, false);
+
+    // the manifest and the installation report of each package are parsed and cached together
+    QStringList cacheFiles;
+    cacheFiles.reserve(manifestFiles.size() * 2);
+    for (const QString &manifestFile : manifestFiles)
+        cacheFiles << manifestFile << QFileInfo(manifestFile).dir().absoluteFilePath(installationReportFileName);
 
     AbstractConfigCache::Options cacheOptions = AbstractConfigCache::IgnoreBroken;
     if (!m_loadFromCache)
         cacheOptions |= AbstractConfigCache::ClearCache;
     if (!m_loadFromCache && !m_saveToCache)
         cacheOptions |= AbstractConfigCache::NoCache;
+    if (m_fullCacheVerification)
+        cacheOptions |= AbstractConfigCache::FullVerify;
 
-    ConfigCache<PackageInfo> cache(manifestFiles, qSL("appdb-installed"), { 'P','K','G','I' },
-                                   PackageInfo::dataStreamVersion(), cacheOptions);
+    ConfigCache<InstalledPackageFile> cache(cacheFiles, qSL("appdb-installed"), { 'P','K','G','I' },
+                                            PackageInfo::dataStreamVersion(), cacheOptions);
     cache.parse();
 
     for (int i = 0; i < manifestFiles.size(); ++i) {
@@ -253,7 +326,9 @@ void PackageDatabase::parseInstalled()
         QDir pkgDir = QFileInfo(manifestFile).dir();
 
         try {
-            std::unique_ptr<PackageInfo> pkg(cache.takeResult(i));
+            std::unique_ptr<InstalledPackageFile> manifest(cache.takeResult(i * 2));
+            std::unique_ptr<InstalledPackageFile> report(cache.takeResult(i * 2 + 1));
+            std::unique_ptr<PackageInfo> pkg(manifest ? manifest->package.release() : nullptr);
 
             if (!pkg) { // the YAML file was not parseable and we ignore broken manifests
                 qCWarning(LogSystem) << "The file" << manifestFile << "is not a valid manifest YAML"
@@ -266,19 +341,12 @@ void PackageDatabase::parseInstalled()
                                 " the same name as the package's id: found '%1'").arg(pkg->id());
             }
 
-            QFile f(pkgDir.absoluteFilePath(qSL(".installation-report.yaml")));
-            if (!f.open(QFile::ReadOnly))
-                throw Exception(f, "failed to open the installation report");
-
-            auto report = std::make_unique<InstallationReport>(pkg->id());
-            try {
-                report->deserialize(&f);
-            } catch (const Exception &e) {
-                throw Exception("Failed to deserialize the installation report %1: %2")
-                        .arg(f.fileName()).arg(e.errorString());
+            if (!report || !report->report) {
+                throw Exception("Failed to deserialize the installation report %1")
+                        .arg(pkgDir.absoluteFilePath(installationReportFileName));
             }
 
-            pkg->setInstallationReport(report.release());
+            pkg->setInstallationReport(report->report.release());
             pkg->setBaseDir(pkgDir.path());
             m_installedPackages.append(pkg.release());
 
@@ -33,6 +33,7 @@ public:
 
     void enableLoadFromCache();
     void enableSaveToCache();
+    void enableFullCacheVerification();
 
     void parse(PackageLocations packageLocations = All);
 
@@ -57,6 +58,7 @@ private:
 
     bool m_loadFromCache = false;
     bool m_saveToCache = false;
+    bool m_fullCacheVerification = false;
     bool m_parsed = false;
     QStringList m_builtInPackagesDirs;
     QString m_installedPackagesDir;
@@ -3,7 +3,6 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
 
 #include <QDataStream>
-#include <QBuffer>
 
 #include "packageinfo.h"
 #include "applicationinfo.h"
@@ -121,22 +120,17 @@ void PackageInfo::setInstallationReport(InstallationReport *report)
 
 quint32 PackageInfo::dataStreamVersion()
 {
-    return 3
+    return 4
            + (ApplicationInfo::dataStreamVersion() << 8)
-           + (IntentInfo::dataStreamVersion() << 16);
+           + (IntentInfo::dataStreamVersion() << 16)
+           + (InstallationReport::dataStreamVersion() << 24);
 }
 
 void PackageInfo::writeToDataStream(QDataStream &ds) const
 {
     //NOTE: increment dataStreamVersion() above, if you make any changes here
 
-    QByteArray serializedReport;
-
-    if (auto report = installationReport()) {
-        QBuffer buffer(&serializedReport);
-        buffer.open(QBuffer::WriteOnly);
-        report->serialize(&buffer);
-    }
+    const InstallationReport *report = installationReport();
 
     ds << m_id
        << m_names
@@ -146,7 +140,9 @@ void PackageInfo::writeToDataStream(QDataStream &ds) const
        << m_version
        << m_builtIn
        << m_baseDir.absolutePath()
-       << serializedReport;
+       << bool(report);
+    if (report)
+        report->writeToDataStream(ds);
 
     ds << int(m_applications.size());
     for (const auto &app : m_applications)
@@ -164,7 +160,7 @@ PackageInfo *PackageInfo::readFromDataStream(QDataStream &ds)
     std::unique_ptr<PackageInfo> pkg(new PackageInfo);
 
     QString baseDir;
-    QByteArray serializedReport;
+    bool hasReport = false;
 
     ds >> pkg->m_id
        >> pkg->m_names
@@ -174,19 +170,14 @@ PackageInfo *PackageInfo::readFromDataStream(QDataStream &ds)
        >> pkg->m_version
        >> pkg->m_builtIn
        >> baseDir
-       >> serializedReport;
+       >> hasReport;
 
     pkg->m_baseDir.setPath(baseDir);
 
-    if (!serializedReport.isEmpty()) {
-        QBuffer buffer(&serializedReport);
-        buffer.open(QBuffer::ReadOnly);
-        pkg->m_installationReport = std::make_unique<InstallationReport>(pkg->id());
-        try {
-            pkg->m_installationReport->deserialize(&buffer);
-        } catch (...) {
+    if (hasReport) {
+        pkg->m_installationReport.reset(InstallationReport::readFromDataStream(ds));
+        if (!pkg->m_installationReport || (pkg->m_installationReport->packageId() != pkg->id()))
             return nullptr;
-        }
     }
 
     int applicationsSize = 0;
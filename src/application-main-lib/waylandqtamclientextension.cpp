@@ -6,18 +6,25 @@
 #include "waylandqtamclientextension_p.h"
 
 #include <QWindow>
+#include <QQuickWindow>
 #include <QGuiApplication>
 #include <QEvent>
 #include <QExposeEvent>
 #include <qpa/qplatformnativeinterface.h>
 
 #include <QtAppManCommon/logging.h>
+#include <QtAppManSharedMain/waylandwindowproperties.h>
 
 QT_BEGIN_NAMESPACE_AM
 
 WaylandQtAMClientExtension::WaylandQtAMClientExtension()
-    : QWaylandClientExtensionTemplate(1)
+    : QWaylandClientExtensionTemplate(2)
 {
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(WaylandWindowProperties::MaximumCoalescingDelay);
+    connect(&m_flushTimer, &QTimer::timeout,
+            this, qOverload<>(&WaylandQtAMClientExtension::flushWindowProperties));
+
     qApp->installEventFilter(this);
 }
 
@@ -45,12 +52,22 @@ bool WaylandQtAMClientExtension::eventFilter(QObject *o, QEvent *e)
                        (QGuiApplication::platformNativeInterface()->nativeResourceForWindow("surface", window));
         if (surface) {
             m_windowToSurface.insert(window, surface);
-            const QVariantMap wp = windowProperties(window);
-            for (auto it = wp.cbegin(); it != wp.cend(); ++it)
-                sendPropertyToServer(surface, it.key(), it.value());
+            if (auto *quickWindow = qobject_cast<QQuickWindow *>(window)) {
+                // send all pending changes right before the window renders (and commits) its
+                // next frame
+                m_frameConnections.insert(window, connect(quickWindow, &QQuickWindow::afterAnimating,
+                                                          this, [this, window]() {
+                    flushWindowProperties(window);
+                }));
+            }
+            sendPropertiesToServer(surface, windowProperties(window));
         }
     } else if (e->type() == QEvent::Hide) {
-        m_windowToSurface.remove(qobject_cast<QWindow *>(o));
+        QWindow *window = qobject_cast<QWindow *>(o);
+        // the surface is still valid at this point
+        flushWindowProperties(window);
+        m_windowToSurface.remove(window);
+        disconnect(m_frameConnections.take(window));
     }
 
     return false;
@@ -61,29 +78,65 @@ QVariantMap WaylandQtAMClientExtension::windowProperties(QWindow *window) const
     return m_windowProperties.value(window);
 }
 
-void WaylandQtAMClientExtension::sendPropertyToServer(struct ::wl_surface *surface, const QString &name,
-                                                      const QVariant &value)
+void WaylandQtAMClientExtension::sendPropertiesToServer(struct ::wl_surface *surface,
+                                                        const QVariantMap &properties)
 {
-    QByteArray byteValue;
-    QDataStream ds(&byteValue, QDataStream::WriteOnly);
-    ds << value;
-    qCDebug(LogWaylandDebug) << "window property: client send:" << surface << name << value;
-    set_window_property(surface, name, byteValue);
+    if (qtam_extension_get_version(object()) >= QTAM_EXTENSION_SET_WINDOW_PROPERTIES_SINCE_VERSION) {
+        qCDebug(LogWaylandDebug) << "window properties: client send:" << surface << properties;
+        const auto batches = WaylandWindowProperties::serialize(properties);
+        for (const QByteArray &batch : batches)
+            set_window_properties(surface, batch);
+    } else {
+        // version 1 servers only understand single property updates
+        qCDebug(LogWaylandDebug) << "window property: client send:" << surface << properties;
+        const auto messages = WaylandWindowProperties::serializeSingle(properties);
+        for (const auto &[name, byteValue] : messages)
+            set_window_property(surface, name, byteValue);
+    }
 }
 
 bool WaylandQtAMClientExtension::setWindowProperty(QWindow *window, const QString &name, const QVariant &value)
 {
     if (setWindowPropertyHelper(window, name, value) && m_windowToSurface.contains(window)) {
-        auto surface = static_cast<struct ::wl_surface *>
-                       (QGuiApplication::platformNativeInterface()->nativeResourceForWindow("surface", window));
-        if (surface) {
-            sendPropertyToServer(surface, name, value);
-            return true;
-        }
+        m_pendingWindowProperties[window].insert(name, value);
+        if (!m_flushTimer.isActive())
+            m_flushTimer.start();
+        return true;
     }
     return false;
 }
 
+void WaylandQtAMClientExtension::flushWindowProperties()
+{
+    m_flushTimer.stop();
+    const auto windows = m_pendingWindowProperties.keys();
+    for (QWindow *window : windows)
+        flushWindowProperties(window);
+}
+
+void WaylandQtAMClientExtension::flushWindowProperties(QWindow *window)
+{
+    const QVariantMap properties = m_pendingWindowProperties.take(window);
+    if (properties.isEmpty() || !m_windowToSurface.contains(window))
+        return;
+
+    auto surface = static_cast<struct ::wl_surface *>
+                   (QGuiApplication::platformNativeInterface()->nativeResourceForWindow("surface", window));
+    if (surface)
+        sendPropertiesToServer(surface, properties);
+}
+
+void WaylandQtAMClientExtension::discardPendingWindowProperty(QWindow *window, const QString &name)
+{
+    // the server's value wins over a change that we have not sent yet
+    auto it = m_pendingWindowProperties.find(window);
+    if (it != m_pendingWindowProperties.end()) {
+        it.value().remove(name);
+        if (it.value().isEmpty())
+            m_pendingWindowProperties.erase(it);
+    }
+}
+
 bool WaylandQtAMClientExtension::setWindowPropertyHelper(QWindow *window, const QString &name, const QVariant &value)
 {
     auto it = m_windowProperties.find(window);
@@ -102,24 +155,40 @@ bool WaylandQtAMClientExtension::setWindowPropertyHelper(QWindow *window, const
 void WaylandQtAMClientExtension::clearWindowPropertyCache(QWindow *window)
 {
     m_windowProperties.remove(window);
+    m_pendingWindowProperties.remove(window);
 }
 
 void WaylandQtAMClientExtension::qtam_extension_window_property_changed(wl_surface *surface, const QString &name,
                                                                         wl_array *value)
 {
-    const QByteArray data = QByteArray::fromRawData(static_cast<char *>(value->data), int(value->size));
-    QDataStream ds(data);
-    QVariant variantValue;
-    ds >> variantValue;
+    const QVariant variantValue = WaylandWindowProperties::deserializeSingle(
+                QByteArray::fromRawData(static_cast<const char *>(value->data), qsizetype(value->size)));
 
     QWindow *window = m_windowToSurface.key(surface);
     qCDebug(LogWaylandDebug) << "window property: client receive" << window << name << variantValue;
     if (!window)
         return;
 
+    discardPendingWindowProperty(window, name);
     setWindowPropertyHelper(window, name, variantValue);
 }
 
+void WaylandQtAMClientExtension::qtam_extension_window_properties_changed(wl_surface *surface, wl_array *properties)
+{
+    const QVariantMap map = WaylandWindowProperties::deserialize(
+                QByteArray::fromRawData(static_cast<const char *>(properties->data), qsizetype(properties->size)));
+
+    QWindow *window = m_windowToSurface.key(surface);
+    qCDebug(LogWaylandDebug) << "window properties: client receive" << window << map;
+    if (!window)
+        return;
+
+    for (auto it = map.cbegin(); it != map.cend(); ++it) {
+        discardPendingWindowProperty(window, it.key());
+        setWindowPropertyHelper(window, it.key(), it.value());
+    }
+}
+
 QT_END_NAMESPACE_AM
 
 #include "moc_waylandqtamclientextension_p.cpp"
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <QVariantMap>
+#include <QTimer>
 #include <QtWaylandClient/QWaylandClientExtensionTemplate>
 #include "private/qwayland-qtam-extension.h"
 
@@ -47,11 +48,19 @@ protected:
 
 private:
     bool setWindowPropertyHelper(QWindow *window, const QString &name, const QVariant &value);
-    void sendPropertyToServer(::wl_surface *surface, const QString &name, const QVariant &value);
+    void discardPendingWindowProperty(QWindow *window, const QString &name);
+    void flushWindowProperties();
+    void flushWindowProperties(QWindow *window);
+    void sendPropertiesToServer(::wl_surface *surface, const QVariantMap &properties);
     void qtam_extension_window_property_changed(wl_surface *surface, const QString &name, wl_array *value) override;
+    void qtam_extension_window_properties_changed(wl_surface *surface, wl_array *properties) override;
 
     QMap<QWindow *, QVariantMap> m_windowProperties;
     QMap<QWindow *, ::wl_surface *> m_windowToSurface;
+    // changes that have not been sent to the server yet: coalesced until the next frame
+    QMap<QWindow *, QVariantMap> m_pendingWindowProperties;
+    QMap<QWindow *, QMetaObject::Connection> m_frameConnections;
+    QTimer m_flushTimer;
 };
 
 QT_END_NAMESPACE_AM
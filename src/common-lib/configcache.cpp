@@ -10,31 +10,66 @@
 #include <QCryptographicHash>
 #include <QElapsedTimer>
 #include <QBuffer>
+#include <QSaveFile>
+#include <QMutex>
+#include <QHash>
+#include <QThreadPool>
 #include <QtConcurrent/QtConcurrent>
+#include <qplatformdefs.h>
 
 #include "configcache.h"
 #include "configcache_p.h"
 #include "exception.h"
 #include "logging.h"
 
+#include <memory>
+
+#if defined(Q_OS_UNIX)
+#  include <unistd.h>
+#endif
+
 // use QtConcurrent to parse the files, if there are more than x files
 constexpr int AM_PARALLEL_THRESHOLD = 1;
 
 
 QT_BEGIN_NAMESPACE_AM
 
+QDataStream &operator>>(QDataStream &ds, ConfigCacheFileStat &st)
+{
+    ds >> st.inode >> st.size >> st.mtimeNs >> st.ctimeNs;
+    return ds;
+}
+
+QDataStream &operator<<(QDataStream &ds, const ConfigCacheFileStat &st)
+{
+    ds << st.inode << st.size << st.mtimeNs << st.ctimeNs;
+    return ds;
+}
+
 QDataStream &operator>>(QDataStream &ds, ConfigCacheEntry &ce)
 {
-    bool contentValid = false;
-    ds >> ce.filePath >> ce.checksum >> contentValid;
+    ds >> ce.filePath >> ce.checksum >> ce.stat >> ce.preProcessed;
     ce.rawContent.clear();
-    ce.content = contentValid ? reinterpret_cast<void *>(-1) : nullptr;
+    ce.content = nullptr;
+    ce.cachedRecord.clear();
     return ds;
 }
 
 QDataStream &operator<<(QDataStream &ds, const ConfigCacheEntry &ce)
 {
-    ds << ce.filePath << ce.checksum << static_cast<bool>(ce.content);
+    ds << ce.filePath << ce.checksum << ce.stat << ce.preProcessed;
+    return ds;
+}
+
+QDataStream &operator>>(QDataStream &ds, CacheRecord &cr)
+{
+    ds >> cr.offset >> cr.size;
+    return ds;
+}
+
+QDataStream &operator<<(QDataStream &ds, const CacheRecord &cr)
+{
+    ds << cr.offset << cr.size;
     return ds;
 }
 
@@ -53,12 +88,136 @@ QDataStream &operator<<(QDataStream &ds, const CacheHeader &ch)
 QDebug operator<<(QDebug dbg, const ConfigCacheEntry &ce)
 {
     dbg << "CacheEntry {\n  " << ce.filePath << "\n  " << ce.checksum.toHex() << "\n  valid:"
-        << (ce.content ? "yes" : "no") << ce.content
+        << (ce.hasContent() ? "yes" : "no") << ce.content
         << "\n}\n";
     return dbg;
 }
 
 
+/*! \internal
+    Returns the file system meta-data for \a filePath, which is used to detect modifications without
+    having to read the file. Files in Qt resources cannot be stat'ed: an invalid result is returned
+    in this case and also if the file cannot be accessed.
+*/
+static ConfigCacheFileStat statFile(const QString &filePath)
+{
+    ConfigCacheFileStat st;
+    if (filePath.isEmpty() || filePath.startsWith(qL1C(':')))
+        return st;
+
+#if defined(Q_OS_UNIX)
+    QT_STATBUF statBuffer;
+    if (QT_STAT(QFile::encodeName(filePath).constData(), &statBuffer) != 0)
+        return st;
+
+    st.inode = quint64(statBuffer.st_ino);
+    st.size = qint64(statBuffer.st_size);
+#  if defined(Q_OS_DARWIN)
+    st.mtimeNs = qint64(statBuffer.st_mtimespec.tv_sec) * 1000000000 + statBuffer.st_mtimespec.tv_nsec;
+    st.ctimeNs = qint64(statBuffer.st_ctimespec.tv_sec) * 1000000000 + statBuffer.st_ctimespec.tv_nsec;
+#  else
+    st.mtimeNs = qint64(statBuffer.st_mtim.tv_sec) * 1000000000 + statBuffer.st_mtim.tv_nsec;
+    st.ctimeNs = qint64(statBuffer.st_ctim.tv_sec) * 1000000000 + statBuffer.st_ctim.tv_nsec;
+#  endif
+#else
+    const QFileInfo fi(filePath);
+    if (!fi.exists())
+        return st;
+
+    st.size = fi.size();
+    st.mtimeNs = fi.lastModified().toMSecsSinceEpoch() * 1000000;
+    st.ctimeNs = fi.metadataChangeTime().toMSecsSinceEpoch() * 1000000;
+#endif
+    return st;
+}
+
+namespace {
+struct PendingWrites
+{
+    PendingWrites()
+    {
+        // a single thread makes sure that writes to the same file are done in order
+        pool.setMaxThreadCount(1);
+    }
+
+    QMutex mutex;
+    QHash<QString, QFuture<bool>> futures; // cache file path -> write job
+    AbstractConfigCache::BackgroundWriteNotifier notifier;
+    QThreadPool pool; // needs to be destroyed first, as its jobs are accessing the members above
+};
+}
+
+Q_GLOBAL_STATIC(PendingWrites, pendingWrites)
+
+// make sure we are not reading a cache file that is still being written by a worker thread
+static void waitForPendingWrite(const QString &cacheFilePath)
+{
+    QFuture<bool> future;
+    {
+        QMutexLocker locker(&pendingWrites()->mutex);
+        future = pendingWrites()->futures.value(cacheFilePath);
+    }
+    future.waitForFinished();
+}
+
+/*! \internal
+    Writes the concatenation of all \a records to \a cacheFilePath on a worker thread. The data is
+    written to a temporary file first, which is then synced to disk and atomically renamed: a crash
+    or power loss during the write can never leave a truncated cache file behind.
+*/
+static QFuture<bool> writeCacheFileInBackground(const QString &cacheFilePath, const QString &cacheBaseName,
+                                                const QVector<QByteArray> &records)
+{
+    QMutexLocker locker(&pendingWrites()->mutex);
+
+    QFuture<bool> future = QtConcurrent::run(&pendingWrites()->pool, [=]() -> bool {
+        QElapsedTimer timer;
+        timer.start();
+        bool success = false;
+
+        try {
+            QSaveFile file(cacheFilePath);
+            if (!file.open(QIODevice::WriteOnly))
+                throw Exception(file, "failed to open file for writing");
+
+            for (const QByteArray &record : std::as_const(records)) {
+                if (file.write(record) != record.size())
+                    throw Exception(file, "error writing content");
+            }
+            // this does an fsync() before renaming the temporary file
+            if (!file.commit())
+                throw Exception(file, "failed to commit file");
+
+#if defined(Q_OS_UNIX)
+            // also persist the rename itself
+            int dirFd = QT_OPEN(QFile::encodeName(QFileInfo(cacheFilePath).absolutePath()).constData(), O_RDONLY);
+            if (dirFd >= 0) {
+                ::fsync(dirFd);
+                QT_CLOSE(dirFd);
+            }
+#endif
+            success = true;
+        } catch (const Exception &e) {
+            qCWarning(LogCache) << "Failed to write Cache:" << e.what();
+        }
+
+        const qint64 usecs = timer.nsecsElapsed() / 1000;
+        qCDebug(LogCache) << cacheBaseName << "writing the cache in the background finished after"
+                          << usecs << "usec";
+
+        QMutexLocker locker(&pendingWrites()->mutex);
+        if (pendingWrites()->notifier)
+            pendingWrites()->notifier(cacheBaseName, usecs, success);
+        return success;
+    });
+
+    // finished writes do not need to be waited for anymore: without pruning them here, every
+    // cache file ever written would keep an entry in this hash for the lifetime of the process
+    pendingWrites()->futures.removeIf([](const auto &it) { return it.value().isFinished(); });
+    pendingWrites()->futures.insert(cacheFilePath, future);
+    return future;
+}
+
 static quint32 makeTypeId(const std::array<char, 4> &typeIdStr)
 {
     return (quint32(typeIdStr[0])) | (quint32(typeIdStr[1]) << 8)
@@ -71,8 +230,7 @@ bool CacheHeader::isValid(const QString &baseName, quint32 typeId, quint32 typeV
             && version == Version
             && this->typeId == typeId
             && this->typeVersion == typeVersion
-            && this->baseName == baseName
-            && entries < 1000;
+            && this->baseName == baseName;
 }
 
 
@@ -101,20 +259,81 @@ void *AbstractConfigCache::takeMergedResult() const
     return result;
 }
 
-void *AbstractConfigCache::takeResult(int index) const
+void *AbstractConfigCache::takeResult(int index)
 {
     Q_ASSERT(!(d->options & MergedResult));
     void *result = nullptr;
-    if (index >= 0 && index < d->cache.size())
-        std::swap(result, d->cache[index].content);
+    if (index >= 0 && index < d->cache.size()) {
+        ConfigCacheEntry &ce = d->cache[index];
+
+        if (!ce.content && !ce.cachedRecord.isEmpty() && !loadCachedRecord(ce)) {
+            qCWarning(LogCache) << "Failed to read cache record for" << ce.filePath
+                                << "- parsing the file instead";
+
+            // make sure that the broken cache file is not used again
+            const QString cacheFile = cacheFilePath();
+            waitForPendingWrite(cacheFile);
+            QFile::remove(cacheFile);
+
+            try {
+                readSourceFile(ce);
+                QBuffer buffer(&ce.rawContent);
+                buffer.open(QIODevice::ReadOnly);
+                ce.content = loadFromSource(&buffer, ce.filePath);
+            } catch (const Exception &e) {
+                if (!d->options.testFlag(IgnoreBroken))
+                    throw Exception("Could not parse file '%1': %2").arg(ce.filePath).arg(e.errorString());
+                qCWarning(LogCache, "Could not parse file '%s': %s (file will be ignored)",
+                          qPrintable(ce.filePath), qPrintable(e.errorString()));
+            }
+        }
+        std::swap(result, ce.content);
+    }
     return result;
 }
 
-void *AbstractConfigCache::takeResult(const QString &rawFile) const
+void *AbstractConfigCache::takeResult(const QString &rawFile)
 {
     return takeResult(d->cacheIndex.value(rawFile, -1));
 }
 
+/*! \internal
+    Deserializes the content of \a ce from its record in the cache file, if this did not happen
+    yet. Returns the content, or \c nullptr if the record was broken.
+*/
+void *AbstractConfigCache::loadCachedRecord(ConfigCacheEntry &ce)
+{
+    if (!ce.content && !ce.cachedRecord.isEmpty()) {
+        QDataStream ds(ce.cachedRecord);
+        void *content = loadFromCache(ds);
+        if (content && (ds.status() == QDataStream::Ok))
+            ce.content = content;
+        else
+            destruct(content);
+        ce.cachedRecord.clear();
+    }
+    return ce.content;
+}
+
+/*! \internal
+    Reads the source file of \a ce into its rawContent and pre-processes it.
+*/
+void AbstractConfigCache::readSourceFile(ConfigCacheEntry &ce)
+{
+    QFile file(ce.filePath);
+    if (!file.open(QIODevice::ReadOnly))
+        throw Exception("Failed to open file '%1' for reading.\n").arg(file.fileName());
+
+    // installation reports list all files of a package, so they can get quite big
+    if (file.size() > 2*1024*1024)
+        throw Exception("File '%1' is too big (> 2MB).\n").arg(file.fileName());
+
+    const QByteArray fileContent = file.readAll();
+    ce.rawContent = fileContent;
+    preProcessSourceContent(ce.rawContent, ce.filePath);
+    ce.preProcessed = (ce.rawContent != fileContent);
+}
+
 void AbstractConfigCache::parse()
 {
     clear();
@@ -126,34 +345,70 @@ void AbstractConfigCache::parse()
     if (LogCache().isDebugEnabled())
         timer.start();
 
+    const bool ignoreBroken = d->options.testFlag(IgnoreBroken);
+
     // normalize all yaml file names
     QStringList rawFilePaths;
     for (const auto &rawFile : std::as_const(d->rawFiles)) {
-        const auto path = QFileInfo(rawFile).canonicalFilePath();
-        if (path.isEmpty())
-            throw Exception("file %1 does not exist").arg(rawFile);
+        auto path = QFileInfo(rawFile).canonicalFilePath();
+        if (path.isEmpty()) {
+            if (!ignoreBroken)
+                throw Exception("file %1 does not exist").arg(rawFile);
+            // this will fail to be read below and then be ignored
+            path = QFileInfo(rawFile).absoluteFilePath();
+        }
         if (rawFilePaths.contains(path))
             throw Exception("duplicate files are not allowed - found %1 at least two times").arg(path);
         rawFilePaths << path;
     }
 
     QFile cacheFile(cacheFilePath());
+    waitForPendingWrite(cacheFile.fileName());
 
     QAtomicInt cacheIsValid = false;
     QAtomicInt cacheIsComplete = false;
+    QAtomicInt statMatchCount = 0;
+
+    // Source files that have been modified after the cache was written are always hashed: this
+    // way we are not fooled by file systems with a coarse timestamp resolution, where a file can
+    // be changed within the same tick the cache was written in (same as git's "racy clean" check)
+    qint64 cacheFileMTimeNs = 0;
 
     QVector<ConfigCacheEntry> cache;
     void *mergedContent = nullptr;
 
     qCDebug(LogCache) << d->cacheBaseName << "cache file:" << cacheFile.fileName();
     qCDebug(LogCache) << d->cacheBaseName << "read cache?" << ((d->options & (ClearCache | NoCache)) ? "no" : "yes")
-                      << "/ write cache?" << ((d->options & NoCache) ? "no" : "yes");
+                      << "/ write cache?" << ((d->options & NoCache) ? "no" : "yes")
+                      << "/ full verify?" << ((d->options & FullVerify) ? "yes" : "no");
     qCDebug(LogCache) << d->cacheBaseName << "reading:" << rawFilePaths;
 
     if (!d->options.testFlag(NoCache) && !d->options.testFlag(ClearCache)) {
-        if (cacheFile.open(QFile::ReadOnly)) {
+        std::unique_ptr<QFile> mappedCacheFile(new QFile(cacheFile.fileName()));
+        if (mappedCacheFile->open(QFile::ReadOnly)) {
             try {
-                QDataStream ds(&cacheFile);
+                cacheFileMTimeNs = statFile(cacheFile.fileName()).mtimeNs;
+
+                // The cache file is mapped into memory if possible and stays mapped until clear()
+                // is called: only the index is read here, while the content records are
+                // deserialized directly from the page cache when they are first needed (see
+                // takeResult()). A background write can still replace the file while it is
+                // mapped, but this is not possible on Windows, so we just read it there.
+                QByteArray cacheData;
+                const qint64 cacheFileSize = mappedCacheFile->size();
+                bool mapped = false;
+                if (cacheFileSize > 0) {
+#if defined(Q_OS_UNIX)
+                    if (const uchar *data = mappedCacheFile->map(0, cacheFileSize)) {
+                        cacheData = QByteArray::fromRawData(reinterpret_cast<const char *>(data), qsizetype(cacheFileSize));
+                        mapped = true;
+                    }
+#endif
+                    if (!mapped)
+                        cacheData = mappedCacheFile->readAll();
+                }
+
+                QDataStream ds(cacheData);
                 CacheHeader cacheHeader;
                 ds >> cacheHeader;
 
@@ -161,30 +416,55 @@ void AbstractConfigCache::parse()
                     throw Exception("failed to read cache header");
                 if (!cacheHeader.isValid(d->cacheBaseName, d->typeId, d->typeVersion))
                     throw Exception("failed to parse cache header");
+                // a corrupt entry count must not make us allocate huge amounts of memory below
+                const qint64 remainingSize = cacheData.size() - ds.device()->pos();
+                if (quint64(cacheHeader.entries) * MinimumIndexEntrySize > quint64(remainingSize))
+                    throw Exception("failed to parse cache header");
+
+                // read the index: all the entries' meta-data and the location of their content
+                QVector<CacheRecord> records(int(cacheHeader.entries));
+                CacheRecord mergedRecord;
 
                 cache.resize(int(cacheHeader.entries));
-                for (int i = 0; i < int(cacheHeader.entries); ++i) {
-                    ConfigCacheEntry &ce = cache[i];
-                    ds >> ce;
-                    if (ce.content)
-                        ce.content = loadFromCache(ds);
-                }
-                if (d->options & MergedResult) {
-                    bool hasMerged = false;
-                    ds >> hasMerged;
-                    if (hasMerged)
-                        mergedContent = loadFromCache(ds);
+                for (int i = 0; i < int(cacheHeader.entries); ++i)
+                    ds >> cache[i] >> records[i];
+                if (d->options & MergedResult)
+                    ds >> mergedRecord;
+
+                if (ds.status() != QDataStream::Ok)
+                    throw Exception("failed to read cache index (%1)").arg(ds.status());
+
+                const qint64 dataStart = ds.device()->pos();
+                const qint64 dataSize = cacheData.size() - dataStart;
 
+                auto recordData = [&cacheData, dataStart, dataSize](const CacheRecord &record) {
+                    if ((record.offset > quint64(dataSize)) || (record.size > (quint64(dataSize) - record.offset)))
+                        throw Exception("cache record is out of bounds");
+                    return QByteArray::fromRawData(cacheData.constData() + dataStart + qint64(record.offset),
+                                                   qsizetype(record.size));
+                };
+
+                // the entries just reference their records, which are decoded on first use
+                for (int i = 0; i < cache.size(); ++i)
+                    cache[i].cachedRecord = recordData(records.at(i));
+
+                if (d->options & MergedResult) {
+                    // the merged result is always needed as a whole
+                    if (mergedRecord.size) {
+                        QDataStream rds(recordData(mergedRecord));
+                        mergedContent = loadFromCache(rds);
+                        if (rds.status() != QDataStream::Ok) {
+                            destruct(mergedContent);
+                            mergedContent = nullptr;
+                        }
+                    }
                     if (!mergedContent)
                         throw Exception("failed to read merged cache content");
                 }
 
-                if (ds.status() != QDataStream::Ok)
-                    throw Exception("failed to read cache content (%1)").arg(ds.status());
-
                 cacheIsValid = true;
 
-                qCDebug(LogCache) << d->cacheBaseName << "loaded" << cache.size() << "entries in"
+                qCDebug(LogCache) << d->cacheBaseName << "indexed" << cache.size() << "entries in"
                                   << timer.nsecsElapsed() / 1000 << "usec";
 
                 // check if we can use the cache as-is, or if we need to cherry-pick parts
@@ -194,16 +474,22 @@ void AbstractConfigCache::parse()
                     for (int i = 0; i < rawFilePaths.count(); ++i) {
                         const ConfigCacheEntry &ce = cache.at(i);
 
-                        if ((rawFilePaths.at(i) != ce.filePath) || !ce.content)
+                        if ((rawFilePaths.at(i) != ce.filePath) || !ce.hasContent())
                             cacheIsComplete = false;
                     }
                 }
                 d->cacheWasRead = true;
 
+                // the records are referencing this data
+                d->cacheData = cacheData;
+                if (mapped)
+                    d->mappedCacheFile = std::move(mappedCacheFile);
+
             } catch (const Exception &e) {
+                // none of the records can be used
+                cache.clear();
                 qWarning(LogCache) << "Failed to read cache:" << e.what();
             }
-            cacheFile.close();
         }
     } else if (d->options.testFlag(ClearCache)) {
         cacheFile.remove();
@@ -228,7 +514,7 @@ void AbstractConfigCache::parse()
             // if we already got this file in the cache, then use the entry
             bool found = false;
             for (const auto &c : std::as_const(cache)) {
-                if ((c.filePath == rawFilePath) && c.content) {
+                if ((c.filePath == rawFilePath) && c.hasContent()) {
                     ce = c;
                     found = true;
                     qCDebug(LogCache) << d->cacheBaseName << "found cache entry for" << c.filePath;
@@ -245,27 +531,55 @@ void AbstractConfigCache::parse()
         cache = newCache;
     }
 
+    const bool fullVerify = d->options.testFlag(FullVerify);
+
     // reads a single config file and calculates its hash - defined as lambda to be usable
     // both via QtConcurrent and via std:for_each
-    auto readConfigFile = [&cacheIsComplete, this](ConfigCacheEntry &ce) {
-        QFile file(ce.filePath);
-        if (!file.open(QIODevice::ReadOnly))
-            throw Exception("Failed to open file '%1' for reading.\n").arg(file.fileName());
-
-        if (file.size() > 1024*1024)
-            throw Exception("File '%1' is too big (> 1MB).\n").arg(file.fileName());
-
-        ce.rawContent = file.readAll();
-        preProcessSourceContent(ce.rawContent, ce.filePath);
+    auto readConfigFile = [&cacheIsComplete, &statMatchCount, cacheFileMTimeNs, fullVerify, ignoreBroken,
+                           this](ConfigCacheEntry &ce) {
+        // the stat has to happen before reading the file: if the file gets modified in between,
+        // we will just end up with a mismatch on the next run
+        const ConfigCacheFileStat st = statFile(ce.filePath);
+
+        // if the file's meta-data did not change since we cached it, we can skip reading and
+        // hashing it altogether. This is not possible for pre-processed files though, as their
+        // content might depend on the environment (e.g. variable substitutions).
+        if (!fullVerify && ce.hasContent() && !ce.preProcessed && !ce.checksum.isEmpty()
+                && st.isValid() && (st == ce.stat)
+                && (st.mtimeNs < cacheFileMTimeNs) && (st.ctimeNs < cacheFileMTimeNs)) {
+            ce.checksumMatches = true;
+            ++statMatchCount;
+            return;
+        }
+        ce.stat = st;
+        ce.unreadable = false;
+
+        try {
+            readSourceFile(ce);
+        } catch (const Exception &e) {
+            if (!ignoreBroken)
+                throw;
+            qCWarning(LogCache, "Could not read file '%s': %s (file will be ignored)",
+                      qPrintable(ce.filePath), qPrintable(e.errorString().trimmed()));
+            destruct(ce.content);
+            ce.content = nullptr;
+            ce.cachedRecord.clear();
+            ce.rawContent.clear();
+            ce.checksum.clear();
+            ce.unreadable = true;
+            cacheIsComplete = false;
+            return;
+        }
 
         QByteArray checksum = QCryptographicHash::hash(ce.rawContent, QCryptographicHash::Sha1);
         ce.checksumMatches = (checksum == ce.checksum);
         ce.checksum = checksum;
         if (!ce.checksumMatches) {
-            if (ce.content) {
+            if (ce.hasContent()) {
                 qWarning(LogCache) << "Failed to read Cache: cached file checksums do not match";
                 destruct(ce.content);
                 ce.content = nullptr;
+                ce.cachedRecord.clear();
             }
             cacheIsComplete = false;
         }
@@ -279,6 +593,8 @@ void AbstractConfigCache::parse()
 
     qCDebug(LogCache) << d->cacheBaseName << "reading all of" << cache.size() << "file(s) finished after"
                       << (timer.nsecsElapsed() / 1000) << "usec";
+    qCDebug(LogCache) << d->cacheBaseName << "verified" << statMatchCount.loadAcquire()
+                      << "file(s) via their meta-data only";
     qCDebug(LogCache) << d->cacheBaseName << "still complete:" << (cacheIsComplete ? "yes" : "no");
 
     if (!cacheIsComplete) {
@@ -290,12 +606,22 @@ void AbstractConfigCache::parse()
 
         QAtomicInt count;
 
-        auto parseConfigFile = [this, &count](ConfigCacheEntry &ce) {
-            if (ce.content)
+        const bool mergedResult = d->options.testFlag(MergedResult);
+
+        auto parseConfigFile = [this, &count, mergedResult](ConfigCacheEntry &ce) {
+            // merging needs the actual content of all files
+            if (mergedResult)
+                loadCachedRecord(ce);
+            if (ce.hasContent() || ce.unreadable)
                 return;
 
             ++count;
             try {
+                // files verified via their meta-data have not been read, but their cache
+                // record might have turned out to be broken
+                if (ce.rawContent.isEmpty())
+                    readSourceFile(ce);
+
                 QBuffer buffer(&ce.rawContent);
                 buffer.open(QIODevice::ReadOnly);
                 ce.content = loadFromSource(&buffer, ce.filePath);
@@ -336,12 +662,32 @@ void AbstractConfigCache::parse()
         if (!d->options.testFlag(NoCache)) {
             // everything is parsed now, so we can write a new cache file
 
-            try {
-                QFile newCacheFile(cacheFile.fileName());
-                if (!newCacheFile.open(QFile::WriteOnly | QFile::Truncate))
-                    throw Exception(cacheFile, "failed to open file for writing");
+            // The content has to be serialized right here, since the caller will take ownership
+            // of it after parse() returns. Only the actual file I/O is done in the background.
+            auto serializeContent = [this](const void *content) {
+                QByteArray data;
+                if (content) {
+                    QDataStream rds(&data, QIODevice::WriteOnly);
+                    saveToCache(rds, content);
+                }
+                return data;
+            };
 
-                QDataStream ds(&newCacheFile);
+            QVector<QByteArray> records;
+            records.reserve(cache.size() + 2);
+            records << QByteArray(); // placeholder for the header and index
+            for (const ConfigCacheEntry &ce : std::as_const(cache)) {
+                // records that have not been decoded yet can be copied as-is
+                if (ce.content || ce.cachedRecord.isEmpty())
+                    records << serializeContent(ce.content);
+                else
+                    records << QByteArray(ce.cachedRecord.constData(), ce.cachedRecord.size());
+            }
+            if (d->options & MergedResult)
+                records << serializeContent(mergedContent);
+
+            {
+                QDataStream ds(&records.first(), QIODevice::WriteOnly);
                 CacheHeader cacheHeader;
                 cacheHeader.baseName = d->cacheBaseName;
                 cacheHeader.typeId = d->typeId;
@@ -349,27 +695,20 @@ void AbstractConfigCache::parse()
                 cacheHeader.entries = quint32(cache.size());
                 ds << cacheHeader;
 
-                for (const ConfigCacheEntry &ce : std::as_const(cache)) {
-                    ds << ce;
-                    // qCDebug(LogCache) << "SAVING" << ce << ce.content;
-                    if (ce.content)
-                        saveToCache(ds, ce.content);
+                quint64 offset = 0;
+                for (int i = 0; i < cache.size(); ++i) {
+                    const CacheRecord record { offset, quint64(records.at(i + 1).size()) };
+                    ds << cache.at(i) << record;
+                    offset += record.size;
                 }
+                if (d->options & MergedResult)
+                    ds << CacheRecord { offset, quint64(records.constLast().size()) };
+            }
 
-                if (d->options & MergedResult) {
-                    ds << bool(mergedContent);
-                    if (mergedContent)
-                        saveToCache(ds, mergedContent);
-                }
+            d->cacheWriteFuture = writeCacheFileInBackground(cacheFile.fileName(), d->cacheBaseName, records);
+            d->cacheWriteScheduled = true;
 
-                if (ds.status() != QDataStream::Ok)
-                    throw Exception("error writing content");
-
-                d->cacheWasWritten = true;
-            } catch (const Exception &e) {
-                qCWarning(LogCache) << "Failed to write Cache:" << e.what();
-            }
-            qCDebug(LogCache) << d->cacheBaseName << "writing the cache finished after"
+            qCDebug(LogCache) << d->cacheBaseName << "scheduling the cache write finished after"
                               << (timer.nsecsElapsed() / 1000) << "usec";
         }
     }
@@ -377,6 +716,7 @@ void AbstractConfigCache::parse()
     d->cache = cache;
     if (d->options & MergedResult)
         d->mergedContent = mergedContent;
+    d->hashedFileCount = int(cache.size()) - statMatchCount.loadAcquire();
 
     qCDebug(LogCache) << d->cacheBaseName << "finished cache parsing after"
                       << (timer.nsecsElapsed() / 1000) << "usec";
@@ -387,11 +727,16 @@ void AbstractConfigCache::clear()
     for (auto &ce : std::as_const(d->cache))
         destruct(ce.content);
     d->cache.clear();
+    // the records are not referenced anymore: this unmaps the cache file
+    d->cacheData.clear();
+    d->mappedCacheFile.reset();
     d->cacheIndex.clear();
     destruct(d->mergedContent);
     d->mergedContent = nullptr;
     d->cacheWasRead = false;
-    d->cacheWasWritten = false;
+    d->cacheWriteScheduled = false;
+    d->cacheWriteFuture = QFuture<bool>();
+    d->hashedFileCount = 0;
 }
 
 bool AbstractConfigCache::parseReadFromCache() const
@@ -399,9 +744,32 @@ bool AbstractConfigCache::parseReadFromCache() const
     return d->cacheWasRead;
 }
 
+int AbstractConfigCache::parseHashedFiles() const
+{
+    return d->hashedFileCount;
+}
+
 bool AbstractConfigCache::parseWroteToCache() const
 {
-    return d->cacheWasWritten;
+    // the cache is written asynchronously, so we need to wait for the result here
+    return d->cacheWriteScheduled && d->cacheWriteFuture.result();
+}
+
+void AbstractConfigCache::setBackgroundWriteNotifier(const BackgroundWriteNotifier &notifier)
+{
+    QMutexLocker locker(&pendingWrites()->mutex);
+    pendingWrites()->notifier = notifier;
+}
+
+void AbstractConfigCache::waitForBackgroundWrites()
+{
+    QList<QFuture<bool>> futures;
+    {
+        QMutexLocker locker(&pendingWrites()->mutex);
+        futures = pendingWrites()->futures.values();
+    }
+    for (auto &future : futures)
+        future.waitForFinished();
 }
 
 QString AbstractConfigCache::cacheFilePath() const
@@ -17,6 +17,7 @@
 QT_BEGIN_NAMESPACE_AM
 
 class ConfigCachePrivate;
+struct ConfigCacheEntry;
 
 template <typename T> class ConfigCacheAdaptor
 {
@@ -36,6 +37,7 @@ public:
         NoCache       = 0x2,
         ClearCache    = 0x4,
         IgnoreBroken  = 0x8,
+        FullVerify    = 0x10,
     };
     Q_DECLARE_FLAGS(Options, Option)
 
@@ -46,16 +48,23 @@ public:
     virtual void parse();
 
     void *takeMergedResult() const;
-    void *takeResult(int index) const;
-    void *takeResult(const QString &rawFile) const;
+    void *takeResult(int index);
+    void *takeResult(const QString &rawFile);
 
     void clear();
 
     // mainly for debugging and auto tests
     bool parseReadFromCache() const;
     bool parseWroteToCache() const;
+    int parseHashedFiles() const;
     QString cacheFilePath() const;
 
+    // Cache files are written asynchronously on a worker thread. The notifier is called on that
+    // thread after each write, with the time it took in usec.
+    using BackgroundWriteNotifier = std::function<void(const QString &cacheBaseName, qint64 usecs, bool success)>;
+    static void setBackgroundWriteNotifier(const BackgroundWriteNotifier &notifier);
+    static void waitForBackgroundWrites();
+
 protected:
     virtual void *loadFromSource(QIODevice *source, const QString &fileName) = 0;
     virtual void preProcessSourceContent(QByteArray &sourceContent, const QString &fileName) = 0;
@@ -66,6 +75,9 @@ protected:
     virtual void destruct(void *t) = 0;
 
 private:
+    void *loadCachedRecord(ConfigCacheEntry &ce);
+    void readSourceFile(ConfigCacheEntry &ce);
+
     Q_DISABLE_COPY_MOVE(AbstractConfigCache)
 
     ConfigCachePrivate *d;
@@ -96,11 +108,11 @@ public:
     {
         return static_cast<T *>(AbstractConfigCache::takeMergedResult());
     }
-    T *takeResult(int index) const
+    T *takeResult(int index)
     {
         return static_cast<T *>(AbstractConfigCache::takeResult(index));
     }
-    T *takeResult(const QString &yamlFile) const
+    T *takeResult(const QString &yamlFile)
     {
         return static_cast<T *>(AbstractConfigCache::takeResult(yamlFile));
     }
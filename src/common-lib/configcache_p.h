@@ -4,23 +4,49 @@
 
 #pragma once
 
+#include <memory>
+#include <QtCore/QFuture>
+#include <QtCore/QFile>
+
 #include "configcache.h"
 
 QT_BEGIN_NAMESPACE_AM
 
+struct ConfigCacheFileStat
+{
+    quint64 inode = 0;
+    qint64 size = -1;
+    qint64 mtimeNs = 0;
+    qint64 ctimeNs = 0;
+
+    bool isValid() const { return size >= 0; }
+    bool operator==(const ConfigCacheFileStat &other) const
+    {
+        return (inode == other.inode) && (size == other.size)
+                && (mtimeNs == other.mtimeNs) && (ctimeNs == other.ctimeNs);
+    }
+    bool operator!=(const ConfigCacheFileStat &other) const { return !(*this == other); }
+};
+
 struct ConfigCacheEntry
 {
     QString filePath;    // abs. file path
     QByteArray checksum; // sha1 (fast and sufficient for this use-case)
+    ConfigCacheFileStat stat; // file meta-data at the time the checksum was calculated
+    bool preProcessed = false; // content was modified by preProcessSourceContent()
     QByteArray rawContent;  // raw YAML content
     void *content = nullptr;  // parsed YAML content
+    QByteArray cachedRecord; // serialized content in the cache file, if not deserialized yet
     bool checksumMatches = false;
+    bool unreadable = false; // the file could not be read, but broken files are ignored
+
+    bool hasContent() const { return content || !cachedRecord.isEmpty(); }
 };
 
 struct CacheHeader
 {
     enum { Magic = 0x23d39366, // dd if=/dev/random bs=4 count=1 status=none | xxd -p
-           Version = 3 | (QT_VERSION_MAJOR << 24) };
+           Version = 5 | (QT_VERSION_MAJOR << 24) };
 
     quint32 magic = Magic;
     quint32 version = Version;
@@ -32,6 +58,22 @@ struct CacheHeader
     bool isValid(const QString &baseName, quint32 typeId = 0, quint32 typeVersion = 0) const;
 };
 
+// The cache file consists of the CacheHeader, followed by an index of all ConfigCacheEntry
+// meta-data, each one followed by a CacheRecord pointing to the entry's serialized content.
+// For merged caches, one more CacheRecord for the merged content follows. The offsets are
+// relative to the end of the index, where all the content records are stored back to back.
+// This way, each record can be deserialized independently and on demand from the mapped file.
+struct CacheRecord
+{
+    quint64 offset = 0;
+    quint64 size = 0; // 0 means: no content
+};
+
+// The smallest possible serialization of one index entry (empty strings, no checksum), used to
+// validate the entry count in the header against the size of the cache file:
+// ConfigCacheEntry (4 + 4 + 32 + 1 bytes) + CacheRecord (16 bytes)
+static constexpr quint64 MinimumIndexEntrySize = 57;
+
 class ConfigCachePrivate
 {
 public:
@@ -44,7 +86,12 @@ public:
     QMap<QString, int> cacheIndex;
     void *mergedContent = nullptr;
     bool cacheWasRead = false;
-    bool cacheWasWritten = false;
+    bool cacheWriteScheduled = false;
+    int hashedFileCount = 0; // files that had to be read, because their meta-data did not match
+    QFuture<bool> cacheWriteFuture;
+    // the (mapped) content of the cache file, referenced by the entries' cachedRecords
+    QByteArray cacheData;
+    std::unique_ptr<QFile> mappedCacheFile;
 };
 
 QT_END_NAMESPACE_AM
@@ -0,0 +1,223 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QTimerEvent>
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "timerwheel.h"
+
+QT_BEGIN_NAMESPACE_AM
+
+// Level L of the wheel holds all timeouts that expire within the next SlotCount^(L+1) ticks.
+// Whenever the current tick crosses a slot boundary of level L (L > 0), the timeouts in the
+// corresponding slot are re-inserted (cascaded) into the lower levels. Timeouts that are even
+// farther in the future are parked in the last slot of the highest level and get re-inserted
+// from there.
+// The underlying timer does not tick continuously: it is always started to fire at the next
+// tick that actually has work to do (either expired timeouts or a non-empty cascade).
+
+static QPointer<TimerWheel> s_instance;
+
+TimerWheel::TimerWheel(QObject *parent)
+    : QObject(parent)
+{
+    m_clock.start();
+}
+
+TimerWheel::~TimerWheel()
+{
+    if (s_instance == this)
+        s_instance = nullptr;
+}
+
+TimerWheel *TimerWheel::instance()
+{
+    if (!s_instance) {
+        auto app = QCoreApplication::instance();
+        Q_ASSERT(!app || (QThread::currentThread() == app->thread()));
+        s_instance = new TimerWheel(app);
+    }
+    return s_instance;
+}
+
+TimerWheel::TimerId TimerWheel::start(int msec, QObject *context, const std::function<void()> &callback)
+{
+    if (m_timeouts.isEmpty())
+        m_currentTick = currentClockTick();
+
+    const qint64 expiry = (m_clock.elapsed() + qMax(0, msec) + TickInterval - 1) / TickInterval;
+
+    Timeout timeout { qMax(expiry, m_currentTick + 1), 0, 0, context, context != nullptr, callback };
+    TimerId id = m_nextId++;
+    insert(id, timeout);
+    m_timeouts.insert(id, timeout);
+
+    if ((m_scheduledTick < 0) || (timeout.expiryTick < m_scheduledTick))
+        reschedule();
+    return id;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    auto it = m_timeouts.find(id);
+    if (it == m_timeouts.end())
+        return false;
+
+    m_slots[it->level][it->slot].remove(id);
+    m_timeouts.erase(it);
+
+    if (m_timeouts.isEmpty()) {
+        m_timer.stop();
+        m_scheduledTick = -1;
+    }
+    return true;
+}
+
+bool TimerWheel::isActive(TimerId id) const
+{
+    return m_timeouts.contains(id);
+}
+
+int TimerWheel::activeCount() const
+{
+    return int(m_timeouts.size());
+}
+
+qint64 TimerWheel::currentClockTick() const
+{
+    return m_clock.elapsed() / TickInterval;
+}
+
+void TimerWheel::insert(TimerId id, Timeout &timeout)
+{
+    int level = 0;
+    qint64 slotTick = timeout.expiryTick;
+
+    for (; level < LevelCount; ++level) {
+        const int shift = level * LevelBits;
+        if (((timeout.expiryTick >> shift) - (m_currentTick >> shift)) < SlotCount) {
+            slotTick = timeout.expiryTick >> shift;
+            break;
+        }
+    }
+    if (level == LevelCount) {
+        // too far in the future: park it in the last slot of the highest level
+        level = LevelCount - 1;
+        slotTick = (m_currentTick >> (level * LevelBits)) + SlotCount - 1;
+    }
+
+    timeout.level = level;
+    timeout.slot = int(slotTick & (SlotCount - 1));
+    m_slots[level][timeout.slot].insert(id);
+}
+
+void TimerWheel::cascade(int level, qint64 tick)
+{
+    auto &slot = m_slots[level][(tick >> (level * LevelBits)) & (SlotCount - 1)];
+    if (slot.isEmpty())
+        return;
+
+    const QSet<TimerId> ids = std::exchange(slot, { });
+    for (TimerId id : ids) {
+        auto it = m_timeouts.find(id);
+        if (it != m_timeouts.end())
+            insert(id, *it);
+    }
+}
+
+void TimerWheel::processTick(qint64 tick)
+{
+    m_currentTick = tick;
+
+    for (int level = LevelCount - 1; level > 0; --level) {
+        if ((tick & ((qint64(1) << (level * LevelBits)) - 1)) == 0)
+            cascade(level, tick);
+    }
+
+    auto &slot = m_slots[0][tick & (SlotCount - 1)];
+    if (slot.isEmpty())
+        return;
+
+    // fire in the order the timeouts were started in
+    QList<TimerId> ids = std::exchange(slot, { }).values();
+    std::sort(ids.begin(), ids.end());
+
+    for (TimerId id : std::as_const(ids)) {
+        // the callbacks are free to start and cancel timeouts, including the ones in this slot
+        auto it = m_timeouts.find(id);
+        if (it == m_timeouts.end())
+            continue;
+        Timeout timeout = std::move(*it);
+        m_timeouts.erase(it);
+
+        if ((!timeout.hasContext || timeout.context) && timeout.callback)
+            timeout.callback();
+    }
+}
+
+qint64 TimerWheel::nextEventTick() const
+{
+    if (m_timeouts.isEmpty())
+        return -1;
+
+    qint64 next = -1;
+
+    for (int j = 1; j < SlotCount; ++j) {
+        qint64 tick = m_currentTick + j;
+        if (!m_slots[0][tick & (SlotCount - 1)].isEmpty()) {
+            next = tick;
+            break;
+        }
+    }
+    for (int level = 1; level < LevelCount; ++level) {
+        const int shift = level * LevelBits;
+        for (int j = 1; j <= SlotCount; ++j) {
+            qint64 slotTick = (m_currentTick >> shift) + j;
+            if (!m_slots[level][slotTick & (SlotCount - 1)].isEmpty()) {
+                qint64 tick = slotTick << shift;
+                if ((next < 0) || (tick < next))
+                    next = tick;
+                break;
+            }
+        }
+    }
+    return next;
+}
+
+void TimerWheel::reschedule()
+{
+    m_scheduledTick = nextEventTick();
+    if (m_scheduledTick < 0) {
+        m_timer.stop();
+    } else {
+        qint64 interval = m_scheduledTick * TickInterval - m_clock.elapsed();
+        m_timer.start(int(qBound(qint64(0), interval, qint64(std::numeric_limits<int>::max()))),
+                      Qt::PreciseTimer, this);
+    }
+}
+
+void TimerWheel::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_timer.timerId())
+        return QObject::timerEvent(event);
+
+    const qint64 now = currentClockTick();
+    forever {
+        qint64 next = nextEventTick();
+        if ((next < 0) || (next > now))
+            break;
+        processTick(next);
+    }
+    // nothing happens in between, so we can safely skip ahead
+    m_currentTick = qMax(m_currentTick, now);
+    reschedule();
+}
+
+QT_END_NAMESPACE_AM
+
+#include "moc_timerwheel.cpp"
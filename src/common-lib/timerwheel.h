@@ -0,0 +1,82 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
+#include <QtCore/QPointer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QBasicTimer>
+#include <QtAppManCommon/global.h>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE_AM
+
+// A hierarchical timer wheel for large numbers of (mostly canceled) single-shot timeouts.
+// Starting and canceling a timeout is O(1) and all timeouts share a single QBasicTimer, which is
+// only running while timeouts are pending. The resolution is TickInterval msec: timeouts never
+// fire early, but may fire up to one tick late.
+// This class is not thread-safe: use it from the thread it was created in only.
+
+class TimerWheel : public QObject
+{
+    Q_OBJECT
+
+public:
+    using TimerId = quint64;
+    static constexpr int TickInterval = 10; // msec
+
+    TimerWheel(QObject *parent = nullptr);
+    ~TimerWheel() override;
+
+    // a shared instance living in the main thread
+    static TimerWheel *instance();
+
+    // Calls callback after msec, unless canceled or a non-null context is destroyed before.
+    // Returns an id that can be used to cancel the timeout (ids are never 0)
+    TimerId start(int msec, QObject *context, const std::function<void()> &callback);
+    bool cancel(TimerId id);
+    bool isActive(TimerId id) const;
+    int activeCount() const;
+
+protected:
+    void timerEvent(QTimerEvent *event) override;
+
+private:
+    static constexpr int LevelBits = 6;
+    static constexpr int SlotCount = 1 << LevelBits;
+    static constexpr int LevelCount = 4;
+
+    struct Timeout
+    {
+        qint64 expiryTick;
+        int level;
+        int slot;
+        QPointer<QObject> context;
+        bool hasContext;
+        std::function<void()> callback;
+    };
+
+    qint64 currentClockTick() const;
+    void insert(TimerId id, Timeout &timeout);
+    void cascade(int level, qint64 tick);
+    void processTick(qint64 tick);
+    qint64 nextEventTick() const;
+    void reschedule();
+
+    QElapsedTimer m_clock;
+    QBasicTimer m_timer;
+    qint64 m_currentTick = 0;
+    qint64 m_scheduledTick = -1;
+    TimerId m_nextId = 1;
+
+    QHash<TimerId, Timeout> m_timeouts;
+    QSet<TimerId> m_slots[LevelCount][SlotCount];
+
+    Q_DISABLE_COPY_MOVE(TimerWheel)
+};
+
+QT_END_NAMESPACE_AM
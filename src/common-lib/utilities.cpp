@@ -21,6 +21,9 @@
 
 #if defined(Q_OS_UNIX)
 #  include <unistd.h>
+#  include <fcntl.h>
+#  include <dirent.h>
+#  include <sys/stat.h>
 #endif
 #if defined(Q_OS_WIN)
 #  include <windows.h>
@@ -31,6 +34,9 @@
 #endif
 
 #include <memory>
+#include <vector>
+#include <atomic>
+#include <thread>
 
 QT_BEGIN_NAMESPACE_AM
 
@@ -120,6 +126,69 @@ bool safeRemove(const QString &path, RecursiveOperationType type)
    return false;
 }
 
+bool setPermissionsAt(int dirFd, const char *name, uint mode)
+{
+#if defined(Q_OS_LINUX)
+    // fchmodat() always follows symlinks and AT_SYMLINK_NOFOLLOW is not supported by older
+    // kernels and C libraries. Checking for a symlink beforehand would be racy, so we pin the
+    // inode via an O_PATH fd instead and change its mode via procfs (O_PATH fds cannot be used
+    // with fchmod() directly).
+    int fd = ::openat(dirFd, name, O_PATH | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    struct ::stat st;
+    bool ok = (::fstat(fd, &st) == 0);
+    if (ok && !S_ISLNK(st.st_mode)) {
+        const QByteArray fdPath = "/proc/self/fd/" + QByteArray::number(fd);
+        ok = (::chmod(fdPath.constData(), mode_t(mode)) == 0);
+    }
+    const int savedErrno = errno;
+    ::close(fd);
+    errno = savedErrno;
+    return ok;
+#elif defined(Q_OS_UNIX)
+    if (::fchmodat(dirFd, name, mode_t(mode), AT_SYMLINK_NOFOLLOW) == 0)
+        return true;
+    // platforms that cannot change the mode of a symlink itself report EOPNOTSUPP for links
+    return (errno == EOPNOTSUPP);
+#else
+    Q_UNUSED(dirFd)
+    Q_UNUSED(name)
+    Q_UNUSED(mode)
+    return false;
+#endif
+}
+
+bool safeRemoveAt(int dirFd, const char *name, RecursiveOperationType type)
+{
+#if defined(Q_OS_UNIX)
+    switch (type) {
+    case RecursiveOperationType::EnterDirectory:
+        return setPermissionsAt(dirFd, name, 0777);
+    case RecursiveOperationType::LeaveDirectory:
+        return ::unlinkat(dirFd, name, AT_REMOVEDIR) == 0;
+    case RecursiveOperationType::File:
+        return ::unlinkat(dirFd, name, 0) == 0;
+    }
+#else
+    Q_UNUSED(dirFd)
+    Q_UNUSED(name)
+    Q_UNUSED(type)
+#endif
+    return false;
+}
+
+bool removeRecursive(const QString &path, int maxThreads)
+{
+#if defined(Q_OS_UNIX)
+    return recursiveOperationAt(path, safeRemoveAt, maxThreads);
+#else
+    Q_UNUSED(maxThreads)
+    return recursiveOperation(path, safeRemove);
+#endif
+}
+
 qint64 getParentPid(qint64 pid)
 {
     qint64 ppid = 0;
@@ -217,6 +286,148 @@ bool recursiveOperation(const QDir &path, const std::function<bool (const QStrin
     return recursiveOperation(path.absolutePath(), operation);
 }
 
+#if defined(Q_OS_UNIX)
+
+namespace {
+
+class RecursiveOperationAt
+{
+public:
+    RecursiveOperationAt(const std::function<bool(int, const char *, RecursiveOperationType)> &operation)
+        : m_operation(operation)
+    { }
+
+    bool file(int dirFd, const char *name)
+    {
+        return m_operation(dirFd, name, RecursiveOperationType::File) || fail();
+    }
+
+    bool directory(int parentFd, const char *name, int maxThreads)
+    {
+        if (!m_operation(parentFd, name, RecursiveOperationType::EnterDirectory))
+            return fail();
+
+        int fd = ::openat(parentFd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (fd < 0)
+            return fail();
+        DIR *dir = ::fdopendir(fd);
+        if (!dir) {
+            fail();
+            ::close(fd);
+            return false;
+        }
+
+        // Read the complete directory first: modifying a directory while iterating over it
+        // with readdir() is allowed, but the results are unspecified.
+        std::vector<QByteArray> files;
+        std::vector<QByteArray> subDirs;
+        bool ok = true;
+
+        forever {
+            errno = 0;
+            const struct ::dirent *de = ::readdir(dir);
+            if (!de) {
+                if (errno)
+                    ok = fail();
+                break;
+            }
+            const char *n = de->d_name;
+            if ((n[0] == '.') && (!n[1] || ((n[1] == '.') && !n[2])))
+                continue;
+
+            bool isDir = (de->d_type == DT_DIR);
+            if (de->d_type == DT_UNKNOWN) {
+                struct ::stat st;
+                if (::fstatat(fd, n, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    ok = fail();
+                    break;
+                }
+                isDir = S_ISDIR(st.st_mode);
+            }
+            (isDir ? subDirs : files).emplace_back(n);
+        }
+
+        for (auto it = files.cbegin(); ok && (it != files.cend()); ++it)
+            ok = file(fd, it->constData());
+
+        if (ok && (maxThreads > 1) && (subDirs.size() > 1)) {
+            std::atomic<size_t> next { 0 };
+            auto worker = [this, fd, &next, &subDirs]() {
+                for (size_t i = next++; !failed() && (i < subDirs.size()); i = next++)
+                    directory(fd, subDirs.at(i).constData(), 1);
+            };
+
+            std::vector<std::thread> threads;
+            const size_t threadCount = std::min(size_t(maxThreads), subDirs.size());
+            for (size_t i = 1; i < threadCount; ++i)
+                threads.emplace_back(worker);
+            worker();
+            for (auto &thread : threads)
+                thread.join();
+            ok = !failed();
+        } else {
+            for (auto it = subDirs.cbegin(); ok && (it != subDirs.cend()); ++it)
+                ok = directory(fd, it->constData(), 1);
+        }
+
+        ::closedir(dir);
+
+        if (!ok)
+            return false;
+        return m_operation(parentFd, name, RecursiveOperationType::LeaveDirectory) || fail();
+    }
+
+    bool failed() const
+    {
+        return m_errorCode.load() != 0;
+    }
+
+    int errorCode() const
+    {
+        return m_errorCode.load();
+    }
+
+private:
+    // the first error wins: errno is thread-local, so it needs to be transported to the caller
+    bool fail()
+    {
+        int expected = 0;
+        m_errorCode.compare_exchange_strong(expected, errno ? errno : EIO);
+        return false;
+    }
+
+    const std::function<bool(int, const char *, RecursiveOperationType)> &m_operation;
+    std::atomic<int> m_errorCode { 0 };
+};
+
+} // namespace
+
+#endif // defined(Q_OS_UNIX)
+
+bool recursiveOperationAt(const QString &path, const std::function<bool (int, const char *, RecursiveOperationType)> &operation,
+                          int maxThreads)
+{
+#if defined(Q_OS_UNIX)
+    const QByteArray localPath = path.toLocal8Bit();
+    struct ::stat st;
+    if (::fstatat(AT_FDCWD, localPath.constData(), &st, AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+
+    RecursiveOperationAt rop(operation);
+    bool ok = S_ISDIR(st.st_mode) ? rop.directory(AT_FDCWD, localPath.constData(), maxThreads)
+                                  : rop.file(AT_FDCWD, localPath.constData());
+    if (!ok)
+        errno = rop.errorCode();
+    return ok;
+#else
+    Q_UNUSED(path)
+    Q_UNUSED(operation)
+    Q_UNUSED(maxThreads)
+    errno = ENOSYS;
+    return false;
+#endif
+}
+
 QVector<QObject *> loadPlugins_helper(const char *type, const QStringList &files, const char *iid) Q_DECL_NOEXCEPT_EXPR(false)
 {
     QVector<QObject *> interfaces;
@@ -98,6 +98,31 @@ bool recursiveOperation(const QDir &path, const std::function<bool(const QString
 // makes files and directories writable, then deletes them
 bool safeRemove(const QString &path, RecursiveOperationType type);
 
+/*! \internal
+
+    A faster variant of recursiveOperation(), which works on directory file descriptors: instead
+    of a path, \a operation gets the file descriptor \a dirFd of the parent directory and the
+    \a name of the entry, so it can use the fd-relative *at() system calls (e.g. \c unlinkat or
+    \c fchownat). For the top-level \a path, \a dirFd is \c AT_FDCWD.
+    Symbolic links are never followed.
+
+    If \a maxThreads is larger than 1, the sub-directories of \a path are processed in parallel,
+    so \a operation needs to be thread-safe in this case.
+
+    This is only available on Unix and will always fail on other platforms.
+ */
+bool recursiveOperationAt(const QString &path, const std::function<bool(int dirFd, const char *name, RecursiveOperationType)> &operation,
+                          int maxThreads = 1);
+
+// fchmodat() without ever following symlinks: symlinks are left untouched (Unix only)
+bool setPermissionsAt(int dirFd, const char *name, uint mode);
+
+// the equivalent of safeRemove for recursiveOperationAt
+bool safeRemoveAt(int dirFd, const char *name, RecursiveOperationType type);
+
+// recursively removes path via recursiveOperationAt() if possible, or recursiveOperation() if not
+bool removeRecursive(const QString &path, int maxThreads = 1);
+
 qint64 getParentPid(qint64 pid);
 
 QVector<QObject *> loadPlugins_helper(const char *type, const QStringList &files, const char *iid) Q_DECL_NOEXCEPT_EXPR(false);
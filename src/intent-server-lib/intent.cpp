@@ -5,6 +5,7 @@
 
 #include "intent.h"
 #include "utilities.h"
+#include "logging.h"
 
 #include <QRegularExpression>
 #include <QVariant>
@@ -176,6 +177,7 @@ Intent::Intent(const QString &id, const QString &packageId, const QString &appli
     , m_icon(icon)
     , m_handleOnlyWhenRunning(handleOnlyWhenRunning)
 {
+    compileParameterMatch();
 }
 
 QString Intent::intentId() const
@@ -210,44 +212,79 @@ QString Intent::applicationId() const
 
 bool Intent::checkParameterMatch(const QVariantMap &parameters) const
 {
-    for (auto rit = m_parameterMatch.cbegin(); rit != m_parameterMatch.cend(); ++rit) {
-        const QString &paramName = rit.key();
-        auto pit = parameters.find(paramName);
-        if (pit == parameters.cend())
+    for (const ParameterMatcher &matcher : m_parameterMatchers) {
+        auto pit = parameters.find(matcher.name);
+        if ((pit == parameters.cend()) || !matcher.matches(pit.value()))
             return false;
+    }
+    return true;
+}
 
-        const QVariant requiredValue = rit.value();
-        const QVariant actualValue = pit.value();
+void Intent::compileParameterMatch()
+{
+    m_parameterMatchers.clear();
+    m_parameterMatchers.reserve(m_parameterMatch.size());
+
+    for (auto rit = m_parameterMatch.cbegin(); rit != m_parameterMatch.cend(); ++rit) {
+        ParameterMatcher matcher;
+        matcher.name = rit.key();
+        const QVariant &requiredValue = rit.value();
 
         switch (requiredValue.metaType().id()) {
-        case QMetaType::QString: {
-            QRegularExpression regexp(requiredValue.toString());
-            auto match = regexp.match(actualValue.toString());
-            if (!match.hasMatch())
-                return false;
+        case QMetaType::QString:
+            matcher.type = ParameterMatcher::RegularExpression;
+            matcher.regexp.setPattern(requiredValue.toString());
+            if (matcher.regexp.isValid()) {
+                matcher.regexp.optimize();
+            } else {
+                qCWarning(LogIntents) << "Intent" << m_intentId << "of application" << m_applicationId
+                                      << "has an invalid regular expression for parameter"
+                                      << matcher.name << ":" << matcher.regexp.errorString();
+            }
             break;
-        }
+
         case QMetaType::QVariantList: {
-            bool foundMatch = false;
+            matcher.type = ParameterMatcher::List;
             const QVariantList rvlist = requiredValue.toList();
             for (const QVariant &rv2 : rvlist) {
-                if (actualValue.canConvert(rv2.metaType()) && actualValue == rv2) {
-                    foundMatch = true;
-                    break;
-                }
+                // a string can only ever be equal to another string, so these can be hashed
+                if (rv2.metaType().id() == QMetaType::QString)
+                    matcher.stringValues.insert(rv2.toString());
+                else
+                    matcher.otherValues.append(rv2);
             }
-            if (!foundMatch)
-                return false;
             break;
         }
-        default: {
-            if (requiredValue != actualValue)
-                return false;
+        default:
+            matcher.type = ParameterMatcher::Value;
+            matcher.value = requiredValue;
             break;
         }
+        m_parameterMatchers.append(matcher);
+    }
+}
+
+bool Intent::ParameterMatcher::matches(const QVariant &actualValue) const
+{
+    switch (type) {
+    case RegularExpression:
+        return regexp.match(actualValue.toString()).hasMatch();
+
+    case List:
+        if ((actualValue.metaType().id() == QMetaType::QString)
+                && stringValues.contains(actualValue.toString())) {
+            return true;
+        }
+        for (const QVariant &rv2 : otherValues) {
+            if (actualValue.canConvert(rv2.metaType()) && actualValue == rv2)
+                return true;
         }
+        return false;
+
+    case Value:
+    default:
+        return value == actualValue;
     }
-    return true;
 }
 
 QUrl Intent::icon() const
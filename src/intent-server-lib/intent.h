@@ -10,6 +10,9 @@
 #include <QtCore/QUrl>
 #include <QtCore/QStringList>
 #include <QtCore/QVariantMap>
+#include <QtCore/QVector>
+#include <QtCore/QSet>
+#include <QtCore/QRegularExpression>
 #include <QtAppManCommon/global.h>
 
 QT_BEGIN_NAMESPACE_AM
@@ -70,10 +73,27 @@ private:
            const QMap<QString, QString> &descriptions, const QUrl &icon,
            const QStringList &categories, bool handleOnlyWhenRunning);
 
+    // the parameterMatch map, compiled once when the intent is registered
+    struct ParameterMatcher
+    {
+        enum Type { RegularExpression, List, Value };
+
+        QString name;
+        Type type = Value;
+        QRegularExpression regexp;
+        QSet<QString> stringValues;
+        QVariantList otherValues;
+        QVariant value;
+
+        bool matches(const QVariant &actualValue) const;
+    };
+    void compileParameterMatch();
+
     QString m_intentId;
     Visibility m_visibility = Public;
     QStringList m_requiredCapabilities;
     QVariantMap m_parameterMatch;
+    QVector<ParameterMatcher> m_parameterMatchers;
 
     QString m_packageId;
     QString m_applicationId;
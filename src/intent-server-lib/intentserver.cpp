@@ -9,13 +9,15 @@
 #include "intentmodel.h"
 
 #include <QtAppManCommon/logging.h>
+#include <QtAppManCommon/timerwheel.h>
 
 #include <algorithm>
 
 #include <QRegularExpression>
 #include <QUuid>
 #include <QMetaObject>
-#include <QTimer>
+#include <QElapsedTimer>
+#include <QMetaEnum>
 #include <QDebug>
 
 #include <QQmlEngine>
@@ -248,6 +250,7 @@ Intent *IntentServer::addIntent(const QString &id, const QString &packageId,
 
     beginInsertRows(QModelIndex(), rowCount(), rowCount());
     m_intents << intent;
+    m_intentsById[id].append(intent);
     endInsertRows();
 
     emit countChanged();
@@ -262,6 +265,12 @@ void IntentServer::removeIntent(Intent *intent)
         emit intentAboutToBeRemoved(intent);
         beginRemoveRows(QModelIndex(), index, index);
         m_intents.removeAt(index);
+        auto it = m_intentsById.find(intent->intentId());
+        if (it != m_intentsById.end()) {
+            it->removeOne(intent);
+            if (it->isEmpty())
+                m_intentsById.erase(it);
+        }
         endRemoveRows();
 
         emit countChanged();
@@ -422,12 +431,12 @@ Intent *IntentServer::intent(int index) const
 Intent *IntentServer::applicationIntent(const QString &intentId, const QString &applicationId,
                              const QVariantMap &parameters) const
 {
-    auto it = std::find_if(m_intents.cbegin(), m_intents.cend(),
-                           [intentId, applicationId, parameters](Intent *intent) -> bool {
-        return (intent->applicationId() == applicationId) && (intent->intentId() == intentId)
-                && intent->checkParameterMatch(parameters);
+    const auto intents = m_intentsById.value(intentId);
+    auto it = std::find_if(intents.cbegin(), intents.cend(),
+                           [applicationId, parameters](Intent *intent) -> bool {
+        return (intent->applicationId() == applicationId) && intent->checkParameterMatch(parameters);
     });
-    return (it != m_intents.cend()) ? *it : nullptr;
+    return (it != intents.cend()) ? *it : nullptr;
 }
 
 /*! \qmlmethod IntentObject IntentServer::packageIntent(string intentId, string packageId, var parameters)
@@ -440,12 +449,12 @@ Intent *IntentServer::applicationIntent(const QString &intentId, const QString &
 Intent *IntentServer::packageIntent(const QString &intentId, const QString &packageId,
                                     const QVariantMap &parameters) const
 {
-    auto it = std::find_if(m_intents.cbegin(), m_intents.cend(),
-                           [intentId, packageId, parameters](Intent *intent) -> bool {
-        return (intent->packageId() == packageId) && (intent->intentId() == intentId)
-                && intent->checkParameterMatch(parameters);
+    const auto intents = m_intentsById.value(intentId);
+    auto it = std::find_if(intents.cbegin(), intents.cend(),
+                           [packageId, parameters](Intent *intent) -> bool {
+        return (intent->packageId() == packageId) && intent->checkParameterMatch(parameters);
     });
-    return (it != m_intents.cend()) ? *it : nullptr;
+    return (it != intents.cend()) ? *it : nullptr;
 }
 
 /*! \qmlmethod IntentObject IntentServer::packageIntent(string intentId, string packageId, string applicationId, var parameters)
@@ -458,12 +467,13 @@ Intent *IntentServer::packageIntent(const QString &intentId, const QString &pack
 Intent *IntentServer::packageIntent(const QString &intentId, const QString &packageId,
                                     const QString &applicationId, const QVariantMap &parameters) const
 {
-    auto it = std::find_if(m_intents.cbegin(), m_intents.cend(),
-                           [intentId, packageId, applicationId, parameters](Intent *intent) -> bool {
+    const auto intents = m_intentsById.value(intentId);
+    auto it = std::find_if(intents.cbegin(), intents.cend(),
+                           [packageId, applicationId, parameters](Intent *intent) -> bool {
         return (intent->packageId() == packageId) && (intent->applicationId() == applicationId)
-                && (intent->intentId() == intentId) && intent->checkParameterMatch(parameters);
+                && intent->checkParameterMatch(parameters);
     });
-    return (it != m_intents.cend()) ? *it : nullptr;
+    return (it != intents.cend()) ? *it : nullptr;
 }
 
 /*! \qmlmethod int IntentServer::indexOfIntent(string intentId, string applicationId, var parameters)
@@ -491,8 +501,100 @@ int IntentServer::indexOfIntent(Intent *intent)
     return m_intents.indexOf(intent);
 }
 
+// the request queue is drained in batches: at most this many requests or for this many msec per
+// event loop iteration (whatever limit is hit first)
+static constexpr int MaximumRequestBatchSize = 64;
+static constexpr int RequestBatchTimeBudget = 5;
+
+struct IntentServer::RequestBatch
+{
+    // Consecutive requests for the same handler are coalesced into one dispatch. Pending dispatches
+    // are sent out before any other outgoing message (replies, application starts,
+    // disambiguations), so the order in which the IPC connections see all of these is exactly the
+    // same as when every request was processed in its own event loop iteration.
+    QVector<QPair<IntentServerSystemInterface::IpcConnection *, QVector<IntentServerRequest *>>> dispatches;
+    QVector<IntentServerRequest *> finished;
+
+    void addDispatch(IntentServerSystemInterface::IpcConnection *clientIPC, IntentServerRequest *isr)
+    {
+        if (!dispatches.isEmpty() && (dispatches.last().first == clientIPC))
+            dispatches.last().second << isr;
+        else
+            dispatches.append({ clientIPC, { isr } });
+    }
+};
+
+void IntentServer::dispatchRequests(RequestBatch &batch)
+{
+    for (const auto &dispatch : std::as_const(batch.dispatches))
+        m_systemInterface->requestsToApplication(dispatch.first, dispatch.second);
+    batch.dispatches.clear();
+}
+
+/*! \qmlmethod object IntentServer::requestQueueStatistics()
+
+    Returns statistics about the IntentServer's internal request queue, mainly for debugging and
+    performance analysis. The queue is processed in batches: at most 64 requests or 5 msec per
+    event loop iteration. The returned object has these fields:
+
+    \table
+    \header
+        \li Name
+        \li Description
+    \row
+        \li \c queueDepth
+        \li The number of currently queued requests.
+    \row
+        \li \c maximumQueueDepth
+        \li The highest number of queued requests so far.
+    \row
+        \li \c batches
+        \li The number of batches the queue has been processed in so far.
+    \row
+        \li \c processedRequests
+        \li The number of requests processed so far. A request is processed more than once on its
+             way from the sender to the handler and back.
+    \row
+        \li \c completedRequests
+        \li The number of requests that have been completely handled so far.
+    \row
+        \li \c stateLatencies
+        \li An object with one entry per request state, each containing the \c totalTime,
+             \c averageTime and \c maximumTime (in msec) that the completed requests spent in
+             this state.
+    \endtable
+*/
+QVariantMap IntentServer::requestQueueStatistics() const
+{
+    const auto &stats = m_requestQueueStatistics;
+
+    QVariantMap stateLatencies;
+    const auto stateEnum = QMetaEnum::fromType<IntentServerRequest::State>();
+    for (int i = 0; i < IntentServerRequest::StateCount; ++i) {
+        stateLatencies.insert(qL1S(stateEnum.valueToKey(i)), QVariantMap {
+            { qSL("totalTime"), double(stats.totalTimeInState[i]) / 1000000 },
+            { qSL("averageTime"), stats.completedRequests
+                    ? double(stats.totalTimeInState[i]) / 1000000 / double(stats.completedRequests) : 0.0 },
+            { qSL("maximumTime"), double(stats.maximumTimeInState[i]) / 1000000 },
+        });
+    }
+
+    return QVariantMap {
+        { qSL("queueDepth"), qint64(m_requestQueue.size()) },
+        { qSL("maximumQueueDepth"), qint64(stats.maximumQueueDepth) },
+        { qSL("batches"), stats.batches },
+        { qSL("processedRequests"), stats.processedRequests },
+        { qSL("completedRequests"), stats.completedRequests },
+        { qSL("stateLatencies"), stateLatencies }, // all times in msec
+    };
+}
+
 void IntentServer::triggerRequestQueue()
 {
+    // one queued invocation is enough, since processRequestQueue() drains the queue in batches
+    if (m_requestQueueTriggered)
+        return;
+    m_requestQueueTriggered = true;
     QMetaObject::invokeMethod(this, &IntentServer::processRequestQueue, Qt::QueuedConnection);
 }
 
@@ -500,16 +602,111 @@ void IntentServer::enqueueRequest(IntentServerRequest *isr)
 {
     qCDebug(LogIntents) << "Enqueueing Intent request:" << isr << isr->requestId() << isr->state();
     m_requestQueue.enqueue(isr);
+    m_requestQueueStatistics.maximumQueueDepth = qMax(m_requestQueueStatistics.maximumQueueDepth,
+                                                      m_requestQueue.size());
     triggerRequestQueue();
 }
 
 void IntentServer::processRequestQueue()
 {
+    m_requestQueueTriggered = false;
+
     if (m_requestQueue.isEmpty())
         return;
 
-    IntentServerRequest *isr = m_requestQueue.takeFirst();
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    RequestBatch batch;
+    int count = 0;
+
+    do {
+        processRequest(m_requestQueue.takeFirst(), batch);
+        ++count;
+    } while (!m_requestQueue.isEmpty() && (count < MaximumRequestBatchSize)
+             && !batchTimer.hasExpired(RequestBatchTimeBudget));
+
+    dispatchRequests(batch);
+
+    if (!batch.finished.isEmpty()) {
+        auto &stats = m_requestQueueStatistics;
+        for (const auto *isr : std::as_const(batch.finished)) {
+            for (int i = 0; i < IntentServerRequest::StateCount; ++i) {
+                qint64 t = isr->timeInState(IntentServerRequest::State(i));
+                stats.totalTimeInState[i] += t;
+                stats.maximumTimeInState[i] = qMax(stats.maximumTimeInState[i], t);
+            }
+        }
+        stats.completedRequests += quint64(batch.finished.size());
+
+        // the IPC implementations might still reference the requests in queued invocations, so
+        // we must not delete them right away
+        QMetaObject::invokeMethod(this, [finished = batch.finished]() {
+            qDeleteAll(finished);
+        }, Qt::QueuedConnection); // aka deleteLater for non-QObjects
+    }
+
+    ++m_requestQueueStatistics.batches;
+    m_requestQueueStatistics.processedRequests += quint64(count);
+
+    qCDebug(LogIntents) << "Processed" << count << "intent request(s) in" << batchTimer.nsecsElapsed() / 1000
+                        << "usec," << m_requestQueue.size() << "still queued";
 
+    if (!m_requestQueue.isEmpty())
+        triggerRequestQueue();
+}
+
+void IntentServer::startRequestTimeout(IntentServerRequest *isr, int timeout, const QString &errorMessage)
+{
+    // a request only ever has one timeout: the one for its current state
+    cancelRequestTimeout(isr);
+
+    if (timeout <= 0)
+        return;
+
+    auto timerId = TimerWheel::instance()->start(timeout, this, [this, isr, errorMessage]() {
+        m_requestTimeouts.remove(isr);
+
+        bool removed = false;
+        switch (isr->state()) {
+        case IntentServerRequest::State::WaitingForDisambiguation:
+            removed = m_disambiguationQueue.remove(isr->requestId());
+            break;
+        case IntentServerRequest::State::WaitingForApplicationStart:
+            // the selected intent might be gone already, so we cannot rely on its applicationId
+            for (auto it = m_startingAppQueue.begin(); it != m_startingAppQueue.end(); ++it) {
+                if (it->removeOne(isr)) {
+                    if (it->isEmpty())
+                        m_startingAppQueue.erase(it);
+                    removed = true;
+                    break;
+                }
+            }
+            break;
+        case IntentServerRequest::State::WaitingForReplyFromApplication:
+            removed = m_sentToAppQueue.remove(isr->requestId());
+            break;
+        default:
+            break;
+        }
+        if (removed) {
+            isr->setRequestFailed(errorMessage);
+            enqueueRequest(isr);
+        }
+    });
+    m_requestTimeouts.insert(isr, timerId);
+}
+
+void IntentServer::cancelRequestTimeout(IntentServerRequest *isr)
+{
+    auto it = m_requestTimeouts.find(isr);
+    if (it != m_requestTimeouts.end()) {
+        TimerWheel::instance()->cancel(it.value());
+        m_requestTimeouts.erase(it);
+    }
+}
+
+void IntentServer::processRequest(IntentServerRequest *isr, RequestBatch &batch)
+{
     qCDebug(LogIntents) << "Processing intent request" << isr << isr->requestId() << "in state" << isr->state();
 
     if (isr->state() == IntentServerRequest::State::ReceivedRequest) { // step 1) disambiguate
@@ -520,20 +717,15 @@ void IntentServer::processRequestQueue()
                 // If the System UI does not react to the signal, then just use the first match.
                 isr->setSelectedIntent(isr->potentialIntents().constFirst());
             } else {
-                m_disambiguationQueue.enqueue(isr);
+                m_disambiguationQueue.insert(isr->requestId(), isr);
                 isr->setState(IntentServerRequest::State::WaitingForDisambiguation);
                 qCDebug(LogIntents) << "Waiting for disambiguation on intent" << isr->intentId();
-                if (m_disambiguationTimeout > 0) {
-                    QTimer::singleShot(m_disambiguationTimeout, this, [this, isr]() {
-                        if (m_disambiguationQueue.removeOne(isr)) {
-                            isr->setRequestFailed(qSL("Disambiguation timed out after %1 ms").arg(m_disambiguationTimeout));
-                            enqueueRequest(isr);
-                        }
-                    });
-                }
+                startRequestTimeout(isr, m_disambiguationTimeout,
+                                    qSL("Disambiguation timed out after %1 ms").arg(m_disambiguationTimeout));
                 //TODO: we really should copy here, because the Intent pointers may die: a disambiguation might
                 //      be active, while one of the apps involved is removed or updated
 
+                dispatchRequests(batch);
                 emit disambiguationRequest(isr->requestId(), isr->potentialIntents(),
                                            isr->parameters());
             }
@@ -553,16 +745,11 @@ void IntentServer::processRequestQueue()
                 qCDebug(LogIntents) << " * skipping, because 'handleOnlyWhenRunning' is set";
                 isr->setRequestFailed(qSL("Skipping delivery due to handleOnlyWhenRunning"));
             } else {
-                m_startingAppQueue.enqueue(isr);
+                m_startingAppQueue[isr->selectedIntent()->applicationId()].append(isr);
                 isr->setState(IntentServerRequest::State::WaitingForApplicationStart);
-                if (m_startingAppTimeout > 0) {
-                    QTimer::singleShot(m_startingAppTimeout, this, [this, isr]() {
-                        if (m_startingAppQueue.removeOne(isr)) {
-                            isr->setRequestFailed(qSL("Starting handler application timed out after %1 ms").arg(m_startingAppTimeout));
-                            enqueueRequest(isr);
-                        }
-                    });
-                }
+                startRequestTimeout(isr, m_startingAppTimeout,
+                                    qSL("Starting handler application timed out after %1 ms").arg(m_startingAppTimeout));
+                dispatchRequests(batch);
                 m_systemInterface->startApplication(isr->selectedIntent()->applicationId());
             }
         } else {
@@ -582,21 +769,15 @@ void IntentServer::processRequestQueue()
             qCDebug(LogIntents) << "Sending intent request to handler application"
                                 << isr->selectedIntent()->applicationId();
             if (!isr->isBroadcast()) {
-                m_sentToAppQueue.enqueue(isr);
+                m_sentToAppQueue.insert(isr->requestId(), isr);
                 isr->setState(IntentServerRequest::State::WaitingForReplyFromApplication);
-                if (m_sentToAppTimeout > 0) {
-                    QTimer::singleShot(m_sentToAppTimeout, this, [this, isr]() {
-                        if (m_sentToAppQueue.removeOne(isr)) {
-                            isr->setRequestFailed(qSL("Waiting for reply from handler application timed out after %1 ms").arg(m_sentToAppTimeout));
-                            enqueueRequest(isr);
-                        }
-                    });
-                }
+                startRequestTimeout(isr, m_sentToAppTimeout,
+                                    qSL("Waiting for reply from handler application timed out after %1 ms").arg(m_sentToAppTimeout));
             } else {
                 // there are no replies for broadcasts, so we simply skip this step
                 isr->setState(IntentServerRequest::State::ReceivedReplyFromApplication);
             }
-            m_systemInterface->requestToApplication(clientIPC, isr);
+            batch.addDispatch(clientIPC, isr);
         }
     }
 
@@ -610,14 +791,12 @@ void IntentServer::processRequestQueue()
             } else {
                 qCDebug(LogIntents) << "Forwarding intent reply" << isr->requestId()
                                     << "to requesting application" << isr->requestingApplicationId();
+                dispatchRequests(batch);
                 m_systemInterface->replyFromSystem(clientIPC, isr);
             }
         }
-        QMetaObject::invokeMethod(this, [isr]() { delete isr; }, Qt::QueuedConnection); // aka deleteLater for non-QObject
-        isr = nullptr;
+        batch.finished << isr;
     }
-
-    triggerRequestQueue();
 }
 
 QString IntentServer::packageIdForApplicationId(const QString &applicationId) const
@@ -679,13 +858,9 @@ void IntentServer::rejectDisambiguationRequest(const QUuid &requestId)
 
 void IntentServer::internalDisambiguateRequest(const QUuid &requestId, bool reject, Intent *selectedIntent)
 {
-    IntentServerRequest *isr = nullptr;
-    for (int i = 0; i < m_disambiguationQueue.size(); ++i) {
-        if (m_disambiguationQueue.at(i)->requestId() == requestId) {
-            isr = m_disambiguationQueue.takeAt(i);
-            break;
-        }
-    }
+    IntentServerRequest *isr = m_disambiguationQueue.take(requestId);
+    if (isr)
+        cancelRequestTimeout(isr);
 
     if (!isr) {
         qmlWarning(this) << "Got a disambiguation acknowledge or reject for intent " << requestId
@@ -710,36 +885,25 @@ void IntentServer::internalDisambiguateRequest(const QUuid &requestId, bool reje
 void IntentServer::applicationWasStarted(const QString &applicationId)
 {
     // check if any intent request is waiting for this app to start
-    bool foundOne = false;
-    for (auto it = m_startingAppQueue.cbegin(); it != m_startingAppQueue.cend(); ) {
-        auto isr = *it;
-        if (isr->selectedIntent()->applicationId() == applicationId) {
-            qCDebug(LogIntents) << "Intent request" << isr->intentId()
-                                << "can now be forwarded to application" << applicationId;
-
-            isr->setState(IntentServerRequest::State::StartedApplication);
-            m_requestQueue << isr;
-            foundOne = true;
-
-            it = m_startingAppQueue.erase(it);
-        } else {
-            ++it;
-        }
+    const auto isrs = m_startingAppQueue.take(applicationId);
+    for (auto isr : isrs) {
+        qCDebug(LogIntents) << "Intent request" << isr->intentId()
+                            << "can now be forwarded to application" << applicationId;
+
+        cancelRequestTimeout(isr);
+        isr->setState(IntentServerRequest::State::StartedApplication);
+        m_requestQueue << isr;
     }
-    if (foundOne)
+    if (!isrs.isEmpty())
         triggerRequestQueue();
 }
 
 void IntentServer::replyFromApplication(const QString &replyingApplicationId, const QUuid &requestId,
                                         bool error, const QVariantMap &result)
 {
-    IntentServerRequest *isr = nullptr;
-    for (int i = 0; i < m_sentToAppQueue.size(); ++i) {
-        if (m_sentToAppQueue.at(i)->requestId() == requestId) {
-            isr = m_sentToAppQueue.takeAt(i);
-            break;
-        }
-    }
+    IntentServerRequest *isr = m_sentToAppQueue.take(requestId);
+    if (isr)
+        cancelRequestTimeout(isr);
 
     if (!isr) {
         qCWarning(LogIntents) << "Got a reply for intent" << requestId << "from application"
@@ -783,7 +947,7 @@ IntentServerRequest *IntentServer::requestToSystem(const QString &requestingAppl
     QVector<Intent *> intents;
     bool broadcast = (applicationId == qSL(":broadcast:"));
     if (applicationId.isEmpty() || broadcast) {
-        intents = filterByIntentId(m_intents, intentId, parameters);
+        intents = filterByIntentId(m_intentsById.value(intentId), intentId, parameters);
     } else {
         if (Intent *intent = this->applicationIntent(intentId, applicationId, parameters))
             intents << intent;
@@ -12,6 +12,7 @@
 #include <QtCore/QQueue>
 #include <QtAppManCommon/global.h>
 #include <QtAppManIntentServer/intent.h>
+#include <QtAppManIntentServer/intentserverrequest.h>
 
 
 QT_BEGIN_NAMESPACE_AM
@@ -82,6 +83,8 @@ public:
                                                       QT_PREPEND_NAMESPACE_AM(Intent) *selectedIntent);
     Q_INVOKABLE void rejectDisambiguationRequest(const QUuid &requestId);
 
+    Q_INVOKABLE QVariantMap requestQueueStatistics() const;
+
 signals:
     void intentAdded(QT_PREPEND_NAMESPACE_AM(Intent) *intent);
     void intentAboutToBeRemoved(QT_PREPEND_NAMESPACE_AM(Intent) *intent);
@@ -101,9 +104,15 @@ private:
     IntentServerRequest *requestToSystem(const QString &requestingApplicationId, const QString &intentId,
                                          const QString &applicationId, const QVariantMap &parameters);
 
+    struct RequestBatch;
+
     void triggerRequestQueue();
     void enqueueRequest(IntentServerRequest *isr);
     void processRequestQueue();
+    void processRequest(IntentServerRequest *isr, RequestBatch &batch);
+    void dispatchRequests(RequestBatch &batch);
+    void startRequestTimeout(IntentServerRequest *isr, int timeout, const QString &errorMessage);
+    void cancelRequestTimeout(IntentServerRequest *isr);
 
     QString packageIdForApplicationId(const QString &applicationId) const;
 
@@ -117,10 +126,21 @@ private:
     QMap<QString, QStringList> m_knownApplications;
 
     QQueue<IntentServerRequest *> m_requestQueue;
-
-    QQueue<IntentServerRequest *> m_disambiguationQueue;
-    QQueue<IntentServerRequest *> m_startingAppQueue;
-    QQueue<IntentServerRequest *> m_sentToAppQueue;
+    bool m_requestQueueTriggered = false;
+
+    struct {
+        qsizetype maximumQueueDepth = 0;
+        quint64 batches = 0;
+        quint64 processedRequests = 0;
+        quint64 completedRequests = 0;
+        qint64 totalTimeInState[IntentServerRequest::StateCount] = { }; // in nsec
+        qint64 maximumTimeInState[IntentServerRequest::StateCount] = { }; // in nsec
+    } m_requestQueueStatistics;
+
+    QHash<QUuid, IntentServerRequest *> m_disambiguationQueue;
+    QHash<QString, QVector<IntentServerRequest *>> m_startingAppQueue; // handling app-id -> requests
+    QHash<QUuid, IntentServerRequest *> m_sentToAppQueue;
+    QHash<IntentServerRequest *, quint64> m_requestTimeouts; // TimerWheel ids
 
     // no timeouts by default -- these have to be set at runtime
     int m_disambiguationTimeout = 0;
@@ -128,6 +148,7 @@ private:
     int m_sentToAppTimeout = 0;
 
     QVector<Intent *> m_intents;
+    QHash<QString, QVector<Intent *>> m_intentsById; // same order as in m_intents
 
     IntentServerSystemInterface *m_systemInterface;
     friend class IntentServerSystemInterface;
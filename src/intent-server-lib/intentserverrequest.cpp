@@ -25,6 +25,8 @@ IntentServerRequest::IntentServerRequest(const QString &requestingApplicationId,
 
     if (potentialIntents.size() == 1)
         setSelectedIntent(potentialIntents.constFirst());
+
+    m_stateTimer.start();
 }
 
 IntentServerRequest::State IntentServerRequest::state() const
@@ -87,21 +89,31 @@ void IntentServerRequest::setRequestFailed(const QString &errorMessage)
     m_succeeded = false;
     m_result.clear();
     m_result[qSL("errorMessage")] = errorMessage;
-    m_state = State::ReceivedReplyFromApplication;
+    setState(State::ReceivedReplyFromApplication);
 }
 
 void IntentServerRequest::setRequestSucceeded(const QVariantMap &result)
 {
     m_succeeded = true;
     m_result = result;
-    m_state = State::ReceivedReplyFromApplication;
+    setState(State::ReceivedReplyFromApplication);
 }
 
 void IntentServerRequest::setState(IntentServerRequest::State newState)
 {
+    m_timeInState[int(m_state)] += m_stateTimer.nsecsElapsed();
+    m_stateTimer.start();
     m_state = newState;
 }
 
+qint64 IntentServerRequest::timeInState(State state) const
+{
+    qint64 t = m_timeInState[int(state)];
+    if (state == m_state)
+        t += m_stateTimer.nsecsElapsed();
+    return t;
+}
+
 void IntentServerRequest::setSelectedIntent(Intent *intent)
 {
     if (m_potentialIntents.contains(intent))
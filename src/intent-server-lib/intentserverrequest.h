@@ -11,6 +11,7 @@
 #include <QtCore/QUuid>
 #include <QtCore/QVector>
 #include <QtCore/QPointer>
+#include <QtCore/QElapsedTimer>
 #include <QtAppManCommon/global.h>
 #include <QtAppManIntentServer/intent.h>
 
@@ -36,6 +37,7 @@ public:
         WaitingForReplyFromApplication,
         ReceivedReplyFromApplication,
     };
+    static constexpr int StateCount = int(State::ReceivedReplyFromApplication) + 1;
 
     Q_ENUM(State)
 
@@ -51,6 +53,7 @@ public:
     bool isBroadcast() const;
 
     void setState(State newState);
+    qint64 timeInState(State state) const; // in nsec
     void setSelectedIntent(Intent *intent);
 
     void setRequestFailed(const QString &errorMessage);
@@ -59,6 +62,8 @@ public:
 private:
     QUuid m_id;
     State m_state;
+    QElapsedTimer m_stateTimer;
+    qint64 m_timeInState[StateCount] = { };
     bool m_succeeded = false;
     bool m_broadcast = false;
     QString m_intentId;
@@ -35,6 +35,13 @@ IntentServerRequest *IntentServerSystemInterface::requestToSystem(const QString
     return m_is->requestToSystem(requestingApplicationId, intentId, applicationId, parameters);
 }
 
+void IntentServerSystemInterface::requestsToApplication(IpcConnection *clientIPC,
+                                                        const QVector<IntentServerRequest *> &requests)
+{
+    for (auto *isr : requests)
+        requestToApplication(clientIPC, isr);
+}
+
 QT_END_NAMESPACE_AM
 
 #include "moc_intentserversysteminterface.cpp"
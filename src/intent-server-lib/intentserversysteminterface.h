@@ -9,6 +9,7 @@
 #include <QtCore/QVariantMap>
 #include <QtCore/QString>
 #include <QtCore/QStringList>
+#include <QtCore/QVector>
 #include <QtAppManCommon/global.h>
 
 QT_BEGIN_NAMESPACE_AM
@@ -40,6 +41,8 @@ public:
     virtual void replyFromSystem(IpcConnection *clientIPC, IntentServerRequest *isr) = 0;
 
     virtual void requestToApplication(IpcConnection *clientIPC, IntentServerRequest *isr) = 0;
+    // the default implementation calls requestToApplication() for each request
+    virtual void requestsToApplication(IpcConnection *clientIPC, const QVector<IntentServerRequest *> &requests);
 
 signals:
     void applicationWasStarted(const QString &appId);
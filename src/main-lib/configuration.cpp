@@ -140,6 +140,7 @@ Configuration::Configuration(const QStringList &defaultConfigFilePaths,
                                                    qSL("Disable the use of the config and appdb file cache.") });
     m_clp.addOption({ { qSL("clear-cache"), qSL("clear-config-cache") },
                                                    qSL("Ignore an existing config and appdb file cache.") });
+    m_clp.addOption({ qSL("verify-cache"),         qSL("Verify the config and appdb file cache by hashing all source files.") });
     m_clp.addOption({ { qSL("r"), qSL("recreate-database") },
                                                    qSL("Backwards compatibility: synonyms for --clear-cache.") });
     if (!buildConfigFilePath.isEmpty())
@@ -302,6 +303,8 @@ void Configuration::parseWithArguments(const QStringList &arguments)
         cacheOptions |= AbstractConfigCache::NoCache;
     if (clearCache())
         cacheOptions |= AbstractConfigCache::ClearCache;
+    if (verifyCache())
+        cacheOptions |= AbstractConfigCache::FullVerify;
 
     if (configFilePaths.isEmpty()) {
         m_data.reset(new ConfigurationData());
@@ -376,7 +379,7 @@ void Configuration::parseWithArguments(const QStringList &arguments)
 
 quint32 ConfigurationData::dataStreamVersion()
 {
-    return 12;
+    return 15;
 }
 
 ConfigurationData *ConfigurationData::loadFromCache(QDataStream &ds)
@@ -406,6 +409,9 @@ ConfigurationData *ConfigurationData::loadFromCache(QDataStream &ds)
        >> cd->logging.useAMConsoleLogger
        >> cd->installer.disable
        >> cd->installer.caCertificates
+       >> cd->installer.maximumConcurrentInstallations
+       >> cd->installer.deduplicateFiles
+       >> cd->installer.asynchronousRemoval
        >> cd->dbus.policies
        >> cd->dbus.registrations
        >> cd->quicklaunch.idleLoad
@@ -470,6 +476,9 @@ void ConfigurationData::saveToCache(QDataStream &ds) const
        << logging.useAMConsoleLogger
        << installer.disable
        << installer.caCertificates
+       << installer.maximumConcurrentInstallations
+       << installer.deduplicateFiles
+       << installer.asynchronousRemoval
        << dbus.policies
        << dbus.registrations
        << quicklaunch.idleLoad
@@ -571,6 +580,9 @@ void ConfigurationData::mergeFrom(const ConfigurationData *from)
     MERGE_FIELD(logging.useAMConsoleLogger);
     MERGE_FIELD(installer.disable);
     MERGE_FIELD(installer.caCertificates);
+    MERGE_FIELD(installer.maximumConcurrentInstallations);
+    MERGE_FIELD(installer.deduplicateFiles);
+    MERGE_FIELD(installer.asynchronousRemoval);
     MERGE_FIELD(dbus.policies);
     MERGE_FIELD(dbus.registrations);
     MERGE_FIELD(quicklaunch.idleLoad);
@@ -753,6 +765,12 @@ ConfigurationData *ConfigurationData::loadFromSource(QIODevice *source, const QS
                             cd->installer.disable = p->parseScalar().toBool(); } },
                       { "caCertificates", false, YamlParser::Scalar | YamlParser::List, [&cd](YamlParser *p) {
                             cd->installer.caCertificates = p->parseStringOrStringList(); } },
+                      { "maximumConcurrentInstallations", false, YamlParser::Scalar, [&cd](YamlParser *p) {
+                            cd->installer.maximumConcurrentInstallations = p->parseScalar().toInt(); } },
+                      { "deduplicateFiles", false, YamlParser::Scalar, [&cd](YamlParser *p) {
+                            cd->installer.deduplicateFiles = p->parseScalar().toBool(); } },
+                      { "asynchronousRemoval", false, YamlParser::Scalar, [&cd](YamlParser *p) {
+                            cd->installer.asynchronousRemoval = p->parseScalar().toBool(); } },
                   }); } },
             { "quicklaunch", false, YamlParser::Map, [&cd](YamlParser *p) {
                   p->parseFields({
@@ -926,6 +944,11 @@ bool Configuration::clearCache() const
     return value<bool>("clear-cache");
 }
 
+bool Configuration::verifyCache() const
+{
+    return value<bool>("verify-cache");
+}
+
 
 QStringList Configuration::builtinAppsManifestDirs() const
 {
@@ -1263,6 +1286,22 @@ QStringList Configuration::caCertificates() const
     return m_data->installer.caCertificates;
 }
 
+int Configuration::maximumConcurrentInstallations() const
+{
+    // every concurrent installation is a thread that buffers its download and extraction
+    return qBound(1, m_data->installer.maximumConcurrentInstallations, 16);
+}
+
+bool Configuration::deduplicateInstalledFiles() const
+{
+    return m_data->installer.deduplicateFiles;
+}
+
+bool Configuration::asynchronousPackageRemoval() const
+{
+    return m_data->installer.asynchronousRemoval;
+}
+
 QStringList Configuration::pluginFilePaths(const char *type) const
 {
     if (qstrcmp(type, "startup") == 0)
@@ -33,6 +33,7 @@ public:
 
     bool noCache() const;
     bool clearCache() const;
+    bool verifyCache() const;
 
     QStringList builtinAppsManifestDirs() const;
     QString documentDir() const;
@@ -102,6 +103,9 @@ public:
     QVariantMap managerCrashAction() const;
 
     QStringList caCertificates() const;
+    int maximumConcurrentInstallations() const;
+    bool deduplicateInstalledFiles() const;
+    bool asynchronousPackageRemoval() const;
 
     QStringList pluginFilePaths(const char *type) const;
 
@@ -70,6 +70,9 @@ struct ConfigurationData
     struct {
         bool disable = false;
         QStringList caCertificates;
+        int maximumConcurrentInstallations = 1;
+        bool deduplicateFiles = false;
+        bool asynchronousRemoval = false;
     } installer;
 
     struct {
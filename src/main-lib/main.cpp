@@ -78,6 +78,7 @@
 #include "gpustatus.h"
 
 #include "configuration.h"
+#include "configcache.h"
 #include "utilities.h"
 #include "exception.h"
 #include "crashhandler.h"
@@ -130,11 +131,26 @@ Main::Main(int &argc, char **argv)
             fputs("\n*** received SIGINT / Ctrl+C ... exiting ***\n\n", stderr);
         static_cast<Main *>(QCoreApplication::instance())->shutDown();
     });
+
+    // the config and package database caches are written on a worker thread: we do not wait for
+    // them, but we still want to know how long this took
+    AbstractConfigCache::setBackgroundWriteNotifier([this](const QString &cacheBaseName, qint64 usecs, bool success) {
+        const QString text = qSL("after background write of %1 cache (%2, took %3 msec)")
+                .arg(cacheBaseName, success ? qSL("success") : qSL("failed"))
+                .arg(double(usecs) / 1000, 0, 'f', 3);
+        QMetaObject::invokeMethod(this, [text]() {
+            StartupTimer::instance()->checkpoint(text);
+        }, Qt::QueuedConnection);
+    });
+
     StartupTimer::instance()->checkpoint("after application constructor");
 }
 
 Main::~Main()
 {
+    AbstractConfigCache::setBackgroundWriteNotifier({ });
+    AbstractConfigCache::waitForBackgroundWrites();
+
     delete m_engine;
 
     delete m_intentServer;
@@ -191,7 +207,7 @@ void Main::setup(const Configuration *cfg) Q_DECL_NOEXCEPT_EXPR(false)
                                cfg->openGLConfiguration(),
                                cfg->iconThemeSearchPaths(), cfg->iconThemeName());
 
-    loadPackageDatabase(cfg->clearCache() || cfg->noCache(), cfg->singleApp());
+    loadPackageDatabase(cfg->clearCache() || cfg->noCache(), cfg->singleApp(), cfg->verifyCache());
 
     setupSingletons(cfg->containerSelectionConfiguration());
     setupQuickLauncher(cfg->quickLaunchRuntimesPerContainer(), cfg->quickLaunchIdleLoad(),
@@ -207,7 +223,9 @@ void Main::setup(const Configuration *cfg) Q_DECL_NOEXCEPT_EXPR(false)
     if (m_installationDir.isEmpty() || cfg->disableInstaller())
         StartupTimer::instance()->checkpoint("skipping installer");
     else
-        setupInstaller(cfg->allowUnsignedPackages(), cfg->caCertificates());
+        setupInstaller(cfg->allowUnsignedPackages(), cfg->caCertificates(),
+                       cfg->maximumConcurrentInstallations(), cfg->deduplicateInstalledFiles(),
+                       cfg->asynchronousPackageRemoval());
 
     setLibraryPaths(libraryPaths() + cfg->pluginPaths());
     setupQmlEngine(cfg->importPaths(), cfg->style());
@@ -427,7 +445,8 @@ void Main::setupRuntimesAndContainers(const QVariantMap &runtimeConfigurations,
     StartupTimer::instance()->checkpoint("after runtime registration");
 }
 
-void Main::loadPackageDatabase(bool recreateDatabase, const QString &singlePackage) Q_DECL_NOEXCEPT_EXPR(false)
+void Main::loadPackageDatabase(bool recreateDatabase, const QString &singlePackage,
+                               bool verifyCache) Q_DECL_NOEXCEPT_EXPR(false)
 {
     if (!singlePackage.isEmpty()) {
         m_packageDatabase = new PackageDatabase(singlePackage);
@@ -437,6 +456,8 @@ void Main::loadPackageDatabase(bool recreateDatabase, const QString &singlePacka
         if (!recreateDatabase)
             m_packageDatabase->enableLoadFromCache();
         m_packageDatabase->enableSaveToCache();
+        if (verifyCache)
+            m_packageDatabase->enableFullCacheVerification();
     }
     m_packageDatabase->parse();
 
@@ -499,7 +520,9 @@ void Main::setupQuickLauncher(int quickLaunchRuntimesPerContainer, qreal quickLa
     }
 }
 
-void Main::setupInstaller(bool allowUnsigned, const QStringList &caCertificatePaths) Q_DECL_NOEXCEPT_EXPR(false)
+void Main::setupInstaller(bool allowUnsigned, const QStringList &caCertificatePaths,
+                          int maximumConcurrentInstallations, bool deduplicateFiles,
+                          bool asynchronousRemoval) Q_DECL_NOEXCEPT_EXPR(false)
 {
 #if !defined(AM_DISABLE_INSTALLER)
     if (Q_UNLIKELY(!PackageUtilities::checkCorrectLocale())) {
@@ -547,12 +570,19 @@ void Main::setupInstaller(bool allowUnsigned, const QStringList &caCertificatePa
         m_packageManager->setCACertificates(caCertificateList);
     }
 
+    m_packageManager->setMaximumConcurrentInstallations(maximumConcurrentInstallations);
+    m_packageManager->setDeduplicateInstalledFiles(deduplicateFiles);
+    m_packageManager->setRemoveAsynchronously(asynchronousRemoval);
+
     m_packageManager->enableInstaller();
 
     StartupTimer::instance()->checkpoint("after installer setup");
 #else
     Q_UNUSED(allowUnsigned)
     Q_UNUSED(caCertificatePaths)
+    Q_UNUSED(maximumConcurrentInstallations)
+    Q_UNUSED(deduplicateFiles)
+    Q_UNUSED(asynchronousRemoval)
 #endif // AM_DISABLE_INSTALLER
 }
 
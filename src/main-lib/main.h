@@ -75,13 +75,16 @@ protected:
                                     const QVariantMap &containerConfigurations, const QStringList &containerPluginPaths,
                                     const QVariantMap &openGLConfiguration,
                                     const QStringList &iconThemeSearchPaths, const QString &iconThemeName);
-    void loadPackageDatabase(bool recreateDatabase, const QString &singlePackage) Q_DECL_NOEXCEPT_EXPR(false);
+    void loadPackageDatabase(bool recreateDatabase, const QString &singlePackage,
+                             bool verifyCache = false) Q_DECL_NOEXCEPT_EXPR(false);
     void setupIntents(int disambiguationTimeout, int startApplicationTimeout,
                       int replyFromApplicationTimeout, int replyFromSystemTimeout) Q_DECL_NOEXCEPT_EXPR(false);
     void setupSingletons(const QList<QPair<QString, QString>> &containerSelectionConfiguration) Q_DECL_NOEXCEPT_EXPR(false);
     void setupQuickLauncher(int quickLaunchRuntimesPerContainer, qreal quickLaunchIdleLoad,
                             int failedStartLimit, int failedStartLimitIntervalSec) Q_DECL_NOEXCEPT_EXPR(false);
-    void setupInstaller(bool allowUnsigned, const QStringList &caCertificatePaths) Q_DECL_NOEXCEPT_EXPR(false);
+    void setupInstaller(bool allowUnsigned, const QStringList &caCertificatePaths,
+                        int maximumConcurrentInstallations, bool deduplicateFiles,
+                        bool asynchronousRemoval) Q_DECL_NOEXCEPT_EXPR(false);
     void registerPackages();
 
     void setupQmlEngine(const QStringList &importPaths, const QString &quickControlsStyle = QString());
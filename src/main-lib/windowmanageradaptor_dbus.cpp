@@ -20,6 +20,8 @@ WindowManagerAdaptor::WindowManagerAdaptor(QObject *parent)
             this, &WindowManagerAdaptor::countChanged);
     connect(WindowManager::instance(), &WindowManager::slowAnimationsChanged,
             this, &WindowManagerAdaptor::slowAnimationsChanged);
+    connect(WindowManager::instance(), &WindowManager::screenshotFinished,
+            this, &WindowManagerAdaptor::screenshotFinished);
 }
 
 WindowManagerAdaptor::~WindowManagerAdaptor()
@@ -50,6 +52,16 @@ void WindowManagerAdaptor::setSlowAnimations(bool slow)
     WindowManager::instance()->setSlowAnimations(slow);
 }
 
+bool WindowManagerAdaptor::reuseScreenshotBuffers() const
+{
+    return WindowManager::instance()->reuseScreenshotBuffers();
+}
+
+void WindowManagerAdaptor::setReuseScreenshotBuffers(bool reuse)
+{
+    WindowManager::instance()->setReuseScreenshotBuffers(reuse);
+}
+
 bool WindowManagerAdaptor::makeScreenshot(const QString &filename, const QString &selector)
 {
     AM_AUTHENTICATE_DBUS(bool)
@@ -358,6 +358,52 @@ ApplicationManagerPrivate::~ApplicationManagerPrivate()
     qDeleteAll(apps);
 }
 
+void ApplicationManagerPrivate::rebuildAppRows()
+{
+    appRows.clear();
+    appRows.reserve(apps.size());
+    // iterate backwards, so that the first application with a given id wins, just like a linear
+    // search would
+    for (int i = int(apps.size()) - 1; i >= 0; --i)
+        appRows.insert(apps.at(i)->id(), i);
+}
+
+void ApplicationManagerPrivate::updateRuntimeIndexes(Application *app)
+{
+    AbstractRuntime *rt = app->currentRuntime();
+
+    // most runtime state changes do not affect the keys
+    const auto it = runtimeIndexKeys.constFind(app);
+    if (rt && (it != runtimeIndexKeys.cend()) && (it->securityToken == rt->securityToken())
+            && (it->processId == rt->applicationProcessId())) {
+        return;
+    }
+
+    removeFromRuntimeIndexes(app);
+
+    if (rt) {
+        RuntimeIndexKeys keys { rt->securityToken(), rt->applicationProcessId() };
+        appsBySecurityToken.insert(keys.securityToken, app);
+        if (keys.processId)
+            appsByProcessId.insert(keys.processId, app);
+        runtimeIndexKeys.insert(app, keys);
+    }
+}
+
+void ApplicationManagerPrivate::removeFromRuntimeIndexes(Application *app)
+{
+    const auto it = runtimeIndexKeys.constFind(app);
+    if (it == runtimeIndexKeys.cend())
+        return;
+
+    const auto tokenIt = appsBySecurityToken.constFind(it->securityToken);
+    if ((tokenIt != appsBySecurityToken.cend()) && (tokenIt.value() == app))
+        appsBySecurityToken.erase(tokenIt);
+    if (it->processId)
+        appsByProcessId.remove(it->processId, app);
+    runtimeIndexKeys.erase(it);
+}
+
 ApplicationManager *ApplicationManager::s_instance = nullptr;
 
 ApplicationManager *ApplicationManager::createInstance(bool singleProcess)
@@ -516,11 +562,8 @@ QVector<Application *> ApplicationManager::applications() const
 
 Application *ApplicationManager::fromId(const QString &id) const
 {
-    for (Application *app : d->apps) {
-        if (app->id() == id)
-            return app;
-    }
-    return nullptr;
+    int row = d->appRows.value(id, -1);
+    return (row < 0) ? nullptr : d->apps.at(row);
 }
 
 QVector<Application *> ApplicationManager::fromProcessId(qint64 pid) const
@@ -532,9 +575,11 @@ QVector<Application *> ApplicationManager::fromProcessId(qint64 pid) const
 
     int level = 0;
     while ((pid > 1) && (pid != appmanPid) && (level < 5)) {
-        for (Application *app : d->apps) {
+        for (auto it = d->appsByProcessId.constFind(pid); it != d->appsByProcessId.cend() && it.key() == pid; ++it) {
+            Application *app = it.value();
             if (apps.contains(app))
                 continue;
+            // the index is updated on runtime state changes, but double-check anyway
             if (app->currentRuntime() && (app->currentRuntime()->applicationProcessId() == pid))
                 apps.append(app);
         }
@@ -549,10 +594,9 @@ Application *ApplicationManager::fromSecurityToken(const QByteArray &securityTok
     if (securityToken.size() != AbstractRuntime::SecurityTokenSize)
         return nullptr;
 
-    for (Application *app : d->apps) {
-        if (app->currentRuntime() && app->currentRuntime()->securityToken() == securityToken)
-            return app;
-    }
+    Application *app = d->appsBySecurityToken.value(securityToken);
+    if (app && app->currentRuntime() && (app->currentRuntime()->securityToken() == securityToken))
+        return app;
     return nullptr;
 }
 
@@ -1238,7 +1282,7 @@ void ApplicationManager::openUrlRelay(const QUrl &url)
 
 void ApplicationManager::emitDataChanged(Application *app, const QVector<int> &roles)
 {
-    int row = d->apps.indexOf(app);
+    int row = indexOfApplication(app);
     if (row >= 0) {
         emit dataChanged(index(row), index(row), roles);
 
@@ -1398,11 +1442,7 @@ Application *ApplicationManager::application(const QString &id) const
 */
 int ApplicationManager::indexOfApplication(const QString &id) const
 {
-    for (int i = 0; i < d->apps.size(); ++i) {
-        if (d->apps.at(i)->id() == id)
-            return i;
-    }
-    return -1;
+    return d->appRows.value(id, -1);
 }
 
 /*!
@@ -1413,6 +1453,12 @@ int ApplicationManager::indexOfApplication(const QString &id) const
 */
 int ApplicationManager::indexOfApplication(Application *application) const
 {
+    if (!application)
+        return -1;
+    int row = d->appRows.value(application->id(), -1);
+    if ((row >= 0) && (d->apps.at(row) == application))
+        return row;
+    // only needed while an updated package temporarily has two applications with the same id
     return d->apps.indexOf(application);
 }
 
@@ -1455,8 +1501,8 @@ void ApplicationManager::addApplication(ApplicationInfo *appInfo, Package *packa
 {
     // check for id clashes outside of the package (the scanner made sure the package itself is
     // consistent and doesn't have duplicates already)
-    for (Application *checkApp : std::as_const(d->apps)) {
-        if ((checkApp->id() == appInfo->id()) && (checkApp->package() != package)) {
+    if (Application *checkApp = fromId(appInfo->id())) {
+        if (checkApp->package() != package) {
             throw Exception("found an application with the same id in package %1")
                 .arg(checkApp->packageInfo()->id());
         }
@@ -1485,9 +1531,22 @@ void ApplicationManager::addApplication(ApplicationInfo *appInfo, Package *packa
             this, [this, app]() {
         emitDataChanged(app);
     });
+    connect(app, &Application::runtimeChanged,
+            this, [this, app]() {
+        d->updateRuntimeIndexes(app);
+        if (AbstractRuntime *rt = app->currentRuntime()) {
+            // the pid is only known after the process has been started
+            connect(rt, &AbstractRuntime::stateChanged, app, [this, app, rt]() {
+                if (app->currentRuntime() == rt)
+                    d->updateRuntimeIndexes(app);
+            });
+        }
+    });
 
     beginInsertRows(QModelIndex(), d->apps.count(), d->apps.count());
     d->apps << app;
+    if (!d->appRows.contains(appInfo->id()))
+        d->appRows.insert(appInfo->id(), int(d->apps.size()) - 1);
 
     endInsertRows();
 
@@ -1501,10 +1560,15 @@ void ApplicationManager::removeApplication(ApplicationInfo *appInfo, Package *pa
 {
     int index = -1;
 
-    for (int i = 0; i < d->apps.size(); ++i) {
-        if (d->apps.at(i)->info() == appInfo) {
-            index = i;
-            break;
+    int row = d->appRows.value(appInfo->id(), -1);
+    if ((row >= 0) && (d->apps.at(row)->info() == appInfo)) {
+        index = row;
+    } else {
+        for (int i = 0; i < d->apps.size(); ++i) {
+            if (d->apps.at(i)->info() == appInfo) {
+                index = i;
+                break;
+            }
         }
     }
     if (index < 0)
@@ -1518,6 +1582,8 @@ void ApplicationManager::removeApplication(ApplicationInfo *appInfo, Package *pa
 
     beginRemoveRows(QModelIndex(), index, index);
     auto app = d->apps.takeAt(index);
+    d->rebuildAppRows();
+    d->removeFromRuntimeIndexes(app);
 
     endRemoveRows();
 
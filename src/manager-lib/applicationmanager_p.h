@@ -9,6 +9,8 @@
 #include <QVariantMap>
 #include <QJSValue>
 #include <QSet>
+#include <QHash>
+#include <QMultiHash>
 #include <QtAppManCommon/global.h>
 #include <QtAppManManager/applicationmanager.h>
 
@@ -25,6 +27,23 @@ public:
 
     QVector<Application *> apps;
 
+    // secondary indexes into apps: these are needed for the lookups that happen on every D-Bus
+    // call, Wayland surface mapping and intent request, so they have to be kept in sync with apps
+    QHash<QString, int> appRows; // id -> row in apps (the lowest row wins on duplicates)
+    QHash<QByteArray, Application *> appsBySecurityToken;
+    QMultiHash<qint64, Application *> appsByProcessId;
+    // the keys each application is currently indexed under, so that they can be removed directly
+    struct RuntimeIndexKeys
+    {
+        QByteArray securityToken;
+        qint64 processId = 0;
+    };
+    QHash<Application *, RuntimeIndexKeys> runtimeIndexKeys;
+
+    void rebuildAppRows();
+    void updateRuntimeIndexes(Application *app);
+    void removeFromRuntimeIndexes(Application *app);
+
     QString currentLocale;
     QHash<int, QByteArray> roleNames;
 
@@ -0,0 +1,139 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDirIterator>
+#include <QCryptographicHash>
+
+#include "contentpool.h"
+#include "exception.h"
+#include "logging.h"
+
+#if defined(Q_OS_UNIX)
+#  include <sys/stat.h>
+#  include <unistd.h>
+#  include <errno.h>
+#  include <string.h>
+#endif
+
+QT_BEGIN_NAMESPACE_AM
+
+// pooling tiny files does not save anything, as each of them only occupies a single block
+static constexpr qint64 MinimumFileSize = 4096;
+
+QMutex ContentPool::s_mutex { };
+
+ContentPool::ContentPool(const QString &installationPath)
+    : m_path(installationPath + qL1C('/') + directoryName())
+{ }
+
+QString ContentPool::directoryName()
+{
+    return qSL(".content-pool");
+}
+
+QString ContentPool::path() const
+{
+    return m_path;
+}
+
+QString ContentPool::entryPath(const QString &key) const
+{
+    return m_path + qL1C('/') + key.left(2) + qL1C('/') + key;
+}
+
+QString ContentPool::add(const QString &filePath) Q_DECL_NOEXCEPT_EXPR(false)
+{
+#if defined(Q_OS_UNIX)
+    const QByteArray fileName = filePath.toLocal8Bit();
+    struct ::stat st;
+    if ((::lstat(fileName.constData(), &st) != 0) || !S_ISREG(st.st_mode) || (st.st_size < MinimumFileSize))
+        return { };
+
+    QFile f(filePath);
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    if (!f.open(QIODevice::ReadOnly) || !hash.addData(&f))
+        throw Exception(f, "could not read the file for the content pool");
+    f.close();
+
+    const QString key = QString::fromLatin1(hash.result().toHex())
+            + ((st.st_mode & S_IXUSR) ? qSL("x") : QString());
+    const QString poolPath = entryPath(key);
+    const QByteArray poolFileName = poolPath.toLocal8Bit();
+
+    QMutexLocker locker(&s_mutex);
+
+    struct ::stat poolSt;
+    if (::lstat(poolFileName.constData(), &poolSt) == 0) {
+        // files copied from the base version of a delta package are already linked to the pool
+        if ((poolSt.st_dev == st.st_dev) && (poolSt.st_ino == st.st_ino))
+            return key;
+
+        // link to the existing entry: the rename atomically replaces our own copy
+        const QByteArray tempFileName = fileName + ".pooled";
+        ::unlink(tempFileName.constData());
+        if (::link(poolFileName.constData(), tempFileName.constData()) == 0) {
+            if (::rename(tempFileName.constData(), fileName.constData()) == 0)
+                return key;
+            int errorCode = errno;
+            ::unlink(tempFileName.constData());
+            throw Exception(errorCode, "could not replace %1 with a link into the content pool").arg(filePath);
+        }
+    } else if (errno == ENOENT) {
+        if (!QDir().mkpath(QFileInfo(poolPath).path()))
+            throw Exception(Error::IO, "could not create a directory in the content pool for %1").arg(poolPath);
+
+        // new content: our file becomes the pool entry. Pooled files are shared between packages,
+        // so nobody is allowed to modify them anymore
+        if (::link(fileName.constData(), poolFileName.constData()) == 0) {
+            ::chmod(poolFileName.constData(), st.st_mode & 0555);
+            return key;
+        }
+    }
+
+    // EMLINK, EPERM, ...: the package just keeps its own copy of the file
+    qCDebug(LogInstaller) << "content pool: could not pool" << filePath << ":" << ::strerror(errno);
+    return { };
+#else
+    Q_UNUSED(filePath)
+    return { };
+#endif
+}
+
+int ContentPool::collectGarbage(const QStringList &keys)
+{
+    int count = 0;
+
+#if defined(Q_OS_UNIX)
+    QStringList entries;
+    if (keys.isEmpty()) {
+        QDirIterator it(m_path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (it.hasNext())
+            entries << it.next();
+    } else {
+        entries.reserve(keys.size());
+        for (const QString &key : keys)
+            entries << entryPath(key);
+    }
+
+    QMutexLocker locker(&s_mutex);
+
+    for (const QString &entry : std::as_const(entries)) {
+        const QByteArray fileName = entry.toLocal8Bit();
+        struct ::stat st;
+        if ((::lstat(fileName.constData(), &st) == 0) && (st.st_nlink <= 1)
+                && (::unlink(fileName.constData()) == 0)) {
+            ++count;
+        }
+    }
+    if (count)
+        qCDebug(LogInstaller) << "content pool: removed" << count << "unused entries";
+#else
+    Q_UNUSED(keys)
+#endif
+    return count;
+}
+
+QT_END_NAMESPACE_AM
@@ -0,0 +1,47 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+#include <QtCore/QMutex>
+
+#include <QtAppManCommon/global.h>
+
+QT_BEGIN_NAMESPACE_AM
+
+// Files with identical content are only stored once in the installation directory: the package
+// directories contain hard links into a content-addressed pool (<installationDir>/.content-pool).
+// Pool entries are named after the SHA-256 of the file's content, with an 'x' suffix for
+// executables, since all hard links share the same permissions.
+// Each package's InstallationReport records which of its files are pooled and under which key:
+// the link count of a pool entry is its reference count, so an entry with a link count of 1 is
+// not used by any package anymore and can be removed.
+
+class ContentPool
+{
+public:
+    explicit ContentPool(const QString &installationPath);
+
+    static QString directoryName();
+    QString path() const;
+
+    // Moves the file into the pool or replaces it with a hard link to an existing pool entry.
+    // Returns the pool key, or an empty string if the file was not pooled (e.g. if it is too small
+    // or the file-system does not support hard links).
+    QString add(const QString &filePath) Q_DECL_NOEXCEPT_EXPR(false);
+
+    // Removes all unused pool entries. If keys is not empty, only these entries are checked.
+    int collectGarbage(const QStringList &keys = { });
+
+private:
+    QString entryPath(const QString &key) const;
+
+    QString m_path;
+
+    // serializes all modifications of the pool, even across different installation tasks
+    static QMutex s_mutex;
+};
+
+QT_END_NAMESPACE_AM
@@ -10,6 +10,7 @@
 #include "package.h"
 #include "exception.h"
 #include "scopeutilities.h"
+#include "contentpool.h"
 #include "deinstallationtask.h"
 
 QT_BEGIN_NAMESPACE_AM
@@ -95,13 +96,37 @@ void DeinstallationTask::execute()
 
         // point of no return
 
+        // in asynchronous mode, the directories are just moved to the trash: removing a big
+        // package can take quite some time and the package is gone for all intents and purposes
+        const bool removeAsynchronously = PackageManager::instance()->removeAsynchronously();
+        QStringList trashedPaths;
+
         for (ScopedRenamer *toDelete : { &docDirRename, &appDirRename }) {
             if (toDelete->isRenamed()) {
-                if (!removeRecursiveHelper(toDelete->baseName() + qL1C('-')))
-                    qCCritical(LogInstaller) << "ERROR: could not remove" << (toDelete->baseName() + qL1C('-'));
+                const QString path = toDelete->baseName() + qL1C('-');
+                if (removeAsynchronously) {
+                    const QString trashedPath = moveToTrashHelper(path);
+                    if (!trashedPath.isEmpty()) {
+                        trashedPaths << trashedPath;
+                        continue;
+                    }
+                }
+                if (!removeRecursiveHelper(path))
+                    qCCritical(LogInstaller) << "ERROR: could not remove" << path;
             }
         }
 
+        // the pool entries that were only used by this package are not needed anymore
+        const QStringList poolKeys = package->info()->installationReport()->pooledFiles().values();
+        if (!trashedPaths.isEmpty()) {
+            removeRecursiveInBackground(trashedPaths, [installationPath = m_installationPath, poolKeys]() {
+                if (!poolKeys.isEmpty())
+                    ContentPool(installationPath).collectGarbage(poolKeys);
+            });
+        } else if (!poolKeys.isEmpty()) {
+            ContentPool(m_installationPath).collectGarbage(poolKeys);
+        }
+
         // we need to call those PackageManager methods in the correct thread
         bool finishOk = false;
         QMetaObject::invokeMethod(PackageManager::instance(), [this, &finishOk]()
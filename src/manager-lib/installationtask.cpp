@@ -4,8 +4,10 @@
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
 
 #include <QTemporaryDir>
+#include <QCryptographicHash>
 #include <QMessageAuthenticationCode>
 #include <QPointer>
+#include <QStorageInfo>
 
 #include "logging.h"
 #include "packagemanager_p.h"
@@ -20,6 +22,7 @@
 #include "utilities.h"
 #include "signature.h"
 #include "sudo.h"
+#include "contentpool.h"
 #include "installationtask.h"
 
 #include <memory>
@@ -40,6 +43,10 @@
   ======================
 
   PackageExtractor does its job
+  (delta packages are applied on top of <location>/<id>, which has to be the matching version)
+
+  if (deduplication)
+      replace files in <extractiondir> with hard links into <location>/.content-pool
 
 
   Step 3 -- finishInstallation()
@@ -81,7 +88,7 @@ public:
     { }
     ~TemporaryDir()
     {
-        recursiveOperation(path(), safeRemove);
+        removeRecursive(path());
     }
 private:
     Q_DISABLE_COPY_MOVE(TemporaryDir)
@@ -89,6 +96,9 @@ private:
 
 
 QMutex InstallationTask::s_serializeFinishInstallation { };
+QMutex InstallationTask::s_diskSpaceMutex { };
+QWaitCondition InstallationTask::s_diskSpaceWaitCondition { };
+quint64 InstallationTask::s_reservedDiskSpace = 0;
 
 InstallationTask::InstallationTask(const QString &installationPath, const QString &documentPath,
                                    const QUrl &sourceUrl, QObject *parent)
@@ -102,6 +112,11 @@ InstallationTask::InstallationTask(const QString &installationPath, const QStrin
 InstallationTask::~InstallationTask()
 { }
 
+QUrl InstallationTask::sourceUrl() const
+{
+    return m_sourceUrl;
+}
+
 bool InstallationTask::cancel()
 {
     QMutexLocker locker(&m_mutex);
@@ -114,9 +129,19 @@ bool InstallationTask::cancel()
     if (m_extractor)
         m_extractor->cancel();
     m_installationAcknowledgeWaitCondition.wakeAll();
+    locker.unlock();
+
+    // we might be waiting for disk space
+    QMutexLocker diskSpaceLocker(&s_diskSpaceMutex);
+    s_diskSpaceWaitCondition.wakeAll();
     return true;
 }
 
+QString InstallationTask::partialDownloadsDirectoryName()
+{
+    return qSL(".partial-downloads");
+}
+
 void InstallationTask::acknowledge()
 {
     QMutexLocker locker(&m_mutex);
@@ -147,13 +172,40 @@ void InstallationTask::execute()
         locker.unlock();
 
         connect(m_extractor, &PackageExtractor::progress, this, &AsynchronousTask::progress);
+        // the extractor lives in this thread, so a direct connection is safe here
+        connect(m_extractor, &PackageExtractor::progress, this, [this]() {
+            const QVariantMap stats = m_extractor->statistics();
+            quint64 written = stats.value(qSL("bytesExtracted")).toULongLong();
+            // everything read so far is also in the download checkpoint
+            if (m_checkpointDiskSpace)
+                written += stats.value(qSL("bytesRead")).toULongLong();
+            updateDiskSpaceReservation(written);
+        }, Qt::DirectConnection);
 
         m_extractor->setFileExtractedCallback(std::bind(&InstallationTask::checkExtractedFile,
                                                         this, std::placeholders::_1));
+        m_extractor->setDeltaBaseCallback(std::bind(&InstallationTask::deltaBaseDirectory, this,
+                                                    std::placeholders::_1, std::placeholders::_2));
+
+        // an interrupted download can be resumed by the next installation attempt of the same
+        // URL, even after a restart of the application manager
+        if ((m_sourceUrl.scheme() == qL1S("http")) || (m_sourceUrl.scheme() == qL1S("https"))) {
+            QDir installationDir(m_installationPath);
+            if (installationDir.mkpath(partialDownloadsDirectoryName())) {
+                const QString checkpointName = QString::fromLatin1(
+                            QCryptographicHash::hash(m_sourceUrl.toEncoded(), QCryptographicHash::Sha1).toHex());
+                m_extractor->setDownloadCheckpoint(installationDir.absoluteFilePath(
+                                                       partialDownloadsDirectoryName() + u'/' + checkpointName));
+            }
+        }
 
         if (!m_extractor->extract())
             throw Exception(m_extractor->errorCode(), m_extractor->errorString());
 
+        // everything is on disk now and accounted for in the free space of the installation
+        // device: there is no need to block other installations while we wait for an acknowledge
+        releaseDiskSpace();
+
         if (!m_foundInfo || !m_foundIcon)
             throw Exception(Error::Package, "package did not contain a valid info.yaml and icon file");
 
@@ -188,6 +240,17 @@ void InstallationTask::execute()
             }
         }
 
+        // files with the same content as files in other packages are only stored once
+        if (m_pm->deduplicateInstalledFiles()) {
+            ContentPool pool(m_installationPath);
+            const QStringList files = m_extractor->installationReport().files();
+            for (const QString &file : files) {
+                const QString key = pool.add(m_extractionDir.absoluteFilePath(file));
+                if (!key.isEmpty())
+                    m_pooledFiles.insert(file, key);
+            }
+        }
+
         emit finishedPackageExtraction();
         setState(AwaitingAcknowledge);
 
@@ -233,9 +296,19 @@ void InstallationTask::execute()
             if (!cancelOk)
                 qCWarning(LogInstaller) << "PackageManager could not remove package" << m_packageId << "after a failed installation";
         }
+
+        // the extracted files might have been added to the content pool already: remove the
+        // partial installation and then all pool entries that only it was referencing
+        m_installationDirCreator.destroy();
+        if (!m_pooledFiles.isEmpty()) {
+            ContentPool(m_installationPath).collectGarbage(m_pooledFiles.values());
+            m_pooledFiles.clear();
+        }
     }
 
 
+    releaseDiskSpace();
+
     {
         QMutexLocker locker(&m_mutex);
         delete m_extractor;
@@ -253,6 +326,11 @@ void InstallationTask::checkExtractedFile(const QString &file) Q_DECL_NOEXCEPT_E
             throw Exception(Error::Package, "info.yaml must be the first file in the package. Got %1")
                 .arg(file);
 
+        // the package header has been parsed at this point. A download checkpoint holds another
+        // copy of the complete package, until the download has finished.
+        m_checkpointDiskSpace = quint64(m_extractor->downloadCheckpointSize());
+        reserveDiskSpace(m_extractor->installationReport().diskSpaceUsed() + m_checkpointDiskSpace);
+
         m_package.reset(PackageInfo::fromManifest(m_extractor->destinationDirectory().absoluteFilePath(file)));
         if (m_package->id() != m_extractor->installationReport().packageId())
             throw Exception(Error::Package, "the package identifiers in --PACKAGE-HEADER--' and info.yaml do not match");
@@ -287,9 +365,14 @@ void InstallationTask::checkExtractedFile(const QString &file) Q_DECL_NOEXCEPT_E
     }
 
     if (m_foundIcon && m_foundInfo) {
+        // other installations of the same package could be extracting concurrently: the check
+        // and the claim have to happen in one go, before we touch the <id>+ directory
         bool doubleInstallation = false;
         QMetaObject::invokeMethod(PackageManager::instance(), [this, &doubleInstallation]() {
-            doubleInstallation = PackageManager::instance()->isPackageInstallationActive(m_packageId);
+            PackageManager *pm = PackageManager::instance();
+            doubleInstallation = pm->isPackageInstallationActive(m_packageId);
+            if (!doubleInstallation)
+                pm->d->installingPackages.insert(m_packageId, this);
         }, Qt::BlockingQueuedConnection);
         if (doubleInstallation)
             throw Exception(Error::Package, "Cannot install the same package %1 multiple times in parallel").arg(m_packageId);
@@ -352,6 +435,86 @@ void InstallationTask::checkExtractedFile(const QString &file) Q_DECL_NOEXCEPT_E
     }
 }
 
+// called from the extractor's decode thread: only the file-system is accessed in here
+QString InstallationTask::deltaBaseDirectory(const QString &packageId, const QByteArray &baseDigest) const Q_DECL_NOEXCEPT_EXPR(false)
+{
+    QDir baseDir(m_installationPath + qL1C('/') + packageId);
+    QFile reportFile(baseDir.absoluteFilePath(qSL(".installation-report.yaml")));
+    if (!reportFile.open(QFile::ReadOnly))
+        throw Exception(Error::Package, "cannot install the delta package for %1: the package is not installed").arg(packageId);
+
+    InstallationReport report;
+    try {
+        report.deserialize(&reportFile);
+    } catch (const Exception &e) {
+        throw Exception(Error::Package, "cannot install the delta package for %1: %2").arg(packageId).arg(e.errorString());
+    }
+
+    if (report.digest() != baseDigest) {
+        throw Exception(Error::Package, "cannot install the delta package for %1: it was created for the version with digest %2, but %3 is installed")
+                .arg(packageId).arg(QString::fromLatin1(baseDigest.toHex()))
+                .arg(QString::fromLatin1(report.digest().toHex()));
+    }
+    return baseDir.absolutePath();
+}
+
+// Waits until the package fits onto the installation device, next to all the other packages that
+// are currently being installed. The reservation is only an estimate: it is based on the
+// diskSpaceUsed field of the package header and shrinks while the package is being written (see
+// updateDiskSpaceReservation()), as the written data already reduces the free space.
+void InstallationTask::reserveDiskSpace(quint64 size) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    QMutexLocker locker(&s_diskSpaceMutex);
+
+    forever {
+        {
+            QMutexLocker cancelLocker(&m_mutex);
+            if (m_canceled)
+                throw Exception(Error::Canceled, "canceled");
+        }
+
+        const QStorageInfo storage(m_installationPath);
+        const qint64 available = storage.isValid() ? storage.bytesAvailable() : -1;
+
+        // we cannot do any admission control, if the free space cannot be determined
+        if ((available < 0) || ((s_reservedDiskSpace + size) <= quint64(available))) {
+            s_reservedDiskSpace += size;
+            m_reservedDiskSpace = size;
+            m_estimatedDiskSpace = size;
+            return;
+        }
+        if (!s_reservedDiskSpace) {
+            throw Exception(Error::StorageSpace, "not enough free space on the installation device: the package needs %1 bytes, but only %2 bytes are available")
+                    .arg(size).arg(available);
+        }
+
+        qCDebug(LogInstaller) << "task" << id() << "is waiting for" << size << "bytes of free disk space";
+        s_diskSpaceWaitCondition.wait(&s_diskSpaceMutex);
+    }
+}
+
+// only the part of the estimate that has not been written yet stays reserved
+void InstallationTask::updateDiskSpaceReservation(quint64 writtenSize)
+{
+    QMutexLocker locker(&s_diskSpaceMutex);
+    const quint64 outstanding = m_estimatedDiskSpace - qMin(m_estimatedDiskSpace, writtenSize);
+    if (outstanding < m_reservedDiskSpace) {
+        s_reservedDiskSpace -= (m_reservedDiskSpace - outstanding);
+        m_reservedDiskSpace = outstanding;
+        s_diskSpaceWaitCondition.wakeAll();
+    }
+}
+
+void InstallationTask::releaseDiskSpace()
+{
+    QMutexLocker locker(&s_diskSpaceMutex);
+    if (m_reservedDiskSpace) {
+        s_reservedDiskSpace -= m_reservedDiskSpace;
+        m_reservedDiskSpace = 0;
+        s_diskSpaceWaitCondition.wakeAll();
+    }
+}
+
 void InstallationTask::startInstallation() Q_DECL_NOEXCEPT_EXPR(false)
 {
     // 2. delete old, partial installation
@@ -382,8 +545,22 @@ void InstallationTask::finishInstallation() Q_DECL_NOEXCEPT_EXPR(false)
     if (m_applicationDir.exists())
         mode = Update;
 
+    // the pool entries of the old version might not be needed anymore after the update
+    QStringList oldPoolKeys;
+    if (mode == Update) {
+        QFile oldReportFile(m_applicationDir.absoluteFilePath(qSL(".installation-report.yaml")));
+        if (oldReportFile.open(QFile::ReadOnly)) {
+            try {
+                InstallationReport oldReport(m_packageId);
+                oldReport.deserialize(&oldReportFile);
+                oldPoolKeys = oldReport.pooledFiles().values();
+            } catch (const Exception &) { }
+        }
+    }
+
     // create the installation report
     InstallationReport report = m_extractor->installationReport();
+    report.setPooledFiles(m_pooledFiles);
 
     QFile reportFile(m_extractionDir.absoluteFilePath(qSL(".installation-report.yaml")));
     if (!reportFile.open(QFile::WriteOnly) || !report.serialize(&reportFile))
@@ -425,8 +602,21 @@ void InstallationTask::finishInstallation() Q_DECL_NOEXCEPT_EXPR(false)
     m_installationDirCreator.take();
 
     // this should not be necessary, but it also won't hurt
-    if (mode == Update)
-        removeRecursiveHelper(m_applicationDir.absolutePath() + qL1C('-'));
+    if (mode == Update) {
+        const QString oldPath = m_applicationDir.absolutePath() + qL1C('-');
+        const QString trashedPath = m_pm->removeAsynchronously() ? moveToTrashHelper(oldPath) : QString();
+
+        if (!trashedPath.isEmpty()) {
+            removeRecursiveInBackground({ trashedPath }, [installationPath = m_installationPath, oldPoolKeys]() {
+                if (!oldPoolKeys.isEmpty())
+                    ContentPool(installationPath).collectGarbage(oldPoolKeys);
+            });
+        } else {
+            removeRecursiveHelper(oldPath);
+            if (!oldPoolKeys.isEmpty())
+                ContentPool(m_installationPath).collectGarbage(oldPoolKeys);
+        }
+    }
 
 #ifdef Q_OS_UNIX
     // write files to the filesystem
@@ -33,9 +33,14 @@ public:
                      const QUrl &sourceUrl, QObject *parent = nullptr);
     ~InstallationTask() override;
 
+    QUrl sourceUrl() const;
+
     void acknowledge();
     bool cancel() override;
 
+    // the sub-directory of the installation path, where interrupted downloads are kept
+    static QString partialDownloadsDirectoryName();
+
 signals:
     void finishedPackageExtraction();
 
@@ -46,6 +51,10 @@ private:
     void startInstallation() Q_DECL_NOEXCEPT_EXPR(false);
     void finishInstallation() Q_DECL_NOEXCEPT_EXPR(false);
     void checkExtractedFile(const QString &file) Q_DECL_NOEXCEPT_EXPR(false);
+    QString deltaBaseDirectory(const QString &packageId, const QByteArray &baseDigest) const Q_DECL_NOEXCEPT_EXPR(false);
+    void reserveDiskSpace(quint64 size) Q_DECL_NOEXCEPT_EXPR(false);
+    void updateDiskSpaceReservation(quint64 writtenSize);
+    void releaseDiskSpace();
 
 private:
     PackageManager *m_pm;
@@ -60,6 +69,7 @@ private:
     std::unique_ptr<PackageInfo> m_package;
     std::unique_ptr<Package> m_tempPackageForAcknowledge;
     std::vector<std::unique_ptr<Application>> m_tempApplicationsForAcknowledge;
+    QMap<QString, QString> m_pooledFiles;
 
     // changes to these 4 member variables are protected by m_mutex
     PackageExtractor *m_extractor = nullptr;
@@ -69,6 +79,14 @@ private:
 
     static QMutex s_serializeFinishInstallation;
 
+    // the free space on the installation device is shared between all concurrent installations
+    quint64 m_estimatedDiskSpace = 0; // for the complete package
+    quint64 m_reservedDiskSpace = 0; // the part not written yet
+    quint64 m_checkpointDiskSpace = 0; // included in the estimate
+    static QMutex s_diskSpaceMutex;
+    static QWaitCondition s_diskSpaceWaitCondition;
+    static quint64 s_reservedDiskSpace;
+
     QDir m_applicationDir;
     QDir m_extractionDir;
 
@@ -224,6 +224,12 @@ void IntentServerAMImplementation::requestToApplication(IntentServerSystemInterf
     reinterpret_cast<IntentServerIpcConnection *>(clientIPC)->requestToApplication(isr);
 }
 
+void IntentServerAMImplementation::requestsToApplication(IntentServerSystemInterface::IpcConnection *clientIPC,
+                                                         const QVector<IntentServerRequest *> &requests)
+{
+    reinterpret_cast<IntentServerIpcConnection *>(clientIPC)->requestsToApplication(requests);
+}
+
 void IntentServerAMImplementation::replyFromSystem(IntentServerSystemInterface::IpcConnection *clientIPC,
                                                    IntentServerRequest *isr)
 {
@@ -361,6 +367,12 @@ bool IntentServerIpcConnection::isInProcess() const
     return m_inprocess;
 }
 
+void IntentServerIpcConnection::requestsToApplication(const QVector<IntentServerRequest *> &requests)
+{
+    for (auto *isr : requests)
+        requestToApplication(isr);
+}
+
 
 // ^^^ IntentServerIpcConnection ^^^
 //////////////////////////////////////////////////////////////////////////
@@ -400,14 +412,22 @@ QString IntentServerInProcessIpcConnection::applicationId() const
 }
 
 void IntentServerInProcessIpcConnection::requestToApplication(IntentServerRequest *isr)
+{
+    requestsToApplication({ isr });
+}
+
+void IntentServerInProcessIpcConnection::requestsToApplication(const QVector<IntentServerRequest *> &requests)
 {
     // we need decouple the server/client interface at this point to have a consistent
-    // behavior in single- and multi-process mode
-    QMetaObject::invokeMethod(this, [this, isr]() {
+    // behavior in single- and multi-process mode, but one event loop round trip is enough for
+    // all the requests in a batch
+    QMetaObject::invokeMethod(this, [this, requests]() {
         auto clientInterface = m_interface->intentClientSystemInterface();
-        emit clientInterface->requestToApplication(isr->requestId(), isr->intentId(),
-                                                   isr->isBroadcast() ? qSL(":broadcast:") : isr->requestingApplicationId(),
-                                                   isr->selectedIntent()->applicationId(), isr->parameters());
+        for (auto *isr : requests) {
+            emit clientInterface->requestToApplication(isr->requestId(), isr->intentId(),
+                                                       isr->isBroadcast() ? qSL(":broadcast:") : isr->requestingApplicationId(),
+                                                       isr->selectedIntent()->applicationId(), isr->parameters());
+        }
     }, Qt::QueuedConnection);
 }
 
@@ -736,6 +756,7 @@ void IntentServerHandler::setParameterMatch(const QVariantMap &parameterMatch)
         return;
     }
     m_intent->m_parameterMatch = parameterMatch;
+    m_intent->compileParameterMatch();
 }
 
 void IntentServerHandler::componentComplete()
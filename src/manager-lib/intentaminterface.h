@@ -55,6 +55,7 @@ public:
 
     void startApplication(const QString &appId) override;
     void requestToApplication(IpcConnection *clientIPC, IntentServerRequest *isr) override;
+    void requestsToApplication(IpcConnection *clientIPC, const QVector<IntentServerRequest *> &requests) override;
     void replyFromSystem(IpcConnection *clientIPC, IntentServerRequest *isr) override;
 
 private:
@@ -96,6 +97,7 @@ public:
 
     virtual void replyFromSystem(IntentServerRequest *isr) = 0;
     virtual void requestToApplication(IntentServerRequest *isr) = 0;
+    virtual void requestsToApplication(const QVector<IntentServerRequest *> &requests);
 
 signals:
     void applicationIsReady(const QString &applicationId);
@@ -124,6 +126,7 @@ public:
 
     void replyFromSystem(IntentServerRequest *isr) override;
     void requestToApplication(IntentServerRequest *isr) override;
+    void requestsToApplication(const QVector<IntentServerRequest *> &requests) override;
 
 private:
     IntentServerInProcessIpcConnection(Application *application, IntentServerAMImplementation *iface);
@@ -5,7 +5,6 @@
 
 #include <QVariant>
 #include <QCoreApplication>
-#include <QTimer>
 #include <QMetaObject>
 
 #include "global.h"
@@ -17,6 +16,7 @@
 #include "dbus-utilities.h"
 #include "package.h"
 #include "notificationmodel.h"
+#include "timerwheel.h"
 #include "qmlinprocnotificationimpl.h"
 
 /*!
@@ -188,7 +188,7 @@ struct NotificationData
     int timeout;
     QVariantMap extended;
 
-    QTimer *timer = nullptr;
+    TimerWheel::TimerId timeoutId = 0;
 };
 
 enum CloseReason
@@ -598,14 +598,11 @@ uint NotificationManager::notifyHelper(const QString &app_name, uint id, bool re
     }
 
     if (timeout > 0) {
-        delete n->timer;
-        QTimer *t = new QTimer(this);
-        connect(t, &QTimer::timeout,
-                this, [this, id, t]() {
-            d->closeNotification(id, TimeoutExpired); t->deleteLater();
+        auto timerWheel = TimerWheel::instance();
+        timerWheel->cancel(n->timeoutId);
+        n->timeoutId = timerWheel->start(timeout, this, [this, id]() {
+            d->closeNotification(id, TimeoutExpired);
         });
-        t->start(timeout);
-        n->timer = t;
     }
 
     qCDebug(LogNotifications) << "  -> returning id" << id;
@@ -636,6 +633,7 @@ void NotificationManagerPrivate::closeNotification(uint id, CloseReason reason)
         emit q->NotificationClosed(id, uint(reason));
 
         qCDebug(LogNotifications) << "Deleting notification with id:" << id;
+        TimerWheel::instance()->cancel(n->timeoutId);
         delete n;
     }
 }
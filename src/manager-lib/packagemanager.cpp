@@ -7,6 +7,8 @@
 #include <QQmlEngine>
 #include <QVersionNumber>
 #include <QCoreApplication>
+#include <QDateTime>
+#include <QUuid>
 #include "packagemanager.h"
 #include "packagedatabase.h"
 #include "packagemanager_p.h"
@@ -22,6 +24,7 @@
 #if !defined(AM_DISABLE_INSTALLER)
 #  include "installationtask.h"
 #  include "deinstallationtask.h"
+#  include "contentpool.h"
 #endif
 
 #if defined(Q_OS_WIN)
@@ -390,6 +393,8 @@ Package *PackageManager::registerPackage(PackageInfo *packageInfo, PackageInfo *
     }
 
     d->packages << package;
+    if (!d->packageRows.contains(package->id()))
+        d->packageRows.insert(package->id(), int(d->packages.size()) - 1);
 
     qCDebug(LogSystem).nospace().noquote() << " + package: " << package->id() << " [at: "
                                            << QDir().relativeFilePath(package->info()->baseDir().path()) << "]";
@@ -479,6 +484,14 @@ void PackageManager::registerQmlTypes()
     s_roleNames.insert(PMRoles::PackageObject, "packageObject");
 }
 
+void PackageManagerPrivate::rebuildPackageRows()
+{
+    packageRows.clear();
+    packageRows.reserve(packages.size());
+    for (int i = int(packages.size()) - 1; i >= 0; --i)
+        packageRows.insert(packages.at(i)->id(), i);
+}
+
 PackageManager::PackageManager(PackageDatabase *packageDatabase,
                                const QString &documentPath)
     : QAbstractListModel()
@@ -499,11 +512,8 @@ PackageManager::~PackageManager()
 
 Package *PackageManager::fromId(const QString &id) const
 {
-    for (auto package : d->packages) {
-        if (package->id() == id)
-            return package;
-    }
-    return nullptr;
+    int row = d->packageRows.value(id, -1);
+    return (row < 0) ? nullptr : d->packages.at(row);
 }
 
 QVariantMap PackageManager::get(Package *package) const
@@ -519,7 +529,9 @@ QVariantMap PackageManager::get(Package *package) const
 
 void PackageManager::emitDataChanged(Package *package, const QVector<int> &roles)
 {
-    int row = d->packages.indexOf(package);
+    int row = d->packageRows.value(package->id(), -1);
+    if ((row >= 0) && (d->packages.at(row) != package))
+        row = d->packages.indexOf(package);
     if (row >= 0) {
         emit dataChanged(index(row), index(row), roles);
 
@@ -656,11 +668,7 @@ Package *PackageManager::package(const QString &id) const
 */
 int PackageManager::indexOfPackage(const QString &id) const
 {
-    for (int i = 0; i < d->packages.size(); ++i) {
-        if (d->packages.at(i)->id() == id)
-            return i;
-    }
-    return -1;
+    return d->packageRows.value(id, -1);
 }
 
 /*!
@@ -756,6 +764,61 @@ void PackageManager::setCACertificates(const QList<QByteArray> &chainOfTrust)
     d->chainOfTrust = chainOfTrust;
 }
 
+int PackageManager::maximumConcurrentInstallations() const
+{
+#if defined(AM_DISABLE_INSTALLER)
+    return 0;
+#else
+    return d->maximumConcurrentInstallations;
+#endif
+}
+
+void PackageManager::setMaximumConcurrentInstallations(int maximum)
+{
+#if defined(AM_DISABLE_INSTALLER)
+    Q_UNUSED(maximum)
+#else
+    d->maximumConcurrentInstallations = qMax(1, maximum);
+    triggerExecuteNextTask();
+#endif
+}
+
+bool PackageManager::deduplicateInstalledFiles() const
+{
+#if defined(AM_DISABLE_INSTALLER)
+    return false;
+#else
+    return d->deduplicateInstalledFiles;
+#endif
+}
+
+void PackageManager::setDeduplicateInstalledFiles(bool enable)
+{
+#if defined(AM_DISABLE_INSTALLER)
+    Q_UNUSED(enable)
+#else
+    d->deduplicateInstalledFiles = enable;
+#endif
+}
+
+bool PackageManager::removeAsynchronously() const
+{
+#if defined(AM_DISABLE_INSTALLER)
+    return false;
+#else
+    return d->removeAsynchronously;
+#endif
+}
+
+void PackageManager::setRemoveAsynchronously(bool enable)
+{
+#if defined(AM_DISABLE_INSTALLER)
+    Q_UNUSED(enable)
+#else
+    d->removeAsynchronously = enable;
+#endif
+}
+
 static QVariantMap locationMap(const QString &path)
 {
     QString cpath = QFileInfo(path).canonicalPath();
@@ -838,10 +901,16 @@ QVariantMap PackageManager::documentLocation() const
 
 bool PackageManager::isPackageInstallationActive(const QString &packageId) const
 {
+#if !defined(AM_DISABLE_INSTALLER)
+    if (d->installingPackages.contains(packageId))
+        return true;
     for (const auto *t : std::as_const(d->installationTaskList)) {
         if (t->packageId() == packageId)
             return true;
     }
+#else
+    Q_UNUSED(packageId)
+#endif
     return false;
 }
 
@@ -858,9 +927,33 @@ void PackageManager::cleanupBrokenInstallations() Q_DECL_NOEXCEPT_EXPR(false)
     QMultiMap<QString, QString> validPaths;
     if (!d->documentPath.isEmpty())
         validPaths.insert(d->documentPath, QString());
-    if (!d->installationPath.isEmpty())
+    if (!d->installationPath.isEmpty()) {
         validPaths.insert(d->installationPath, QString());
 
+        // interrupted downloads are kept for resuming, but not forever
+        const QString partialDownloadsName = InstallationTask::partialDownloadsDirectoryName();
+        QDir partialDownloadsDir(d->installationPath + QDir::separator() + partialDownloadsName);
+        if (partialDownloadsDir.exists()) {
+            validPaths.insert(d->installationPath, partialDownloadsName + QDir::separator());
+
+            const QDateTime expired = QDateTime::currentDateTime().addDays(-7);
+            const auto partialDownloads = partialDownloadsDir.entryInfoList(QDir::Files | QDir::Hidden);
+            for (const QFileInfo &fi : partialDownloads) {
+                if (fi.lastModified() < expired) {
+                    qCDebug(LogInstaller) << "cleanup: removing expired partial download" << fi.fileName();
+                    QFile::remove(fi.absoluteFilePath());
+                }
+            }
+        }
+    }
+
+    // the content pool has to be kept, even if deduplication is not enabled anymore: the packages
+    // that were installed with deduplication enabled still link into it
+    const bool hasContentPool = !d->installationPath.isEmpty()
+            && QFileInfo(ContentPool(d->installationPath).path()).isDir();
+    if (hasContentPool)
+        validPaths.insert(d->installationPath, ContentPool::directoryName() + QDir::separator());
+
     for (Package *pkg : d->packages) { // we want to detach here!
         const InstallationReport *ir = pkg->info()->installationReport();
         if (ir) {
@@ -907,6 +1000,7 @@ void PackageManager::cleanupBrokenInstallations() Q_DECL_NOEXCEPT_EXPR(false)
 
     // Remove everything that is not referenced from the app-db
 
+    QStringList leftovers;
     for (auto it = validPaths.cbegin(); it != validPaths.cend(); ) {
         const QString currentDir = it.key();
 
@@ -925,14 +1019,41 @@ void PackageManager::cleanupBrokenInstallations() Q_DECL_NOEXCEPT_EXPR(false)
 
             if ((!fi.isDir() && !fi.isFile()) || !validNames.contains(name)) {
                 qCDebug(LogInstaller) << "cleanup: removing unreferenced inode" << name;
-
-                if (!removeRecursiveHelper(fi.absoluteFilePath())) {
-                    throw Exception(Error::IO, "could not remove broken installation leftover %1 (maybe due to missing root privileges)")
-                        .arg(fi.absoluteFilePath());
-                }
+                leftovers << fi.absoluteFilePath();
             }
         }
     }
+
+    if (!leftovers.isEmpty()) {
+        const QStringList failed = removeRecursiveHelper(leftovers);
+        if (!failed.isEmpty()) {
+            throw Exception(Error::IO, "could not remove broken installation leftover %1 (maybe due to missing root privileges)")
+                .arg(failed.constFirst());
+        }
+    }
+
+    // now that all leftovers are gone, the pool entries of failed installations are unused
+    if (hasContentPool)
+        ContentPool(d->installationPath).collectGarbage();
+
+    // anything still in the trash was not completely removed before the last shutdown: this is
+    // done in the background, so it doesn't delay the startup
+    QStringList trashedPaths;
+    for (const QString &path : { d->installationPath, d->documentPath }) {
+        if (path.isEmpty())
+            continue;
+        QDir trashDir(path + QDir::separator() + trashDirectoryName());
+        const auto trashEntries = trashDir.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+        for (const QFileInfo &fi : trashEntries)
+            trashedPaths << fi.absoluteFilePath();
+    }
+    if (!trashedPaths.isEmpty()) {
+        qCDebug(LogInstaller) << "cleanup: emptying the trash in the background";
+        removeRecursiveInBackground(trashedPaths, [installationPath = d->installationPath, hasContentPool]() {
+            if (hasContentPool)
+                ContentPool(installationPath).collectGarbage();
+        });
+    }
 #endif // !defined(AM_DISABLE_INSTALLER)
 
     d->cleanupBrokenInstallationsDone = true;
@@ -1051,6 +1172,11 @@ QString PackageManager::startPackageInstallation(const QUrl &sourceUrl)
     be canceled by calling cancelTask().
     Failing to do one or the other will leave an unfinished "zombie" installation.
 
+    Downloads via \c http or \c https are resumed automatically after short network outages, if
+    the server supports range requests. If the download still fails with a network error, the
+    data received so far is kept in the installation directory for a week: calling this function
+    again with the same \a sourceUrl will only download the missing part of the package.
+
     Returns a unique \c taskId. This can also be an empty string, if the task could not be
     created (in this case, no signals will be emitted).
 */
@@ -1219,10 +1345,12 @@ bool PackageManager::cancelTask(const QString &taskId)
             }
         }
 
-        // the active task and async tasks might be in a state where cancellation is not possible,
+        // the active tasks and async tasks might be in a state where cancellation is not possible,
         // so we have to ask them nicely
-        if (d->activeTask && d->activeTask->id() == taskId)
-            return d->activeTask->cancel();
+        for (AsynchronousTask *task : std::as_const(d->activeTasks)) {
+            if (task->id() == taskId)
+                return task->cancel();
+        }
 
         for (AsynchronousTask *task : std::as_const(d->installationTaskList)) {
             if (task->id() == taskId)
@@ -1256,26 +1384,68 @@ void PackageManager::triggerExecuteNextTask()
 #endif
 }
 
+#if !defined(AM_DISABLE_INSTALLER)
+bool PackageManagerPrivate::canStartTask(AsynchronousTask *task) const
+{
+    if (activeTasks.isEmpty())
+        return true;
+
+    // Installations can download and extract in parallel, up to the configured limit: they only
+    // touch the file-system in their own <id>+ directories, until the final, serialized rename.
+    // All other tasks (removals) need exclusive access.
+    auto *installationTask = qobject_cast<InstallationTask *>(task);
+    if (!installationTask || (activeTasks.size() >= maximumConcurrentInstallations))
+        return false;
+
+    for (const AsynchronousTask *activeTask : activeTasks) {
+        auto *activeInstallationTask = qobject_cast<const InstallationTask *>(activeTask);
+        if (!activeInstallationTask)
+            return false;
+        // both would use the same partial download checkpoint
+        if (activeInstallationTask->sourceUrl() == installationTask->sourceUrl())
+            return false;
+    }
+    return true;
+}
+#endif
+
 void PackageManager::executeNextTask()
 {
 #if defined(AM_DISABLE_INSTALLER)
     Q_ASSERT_X(false, "PackageManager::executeNextTask", "Installer is disabled");
 #else
-    if (!d->cleanupBrokenInstallationsDone || d->activeTask || d->incomingTaskList.isEmpty())
+    if (!d->cleanupBrokenInstallationsDone)
         return;
 
-    AsynchronousTask *task = d->incomingTaskList.takeFirst();
+    // tasks are started strictly in the order they were enqueued
+    while (!d->incomingTaskList.isEmpty()) {
+        AsynchronousTask *task = d->incomingTaskList.constFirst();
 
-    if (task->hasFailed()) {
-        task->setState(AsynchronousTask::Failed);
+        if (task->hasFailed()) {
+            d->incomingTaskList.removeFirst();
+            task->setState(AsynchronousTask::Failed);
 
-        handleFailure(task);
+            handleFailure(task);
 
-        task->deleteLater();
-        triggerExecuteNextTask();
-        return;
+            task->deleteLater();
+            continue;
+        }
+
+        if (!d->canStartTask(task))
+            break;
+
+        d->incomingTaskList.removeFirst();
+        executeTask(task);
     }
+#endif
+}
 
+void PackageManager::executeTask(AsynchronousTask *task)
+{
+#if defined(AM_DISABLE_INSTALLER)
+    Q_UNUSED(task)
+    Q_ASSERT_X(false, "PackageManager::executeTask", "Installer is disabled");
+#else
     connect(task, &AsynchronousTask::started, this, [this, task]() {
         emit taskStarted(task->id());
     });
@@ -1306,9 +1476,10 @@ void PackageManager::executeNextTask()
             emit taskFinished(task->id());
         }
 
-        if (d->activeTask == task)
-            d->activeTask = nullptr;
+        d->activeTasks.removeOne(task);
         d->installationTaskList.removeOne(task);
+        if (d->installingPackages.value(task->packageId()) == task)
+            d->installingPackages.remove(task->packageId());
 
         delete task;
         triggerExecuteNextTask();
@@ -1322,15 +1493,13 @@ void PackageManager::executeNextTask()
             // we can now start the next download in parallel - the InstallationTask will take care
             // of serializing the final installation steps on its own as soon as it gets the
             // required acknowledge (or cancel).
-            if (d->activeTask == task)
-                d->activeTask = nullptr;
+            d->activeTasks.removeOne(task);
             d->installationTaskList.append(task);
             triggerExecuteNextTask();
         });
     }
 
-
-    d->activeTask = task;
+    d->activeTasks.append(task);
     task->setState(AsynchronousTask::Executing);
     task->start();
 #endif
@@ -1480,6 +1649,7 @@ bool PackageManager::finishedPackageInstall(const QString &id)
             emit packageAboutToBeRemoved(package->id());
             beginRemoveRows(QModelIndex(), row, row);
             d->packages.removeAt(row);
+            d->rebuildPackageRows();
             endRemoveRows();
         }
 
@@ -1514,6 +1684,7 @@ bool PackageManager::canceledPackageInstall(const QString &id)
             emit packageAboutToBeRemoved(package->id());
             beginRemoveRows(QModelIndex(), row, row);
             d->packages.removeAt(row);
+            d->rebuildPackageRows();
             endRemoveRows();
         }
 
@@ -1624,7 +1795,66 @@ bool removeRecursiveHelper(const QString &path)
     if (SudoClient::instance())
         return SudoClient::instance()->removeRecursive(path);
     else
-        return recursiveOperation(path, safeRemove);
+        return removeRecursive(path, QThread::idealThreadCount());
+}
+
+QStringList removeRecursiveHelper(const QStringList &paths)
+{
+    QStringList failed;
+
+    if (auto *sudo = SudoClient::instance()) {
+        SudoClient::Batch batch;
+        for (const QString &path : paths)
+            batch.removeRecursive(path);
+        const auto results = sudo->execute(batch);
+        for (int i = 0; i < paths.size(); ++i) {
+            if (!results.value(i).success)
+                failed << paths.at(i);
+        }
+    } else {
+        for (const QString &path : paths) {
+            if (!removeRecursive(path, QThread::idealThreadCount()))
+                failed << path;
+        }
+    }
+    return failed;
+}
+
+QString trashDirectoryName()
+{
+    return qSL(".trash");
+}
+
+QString moveToTrashHelper(const QString &path)
+{
+    QFileInfo fi(path);
+    QDir trashDir = fi.dir();
+    if (!trashDir.mkpath(trashDirectoryName()) || !trashDir.cd(trashDirectoryName()))
+        return { };
+
+    // the same package can end up in the trash multiple times, before the trash is emptied
+    const QString trashPath = trashDir.absoluteFilePath(fi.fileName() + qL1C('.')
+                                                        + QUuid::createUuid().toString(QUuid::Id128));
+    if (!QDir().rename(fi.absoluteFilePath(), trashPath))
+        return { };
+    return trashPath;
+}
+
+void removeRecursiveInBackground(const QStringList &paths, const std::function<void()> &afterRemoval)
+{
+    QThread *thread = QThread::create([paths, afterRemoval]() {
+        const QStringList failed = removeRecursiveHelper(paths);
+        for (const QString &path : failed)
+            qCWarning(LogInstaller) << "could not remove" << path << "in the background";
+        if (afterRemoval)
+            afterRemoval();
+    });
+    // we might be called from a short-lived task thread, so make sure the thread object is
+    // deleted from the main thread's event loop
+    if (auto *app = QCoreApplication::instance())
+        thread->moveToThread(app->thread());
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->start(QThread::LowPriority);
 }
 
 QT_END_NAMESPACE_AM
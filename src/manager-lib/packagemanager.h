@@ -109,6 +109,12 @@ public:
     void setHardwareId(const QString &hwId);
     QString architecture() const;
     void setCACertificates(const QList<QByteArray> &chainOfTrust);
+    int maximumConcurrentInstallations() const;
+    void setMaximumConcurrentInstallations(int maximum);
+    bool deduplicateInstalledFiles() const;
+    void setDeduplicateInstalledFiles(bool enable);
+    bool removeAsynchronously() const;
+    void setRemoveAsynchronously(bool enable);
 
     void cleanupBrokenInstallations() Q_DECL_NOEXCEPT_EXPR(false);
 
@@ -172,6 +178,7 @@ protected:
 
 private:
     void executeNextTask();
+    void executeTask(AsynchronousTask *task);
     void triggerExecuteNextTask();
     QString enqueueTask(AsynchronousTask *task);
     void handleFailure(AsynchronousTask *task);
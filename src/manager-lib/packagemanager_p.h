@@ -8,7 +8,11 @@
 #include <QMutex>
 #include <QList>
 #include <QSet>
+#include <QHash>
 #include <QThread>
+#include <QStringList>
+
+#include <functional>
 
 #include <QtAppManManager/packagemanager.h>
 #include <QtAppManApplication/packagedatabase.h>
@@ -18,12 +22,23 @@
 QT_BEGIN_NAMESPACE_AM
 
 bool removeRecursiveHelper(const QString &path);
+// removes all paths with a single (batched) call to the SudoServer and returns the failed ones
+QStringList removeRecursiveHelper(const QStringList &paths);
+
+// moves path into the trash directory next to it and returns the new path (empty on failure)
+QString moveToTrashHelper(const QString &path);
+QString trashDirectoryName();
+// removes all paths in a background thread and then calls afterRemoval in that thread
+void removeRecursiveInBackground(const QStringList &paths, const std::function<void()> &afterRemoval = { });
 
 class PackageManagerPrivate
 {
 public:
     PackageDatabase *database = nullptr;
     QVector<Package *> packages;
+    QHash<QString, int> packageRows; // id -> row in packages, kept in sync for fast lookups
+
+    void rebuildPackageRows();
 
     QMap<Package *, PackageInfo *> pendingPackageInfoUpdates;
 
@@ -47,17 +62,23 @@ public:
 #if !defined(AM_DISABLE_INSTALLER)
     QList<AsynchronousTask *> incomingTaskList;     // incoming queue
     QList<AsynchronousTask *> installationTaskList; // installation jobs in state >= AwaitingAcknowledge
-    AsynchronousTask *activeTask = nullptr;         // currently active
+    QList<AsynchronousTask *> activeTasks;          // currently active (downloading, extracting or removing)
+    QHash<QString, AsynchronousTask *> installingPackages; // package-id -> InstallationTask
+    int maximumConcurrentInstallations = 1;
+    bool deduplicateInstalledFiles = false;
+    bool removeAsynchronously = false;
 
     QList<AsynchronousTask *> allTasks() const
     {
         QList<AsynchronousTask *> all = incomingTaskList;
         if (!installationTaskList.isEmpty())
             all += installationTaskList;
-        if (activeTask)
-            all += activeTask;
+        if (!activeTasks.isEmpty())
+            all += activeTasks;
         return all;
     }
+
+    bool canStartTask(AsynchronousTask *task) const;
 #endif
 };
 
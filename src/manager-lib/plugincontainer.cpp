@@ -196,6 +196,28 @@ void PluginContainerHelperFunctions::bindMountFileSystem(const QString &from, co
     }
 }
 
+void PluginContainerHelperFunctions::bindMountFileSystems(const QVector<BindMount> &mounts,
+                                                          quint64 namespacePid)
+{
+    auto sudo = SudoClient::instance();
+    if (sudo && !sudo->isFallbackImplementation()) {
+        SudoClient::Batch batch;
+        for (const BindMount &mount : mounts)
+            batch.bindMountFileSystem(mount.from, mount.to, mount.readOnly, namespacePid);
+
+        QStringList errors;
+        const auto results = sudo->execute(batch);
+        for (const auto &result : results) {
+            if (!result.success)
+                errors << result.errorString;
+        }
+        if (!errors.isEmpty())
+            throw std::runtime_error(errors.join(qL1C('\n')).toLocal8Bit());
+    } else {
+        throw std::runtime_error("Cannot call bindMountFileSystems: root privileges are required. Run appman via 'sudo' or 'chmod +s'.");
+    }
+}
+
 QT_END_NAMESPACE_AM
 
 #include "moc_plugincontainer.cpp"
@@ -21,6 +21,7 @@ public:
 
     void bindMountFileSystem(const QString &from, const QString &to, bool readOnly,
                          quint64 namespacePid) override;
+    void bindMountFileSystems(const QVector<BindMount> &mounts, quint64 namespacePid) override;
 };
 
 class PluginContainerManager : public AbstractContainerManager
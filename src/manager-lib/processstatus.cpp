@@ -6,7 +6,6 @@
 #include "processstatus.h"
 
 #include <QCoreApplication>
-#include <QMutexLocker>
 #include <QtQml/qqmlinfo.h>
 
 
@@ -52,6 +51,11 @@
     }
     \endqml
 
+    All ProcessStatus objects that monitor the same process share their measurements: update
+    requests that arrive while a measurement is in progress, or shortly after one has finished,
+    are answered with that same measurement. This keeps the load low, even if a lot of processes
+    are monitored by multiple ProcessStatus objects.
+
     You can also use this type as a data source for MonitorModel, if you want to plot its previous
     values over time:
 
@@ -101,42 +105,32 @@
 
 QT_USE_NAMESPACE_AM
 
-QThread *ProcessStatus::m_workerThread = nullptr;
-int ProcessStatus::m_instanceCount = 0;
-
 ProcessStatus::ProcessStatus(QObject *parent)
     : QObject(parent)
 {
-    if (m_instanceCount == 0) {
-        m_workerThread = new QThread;
-        m_workerThread->start();
-    }
-    ++m_instanceCount;
+    // all ProcessStatus objects watching the same process share a single reader
+    subscribe();
+}
 
-    m_reader = new ProcessReader;
-    m_reader->moveToThread(m_workerThread);
+ProcessStatus::~ProcessStatus()
+{
+    // the sampler might already be gone, if we are destroyed after the QCoreApplication object
+    if (auto sampler = ProcessSampler::existingInstance())
+        sampler->unsubscribe(this);
+}
 
-    connect(m_reader, &ProcessReader::updated, this, [this]() {
-        fetchReadings();
+void ProcessStatus::subscribe()
+{
+    auto sampler = ProcessSampler::instance();
+    if (!sampler) // we are past the QCoreApplication's lifetime
+        return;
+    sampler->subscribe(this, m_pid, [this](const ProcessSampler::Reading &reading) {
+        fetchReadings(reading);
         emit cpuLoadChanged();
         emit memoryReportingChanged(m_memoryVirtual, m_memoryRss, m_memoryPss);
         m_pendingUpdate = false;
     });
-    connect(this, &ProcessStatus::processIdChanged, m_reader, &ProcessReader::setProcessId);
-    connect(this, &ProcessStatus::memoryReportingEnabledChanged, m_reader, &ProcessReader::enableMemoryReporting);
-}
-
-ProcessStatus::~ProcessStatus()
-{
-    m_reader->deleteLater();
-
-    --m_instanceCount;
-    if (m_instanceCount == 0) {
-        m_workerThread->quit();
-        m_workerThread->wait();
-        delete m_workerThread;
-        m_workerThread = nullptr;
-    }
+    sampler->setMemoryReporting(this, m_memoryReportingEnabled, m_detailedMemoryInterval);
 }
 
 /*!
@@ -147,8 +141,10 @@ ProcessStatus::~ProcessStatus()
 void ProcessStatus::update()
 {
     if (!m_pendingUpdate) {
-        m_pendingUpdate = true;
-        QMetaObject::invokeMethod(m_reader, &ProcessReader::update);
+        if (auto sampler = ProcessSampler::instance()) {
+            m_pendingUpdate = true;
+            sampler->requestUpdate(this);
+        }
     }
 }
 
@@ -212,6 +208,7 @@ void ProcessStatus::determinePid()
 
     if (newId != m_pid) {
         m_pid = newId;
+        subscribe();
         emit processIdChanged(m_pid);
     }
 }
@@ -246,22 +243,20 @@ qreal ProcessStatus::cpuLoad()
     return m_cpuLoad;
 }
 
-void ProcessStatus::fetchReadings()
+void ProcessStatus::fetchReadings(const ProcessSampler::Reading &reading)
 {
-    QMutexLocker locker(&m_reader->mutex);
-
-    m_cpuLoad = m_reader->cpuLoad;
+    m_cpuLoad = reading.cpuLoad;
 
     // Although smaps claims to report kB it's actually KiB (2^10 = 1024 Bytes)
-    m_memoryVirtual[qSL("total")] = static_cast<quint64>(m_reader->memory.totalVm) << 10;
-    m_memoryVirtual[qSL("text")] = static_cast<quint64>(m_reader->memory.textVm) << 10;
-    m_memoryVirtual[qSL("heap")] = static_cast<quint64>(m_reader->memory.heapVm) << 10;
-    m_memoryRss[qSL("total")] = static_cast<quint64>(m_reader->memory.totalRss) << 10;
-    m_memoryRss[qSL("text")] = static_cast<quint64>(m_reader->memory.textRss) << 10;
-    m_memoryRss[qSL("heap")] = static_cast<quint64>(m_reader->memory.heapRss) << 10;
-    m_memoryPss[qSL("total")] = static_cast<quint64>(m_reader->memory.totalPss) << 10;
-    m_memoryPss[qSL("text")] = static_cast<quint64>(m_reader->memory.textPss) << 10;
-    m_memoryPss[qSL("heap")] = static_cast<quint64>(m_reader->memory.heapPss) << 10;
+    m_memoryVirtual[qSL("total")] = static_cast<quint64>(reading.memory.totalVm) << 10;
+    m_memoryVirtual[qSL("text")] = static_cast<quint64>(reading.memory.textVm) << 10;
+    m_memoryVirtual[qSL("heap")] = static_cast<quint64>(reading.memory.heapVm) << 10;
+    m_memoryRss[qSL("total")] = static_cast<quint64>(reading.memory.totalRss) << 10;
+    m_memoryRss[qSL("text")] = static_cast<quint64>(reading.memory.textRss) << 10;
+    m_memoryRss[qSL("heap")] = static_cast<quint64>(reading.memory.heapRss) << 10;
+    m_memoryPss[qSL("total")] = static_cast<quint64>(reading.memory.totalPss) << 10;
+    m_memoryPss[qSL("text")] = static_cast<quint64>(reading.memory.textPss) << 10;
+    m_memoryPss[qSL("heap")] = static_cast<quint64>(reading.memory.heapPss) << 10;
 }
 
 /*!
@@ -337,10 +332,41 @@ void ProcessStatus::setMemoryReportingEnabled(bool enabled)
 {
     if (enabled != m_memoryReportingEnabled) {
         m_memoryReportingEnabled = enabled;
+        if (auto sampler = ProcessSampler::instance())
+            sampler->setMemoryReporting(this, m_memoryReportingEnabled, m_detailedMemoryInterval);
         emit memoryReportingEnabledChanged(m_memoryReportingEnabled);
     }
 }
 
+/*!
+    \qmlproperty int ProcessStatus::detailedMemoryInterval
+
+    Determining the \c text and \c heap values of the memory properties requires a walk over all
+    of the process' memory mappings, which can be expensive for processes with thousands of
+    mappings. On Linux kernels that provide \c{/proc/<pid>/smaps_rollup}, only every n-th
+    \l{ProcessStatus::update()}{update()} does a full walk, while all others only refresh the
+    \c total values and keep the last known \c text and \c heap values. This property holds
+    that n; a value of \c 1 will do a full walk on every update. The default value is \c 10.
+
+    This property has no effect, if \l memoryReportingEnabled is \c false.
+*/
+
+int ProcessStatus::detailedMemoryInterval() const
+{
+    return m_detailedMemoryInterval;
+}
+
+void ProcessStatus::setDetailedMemoryInterval(int interval)
+{
+    interval = qMax(1, interval);
+    if (interval != m_detailedMemoryInterval) {
+        m_detailedMemoryInterval = interval;
+        if (auto sampler = ProcessSampler::instance())
+            sampler->setMemoryReporting(this, m_memoryReportingEnabled, m_detailedMemoryInterval);
+        emit detailedMemoryIntervalChanged(m_detailedMemoryInterval);
+    }
+}
+
 /*!
     \qmlproperty list<string> ProcessStatus::roleNames
     \readonly
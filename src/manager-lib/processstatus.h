@@ -8,13 +8,13 @@
 #include <QtCore/QAtomicInteger>
 #include <QtCore/QObject>
 #include <QtCore/QPointer>
-#include <QtCore/QThread>
 #include <QtCore/QVariant>
 
 #include <QtAppManCommon/global.h>
 #include <QtAppManManager/amnamespace.h>
 #include <QtAppManManager/application.h>
 #include <QtAppManMonitor/processreader.h>
+#include <QtAppManMonitor/processsampler.h>
 
 QT_BEGIN_NAMESPACE_AM
 
@@ -31,6 +31,8 @@ class ProcessStatus : public QObject
     Q_PROPERTY(QVariantMap memoryPss READ memoryPss NOTIFY memoryReportingChanged FINAL)
     Q_PROPERTY(bool memoryReportingEnabled READ isMemoryReportingEnabled WRITE setMemoryReportingEnabled
                                            NOTIFY memoryReportingEnabledChanged)
+    Q_PROPERTY(int detailedMemoryInterval READ detailedMemoryInterval WRITE setDetailedMemoryInterval
+                                          NOTIFY detailedMemoryIntervalChanged)
     Q_PROPERTY(QStringList roleNames READ roleNames CONSTANT FINAL)
 public:
     ProcessStatus(QObject *parent = nullptr);
@@ -53,6 +55,9 @@ public:
     bool isMemoryReportingEnabled() const;
     void setMemoryReportingEnabled(bool enabled);
 
+    int detailedMemoryInterval() const;
+    void setDetailedMemoryInterval(int interval);
+
 signals:
     void applicationIdChanged(const QString &applicationId);
     void processIdChanged(qint64 processId);
@@ -60,13 +65,15 @@ signals:
     void memoryReportingChanged(const QVariantMap &memoryVirtual, const QVariantMap &memoryRss,
                                                                   const QVariantMap &memoryPss);
     void memoryReportingEnabledChanged(bool enabled);
+    void detailedMemoryIntervalChanged(int interval);
 
 private slots:
     void onRunStateChanged(Am::RunState state);
 
 private:
-    void fetchReadings();
+    void fetchReadings(const ProcessSampler::Reading &reading);
     void determinePid();
+    void subscribe();
 
     QString m_appId;
     qint64 m_pid = 0;
@@ -76,13 +83,11 @@ private:
     QVariantMap m_memoryRss;
     QVariantMap m_memoryPss;
     bool m_memoryReportingEnabled = true;
+    int m_detailedMemoryInterval = ProcessReader::DefaultDetailedMemoryInterval;
 
     QPointer<Application> m_application;
 
     bool m_pendingUpdate = false;
-    ProcessReader *m_reader;
-    static QThread *m_workerThread;
-    static int m_instanceCount;
 };
 
 QT_END_NAMESPACE_AM
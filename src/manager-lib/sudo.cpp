@@ -9,6 +9,7 @@
 #include <QFile>
 #include <QtEndian>
 #include <QDataStream>
+#include <QThread>
 #include <qplatformdefs.h>
 #include <QDataStream>
 
@@ -269,11 +270,11 @@ SudoInterface::SudoInterface()
 { }
 
 #ifdef Q_OS_LINUX
-bool SudoInterface::sendMessage(int socket, const QByteArray &msg, MessageType type, const QString &errorString)
+bool SudoInterface::sendMessage(int socket, quint32 id, const QByteArray &msg, MessageType type, const QString &errorString)
 {
     QByteArray packet;
     QDataStream ds(&packet, QDataStream::WriteOnly);
-    ds << errorString << msg;
+    ds << id << errorString << msg;
     packet.prepend((type == Request) ? "RQST" : "RPLY");
 
     auto bytesWritten = EINTR_LOOP(write(socket, packet.constData(), static_cast<size_t>(packet.size())));
@@ -281,23 +282,27 @@ bool SudoInterface::sendMessage(int socket, const QByteArray &msg, MessageType t
 }
 
 
-QByteArray SudoInterface::receiveMessage(int socket, MessageType type, QString *errorString)
+QByteArray SudoInterface::receiveMessage(int socket, MessageType type, quint32 *id, QString *errorString)
 {
     const int headerSize = 4;
-    char recvBuffer[8*1024];
-    auto bytesReceived = EINTR_LOOP(recv(socket, recvBuffer, sizeof(recvBuffer), 0));
 
-    if ((bytesReceived < headerSize) || qstrncmp(recvBuffer, (type == Request ? "RQST" : "RPLY"), 4)) {
+    // batches can get quite big, so we need to get the real datagram size first
+    auto packetSize = EINTR_LOOP(recv(socket, nullptr, 0, MSG_PEEK | MSG_TRUNC));
+    QByteArray recvBuffer(qMax(headerSize, int(packetSize)), Qt::Uninitialized);
+    auto bytesReceived = EINTR_LOOP(recv(socket, recvBuffer.data(), static_cast<size_t>(recvBuffer.size()), 0));
+
+    *id = 0;
+    if ((bytesReceived < headerSize) || qstrncmp(recvBuffer.constData(), (type == Request ? "RQST" : "RPLY"), 4)) {
         *errorString = qL1S("failed to receive command from the SudoClient process");
         //qCCritical(LogSystem) << *errorString;
         return QByteArray();
     }
 
-    QByteArray packet(recvBuffer + headerSize, int(bytesReceived) - headerSize);
+    QByteArray packet = recvBuffer.mid(headerSize, int(bytesReceived) - headerSize);
 
     QDataStream ds(&packet, QDataStream::ReadOnly);
     QByteArray msg;
-    ds >> *errorString >> msg;
+    ds >> *id >> *errorString >> msg;
     return msg;
 }
 #endif // Q_OS_LINUX
@@ -336,7 +341,7 @@ template <typename R, typename C, typename ...Ps> R returnType(R (C::*)(Ps...));
 #define CALL(FUNC_NAME, PARAM) \
     QByteArray msg; \
     QDataStream(&msg, QDataStream::WriteOnly) << #FUNC_NAME << PARAM; \
-    QByteArray reply = call(msg); \
+    QByteArray reply = call(#FUNC_NAME, msg); \
     QDataStream result(&reply, QDataStream::ReadOnly); \
     decltype(returnType(&SudoClient::FUNC_NAME)) r; \
     result >> r; \
@@ -358,39 +363,251 @@ bool SudoClient::bindMountFileSystem(const QString &from, const QString &to, boo
     CALL(bindMountFileSystem, from << to << readOnly << namespacePid);
 }
 
+#define BATCH_CALL(FUNC_NAME, PARAM) \
+    QByteArray msg; \
+    QDataStream(&msg, QDataStream::WriteOnly) << #FUNC_NAME << PARAM; \
+    m_calls << msg
+
+void SudoClient::Batch::removeRecursive(const QString &fileOrDir)
+{
+    BATCH_CALL(removeRecursive, fileOrDir);
+}
+
+void SudoClient::Batch::setOwnerAndPermissionsRecursive(const QString &fileOrDir, uid_t user, gid_t group, mode_t permissions)
+{
+    BATCH_CALL(setOwnerAndPermissionsRecursive, fileOrDir << user << group << permissions);
+}
+
+void SudoClient::Batch::bindMountFileSystem(const QString &from, const QString &to, bool readOnly,
+                                            quint64 namespacePid)
+{
+    BATCH_CALL(bindMountFileSystem, from << to << readOnly << namespacePid);
+}
+
+// Every message is sent as a single datagram, which cannot be bigger than the socket's send
+// buffer: big batches are split into multiple messages. The replies have to fit into a datagram
+// as well and contain an error string per call, so the number of calls per message is limited too.
+static constexpr qsizetype MaximumBatchMessageSize = 32 * 1024;
+static constexpr qsizetype MaximumCallsPerBatchMessage = 64;
+
+quint32 SudoClient::submit(const Batch &batch)
+{
+    const QList<QByteArray> &calls = batch.m_calls;
+    QList<BatchPart> parts;
+    qsizetype begin = 0;
+
+    // an empty batch is still sent as one (empty) message
+    while ((begin < calls.size()) || parts.isEmpty()) {
+        qsizetype end = begin;
+        qsizetype size = 0;
+        while ((end < calls.size()) && ((end - begin) < MaximumCallsPerBatchMessage)
+               && ((end == begin) || ((size + calls.at(end).size()) <= MaximumBatchMessageSize))) {
+            size += calls.at(end).size();
+            ++end;
+        }
+
+        QByteArray msg;
+        QDataStream(&msg, QDataStream::WriteOnly) << "batch" << calls.mid(begin, end - begin);
+        parts.append({ submitMessage("batch", msg), int(end - begin) });
+        begin = end;
+    }
+
+    const quint32 batchId = parts.constFirst().id;
+    QMutexLocker locker(&m_mutex);
+    m_batches.insert(batchId, parts);
+    return batchId;
+}
+
+QList<SudoClient::Result> SudoClient::waitForResults(quint32 batchId)
+{
+    QList<BatchPart> parts;
+    {
+        QMutexLocker locker(&m_mutex);
+        parts = m_batches.take(batchId);
+    }
+    if (parts.isEmpty()) // unknown id: waitForReply() will report the error
+        return waitForBatchPart(batchId, -1);
+
+    QList<Result> results;
+    for (const BatchPart &part : std::as_const(parts))
+        results << waitForBatchPart(part.id, part.callCount);
+    return results;
+}
+
+QList<SudoClient::Result> SudoClient::waitForBatchPart(quint32 id, int callCount)
+{
+    QString errorString;
+    QByteArray reply = waitForReply(id, &errorString);
+
+    QList<QByteArray> replies;
+    QStringList errorStrings;
+    QDataStream ds(&reply, QDataStream::ReadOnly);
+    ds >> replies >> errorStrings;
+
+    QList<Result> results;
+    if (replies.isEmpty() && !errorString.isEmpty()) {
+        // the whole message failed: report the error for every call in it
+        results.fill(Result { false, errorString }, qMax(1, callCount));
+        return results;
+    }
+
+    results.reserve(replies.size());
+    for (int i = 0; i < replies.size(); ++i) {
+        Result result;
+        QDataStream(replies.at(i)) >> result.success;
+        result.errorString = errorStrings.value(i);
+        results << result;
+    }
+    return results;
+}
+
+QList<SudoClient::Result> SudoClient::execute(const Batch &batch)
+{
+    return waitForResults(submit(batch));
+}
+
+SudoClient::LatencyStatistics SudoClient::latencyStatistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_latency;
+}
+
 void SudoClient::stopServer()
 {
 #ifdef Q_OS_LINUX
     if (!m_shortCircuit && m_socket >= 0) {
         QByteArray msg;
         QDataStream(&msg, QDataStream::WriteOnly) << "stopServer";
-        sendMessage(m_socket, msg, Request);
+        QMutexLocker locker(&m_mutex);
+        sendMessage(m_socket, ++m_lastId, msg, Request);
     }
 #endif
 }
 
-QByteArray SudoClient::call(const QByteArray &msg)
+QByteArray SudoClient::call(const char *function, const QByteArray &msg)
+{
+    QString errorString;
+    QByteArray reply = waitForReply(submitMessage(function, msg), &errorString);
+
+    QMutexLocker locker(&m_mutex);
+    m_errorString = errorString;
+    return reply;
+}
+
+QString SudoClient::lastError() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_errorString;
+}
+
+// The server processes one request after the other, but requests are pipelined: the client does
+// not need to wait for a reply before sending the next request. To make sure that neither side
+// blocks on a full socket buffer, the number of requests in flight is limited though.
+static constexpr int MaximumCallsInFlight = 8;
+
+quint32 SudoClient::submitMessage(const char *function, const QByteArray &msg)
 {
     QMutexLocker locker(&m_mutex);
 
+    const quint32 id = ++m_lastId;
+    PendingCall &pending = m_pendingCalls[id];
+    pending.function = function;
+    pending.timer.start();
+
     if (m_shortCircuit) {
-        const QByteArray res = m_shortCircuit->receive(msg);
-        m_errorString = m_shortCircuit->lastError();
-        return res;
+        pending.reply = m_shortCircuit->receive(msg);
+        pending.errorString = m_shortCircuit->lastError();
+        pending.done = true;
+        return id;
     }
 
 #ifdef Q_OS_LINUX
-    if (m_socket >= 0) {
-        if (sendMessage(m_socket, msg, Request))
-            return receiveMessage(m_socket, Reply, &m_errorString);
+    while ((m_socket >= 0) && (m_callsInFlight >= MaximumCallsInFlight))
+        receiveReply(locker);
+
+    if ((m_socket >= 0) && sendMessage(m_socket, id, msg, Request)) {
+        ++m_callsInFlight;
+        return id;
     }
 #else
     Q_UNUSED(m_socket)
 #endif
 
     //qCCritical(LogSystem) << "failed to send command to the SudoServer process";
-    m_errorString = qL1S("failed to send command to the SudoServer process");
-    return QByteArray();
+    PendingCall &failed = m_pendingCalls[id]; // receiveReply() might have rehashed
+    failed.errorString = qL1S("failed to send command to the SudoServer process");
+    failed.done = true;
+    return id;
+}
+
+QByteArray SudoClient::waitForReply(quint32 id, QString *errorString)
+{
+    QMutexLocker locker(&m_mutex);
+
+    forever {
+        auto it = m_pendingCalls.find(id);
+        if (it == m_pendingCalls.end()) {
+            *errorString = qL1S("unknown SudoServer request");
+            return QByteArray();
+        }
+        if (it->done)
+            break;
+        receiveReply(locker);
+    }
+
+    const PendingCall pending = m_pendingCalls.take(id);
+    const qint64 nsecs = pending.timer.nsecsElapsed();
+    ++m_latency.calls;
+    m_latency.totalNSecs += nsecs;
+    m_latency.maximumNSecs = qMax(m_latency.maximumNSecs, nsecs);
+    qCDebug(LogSystem).nospace() << "SudoServer call " << pending.function << " took "
+                                 << (double(nsecs) / 1000000) << "ms";
+
+    *errorString = pending.errorString;
+    return pending.reply;
+}
+
+// Needs to be called with m_mutex locked: either receives one reply from the server, or - if
+// another thread is already doing that - waits for that other thread to receive a reply.
+void SudoClient::receiveReply(QMutexLocker<QMutex> &locker)
+{
+#ifdef Q_OS_LINUX
+    if (m_receiving) {
+        m_replyReceived.wait(&m_mutex);
+        return;
+    }
+
+    m_receiving = true;
+    locker.unlock();
+
+    quint32 id = 0;
+    QString errorString;
+    QByteArray reply = receiveMessage(m_socket, Reply, &id, &errorString);
+
+    locker.relock();
+    m_receiving = false;
+
+    if (!id) {
+        // we lost the connection to the server: fail all calls in flight, so nobody waits forever
+        for (auto &pending : m_pendingCalls) {
+            if (!pending.done) {
+                pending.errorString = errorString;
+                pending.done = true;
+            }
+        }
+        m_callsInFlight = 0;
+    } else if (auto it = m_pendingCalls.find(id); it != m_pendingCalls.end()) {
+        it->reply = reply;
+        it->errorString = errorString;
+        it->done = true;
+        --m_callsInFlight;
+    }
+    m_replyReceived.wakeAll();
+#else
+    Q_UNUSED(locker)
+    for (auto &pending : m_pendingCalls)
+        pending.done = true;
+#endif
 }
 
 
@@ -419,13 +636,14 @@ void SudoServer::run()
     QString dummy;
 
     forever {
-        QByteArray msg = receiveMessage(m_socket, Request, &dummy);
+        quint32 id = 0;
+        QByteArray msg = receiveMessage(m_socket, Request, &id, &dummy);
         QByteArray reply = receive(msg);
 
         if (m_stop)
             exit(0);
 
-        sendMessage(m_socket, reply, Reply, m_errorString);
+        sendMessage(m_socket, id, reply, Reply, m_errorString);
     }
 #else
     Q_UNUSED(m_socket)
@@ -463,7 +681,29 @@ QByteArray SudoServer::receive(const QByteArray &msg)
         quint64 namespacePid;
         params >> from >> to >> readOnly >> namespacePid;
         result << bindMountFileSystem(from, to, readOnly, namespacePid);
-    } else if (function == "stopServer") {
+    } else if ((function == "batch") && !m_inBatch) {
+        QList<QByteArray> calls;
+        params >> calls;
+
+        QList<QByteArray> replies;
+        QStringList errorStrings;
+        replies.reserve(calls.size());
+        errorStrings.reserve(calls.size());
+
+        m_inBatch = true;
+        int failed = 0;
+        for (const QByteArray &call : std::as_const(calls)) {
+            replies << receive(call);
+            errorStrings << m_errorString;
+            if (!m_errorString.isEmpty())
+                ++failed;
+        }
+        m_inBatch = false;
+
+        result << replies << errorStrings;
+        m_errorString = failed ? QString::fromLatin1("%1 of %2 batched operations failed").arg(failed).arg(calls.size())
+                               : QString();
+    } else if ((function == "stopServer") && !m_inBatch) {
         m_stop = true;
     } else {
         reply.truncate(0);
@@ -475,7 +715,7 @@ QByteArray SudoServer::receive(const QByteArray &msg)
 bool SudoServer::removeRecursive(const QString &fileOrDir)
 {
     try {
-        if (!recursiveOperation(fileOrDir, safeRemove))
+        if (!QT_PREPEND_NAMESPACE_AM(removeRecursive)(fileOrDir, QThread::idealThreadCount()))
             throw Exception(errno, "could not recursively remove %1").arg(fileOrDir);
         return true;
     } catch (const Exception &e) {
@@ -487,13 +727,12 @@ bool SudoServer::removeRecursive(const QString &fileOrDir)
 bool SudoServer::setOwnerAndPermissionsRecursive(const QString &fileOrDir, uid_t user, gid_t group, mode_t permissions)
 {
 #if defined(Q_OS_LINUX)
-    static auto setOwnerAndPermissions =
-            [user, group, permissions](const QString &path, RecursiveOperationType type) -> bool {
+    auto setOwnerAndPermissions =
+            [user, group, permissions](int dirFd, const char *name, RecursiveOperationType type) -> bool {
         if (type == RecursiveOperationType::EnterDirectory)
             return true;
 
-        const QByteArray localPath = path.toLocal8Bit();
-        bool noModeChange = (permissions == static_cast<mode_t>(-1));
+        const bool noModeChange = (permissions == static_cast<mode_t>(-1));
         mode_t mode = permissions;
 
         if (type == RecursiveOperationType::LeaveDirectory) {
@@ -506,12 +745,15 @@ bool SudoServer::setOwnerAndPermissionsRecursive(const QString &fileOrDir, uid_t
                 mode |= 0100;
         }
 
-        return ((noModeChange ? true : (chmod(localPath, mode) == 0))
-                && (chown(localPath, user, group) == 0));
+        // we are running as root on directories that are writable by apps, so any entry could
+        // be replaced by a symlink at any time: setPermissionsAt() never follows symlinks and
+        // only the ownership of a link itself is changed
+        return ((noModeChange ? true : setPermissionsAt(dirFd, name, mode))
+                && (fchownat(dirFd, name, user, group, AT_SYMLINK_NOFOLLOW) == 0));
     };
 
     try {
-        if (!recursiveOperation(fileOrDir, setOwnerAndPermissions)) {
+        if (!recursiveOperationAt(fileOrDir, setOwnerAndPermissions, QThread::idealThreadCount())) {
             throw Exception(errno, "could not recursively set owner and permission on %1 to %2:%3 / %4")
                 .arg(fileOrDir).arg(user).arg(group).arg(permissions, 4, 8, QLatin1Char('0'));
         }
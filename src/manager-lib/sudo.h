@@ -7,7 +7,11 @@
 
 #include <QtCore/QString>
 #include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QElapsedTimer>
 #include <qplatformdefs.h>
 
 #ifdef Q_OS_UNIX
@@ -46,8 +50,9 @@ protected:
     enum MessageType { Request, Reply };
 
 #ifdef Q_OS_LINUX
-    QByteArray receiveMessage(int socket, MessageType type, QString *errorString);
-    bool sendMessage(int socket, const QByteArray &msg, MessageType type, const QString &errorString = QString());
+    // every message carries an id, so that replies can be matched to pipelined requests
+    QByteArray receiveMessage(int socket, MessageType type, quint32 *id, QString *errorString);
+    bool sendMessage(int socket, quint32 id, const QByteArray &msg, MessageType type, const QString &errorString = QString());
 #endif
     QByteArray receive(const QByteArray &packet);
 
@@ -72,18 +77,81 @@ public:
     bool setOwnerAndPermissionsRecursive(const QString &fileOrDir, uid_t user, gid_t group, mode_t permissions) override;
     bool bindMountFileSystem(const QString &from, const QString &to, bool readOnly, quint64 namespacePid) override;
 
+    // Operations can be queued in a Batch, which is then sent to the server as a single message
+    // (big batches are split into multiple messages transparently). submit() does not wait for the server to process the batch, so multiple batches (and
+    // single calls from other threads) can be in flight at the same time. waitForResults()
+    // blocks until the server has processed the batch and returns one result per operation.
+    class Batch
+    {
+    public:
+        void removeRecursive(const QString &fileOrDir);
+        void setOwnerAndPermissionsRecursive(const QString &fileOrDir, uid_t user, gid_t group, mode_t permissions);
+        void bindMountFileSystem(const QString &from, const QString &to, bool readOnly, quint64 namespacePid = 0);
+
+        int size() const { return int(m_calls.size()); }
+        bool isEmpty() const { return m_calls.isEmpty(); }
+
+    private:
+        QList<QByteArray> m_calls;
+        friend class SudoClient;
+    };
+
+    struct Result
+    {
+        bool success = false;
+        QString errorString;
+    };
+
+    quint32 submit(const Batch &batch);
+    QList<Result> waitForResults(quint32 batchId);
+    QList<Result> execute(const Batch &batch); // submit() + waitForResults()
+
+    // round-trip times of all calls, as seen by the client
+    struct LatencyStatistics
+    {
+        quint64 calls = 0;
+        qint64 totalNSecs = 0;
+        qint64 maximumNSecs = 0;
+    };
+    LatencyStatistics latencyStatistics() const;
+
     void stopServer();
 
-    QString lastError() const { return m_errorString; }
+    QString lastError() const;
 
 private:
     SudoClient(int socketFd);
 
-    QByteArray call(const QByteArray &msg);
+    QByteArray call(const char *function, const QByteArray &msg);
+    quint32 submitMessage(const char *function, const QByteArray &msg);
+    QByteArray waitForReply(quint32 id, QString *errorString);
+    QList<Result> waitForBatchPart(quint32 id, int callCount);
+    void receiveReply(QMutexLocker<QMutex> &locker);
+
+    struct PendingCall
+    {
+        const char *function = nullptr;
+        QElapsedTimer timer;
+        bool done = false;
+        QByteArray reply;
+        QString errorString;
+    };
 
     int m_socket;
     QString m_errorString;
-    QMutex m_mutex;
+    mutable QMutex m_mutex;
+    QWaitCondition m_replyReceived;
+    QHash<quint32, PendingCall> m_pendingCalls;
+    struct BatchPart
+    {
+        quint32 id;
+        int callCount;
+    };
+    QHash<quint32, QList<BatchPart>> m_batches;
+    quint32 m_lastId = 0;
+    int m_callsInFlight = 0;
+    bool m_receiving = false;
+    LatencyStatistics m_latency;
     SudoServer *m_shortCircuit;
 
     static SudoClient *s_instance;
@@ -113,6 +181,7 @@ private:
     int m_socket;
     QString m_errorString;
     bool m_stop = false;
+    bool m_inBatch = false;
 
     static SudoServer *s_instance;
 };
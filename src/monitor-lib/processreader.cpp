@@ -11,7 +11,10 @@
 #if defined(Q_OS_MACOS)
 #  include <mach/mach.h>
 #elif defined(Q_OS_LINUX)
+#  include <qplatformdefs.h>
 #  include <unistd.h>
+#  include <cerrno>
+#  include <cstring>
 #endif
 
 QT_USE_NAMESPACE_AM
@@ -19,10 +22,20 @@ QT_USE_NAMESPACE_AM
 void ProcessReader::setProcessId(qint64 pid)
 {
     m_pid = pid;
+#if defined(Q_OS_LINUX)
+    m_detailedMemory = Memory();
+    m_updatesSinceDetailedMemory = 0;
+    m_smapsRollupAvailable = true;
+#endif
     if (pid)
         openCpuLoad();
 }
 
+void ProcessReader::setDetailedMemoryInterval(int updates)
+{
+    m_detailedMemoryInterval = qMax(1, updates);
+}
+
 void ProcessReader::enableMemoryReporting(bool enabled)
 {
     m_memoryReportingEnabled = enabled;
@@ -97,175 +110,281 @@ qreal ProcessReader::readCpuLoad()
 
 bool ProcessReader::readMemory(Memory &mem)
 {
-    const QByteArray smapsFile = "/proc/" + QByteArray::number(m_pid) + "/smaps";
-    return readSmaps(smapsFile, mem);
-}
+    const QByteArray procDir = "/proc/" + QByteArray::number(m_pid);
 
-static uint parseValue(const char *pl) {
-    while (*pl && (*pl < '0' || *pl > '9'))
-        pl++;
-    return static_cast<uint>(strtoul(pl, nullptr, 10));
+    if (m_smapsRollupAvailable && (m_updatesSinceDetailedMemory > 0)
+            && (m_updatesSinceDetailedMemory < m_detailedMemoryInterval)) {
+        if (readSmapsRollup(procDir + "/smaps_rollup", procDir + "/statm", mem)) {
+            ++m_updatesSinceDetailedMemory;
+            return true;
+        }
+        // either an old kernel (< 4.14) or the process is gone: in both cases, the full smaps
+        // parse below will tell
+        m_smapsRollupAvailable = false;
+    }
+
+    if (readSmaps(procDir + "/smaps", mem)) {
+        m_updatesSinceDetailedMemory = 1;
+        return true;
+    }
+    m_updatesSinceDetailedMemory = 0;
+    return false;
 }
 
-bool ProcessReader::readSmaps(const QByteArray &smapsFile, Memory &mem)
+// Reads the complete file into m_readBuffer and returns the number of bytes read, or -1 on error.
+// Files in /proc do not report a size, so we just keep growing the buffer until we hit EOF. The
+// buffer is re-used for all subsequent reads, so that a typical update only needs one big read()
+// call plus the one returning EOF, without any allocations.
+qsizetype ProcessReader::readFile(const QByteArray &fileName)
 {
-    struct ScopedFile {
-        ~ScopedFile() { if (file) fclose(file); }
-        FILE *file = nullptr;
-    };
+    int fd = QT_OPEN(fileName.constData(), QT_OPEN_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    if (m_readBuffer.size() < 64 * 1024)
+        m_readBuffer.resize(64 * 1024);
+
+    qsizetype len = 0;
+    forever {
+        if (len == m_readBuffer.size())
+            m_readBuffer.resize(m_readBuffer.size() * 2);
+
+        auto bytesRead = QT_READ(fd, m_readBuffer.data() + len, size_t(m_readBuffer.size() - len));
+        if (bytesRead > 0) {
+            len += bytesRead;
+        } else if (bytesRead == 0) {
+            break;
+        } else if (errno != EINTR) {
+            len = -1;
+            break;
+        }
+    }
+    QT_CLOSE(fd);
+    return len;
+}
 
-    ScopedFile sf;
-    sf.file = fopen(smapsFile.constData(), "r");
+static inline bool isHexDigit(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+}
 
-    if (sf.file == nullptr)
+// Parses a decimal number, skipping leading blanks (e.g. the value of a "Tag:    1234 kB" line)
+static bool parseNumber(const char *pos, const char *end, quint32 &value)
+{
+    while (pos < end && *pos == ' ')
+        ++pos;
+    if (pos == end || *pos < '0' || *pos > '9')
         return false;
 
-    const int lineLen = 100;  // we are not interested in full library paths
-    char line[lineLen + 5];   // padding for highly unlikely trailing perm flags below
-    char *pl;                 // pointer to chars within line
-    bool ok = true;
+    quint32 v = 0;
+    while (pos < end && *pos >= '0' && *pos <= '9')
+        v = v * 10 + quint32(*pos++ - '0');
+    value = v;
+    return true;
+}
 
-    if (fgets(line, lineLen, sf.file) == nullptr)
-        return false;
+// If the line starts with tag, its value is parsed into value and found is set.
+// Returns false for malformed values only.
+static bool parseTag(const char *line, const char *eol, const char *tag, size_t tagLen,
+                     quint32 &value, bool &found)
+{
+    if ((size_t(eol - line) < tagLen) || memcmp(line, tag, tagLen))
+        return true;
+    found = true;
+    return parseNumber(line + tagLen, eol, value);
+}
 
-    // sanity checks
-    for (pl = line; pl < (line + 4) && ok; ++pl)
-        ok = ((*pl >= '0' && *pl <= '9') || (*pl >= 'a' && *pl <= 'f'));
-    while (strlen(line) == lineLen - 1 && line[lineLen - 2] != '\n') {
-        if (Q_UNLIKELY(!fgets(line, lineLen, sf.file)))
-            break;
-    }
-    if (fgets(line, lineLen, sf.file) == nullptr)
-        return false;
-    static const char strSize[] = "Size: ";
-    ok = ok && !qstrncmp(line, strSize, sizeof(strSize) - 1);
-    if (!ok)
-        return false;
+namespace {
 
-    // Determine block size
-    ok = false;
-    int blockLen = 0;
-    while (fgets(line, lineLen, sf.file) != nullptr && !ok) {
-        if (!(line[0] < '0' || line[0] > '9') && (line[0] < 'a' || line[0] > 'f'))
-            ok = true;
-        ++blockLen;
-    }
-    if (!ok || blockLen < 12 || blockLen > 32)
-        return false;
+struct SmapsMapping
+{
+    char permissions[4];
+    bool hasInode = false;
+    bool isMainStack = false;
+    bool foundSize = false;
+    bool foundRss = false;
+    bool foundPss = false;
+    quint32 vm = 0;
+    quint32 rss = 0;
+    quint32 pss = 0;
+
+    // "<start>-<end> <perms> <offset> <dev> <inode>    <path>"
+    bool parseHeader(const char *pos, const char *eol)
+    {
+        const char *fields[6] = { };
+        int fieldCount = 0;
+        bool hasRangeSeparator = false;
+
+        for (const char *p = pos; p < eol && fieldCount < 6; ) {
+            while (p < eol && *p == ' ')
+                ++p;
+            if (p == eol)
+                break;
+            fields[fieldCount++] = p;
+            if (fieldCount == 6)
+                break;
+            while (p < eol && *p != ' ') {
+                if (fieldCount == 1) {
+                    if (*p == '-')
+                        hasRangeSeparator = true;
+                    else if (!isHexDigit(*p))
+                        return false;
+                }
+                ++p;
+            }
+        }
+        if ((fieldCount < 5) || !hasRangeSeparator || ((fields[2] - fields[1]) < 5))
+            return false;
 
-    fseek(sf.file, 0, SEEK_SET);
-    bool wasPrivateOnly = false;
-    ok = false;
+        memcpy(permissions, fields[1], sizeof(permissions));
+        hasInode = (*fields[4] != '0');
 
-    while (true) {
-        if (Q_UNLIKELY(!(fgets(line, lineLen, sf.file) != nullptr))) {
-            ok = feof(sf.file);
-            break;
-        }
+        static const char strStack[] = "[stack]";
+        isMainStack = (fieldCount == 6) && (size_t(eol - fields[5]) >= (sizeof(strStack) - 1))
+                && !memcmp(fields[5], strStack, sizeof(strStack) - 1);
+        return true;
+    }
 
-        // Determine permission flags
-        pl = line;
-        while (*pl && *pl != ' ')
-            ++pl;
-        char permissions[4];
-        memcpy(permissions, ++pl, sizeof(permissions));
-
-        // Determine inode
-        int spaceCount = 0;
-        while (*pl && spaceCount < 3) {
-            if (*pl == ' ')
-                ++spaceCount;
-            ++pl;
-        }
-        bool hasInode = (*pl != '0');
-
-        // Determine library name
-        while (*pl && *pl != ' ')
-            ++pl;
-        while (*pl && *pl == ' ')
-            ++pl;
-
-        static const char strStack[] = "stack]";
-        bool isMainStack = (Q_UNLIKELY(*pl == '['
-                            && !qstrncmp(pl + 1, strStack, sizeof(strStack) - 1)));
-        // Skip rest of library path
-        while (strlen(line) == lineLen - 1 && line[lineLen - 2] != '\n') {
-            if (Q_UNLIKELY(!fgets(line, lineLen, sf.file)))
-                break;
+    bool parseLine(const char *pos, const char *eol)
+    {
+        static const char strSize[] = "Size:";
+        static const char strRss[] = "Rss:";
+        static const char strPss[] = "Pss:";
+
+        switch (*pos) {
+        case 'S': return parseTag(pos, eol, strSize, sizeof(strSize) - 1, vm, foundSize);
+        case 'R': return parseTag(pos, eol, strRss, sizeof(strRss) - 1, rss, foundRss);
+        case 'P': return parseTag(pos, eol, strPss, sizeof(strPss) - 1, pss, foundPss);
+        default:  return true;
         }
+    }
+};
 
-        int skipLen = blockLen;
-        uint vm = 0;
-        uint rss = 0;
-        uint pss = 0;
-        const int sizeTag = 0x01;
-        const int rssTag  = 0x02;
-        const int pssTag  = 0x04;
-        const int allTags = sizeTag | rssTag | pssTag;
-        int foundTags = 0;
-
-        while (foundTags < allTags && skipLen > 0) {
-            skipLen--;
-            if (Q_UNLIKELY(!fgets(line, lineLen, sf.file)))
-                break;
-            pl = line;
+} // namespace
 
-            static const char strSize[] = "ize:";
-            static const char strXss[] = "ss:";
+bool ProcessReader::readSmaps(const QByteArray &smapsFile, Memory &mem)
+{
+    const qsizetype len = readFile(smapsFile);
+    if (len <= 0)
+        return false;
 
-            switch (*pl) {
-            case 'S':
-                if (!qstrncmp(pl + 1, strSize, sizeof(strSize) - 1)) {
-                    foundTags |= sizeTag;
-                    vm = parseValue(pl + sizeof(strSize));
-                }
-                break;
-            case 'R':
-                if (!qstrncmp(pl + 1, strXss, sizeof(strXss) - 1)) {
-                    foundTags |= rssTag;
-                    rss = parseValue(pl + sizeof(strXss));
-                }
-                break;
-            case 'P':
-                if (!qstrncmp(pl + 1, strXss, sizeof(strXss) - 1)) {
-                    foundTags |= pssTag;
-                    pss = parseValue(pl + sizeof(strXss));
-                }
-                break;
-            }
-        }
+    const char *pos = m_readBuffer.constData();
+    const char *end = pos + len;
 
-        if (foundTags < allTags)
-            break;
+    Memory result;
+    SmapsMapping mapping;
+    bool inMapping = false;
+    bool wasPrivateOnly = false;
+
+    auto addMapping = [&]() -> bool {
+        if (!mapping.foundSize || !mapping.foundRss || !mapping.foundPss)
+            return false;
 
-        mem.totalVm += vm;
-        mem.totalRss += rss;
-        mem.totalPss += pss;
+        result.totalVm += mapping.vm;
+        result.totalRss += mapping.rss;
+        result.totalPss += mapping.pss;
 
         static const char permRXP[] = { 'r', '-', 'x', 'p' };
         static const char permRWP[] = { 'r', 'w', '-', 'p' };
-        if (!memcmp(permissions, permRXP, sizeof(permissions))) {
-            mem.textVm += vm;
-            mem.textRss += rss;
-            mem.textPss += pss;
-        } else if (!memcmp(permissions, permRWP, sizeof(permissions))
-                   && !isMainStack && (vm != 8192 || hasInode || !wasPrivateOnly) // try to exclude stack
-                   && !hasInode) {
-            mem.heapVm += vm;
-            mem.heapRss += rss;
-            mem.heapPss += pss;
+        if (!memcmp(mapping.permissions, permRXP, sizeof(permRXP))) {
+            result.textVm += mapping.vm;
+            result.textRss += mapping.rss;
+            result.textPss += mapping.pss;
+        } else if (!memcmp(mapping.permissions, permRWP, sizeof(permRWP))
+                   && !mapping.isMainStack
+                   && (mapping.vm != 8192 || mapping.hasInode || !wasPrivateOnly) // try to exclude stack
+                   && !mapping.hasInode) {
+            result.heapVm += mapping.vm;
+            result.heapRss += mapping.rss;
+            result.heapPss += mapping.pss;
         }
 
         static const char permP[] = { '-', '-', '-', 'p' };
-        wasPrivateOnly = !memcmp(permissions, permP, sizeof(permissions));
+        wasPrivateOnly = !memcmp(mapping.permissions, permP, sizeof(permP));
+        return true;
+    };
 
-        for (int skip = skipLen; skip; --skip) {
-            if (Q_UNLIKELY(!fgets(line, lineLen, sf.file)))
-                break;
+    while (pos < end) {
+        const char *eol = static_cast<const char *>(memchr(pos, '\n', size_t(end - pos)));
+        if (!eol)
+            eol = end;
+
+        if (pos == eol) {
+            // empty lines are not expected, but harmless
+        } else if (isHexDigit(*pos)) {
+            // all the per-mapping tags start with an upper-case letter
+            if (inMapping && !addMapping())
+                return false;
+            mapping = SmapsMapping();
+            if (!mapping.parseHeader(pos, eol))
+                return false;
+            inMapping = true;
+        } else if (!inMapping || !mapping.parseLine(pos, eol)) {
+            return false;
+        }
+        pos = eol + 1;
+    }
+
+    if (!inMapping || !addMapping())
+        return false;
+
+    mem = result;
+    m_detailedMemory = result;
+    return true;
+}
+
+// smaps_rollup has the same format as smaps, but only contains one pseudo-mapping that sums up
+// all the real mappings. It does not have a "Size" tag though, so the total virtual size needs
+// to be taken from statm instead. The text and heap breakdown is not available at all, so we
+// keep reporting the values from the last full smaps parse.
+bool ProcessReader::readSmapsRollup(const QByteArray &smapsRollupFile, const QByteArray &statmFile,
+                                    Memory &mem)
+{
+    static const long pageSize = sysconf(_SC_PAGESIZE);
+    if (pageSize <= 0)
+        return false;
+
+    qsizetype len = readFile(smapsRollupFile);
+    if ((len <= 0) || !isHexDigit(m_readBuffer.at(0)))
+        return false;
+
+    quint32 rss = 0;
+    quint32 pss = 0;
+    bool foundRss = false;
+    bool foundPss = false;
+
+    static const char strRss[] = "Rss:";
+    static const char strPss[] = "Pss:";
+
+    const char *pos = m_readBuffer.constData();
+    const char *end = pos + len;
+    while ((pos < end) && !(foundRss && foundPss)) {
+        const char *eol = static_cast<const char *>(memchr(pos, '\n', size_t(end - pos)));
+        if (!eol)
+            eol = end;
+        if (!parseTag(pos, eol, strRss, sizeof(strRss) - 1, rss, foundRss)
+                || !parseTag(pos, eol, strPss, sizeof(strPss) - 1, pss, foundPss)) {
+            return false;
         }
+        pos = eol + 1;
     }
+    if (!foundRss || !foundPss)
+        return false;
+
+    // the first field in statm is the total virtual size in pages
+    len = readFile(statmFile);
+    if (len <= 0)
+        return false;
+    quint32 vmPages = 0;
+    if (!parseNumber(m_readBuffer.constData(), m_readBuffer.constData() + len, vmPages))
+        return false;
 
-    return ok;
+    Memory result = m_detailedMemory;
+    result.totalVm = quint32(quint64(vmPages) * quint64(pageSize) / 1024);
+    result.totalRss = rss;
+    result.totalPss = pss;
+    mem = result;
+    return true;
 }
 
 bool ProcessReader::testReadSmaps(const QByteArray &smapsFile)
@@ -274,6 +393,12 @@ bool ProcessReader::testReadSmaps(const QByteArray &smapsFile)
     return readSmaps(smapsFile, memory);
 }
 
+bool ProcessReader::testReadSmapsRollup(const QByteArray &smapsRollupFile, const QByteArray &statmFile)
+{
+    memory = Memory();
+    return readSmapsRollup(smapsRollupFile, statmFile, memory);
+}
+
 #elif defined(Q_OS_MACOS)
 
 void ProcessReader::openCpuLoad()
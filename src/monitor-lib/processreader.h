@@ -23,7 +23,7 @@ class ProcessReader : public QObject {
 
 public:
     QMutex mutex;
-    qreal cpuLoad;
+    qreal cpuLoad = 0;
     struct Memory {
         quint32 totalVm = 0;
         quint32 totalRss = 0;
@@ -36,15 +36,22 @@ public:
         quint32 heapPss = 0;
     } memory;
 
+    // the text and heap breakdown needs a full walk of /proc/<pid>/smaps, which gets expensive
+    // for processes with thousands of mappings: on kernels that provide smaps_rollup, only
+    // every n-th update does a full parse, while the others only refresh the totals
+    static constexpr int DefaultDetailedMemoryInterval = 10;
+
 #if defined(Q_OS_LINUX)
     // solely for testing purposes
     bool testReadSmaps(const QByteArray &smapsFile);
+    bool testReadSmapsRollup(const QByteArray &smapsRollupFile, const QByteArray &statmFile);
 #endif
 
 public slots:
     void update();
     void setProcessId(qint64 pid);
     void enableMemoryReporting(bool enabled);
+    void setDetailedMemoryInterval(int updates);
 
 signals:
     void updated();
@@ -56,14 +63,21 @@ private:
 
 #if defined(Q_OS_LINUX)
     bool readSmaps(const QByteArray &smapsFile, Memory &mem);
+    bool readSmapsRollup(const QByteArray &smapsRollupFile, const QByteArray &statmFile, Memory &mem);
+    qsizetype readFile(const QByteArray &fileName);
 
     std::unique_ptr<SysFsReader> m_statReader;
     QElapsedTimer m_elapsedTime;
     quint64 m_lastCpuUsage = 0.0;
+    QByteArray m_readBuffer;
+    Memory m_detailedMemory;
+    int m_updatesSinceDetailedMemory = 0;
+    bool m_smapsRollupAvailable = true;
 #endif
 
     qint64 m_pid = 0;
     bool m_memoryReportingEnabled = true;
+    int m_detailedMemoryInterval = DefaultDetailedMemoryInterval;
 };
 
 QT_END_NAMESPACE_AM
@@ -0,0 +1,310 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QThread>
+
+#include <limits>
+#include <utility>
+
+#include "processsampler.h"
+
+QT_BEGIN_NAMESPACE_AM
+
+ProcessSampler *ProcessSampler::s_instance = nullptr;
+
+ProcessSampler::ProcessSampler(QObject *parent)
+    : QObject(parent)
+{ }
+
+ProcessSampler *ProcessSampler::instance()
+{
+    // Without a QCoreApplication (e.g. while it is being destroyed) nobody would own and delete
+    // a new singleton: its worker threads would still be running at exit.
+    if (!s_instance && QCoreApplication::instance() && !QCoreApplication::closingDown())
+        s_instance = new ProcessSampler(QCoreApplication::instance());
+    return s_instance;
+}
+
+ProcessSampler *ProcessSampler::existingInstance()
+{
+    return s_instance;
+}
+
+ProcessSampler::~ProcessSampler()
+{
+    for (Process *process : std::as_const(m_processes)) {
+        if (process->reader)
+            process->reader->deleteLater();
+        delete process;
+    }
+    m_processes.clear();
+    m_subscribers.clear();
+    stopWorkerThreads();
+
+    if (s_instance == this)
+        s_instance = nullptr;
+}
+
+void ProcessSampler::subscribe(QObject *subscriber, qint64 pid, const Callback &callback)
+{
+    auto it = m_subscribers.find(subscriber);
+    if (it == m_subscribers.end()) {
+        it = m_subscribers.insert(subscriber, Subscriber { });
+        it->pid = pid;
+        it->callback = callback;
+        addSubscriberToProcess(subscriber, pid);
+        return;
+    }
+
+    it->callback = callback;
+    if (it->pid != pid) {
+        const qint64 oldPid = std::exchange(it->pid, pid);
+        const bool updateRequested = std::exchange(it->updateRequested, false);
+
+        removeSubscriberFromProcess(subscriber, oldPid);
+        addSubscriberToProcess(subscriber, pid);
+
+        // a pending update request moves over to the new process
+        if (updateRequested)
+            requestUpdate(subscriber);
+    }
+}
+
+void ProcessSampler::unsubscribe(QObject *subscriber)
+{
+    auto it = m_subscribers.find(subscriber);
+    if (it == m_subscribers.end())
+        return;
+
+    const qint64 pid = it->pid;
+    m_subscribers.erase(it);
+    removeSubscriberFromProcess(subscriber, pid);
+}
+
+void ProcessSampler::setMemoryReporting(QObject *subscriber, bool enabled, int detailedMemoryInterval)
+{
+    auto it = m_subscribers.find(subscriber);
+    if (it == m_subscribers.end())
+        return;
+
+    it->memoryReportingEnabled = enabled;
+    it->detailedMemoryInterval = qMax(1, detailedMemoryInterval);
+
+    if (Process *process = m_processes.value(it->pid))
+        updateReaderConfiguration(process);
+}
+
+void ProcessSampler::requestUpdate(QObject *subscriber)
+{
+    auto it = m_subscribers.find(subscriber);
+    if ((it == m_subscribers.end()) || it->updateRequested)
+        return;
+    it->updateRequested = true;
+
+    const qint64 pid = it->pid;
+    Process *process = m_processes.value(pid);
+    Q_ASSERT(process);
+
+    // another subscriber already asked for a sample: this request piggybacks on it
+    if (process->samplePending)
+        return;
+    process->samplePending = true;
+
+    if (process->reader && (!process->lastSample.isValid()
+                            || (process->lastSample.elapsed() >= MinimumSampleInterval))) {
+        QMetaObject::invokeMethod(process->reader, &ProcessReader::update);
+    } else {
+        // either there is nothing to sample (pid 0), or the last sample is still fresh: we still
+        // need to deliver asynchronously, as if an actual sample was taken
+        QMetaObject::invokeMethod(this, [this, pid]() { deliver(pid); }, Qt::QueuedConnection);
+    }
+}
+
+int ProcessSampler::sampledProcessCount() const
+{
+    int count = 0;
+    for (const Process *process : m_processes) {
+        if (process->reader)
+            ++count;
+    }
+    return count;
+}
+
+int ProcessSampler::workerThreadCount() const
+{
+    return int(m_workerThreads.size());
+}
+
+quint64 ProcessSampler::sampleCount() const
+{
+    return m_sampleCount;
+}
+
+ProcessSampler::Process *ProcessSampler::addSubscriberToProcess(QObject *subscriber, qint64 pid)
+{
+    Process *process = m_processes.value(pid);
+    if (!process) {
+        process = new Process;
+        if (pid) {
+            process->thread = workerThreadForNewProcess();
+            process->reader = new ProcessReader;
+            process->reader->moveToThread(process->thread);
+
+            auto reader = process->reader;
+            connect(reader, &ProcessReader::updated, this, [this, pid, reader]() {
+                sampled(pid, reader);
+            });
+            QMetaObject::invokeMethod(reader, [reader, pid]() { reader->setProcessId(pid); });
+        }
+        m_processes.insert(pid, process);
+    }
+    process->subscribers.append(subscriber);
+    updateReaderConfiguration(process);
+    return process;
+}
+
+void ProcessSampler::removeSubscriberFromProcess(QObject *subscriber, qint64 pid)
+{
+    auto it = m_processes.find(pid);
+    if (it == m_processes.end())
+        return;
+
+    Process *process = *it;
+    process->subscribers.removeOne(subscriber);
+    if (!process->subscribers.isEmpty()) {
+        updateReaderConfiguration(process);
+        return;
+    }
+
+    if (process->reader) {
+        process->reader->disconnect(this);
+        process->reader->deleteLater();
+        --m_workerThreadLoad[process->thread];
+    }
+    m_processes.erase(it);
+    delete process;
+
+    if (m_processes.isEmpty())
+        stopWorkerThreads();
+}
+
+void ProcessSampler::updateReaderConfiguration(Process *process)
+{
+    if (!process->reader)
+        return;
+
+    // the shared reader has to satisfy the most demanding subscriber
+    bool memoryReportingEnabled = false;
+    int detailedMemoryInterval = std::numeric_limits<int>::max();
+
+    for (QObject *subscriber : std::as_const(process->subscribers)) {
+        auto it = m_subscribers.constFind(subscriber);
+        if ((it != m_subscribers.cend()) && it->memoryReportingEnabled) {
+            memoryReportingEnabled = true;
+            detailedMemoryInterval = qMin(detailedMemoryInterval, it->detailedMemoryInterval);
+        }
+    }
+    if (!memoryReportingEnabled)
+        detailedMemoryInterval = ProcessReader::DefaultDetailedMemoryInterval;
+
+    if ((memoryReportingEnabled != process->memoryReportingEnabled)
+            || (detailedMemoryInterval != process->detailedMemoryInterval)) {
+        process->memoryReportingEnabled = memoryReportingEnabled;
+        process->detailedMemoryInterval = detailedMemoryInterval;
+
+        auto reader = process->reader;
+        QMetaObject::invokeMethod(reader, [reader, memoryReportingEnabled, detailedMemoryInterval]() {
+            reader->enableMemoryReporting(memoryReportingEnabled);
+            reader->setDetailedMemoryInterval(detailedMemoryInterval);
+        });
+    }
+}
+
+QThread *ProcessSampler::workerThreadForNewProcess()
+{
+    // reading from /proc is mostly CPU bound, but we do not want to hog the system either
+    static const int maximumThreadCount = qBound(1, QThread::idealThreadCount() / 2, 4);
+
+    int readerCount = 1; // the new one
+    for (int load : std::as_const(m_workerThreadLoad))
+        readerCount += load;
+    const int wantedThreadCount = qMin(maximumThreadCount, (readerCount + ProcessesPerWorkerThread - 1)
+                                                           / ProcessesPerWorkerThread);
+
+    if (m_workerThreads.size() < wantedThreadCount) {
+        auto thread = new QThread;
+        thread->start();
+        m_workerThreads.append(thread);
+        m_workerThreadLoad.insert(thread, 0);
+    }
+
+    QThread *leastLoaded = nullptr;
+    for (QThread *thread : std::as_const(m_workerThreads)) {
+        if (!leastLoaded || (m_workerThreadLoad.value(thread) < m_workerThreadLoad.value(leastLoaded)))
+            leastLoaded = thread;
+    }
+    ++m_workerThreadLoad[leastLoaded];
+    return leastLoaded;
+}
+
+void ProcessSampler::stopWorkerThreads()
+{
+    // the readers have been deleteLater'ed, which QThread takes care of when finishing
+    for (QThread *thread : std::as_const(m_workerThreads)) {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
+    m_workerThreads.clear();
+    m_workerThreadLoad.clear();
+}
+
+void ProcessSampler::sampled(qint64 pid, ProcessReader *reader)
+{
+    Process *process = m_processes.value(pid);
+    if (!process || (process->reader != reader))
+        return;
+
+    {
+        QMutexLocker locker(&reader->mutex);
+        process->reading.cpuLoad = reader->cpuLoad;
+        process->reading.memory = reader->memory;
+    }
+    ++m_sampleCount;
+    process->lastSample.start();
+    deliver(pid);
+}
+
+void ProcessSampler::deliver(qint64 pid)
+{
+    Process *process = m_processes.value(pid);
+    if (!process)
+        return;
+
+    process->samplePending = false;
+    const Reading reading = process->reading;
+    const auto subscribers = process->subscribers;
+
+    for (QObject *subscriber : subscribers) {
+        // the callbacks are free to (un)subscribe, so we cannot hold on to any iterators
+        auto it = m_subscribers.find(subscriber);
+        if ((it == m_subscribers.end()) || !it->updateRequested || (it->pid != pid))
+            continue;
+        it->updateRequested = false;
+
+        const Callback callback = it->callback;
+        if (it->memoryReportingEnabled) {
+            callback(reading);
+        } else {
+            Reading cpuOnlyReading = reading;
+            cpuOnlyReading.memory = ProcessReader::Memory();
+            callback(cpuOnlyReading);
+        }
+    }
+}
+
+QT_END_NAMESPACE_AM
+
+#include "moc_processsampler.cpp"
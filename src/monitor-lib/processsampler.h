@@ -0,0 +1,99 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QVector>
+#include <QtCore/QElapsedTimer>
+#include <QtAppManCommon/global.h>
+#include <QtAppManMonitor/processreader.h>
+
+#include <functional>
+
+QT_FORWARD_DECLARE_CLASS(QThread)
+
+QT_BEGIN_NAMESPACE_AM
+
+// Samples CPU load and memory usage of processes on behalf of any number of subscribers (e.g.
+// ProcessStatus objects). There is exactly one ProcessReader per pid, no matter how many
+// subscribers are watching that process, and all update requests for a pid that arrive while a
+// sample is in flight (or within MinimumSampleInterval after it) share that one sample.
+// The readers are spread over a small pool of worker threads, which grows with the number of
+// sampled processes and is shut down as soon as there are no subscribers anymore.
+// This class must only be used from the thread it was created in (most likely the main one).
+// The singleton is owned by the QCoreApplication object and is destroyed together with it.
+
+class ProcessSampler : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Reading
+    {
+        qreal cpuLoad = 0;
+        ProcessReader::Memory memory;
+    };
+    using Callback = std::function<void(const Reading &reading)>;
+
+    static constexpr int MinimumSampleInterval = 100; // msec
+    static constexpr int ProcessesPerWorkerThread = 8;
+
+    static ProcessSampler *instance(); // nullptr, if there is no (running) QCoreApplication
+    static ProcessSampler *existingInstance(); // does not create the singleton
+    ~ProcessSampler() override;
+
+    // (Re-)subscribes subscriber to pid: the callback is called once for every requestUpdate()
+    void subscribe(QObject *subscriber, qint64 pid, const Callback &callback);
+    void unsubscribe(QObject *subscriber);
+    void setMemoryReporting(QObject *subscriber, bool enabled, int detailedMemoryInterval);
+    void requestUpdate(QObject *subscriber);
+
+    int sampledProcessCount() const;
+    int workerThreadCount() const;
+    quint64 sampleCount() const;
+
+private:
+    struct Subscriber
+    {
+        qint64 pid = 0;
+        bool memoryReportingEnabled = true;
+        int detailedMemoryInterval = ProcessReader::DefaultDetailedMemoryInterval;
+        bool updateRequested = false;
+        Callback callback;
+    };
+
+    struct Process
+    {
+        ProcessReader *reader = nullptr;
+        QThread *thread = nullptr;
+        QVector<QObject *> subscribers;
+        bool samplePending = false;
+        bool memoryReportingEnabled = true;
+        int detailedMemoryInterval = ProcessReader::DefaultDetailedMemoryInterval;
+        QElapsedTimer lastSample;
+        Reading reading;
+    };
+
+    ProcessSampler(QObject *parent = nullptr);
+    Process *addSubscriberToProcess(QObject *subscriber, qint64 pid);
+    void removeSubscriberFromProcess(QObject *subscriber, qint64 pid);
+    void updateReaderConfiguration(Process *process);
+    QThread *workerThreadForNewProcess();
+    void stopWorkerThreads();
+    void sampled(qint64 pid, ProcessReader *reader);
+    void deliver(qint64 pid);
+
+    QHash<QObject *, Subscriber> m_subscribers;
+    QHash<qint64, Process *> m_processes;
+    QVector<QThread *> m_workerThreads;
+    QHash<QThread *, int> m_workerThreadLoad;
+    quint64 m_sampleCount = 0;
+
+    static ProcessSampler *s_instance;
+
+    Q_DISABLE_COPY_MOVE(ProcessSampler)
+};
+
+QT_END_NAMESPACE_AM
@@ -282,6 +282,16 @@ qreal GpuReader::readLoadValue()
 
 // TODO: can we always expect cgroup FS to be mounted on /sys/fs/cgroup?
 static const QString cGroupsMemoryBaseDir = qSL("/sys/fs/cgroup/memory/");
+// the unified cgroup v2 hierarchy
+static const QString cGroupsBaseDir = qSL("/sys/fs/cgroup/");
+
+static quint64 memInfoValue(const QByteArray &buffer, const char *key)
+{
+    int i = buffer.indexOf(key);
+    if (i == -1)
+        return 0;
+    return ::strtoull(buffer.constData() + i + qstrlen(key), nullptr, 10) * 1024;
+}
 
 MemoryReader::MemoryReader() : MemoryReader(QString())
 { }
@@ -289,9 +299,25 @@ MemoryReader::MemoryReader() : MemoryReader(QString())
 MemoryReader::MemoryReader(const QString &groupPath)
     : m_groupPath(groupPath)
 {
-    const QString path = g_systemRootDir + cGroupsMemoryBaseDir + m_groupPath + qSL("/memory.stat");
+    QString path = g_systemRootDir + cGroupsMemoryBaseDir + m_groupPath + qSL("/memory.stat");
+    int maxRead = 1500;
+
+    if (!QFile::exists(path)) {
+        const QString currentPath = g_systemRootDir + cGroupsBaseDir + m_groupPath + qSL("/memory.current");
+
+        if (!m_groupPath.isEmpty() && QFile::exists(currentPath)) {
+            m_source = Source::CGroupV2Current;
+            path = currentPath;
+            maxRead = 41;
+        } else if (m_groupPath.isEmpty()) {
+            // the root group has no memory.current in cgroup v2
+            m_source = Source::ProcMemInfo;
+            path = g_systemRootDir + qSL("/proc/meminfo");
+            maxRead = 256;
+        }
+    }
 
-    m_sysFs.reset(new SysFsReader(path.toLocal8Bit(), 1500));
+    m_sysFs.reset(new SysFsReader(path.toLocal8Bit(), maxRead));
     if (!m_sysFs->isOpen()) {
         qCWarning(LogSystem) << "WARNING: could not read memory statistics from" << m_sysFs->fileName()
                              << "(make sure that the memory cgroup is mounted)";
@@ -313,6 +339,20 @@ MemoryReader::MemoryReader(const QString &groupPath)
 
 quint64 MemoryReader::groupLimit()
 {
+    switch (m_source) {
+    case Source::CGroupV2Current: {
+        QString path = g_systemRootDir + cGroupsBaseDir + m_groupPath + qSL("/memory.max");
+        QByteArray ba = SysFsReader(path.toLocal8Bit(), 41).readValue();
+        if (ba.startsWith("max"))
+            return s_totalValue;
+        return ::strtoull(ba, nullptr, 10);
+    }
+    case Source::ProcMemInfo:
+        return s_totalValue;
+    case Source::CGroupV1Stat:
+        break;
+    }
+
     QString path = g_systemRootDir + cGroupsMemoryBaseDir + m_groupPath + qSL("/memory.limit_in_bytes");
     QByteArray ba = SysFsReader(path.toLocal8Bit(), 41).readValue();
     return ::strtoull(ba, nullptr, 10);
@@ -322,6 +362,18 @@ quint64 MemoryReader::readUsedValue() const
 {
     QByteArray buffer = m_sysFs->readValue();
 
+    switch (m_source) {
+    case Source::CGroupV2Current:
+        return ::strtoull(buffer.constData(), nullptr, 10);
+    case Source::ProcMemInfo: {
+        quint64 total = memInfoValue(buffer, "MemTotal:");
+        quint64 available = memInfoValue(buffer, "MemAvailable:");
+        return (total > available) ? (total - available) : 0;
+    }
+    case Source::CGroupV1Stat:
+        break;
+    }
+
     int i = buffer.indexOf("total_rss ");
     if (i == -1)
         return 0;
@@ -391,6 +443,10 @@ MemoryThreshold::~MemoryThreshold()
         QT_CLOSE(m_controlFd);
     if (m_eventFd != -1)
         QT_CLOSE(m_eventFd);
+    if (m_cgroupEventsFd != -1)
+        QT_CLOSE(m_cgroupEventsFd);
+    if (m_pressureFd != -1)
+        QT_CLOSE(m_pressureFd);
 }
 
 QList<qreal> MemoryThreshold::thresholdPercentages() const
@@ -409,66 +465,167 @@ bool MemoryThreshold::setEnabled(bool enabled)
     return setEnabled(enabled, QString(), &reader);
 }
 
-bool MemoryThreshold::setEnabled(bool enabled, const QString &groupPath, MemoryReader *reader)
+bool MemoryThreshold::setEnabled(bool enabled, const QString &groupPath, MemoryReader *reader,
+                                 Backend backend)
 {
     if (m_enabled == enabled)
         return true;
 
     if (enabled && !m_initialized) {
-        quint64 limit = groupPath.isEmpty() ? reader->totalValue() : reader->groupLimit();
-        const QString cGroup = cGroupsMemoryBaseDir + groupPath;
+        if (backend == Backend::Automatic)
+            backend = detectBackend(groupPath);
+
+        bool ok = false;
+        switch (backend) {
+        case Backend::CGroupV1:
+            ok = initCGroupV1(groupPath, reader);
+            break;
+        case Backend::CGroupV2:
+            ok = initCGroupV2(groupPath);
+            break;
+        case Backend::Pressure:
+            ok = initPressure(groupPath);
+            if (!ok)
+                qWarning() << "Cannot create a memory pressure trigger for" << (groupPath.isEmpty() ? qSL("the system") : groupPath);
+            break;
+        case Backend::Automatic:
+            break;
+        }
 
-        m_eventFd = ::eventfd(0, EFD_CLOEXEC);
+        if (ok) {
+            m_backend = backend;
+            m_initialized = m_enabled = true;
+        }
+        return ok;
+    } else {
+        m_enabled = enabled;
+        for (QSocketNotifier *notifier : { m_notifier, m_cgroupEventsNotifier, m_pressureNotifier }) {
+            if (notifier)
+                notifier->setEnabled(enabled);
+        }
+        return true;
+    }
+}
+
+MemoryThreshold::Backend MemoryThreshold::backend() const
+{
+    return m_backend;
+}
+
+MemoryThreshold::Backend MemoryThreshold::detectBackend(const QString &groupPath)
+{
+    if (QFile::exists(g_systemRootDir + cGroupsMemoryBaseDir + groupPath + qSL("/cgroup.event_control")))
+        return Backend::CGroupV1;
+    // the root group has no memory.events in cgroup v2
+    if (!groupPath.isEmpty() && QFile::exists(g_systemRootDir + cGroupsBaseDir + groupPath + qSL("/memory.events")))
+        return Backend::CGroupV2;
+    return Backend::Pressure;
+}
+
+bool MemoryThreshold::initCGroupV1(const QString &groupPath, MemoryReader *reader)
+{
+    quint64 limit = groupPath.isEmpty() ? reader->totalValue() : reader->groupLimit();
+    const QString cGroup = g_systemRootDir + cGroupsMemoryBaseDir + groupPath;
 
-        if (m_eventFd >= 0) {
-            const QString usagePath = cGroup + qL1S("/memory.usage_in_bytes");
-            m_usageFd = QT_OPEN(usagePath.toLocal8Bit().constData(), QT_OPEN_RDONLY);
+    m_eventFd = ::eventfd(0, EFD_CLOEXEC);
 
-            if (m_usageFd >= 0) {
-                const QString eventControlPath = cGroup + qSL("/cgroup.event_control");
-                m_controlFd = QT_OPEN(eventControlPath.toLocal8Bit().constData(), QT_OPEN_WRONLY);
+    if (m_eventFd >= 0) {
+        const QString usagePath = cGroup + qL1S("/memory.usage_in_bytes");
+        m_usageFd = QT_OPEN(usagePath.toLocal8Bit().constData(), QT_OPEN_RDONLY);
 
-                if (m_controlFd >= 0) {
-                    bool registerOk = true;
+        if (m_usageFd >= 0) {
+            const QString eventControlPath = cGroup + qSL("/cgroup.event_control");
+            m_controlFd = QT_OPEN(eventControlPath.toLocal8Bit().constData(), QT_OPEN_WRONLY);
 
-                    for (qreal percent : std::as_const(m_thresholds)) {
-                        quint64 mem = quint64(limit * percent) / 100;
-                        registerOk = registerOk && (dprintf(m_controlFd, "%d %d %llu", m_eventFd, m_usageFd, mem) > 0);
-                    }
+            if (m_controlFd >= 0) {
+                bool registerOk = true;
 
-                    if (registerOk) {
-                        m_notifier = new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this);
-                        connect(m_notifier, &QSocketNotifier::activated, this, &MemoryThreshold::readEventFd);
-                        return m_initialized = m_enabled = true;
-                    } else {
-                        qWarning() << "Could not register memory limit event handlers";
-                    }
+                for (qreal percent : std::as_const(m_thresholds)) {
+                    quint64 mem = quint64(limit * percent) / 100;
+                    registerOk = registerOk && (dprintf(m_controlFd, "%d %d %llu", m_eventFd, m_usageFd, mem) > 0);
+                }
 
-                    QT_CLOSE(m_controlFd);
-                    m_controlFd = -1;
+                if (registerOk) {
+                    m_notifier = new QSocketNotifier(m_eventFd, QSocketNotifier::Read, this);
+                    connect(m_notifier, &QSocketNotifier::activated, this, &MemoryThreshold::readEventFd);
+                    return true;
                 } else {
-                    qWarning() << "Cannot open" << eventControlPath;
+                    qWarning() << "Could not register memory limit event handlers";
                 }
 
-                QT_CLOSE(m_usageFd);
-                m_usageFd = -1;
+                QT_CLOSE(m_controlFd);
+                m_controlFd = -1;
             } else {
-                qWarning() << "Cannot open" << usagePath;
+                qWarning() << "Cannot open" << eventControlPath;
             }
 
-            QT_CLOSE(m_eventFd);
-            m_eventFd = -1;
+            QT_CLOSE(m_usageFd);
+            m_usageFd = -1;
         } else {
-            qWarning() << "Cannot create an eventfd";
+            qWarning() << "Cannot open" << usagePath;
         }
 
-        return false;
+        QT_CLOSE(m_eventFd);
+        m_eventFd = -1;
     } else {
-        m_enabled = enabled;
-        m_notifier->setEnabled(enabled);
+        qWarning() << "Cannot create an eventfd";
+    }
 
-        return true;
+    return false;
+}
+
+// The kernel signals POLLPRI on memory.events and PSI trigger file descriptors, which is an
+// "exception" in QSocketNotifier terms. Neither needs polling: we only wake up on changes.
+
+static QByteArray readFromStart(int fd)
+{
+    char buffer[512];
+    auto bytesRead = ::pread(fd, buffer, sizeof(buffer), 0);
+    return (bytesRead > 0) ? QByteArray(buffer, int(bytesRead)) : QByteArray();
+}
+
+bool MemoryThreshold::initCGroupV2(const QString &groupPath)
+{
+    const QString eventsPath = g_systemRootDir + cGroupsBaseDir + groupPath + qSL("/memory.events");
+    m_cgroupEventsFd = QT_OPEN(eventsPath.toLocal8Bit().constData(), QT_OPEN_RDONLY | O_CLOEXEC);
+
+    if (m_cgroupEventsFd < 0) {
+        qWarning() << "Cannot open" << eventsPath;
+        return false;
     }
+
+    m_lastCGroupEvents = readFromStart(m_cgroupEventsFd);
+    m_cgroupEventsNotifier = new QSocketNotifier(m_cgroupEventsFd, QSocketNotifier::Exception, this);
+    connect(m_cgroupEventsNotifier, &QSocketNotifier::activated, this, &MemoryThreshold::readCGroupEvents);
+
+    // memory.events only changes when the group runs into its memory.high or memory.max limits,
+    // but a pressure trigger already fires when the group starts to stall on reclaim
+    if (!initPressure(groupPath))
+        qCDebug(LogSystem) << "No memory pressure trigger available for" << groupPath;
+    return true;
+}
+
+// a 200ms stall within a 2s window: unprivileged users can only use multiples of 2s as window
+static const char pressureTrigger[] = "some 200000 2000000";
+
+bool MemoryThreshold::initPressure(const QString &groupPath)
+{
+    const QString pressurePath = groupPath.isEmpty()
+            ? g_systemRootDir + qSL("/proc/pressure/memory")
+            : g_systemRootDir + cGroupsBaseDir + groupPath + qSL("/memory.pressure");
+    m_pressureFd = QT_OPEN(pressurePath.toLocal8Bit().constData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+
+    if (m_pressureFd >= 0) {
+        // the trigger stays active for as long as the file descriptor stays open
+        if (QT_WRITE(m_pressureFd, pressureTrigger, sizeof(pressureTrigger)) == sizeof(pressureTrigger)) {
+            m_pressureNotifier = new QSocketNotifier(m_pressureFd, QSocketNotifier::Exception, this);
+            connect(m_pressureNotifier, &QSocketNotifier::activated, this, &MemoryThreshold::readPressureEvent);
+            return true;
+        }
+        QT_CLOSE(m_pressureFd);
+        m_pressureFd = -1;
+    }
+    return false;
 }
 
 void MemoryThreshold::readEventFd()
@@ -491,6 +648,22 @@ void MemoryThreshold::readEventFd()
     }
 }
 
+void MemoryThreshold::readCGroupEvents()
+{
+    // reading the file also acknowledges the notification
+    const QByteArray events = readFromStart(m_cgroupEventsFd);
+    if (events != m_lastCGroupEvents) {
+        m_lastCGroupEvents = events;
+        emit thresholdTriggered();
+    }
+}
+
+void MemoryThreshold::readPressureEvent()
+{
+    // the kernel resets the event when polling, so there is nothing to read here
+    emit thresholdTriggered();
+}
+
 MemoryWatcher::MemoryWatcher(QObject *parent)
     : QObject(parent)
 { }
@@ -501,7 +674,7 @@ void MemoryWatcher::setThresholds(qreal warning, qreal critical)
     m_critical = critical;
 }
 
-bool MemoryWatcher::startWatching(const QString &groupPath)
+bool MemoryWatcher::startWatching(const QString &groupPath, MemoryThreshold::Backend backend)
 {
     if (m_warning < 0.0 || m_warning > 100.0 || m_critical < 0.0 || m_critical > 100.0) {
         qCWarning(LogSystem) << "Memory threshold out of range [0..100]" << m_warning << m_critical;
@@ -516,7 +689,7 @@ bool MemoryWatcher::startWatching(const QString &groupPath)
 
     m_threshold.reset(new MemoryThreshold({m_warning, m_critical}));
     connect(m_threshold.get(), &MemoryThreshold::thresholdTriggered, this, &MemoryWatcher::checkMemoryConsumption);
-    return m_threshold->setEnabled(true, groupPath, m_reader.get());
+    return m_threshold->setEnabled(true, groupPath, m_reader.get(), backend);
 }
 
 void MemoryWatcher::checkMemoryConsumption()
@@ -791,9 +964,10 @@ void MemoryWatcher::setThresholds(qreal warning, qreal critical)
     m_critical = critical;
 }
 
-bool MemoryWatcher::startWatching(const QString &groupPath)
+bool MemoryWatcher::startWatching(const QString &groupPath, MemoryThreshold::Backend backend)
 {
     Q_UNUSED(groupPath)
+    Q_UNUSED(backend)
     return false;
 }
 
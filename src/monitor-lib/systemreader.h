@@ -82,6 +82,12 @@ public:
 private:
     static quint64 s_totalValue;
 #if defined(Q_OS_LINUX)
+    enum class Source {
+        CGroupV1Stat,    // total_rss in memory.stat
+        CGroupV2Current, // memory.current
+        ProcMemInfo      // MemTotal - MemAvailable in /proc/meminfo (no cgroup v1 memory controller)
+    };
+    Source m_source = Source::CGroupV1Stat;
     std::unique_ptr<SysFsReader> m_sysFs;
     const QString m_groupPath;
 #elif defined(Q_OS_MACOS) || defined(Q_OS_IOS)
@@ -112,6 +118,13 @@ class MemoryThreshold : public QObject
     Q_OBJECT
 
 public:
+    enum class Backend {
+        Automatic, // the first one of the following backends that is available for the group
+        CGroupV1,  // memory.usage_in_bytes thresholds via cgroup.event_control
+        CGroupV2,  // changes in memory.events, plus a PSI trigger on memory.pressure
+        Pressure   // only a PSI trigger on memory.pressure (or /proc/pressure/memory)
+    };
+
     MemoryThreshold(const QList<qreal> &thresholds);
     ~MemoryThreshold();
     QList<qreal> thresholdPercentages() const;
@@ -119,7 +132,11 @@ public:
     bool isEnabled() const;
     bool setEnabled(bool enabled);
 #if defined(Q_OS_LINUX)
-    bool setEnabled(bool enabled, const QString &groupPath, MemoryReader *reader);
+    bool setEnabled(bool enabled, const QString &groupPath, MemoryReader *reader,
+                    Backend backend = Backend::Automatic);
+    Backend backend() const;
+
+    static Backend detectBackend(const QString &groupPath);
 #endif
 
 signals:
@@ -133,12 +150,28 @@ private:
 #if defined(Q_OS_LINUX)
 private slots:
     void readEventFd();
+    void readCGroupEvents();
+    void readPressureEvent();
 
 private:
+    bool initCGroupV1(const QString &groupPath, MemoryReader *reader);
+    bool initCGroupV2(const QString &groupPath);
+    bool initPressure(const QString &groupPath);
+
+    Backend m_backend = Backend::Automatic;
+
+    // cgroup v1
     int m_eventFd = -1;
     int m_controlFd = -1;
     int m_usageFd = -1;
     QSocketNotifier *m_notifier = nullptr;
+
+    // cgroup v2 and PSI
+    int m_cgroupEventsFd = -1;
+    QByteArray m_lastCGroupEvents;
+    QSocketNotifier *m_cgroupEventsNotifier = nullptr;
+    int m_pressureFd = -1;
+    QSocketNotifier *m_pressureNotifier = nullptr;
 #endif
 };
 
@@ -149,7 +182,8 @@ public:
     MemoryWatcher(QObject *parent);
 
     void setThresholds(qreal warning, qreal critical);
-    bool startWatching(const QString &groupPath = QString());
+    bool startWatching(const QString &groupPath = QString(),
+                       MemoryThreshold::Backend backend = MemoryThreshold::Backend::Automatic);
     void checkMemoryConsumption();
 
 signals:
@@ -0,0 +1,122 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QDeadlineTimer>
+#include <QtAppManCommon/global.h>
+
+#include <deque>
+#include <utility>
+
+QT_BEGIN_NAMESPACE_AM
+
+// A thread-safe FIFO with a fixed capacity, used to connect the stages of a processing pipeline.
+// Producers block in push() while the queue is full, consumers block in pop() while it is
+// empty. The time spent blocked is accumulated, so that stalled stages can be identified.
+// close() signals the end of the stream (pop() keeps returning the remaining items), while
+// abort() wakes up everybody and drops all items: both push() and pop() return false from then on.
+
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(qsizetype capacity)
+        : m_capacity(qMax(qsizetype(1), capacity))
+    { }
+
+    // a negative timeout (in msec) waits forever. The item is only moved from, if push() succeeds
+    bool push(T &&item, int timeout = -1)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_aborted && !m_closed && (qsizetype(m_items.size()) >= m_capacity)) {
+            QElapsedTimer stall;
+            stall.start();
+            QDeadlineTimer deadline(timeout < 0 ? QDeadlineTimer(QDeadlineTimer::Forever)
+                                                : QDeadlineTimer(timeout));
+            while (!m_aborted && !m_closed && (qsizetype(m_items.size()) >= m_capacity)) {
+                if (!m_notFull.wait(&m_mutex, deadline))
+                    break;
+            }
+            m_pushStallTime += stall.nsecsElapsed();
+        }
+        if (m_aborted || m_closed || (qsizetype(m_items.size()) >= m_capacity))
+            return false;
+        m_items.push_back(std::move(item));
+        m_notEmpty.wakeOne();
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (!m_aborted && !m_closed && m_items.empty()) {
+            QElapsedTimer stall;
+            stall.start();
+            while (!m_aborted && !m_closed && m_items.empty())
+                m_notEmpty.wait(&m_mutex);
+            m_popStallTime += stall.nsecsElapsed();
+        }
+        if (m_aborted || m_items.empty())
+            return false;
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.wakeOne();
+        return true;
+    }
+
+    void close()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_closed = true;
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    void abort()
+    {
+        QMutexLocker locker(&m_mutex);
+        m_aborted = true;
+        m_items.clear();
+        m_notEmpty.wakeAll();
+        m_notFull.wakeAll();
+    }
+
+    bool isAborted() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_aborted;
+    }
+
+    // both in nsec
+    qint64 pushStallTime() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_pushStallTime;
+    }
+
+    qint64 popStallTime() const
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_popStallTime;
+    }
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_notEmpty;
+    QWaitCondition m_notFull;
+    std::deque<T> m_items;
+    const qsizetype m_capacity;
+    bool m_closed = false;
+    bool m_aborted = false;
+    qint64 m_pushStallTime = 0;
+    qint64 m_popStallTime = 0;
+
+    Q_DISABLE_COPY_MOVE(BoundedQueue)
+};
+
+QT_END_NAMESPACE_AM
+// We mean it. Dummy comment since syncqt needs this also for completely private Qt modules.
@@ -17,6 +17,8 @@
 #include "packageutilities_p.h"
 #include "packagecreator.h"
 #include "packagecreator_p.h"
+#include "parallelgzipwriter_p.h"
+#include "packagedelta_p.h"
 #include "exception.h"
 #include "error.h"
 #include "installationreport.h"
@@ -73,6 +75,45 @@ void PackageCreator::setSourceDirectory(const QDir &sourceDir)
     d->m_sourcePath = sourceDir.absolutePath() + QLatin1Char('/');
 }
 
+PackageCompression PackageCreator::compression() const
+{
+    return d->m_compression;
+}
+
+int PackageCreator::compressionLevel() const
+{
+    return d->m_compressionLevel;
+}
+
+void PackageCreator::setCompression(PackageCompression compression, int level)
+{
+    d->m_compression = compression;
+    d->m_compressionLevel = level;
+}
+
+int PackageCreator::compressionThreadCount() const
+{
+    return d->m_compressionThreadCount;
+}
+
+void PackageCreator::setCompressionThreadCount(int threadCount)
+{
+    d->m_compressionThreadCount = qMax(0, threadCount);
+}
+
+bool PackageCreator::isDeltaPackage() const
+{
+    return !d->m_deltaBasePath.isEmpty();
+}
+
+void PackageCreator::setDeltaBase(const QDir &baseDir, const InstallationReport &baseReport)
+{
+    d->m_deltaBasePath = baseDir.absolutePath() + QLatin1Char('/');
+    d->m_deltaBaseDigest = baseReport.digest();
+    const QStringList baseFiles = baseReport.files();
+    d->m_deltaBaseFiles = QSet<QString>(baseFiles.cbegin(), baseFiles.cend());
+}
+
 bool PackageCreator::create()
 {
     if (!wasCanceled())
@@ -131,6 +172,9 @@ PackageCreatorPrivate::PackageCreatorPrivate(PackageCreator *creator, QIODevice
     , m_report(report)
 { }
 
+PackageCreatorPrivate::~PackageCreatorPrivate()
+{ }
+
 bool PackageCreatorPrivate::create()
 {
     struct archive *ar = nullptr;
@@ -140,17 +184,32 @@ bool PackageCreatorPrivate::create()
         if (m_report.packageId().isNull())
             throw Exception("package identifier is null");
 
+        const bool isDelta = !m_deltaBasePath.isEmpty();
+        if (isDelta && m_deltaBaseDigest.isEmpty())
+            throw Exception(Error::Package, "the base package of a delta package needs to have a digest");
+
         QCryptographicHash digest(QCryptographicHash::Sha256);
 
+        // gzip compressed packages are still created as version 2, so that they can be installed
+        // by older application manager versions. Version 3 adds the compression and delta fields.
+        const bool isVersion2 = (m_compression == PackageCompression::Gzip) && !isDelta;
+
         QVariantMap headerFormat {
             { qSL("formatType"), qSL("am-package-header") },
-            { qSL("formatVersion"), 2 }
+            { qSL("formatVersion"), isVersion2 ? 2 : 3 }
         };
 
         m_metaData = QVariantMap {
             { qSL("packageId"), m_report.packageId() },
             { qSL("diskSpaceUsed"), m_report.diskSpaceUsed() }
         };
+        if (!isVersion2)
+            m_metaData[qSL("compression")] = PackageUtilities::compressionName(m_compression);
+        if (isDelta) {
+            m_metaData[qSL("delta")] = QVariantMap {
+                { qSL("baseDigest"), QLatin1String(m_deltaBaseDigest.toHex()) }
+            };
+        }
         if (!m_report.extraMetaData().isEmpty())
             m_metaData[qSL("extra")] = m_report.extraMetaData();
         if (!m_report.extraSignedMetaData().isEmpty())
@@ -167,22 +226,30 @@ bool PackageCreatorPrivate::create()
             throw ArchiveException(ar, "could not set the archive format to USTAR");
         if (archive_write_set_options(ar, "hdrcharset=UTF-8") != ARCHIVE_OK)
             throw ArchiveException(ar, "could not set the HDRCHARSET option");
-        if (archive_write_add_filter_gzip(ar) != ARCHIVE_OK)
-            throw ArchiveException(ar, "could not enable GZIP compression");
-// disabled for now -- see libarchive.pro
-//        if (archive_write_add_filter_xz(ar) != ARCHIVE_OK)
-//            throw ArchiveException(ar, "could not enable XZ compression");
+
+        // libarchive can only use a single thread for gzip, so we do it ourselves in this case
+        m_gzipWriter.reset();
+        if ((m_compression == PackageCompression::Gzip) && (m_compressionThreadCount != 1)) {
+            const auto levelRange = PackageUtilities::compressionLevelRange(m_compression);
+            if ((m_compressionLevel != -1) && ((m_compressionLevel < levelRange.first)
+                                               || (m_compressionLevel > levelRange.second))) {
+                throw Exception(Error::Package, "invalid gzip compression level %1").arg(m_compressionLevel);
+            }
+            m_gzipWriter = std::make_unique<ParallelGzipWriter>(m_output, m_compressionLevel,
+                                                                m_compressionThreadCount);
+        } else {
+            PackageUtilities::enableWriteCompressionFilter(ar, m_compression, m_compressionLevel,
+                                                           m_compressionThreadCount);
+        }
 
         auto dummyCallback = [](archive *, void *){ return ARCHIVE_OK; };
         auto writeCallback = [](archive *, void *user, const void *buffer, size_t size) {
-            // this could be simpler, if we had an event loop ... but we do not
-            QIODevice *output = reinterpret_cast<QIODevice *>(user);
-            qint64 written = output->write(static_cast<const char *>(buffer), size);
-            output->waitForBytesWritten(-1);
-            return static_cast<__LA_SSIZE_T>(written);
+            auto that = static_cast<PackageCreatorPrivate *>(user);
+            return static_cast<__LA_SSIZE_T>(that->writeArchiveData(static_cast<const char *>(buffer),
+                                                                     static_cast<qint64>(size)));
         };
 
-        if (archive_write_open(ar, m_output, dummyCallback, writeCallback, dummyCallback) != ARCHIVE_OK)
+        if (archive_write_open(ar, this, dummyCallback, writeCallback, dummyCallback) != ARCHIVE_OK)
             throw ArchiveException(ar, "could not open archive.");
 
         // Add the metadata header
@@ -207,6 +274,7 @@ bool PackageCreatorPrivate::create()
 
         qint64 packagedSize = 0;
         int lastProgress = 0;
+        QStringList deltaCopies;
 
         // Iterate over all files in the report
 
@@ -243,20 +311,36 @@ bool PackageCreatorPrivate::create()
 
             // Add to archive
 
-            archive_entry *entry = archive_entry_new();
-            if (!entry)
-                throw Exception(Error::Archive, "[libarchive] could not create a new archive_entry object");
+            DeltaType deltaType = DeltaType::Full;
+            QVector<PackageDelta::Operation> patch;
+            if (isDelta && (packageEntryType == PackageEntry_File))
+                deltaType = deltaTypeForFile(file, fi, (mode & S_IEXEC), patch);
 
-            fixed_archive_entry_set_pathname(entry, file); // please note: this is a special function (see top of file)
-            archive_entry_set_size(entry, static_cast<__LA_INT64_T>(fi.size()));
-            archive_entry_set_mode(entry, mode);
+            if (deltaType == DeltaType::Copy) {
+                // consecutive, unchanged files are grouped into a single entry
+                deltaCopies << file;
+            } else {
+                addDeltaCopies(ar, deltaCopies);
 
-            bool headerOk = (archive_write_header(ar, entry) == ARCHIVE_OK);
+                if (deltaType == DeltaType::Patch) {
+                    addDeltaPatch(ar, file, fi, int(mode), patch);
+                } else {
+                    archive_entry *entry = archive_entry_new();
+                    if (!entry)
+                        throw Exception(Error::Archive, "[libarchive] could not create a new archive_entry object");
 
-            archive_entry_free(entry);
+                    fixed_archive_entry_set_pathname(entry, file); // please note: this is a special function (see top of file)
+                    archive_entry_set_size(entry, static_cast<__LA_INT64_T>(fi.size()));
+                    archive_entry_set_mode(entry, mode);
 
-            if (!headerOk)
-                throw ArchiveException(ar, "could not write header");
+                    bool headerOk = (archive_write_header(ar, entry) == ARCHIVE_OK);
+
+                    archive_entry_free(entry);
+
+                    if (!headerOk)
+                        throw ArchiveException(ar, "could not write header");
+                }
+            }
 
             if (packageEntryType == PackageEntry_File) {
                 QFile f(fi.absoluteFilePath());
@@ -273,8 +357,11 @@ bool PackageCreatorPrivate::create()
                         throw Exception(f, "could not read from file");
                     fileSize += bytesRead;
 
-                    if (archive_write_data(ar, buffer, static_cast<size_t>(bytesRead)) == -1)
+                    // copied and patched files are not stored, but they are part of the digest
+                    if ((deltaType == DeltaType::Full)
+                            && (archive_write_data(ar, buffer, static_cast<size_t>(bytesRead)) == -1)) {
                         throw ArchiveException(ar, "could not write to archive");
+                    }
 
                     digest.addData({ buffer, qsizetype(bytesRead) });
                 }
@@ -295,6 +382,8 @@ bool PackageCreatorPrivate::create()
             }
         }
 
+        addDeltaCopies(ar, deltaCopies);
+
         m_digest = digest.result();
         if (!m_report.digest().isEmpty()) {
             if (m_digest != m_report.digest())
@@ -338,7 +427,13 @@ bool PackageCreatorPrivate::create()
 
         if (archive_write_free(ar) != ARCHIVE_OK)
             throw ArchiveException(ar, "could not close archive");
+        ar = nullptr;
 
+        if (m_gzipWriter) {
+            if (!m_gzipWriter->finish())
+                throw Exception(Error::Archive, "could not compress archive: %1").arg(m_gzipWriter->errorString());
+            m_gzipWriter.reset();
+        }
 
         emit q->progress(1);
 
@@ -351,10 +446,142 @@ bool PackageCreatorPrivate::create()
 
     if (ar)
         archive_write_free(ar);
+    m_gzipWriter.reset();
 
     return false;
 }
 
+qint64 PackageCreatorPrivate::writeArchiveData(const char *data, qint64 size)
+{
+    if (m_gzipWriter)
+        return m_gzipWriter->write(data, size) ? size : -1;
+
+    // this could be simpler, if we had an event loop ... but we do not
+    qint64 written = m_output->write(data, size);
+    m_output->waitForBytesWritten(-1);
+    return written;
+}
+
+/*! \internal
+  Decides how the file is stored in a delta package: unchanged files (same content and x-bit)
+  are just referenced, while big files are stored as a patch against the base version, if the
+  patch is less than half of the file's size.
+*/
+PackageCreatorPrivate::DeltaType PackageCreatorPrivate::deltaTypeForFile(const QString &file,
+                                                                          const QFileInfo &fi,
+                                                                          bool executable,
+                                                                          QVector<PackageDelta::Operation> &patch)
+{
+    if (!m_deltaBaseFiles.contains(file))
+        return DeltaType::Full;
+
+    const QFileInfo baseFi(m_deltaBasePath + file);
+    if (!baseFi.isFile() || baseFi.isSymLink())
+        return DeltaType::Full;
+
+    QFile f(fi.absoluteFilePath());
+    if (!f.open(QIODevice::ReadOnly))
+        throw Exception(f, "could not open for reading");
+    QFile baseF(baseFi.absoluteFilePath());
+    if (!baseF.open(QIODevice::ReadOnly))
+        throw Exception(baseF, "could not open for reading");
+
+    const qint64 size = f.size();
+    const qint64 baseSize = baseF.size();
+
+    if ((size == baseSize) && (baseFi.permission(QFile::ExeOwner) == executable)) {
+        bool same = true;
+        while (same && !f.atEnd()) {
+            if (q->wasCanceled())
+                throw Exception(Error::Canceled);
+
+            const QByteArray data = f.read(64 * 1024);
+            if (data.isEmpty())
+                throw Exception(f, "could not read from file");
+            same = (baseF.read(data.size()) == data);
+        }
+        if (same)
+            return DeltaType::Copy;
+    }
+
+    if ((size < PackageDelta::MinimumPatchFileSize) || !baseSize)
+        return DeltaType::Full;
+
+    const uchar *data = f.map(0, size);
+    const uchar *baseData = baseF.map(0, baseSize);
+    if (!data || !baseData)
+        return DeltaType::Full;
+
+    patch = PackageDelta::diff(baseData, baseSize, data, size);
+    if (PackageDelta::patchSize(file, patch) > (size / 2))
+        return DeltaType::Full;
+    return DeltaType::Patch;
+}
+
+void PackageCreatorPrivate::addDeltaCopies(struct archive *ar, QStringList &files)
+{
+    if (files.isEmpty())
+        return;
+
+    if (!addVirtualFile(ar, qSL("--PACKAGE-DELTA-COPY--"), QtYaml::yamlFromVariantDocuments(QVector<QVariant> { files })))
+        throw ArchiveException(ar, "could not add '--PACKAGE-DELTA-COPY--' to archive");
+    files.clear();
+}
+
+void PackageCreatorPrivate::addDeltaPatch(struct archive *ar, const QString &file,
+                                          const QFileInfo &fi, int mode,
+                                          const QVector<PackageDelta::Operation> &patch)
+{
+    archive_entry *entry = archive_entry_new();
+    if (!entry)
+        throw Exception(Error::Archive, "[libarchive] could not create a new archive_entry object");
+
+    // the entry's mode is the one of the patched file
+    fixed_archive_entry_set_pathname(entry, qSL("--PACKAGE-DELTA-PATCH--"));
+    archive_entry_set_size(entry, static_cast<__LA_INT64_T>(PackageDelta::patchSize(file, patch)));
+    archive_entry_set_mode(entry, static_cast<mode_t>(mode));
+
+    bool headerOk = (archive_write_header(ar, entry) == ARCHIVE_OK);
+
+    archive_entry_free(entry);
+
+    if (!headerOk)
+        throw ArchiveException(ar, "could not write header");
+
+    auto writeData = [ar](const QByteArray &data) {
+        if (archive_write_data(ar, data.constData(), static_cast<size_t>(data.size())) == -1)
+            throw ArchiveException(ar, "could not write to archive");
+    };
+
+    QFile f(fi.absoluteFilePath());
+    if (!f.open(QIODevice::ReadOnly))
+        throw Exception(f, "could not open for reading");
+
+    writeData(PackageDelta::encodePatchHeader(file, fi.size()));
+
+    for (const PackageDelta::Operation &op : patch) {
+        writeData(PackageDelta::encodeOperation(op));
+
+        if (op.type == PackageDelta::Operation::Data) {
+            if (!f.seek(op.offset))
+                throw Exception(f, "could not seek in file");
+
+            qint64 remaining = op.length;
+            while (remaining > 0) {
+                if (q->wasCanceled())
+                    throw Exception(Error::Canceled);
+
+                const QByteArray data = f.read(qMin(remaining, qint64(64 * 1024)));
+                if (data.isEmpty())
+                    throw Exception(f, "could not read from file");
+                writeData(data);
+                remaining -= data.size();
+            }
+        }
+    }
+    writeData(PackageDelta::encodeEnd());
+}
+
 bool PackageCreatorPrivate::addVirtualFile(struct archive *ar, const QString &file, const QByteArray &data)
 {
     bool result = false;
@@ -364,7 +591,7 @@ bool PackageCreatorPrivate::addVirtualFile(struct archive *ar, const QString &fi
         fixed_archive_entry_set_pathname(entry, file);
         archive_entry_set_mode(entry, S_IFREG | S_IREAD);
         archive_entry_set_size(entry, data.size());
-        archive_entry_set_mtime(entry, time(nullptr), 0);
+        // no mtime, just like the file entries: the same input always results in the same package
 
         if (archive_write_header(ar, entry) == ARCHIVE_OK) {
             if (archive_write_data(ar, data.constData(), static_cast<size_t>(data.size())) == data.size())
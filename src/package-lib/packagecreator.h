@@ -8,6 +8,7 @@
 #include <QtCore/QObject>
 
 #include <QtAppManCommon/error.h>
+#include <QtAppManPackage/packageutilities.h>
 
 QT_FORWARD_DECLARE_CLASS(QIODevice)
 QT_FORWARD_DECLARE_CLASS(QDir)
@@ -30,6 +31,23 @@ public:
     QDir sourceDirectory() const;
     void setSourceDirectory(const QDir &sourceDir);
 
+    // anything but gzip results in a package, that older application manager versions cannot read
+    PackageCompression compression() const;
+    int compressionLevel() const;
+    void setCompression(PackageCompression compression, int level = -1);
+
+    // Compresses in parallel, if not 1 (0 means: one thread per CPU core). Neither the package
+    // digest nor the compatibility with older application manager versions is affected.
+    int compressionThreadCount() const;
+    void setCompressionThreadCount(int threadCount);
+
+    // Creates a delta package, that can only be installed on top of the package described by
+    // baseReport (its file list and digest are needed), whose files are found in baseDir.
+    // Unchanged files are only referenced and big, changed files are stored as binary patches.
+    // The digest and the signatures are the same as for the full package.
+    bool isDeltaPackage() const;
+    void setDeltaBase(const QDir &baseDir, const InstallationReport &baseReport);
+
     bool create();
 
     QByteArray createdDigest() const;
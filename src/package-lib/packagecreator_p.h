@@ -5,21 +5,40 @@
 
 #pragma once
 
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QVector>
 #include <QtAppManPackage/packagecreator.h>
 
 #include <archive.h>
 
+#include <memory>
+
+QT_FORWARD_DECLARE_CLASS(QFileInfo)
+
 QT_BEGIN_NAMESPACE_AM
 
+class ParallelGzipWriter;
+namespace PackageDelta { struct Operation; }
+
 class PackageCreatorPrivate
 {
 public:
     PackageCreatorPrivate(PackageCreator *creator, QIODevice *output, const InstallationReport &report);
+    ~PackageCreatorPrivate();
 
     bool create();
 
 private:
     bool addVirtualFile(struct archive *ar, const QString &filename, const QByteArray &data);
+
+    enum class DeltaType { Full, Copy, Patch };
+    DeltaType deltaTypeForFile(const QString &file, const QFileInfo &fi, bool executable,
+                               QVector<PackageDelta::Operation> &patch);
+    void addDeltaCopies(struct archive *ar, QStringList &files);
+    void addDeltaPatch(struct archive *ar, const QString &file, const QFileInfo &fi, int mode,
+                       const QVector<PackageDelta::Operation> &patch);
+    qint64 writeArchiveData(const char *data, qint64 size);
     void setError(Error errorCode, const QString &errorString);
 
 private:
@@ -27,6 +46,13 @@ private:
 
     QIODevice *m_output;
     QString m_sourcePath;
+    PackageCompression m_compression = PackageCompression::Gzip;
+    int m_compressionLevel = -1;
+    int m_compressionThreadCount = 1;
+    std::unique_ptr<ParallelGzipWriter> m_gzipWriter;
+    QString m_deltaBasePath;
+    QByteArray m_deltaBaseDigest;
+    QSet<QString> m_deltaBaseFiles;
     bool m_failed = false;
     QAtomicInt m_canceled;
     Error m_errorCode = Error::None;
@@ -0,0 +1,272 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QMultiHash>
+#include <QtEndian>
+
+#include "packagedelta_p.h"
+#include "exception.h"
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE_AM
+
+static const char PatchMagic[] = "AMPATCH1";
+static constexpr qsizetype PatchMagicSize = 8;
+// a sanity limit for the path in a patch header
+static constexpr quint32 MaximumPathSize = 64 * 1024;
+
+
+namespace PackageDelta {
+
+// the weak checksum used by rsync: a is the sum of all bytes in the block, b the sum of all
+// partial sums. Both can be updated in O(1) when the block is moved by one byte.
+class RollingChecksum
+{
+public:
+    void reset(const uchar *data, qint64 size)
+    {
+        m_a = m_b = 0;
+        for (qint64 i = 0; i < size; ++i) {
+            m_a += data[i];
+            m_b += quint32(size - i) * data[i];
+        }
+    }
+
+    void roll(uchar out, uchar in, qint64 size)
+    {
+        m_a += quint32(in) - quint32(out);
+        m_b += m_a - quint32(size) * out;
+    }
+
+    quint32 value() const { return (m_a & 0xffff) | (m_b << 16); }
+
+private:
+    quint32 m_a = 0;
+    quint32 m_b = 0;
+};
+
+QVector<Operation> diff(const uchar *base, qint64 baseSize, const uchar *target, qint64 targetSize)
+{
+    QVector<Operation> operations;
+
+    auto addOperation = [&operations](Operation::Type type, qint64 offset, qint64 length) {
+        if (length <= 0)
+            return;
+        if (!operations.isEmpty()) {
+            Operation &last = operations.last();
+            if ((last.type == type) && (last.offset + last.length == offset)) {
+                last.length += length;
+                return;
+            }
+        }
+        operations.append({ type, offset, length });
+    };
+
+    // index all complete blocks of the base file
+    QMultiHash<quint32, qint64> blocks;
+    blocks.reserve(baseSize / BlockSize);
+    RollingChecksum checksum;
+    for (qint64 offset = 0; offset + BlockSize <= baseSize; offset += BlockSize) {
+        checksum.reset(base + offset, BlockSize);
+        blocks.insert(checksum.value(), offset);
+    }
+
+    qint64 position = 0;
+    qint64 literalStart = 0;
+
+    if (!blocks.isEmpty() && (targetSize >= BlockSize)) {
+        checksum.reset(target, BlockSize);
+
+        while (position + BlockSize <= targetSize) {
+            qint64 match = -1;
+            const auto [first, last] = blocks.equal_range(checksum.value());
+            for (auto it = first; it != last; ++it) {
+                if (std::memcmp(base + *it, target + position, size_t(BlockSize)) == 0) {
+                    match = *it;
+                    break;
+                }
+            }
+
+            if (match >= 0) {
+                // the match can usually be extended beyond the block boundary
+                qint64 length = BlockSize;
+                while ((position + length < targetSize) && (match + length < baseSize)
+                       && (base[match + length] == target[position + length])) {
+                    ++length;
+                }
+                addOperation(Operation::Data, literalStart, position - literalStart);
+                addOperation(Operation::Copy, match, length);
+                position += length;
+                literalStart = position;
+
+                if (position + BlockSize <= targetSize)
+                    checksum.reset(target + position, BlockSize);
+            } else {
+                if (position + BlockSize < targetSize)
+                    checksum.roll(target[position], target[position + BlockSize], BlockSize);
+                ++position;
+            }
+        }
+    }
+    addOperation(Operation::Data, literalStart, targetSize - literalStart);
+    return operations;
+}
+
+qint64 patchSize(const QString &path, const QVector<Operation> &operations)
+{
+    qint64 size = PatchMagicSize + 4 + path.toUtf8().size() + 8;
+    for (const Operation &op : operations)
+        size += 1 + ((op.type == Operation::Copy) ? 16 : (8 + op.length));
+    return size + 1;
+}
+
+template <typename T> static void appendLittleEndian(QByteArray &ba, T value)
+{
+    const T le = qToLittleEndian(value);
+    ba.append(reinterpret_cast<const char *>(&le), sizeof(T));
+}
+
+QByteArray encodePatchHeader(const QString &path, qint64 targetSize)
+{
+    const QByteArray utf8Path = path.toUtf8();
+
+    QByteArray header(PatchMagic, PatchMagicSize);
+    appendLittleEndian(header, quint32(utf8Path.size()));
+    header.append(utf8Path);
+    appendLittleEndian(header, quint64(targetSize));
+    return header;
+}
+
+QByteArray encodeOperation(const Operation &operation)
+{
+    QByteArray ba;
+    ba.append(char(operation.type));
+    if (operation.type == Operation::Copy)
+        appendLittleEndian(ba, quint64(operation.offset));
+    if (operation.type != Operation::End)
+        appendLittleEndian(ba, quint64(operation.length));
+    return ba;
+}
+
+QByteArray encodeEnd()
+{
+    return encodeOperation({ });
+}
+
+} // namespace PackageDelta
+
+
+void DeltaPatchReader::addData(const char *data, qsizetype size)
+{
+    if (m_position > 0) {
+        m_buffer.remove(0, m_position);
+        m_position = 0;
+    }
+    m_buffer.append(data, size);
+}
+
+template <typename T> T DeltaPatchReader::take()
+{
+    const T value = qFromLittleEndian<T>(m_buffer.constData() + m_position);
+    m_position += qsizetype(sizeof(T));
+    return value;
+}
+
+DeltaPatchReader::Result DeltaPatchReader::next() Q_DECL_NOEXCEPT_EXPR(false)
+{
+    forever {
+        switch (m_state) {
+        case Magic:
+            if (!has(PatchMagicSize))
+                return NeedMoreData;
+            if (std::memcmp(m_buffer.constData() + m_position, PatchMagic, PatchMagicSize) != 0)
+                throw Exception(Error::Package, "delta patch has an invalid magic header");
+            m_position += PatchMagicSize;
+            m_state = PathSize;
+            break;
+
+        case PathSize:
+            if (!has(4))
+                return NeedMoreData;
+            m_pathSize = take<quint32>();
+            if (!m_pathSize || (m_pathSize > MaximumPathSize))
+                throw Exception(Error::Package, "delta patch has an invalid path size (%1)").arg(m_pathSize);
+            m_state = Path;
+            break;
+
+        case Path:
+            if (!has(qsizetype(m_pathSize)))
+                return NeedMoreData;
+            m_path = QString::fromUtf8(m_buffer.constData() + m_position, qsizetype(m_pathSize));
+            m_position += qsizetype(m_pathSize);
+            m_state = TargetSize;
+            break;
+
+        case TargetSize:
+            if (!has(8))
+                return NeedMoreData;
+            m_targetSize = qint64(take<quint64>());
+            if (m_targetSize < 0)
+                throw Exception(Error::Package, "delta patch for %1 has an invalid size").arg(m_path);
+            m_state = Operation;
+            return Header;
+
+        case Operation:
+            if (!has(1))
+                return NeedMoreData;
+            switch (quint8(m_buffer.at(m_position++))) {
+            case PackageDelta::Operation::End:
+                m_state = Finished;
+                return End;
+            case PackageDelta::Operation::Copy:
+                m_state = CopyRange;
+                break;
+            case PackageDelta::Operation::Data:
+                m_state = DataSize;
+                break;
+            default:
+                throw Exception(Error::Package, "delta patch for %1 contains an invalid operation").arg(m_path);
+            }
+            break;
+
+        case CopyRange:
+            if (!has(16))
+                return NeedMoreData;
+            m_copyOffset = qint64(take<quint64>());
+            m_copyLength = qint64(take<quint64>());
+            if ((m_copyOffset < 0) || (m_copyLength < 0))
+                throw Exception(Error::Package, "delta patch for %1 contains an invalid copy range").arg(m_path);
+            m_state = Operation;
+            return Copy;
+
+        case DataSize:
+            if (!has(8))
+                return NeedMoreData;
+            m_dataRemaining = qint64(take<quint64>());
+            if (m_dataRemaining < 0)
+                throw Exception(Error::Package, "delta patch for %1 contains an invalid data size").arg(m_path);
+            m_state = m_dataRemaining ? DataBytes : Operation;
+            break;
+
+        case DataBytes: {
+            const qsizetype available = m_buffer.size() - m_position;
+            if (!available)
+                return NeedMoreData;
+            const qsizetype size = qsizetype(qMin(qint64(available), m_dataRemaining));
+            m_data = m_buffer.mid(m_position, size);
+            m_position += size;
+            m_dataRemaining -= size;
+            if (!m_dataRemaining)
+                m_state = Operation;
+            return Data;
+        }
+        case Finished:
+            if (has(1))
+                throw Exception(Error::Package, "delta patch for %1 has trailing data").arg(m_path);
+            return NeedMoreData;
+        }
+    }
+}
+
+QT_END_NAMESPACE_AM
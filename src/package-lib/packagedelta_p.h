@@ -0,0 +1,97 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+#include <QtAppManCommon/global.h>
+
+QT_BEGIN_NAMESPACE_AM
+
+// A delta package only contains the files that differ from a specific version of the package,
+// the "base". It has the same entries in the same order as the full package, but unchanged
+// files are just listed by name in --PACKAGE-DELTA-COPY-- entries, while big, changed files can
+// be shipped as binary patches against their base version in --PACKAGE-DELTA-PATCH-- entries.
+//
+// The patch format is:
+//   "AMPATCH1"                                  magic
+//   quint32 size, UTF-8 data                    the path of the file, both in the base and the
+//                                               new package
+//   quint64                                     the size of the patched file
+//   a sequence of operations:
+//     quint8 1 (Copy), quint64 offset, quint64 length   copy a range of the base file
+//     quint8 2 (Data), quint64 length, data             literal data
+//     quint8 0 (End)
+// All integers are little endian.
+//
+// Patches are created rsync-style: the base file is indexed in fixed-size blocks, which are then
+// found at any offset in the new file via a rolling checksum.
+
+namespace PackageDelta {
+
+static constexpr qint64 BlockSize = 4096;
+// smaller files are always shipped in full, if they changed
+static constexpr qint64 MinimumPatchFileSize = 64 * 1024;
+
+struct Operation
+{
+    enum Type : quint8 { End = 0, Copy = 1, Data = 2 };
+
+    Type type = End;
+    qint64 offset = 0; // Copy: in the base file, Data: in the new file
+    qint64 length = 0;
+};
+
+QVector<Operation> diff(const uchar *base, qint64 baseSize, const uchar *target, qint64 targetSize);
+
+// the size of the complete, encoded patch
+qint64 patchSize(const QString &path, const QVector<Operation> &operations);
+QByteArray encodePatchHeader(const QString &path, qint64 targetSize);
+// the literal data of Data operations has to be appended by the caller
+QByteArray encodeOperation(const Operation &operation);
+QByteArray encodeEnd();
+
+} // namespace PackageDelta
+
+
+// Decodes a patch incrementally, while it is being read from the archive.
+class DeltaPatchReader
+{
+public:
+    enum Result { NeedMoreData, Header, Copy, Data, End };
+
+    void addData(const char *data, qsizetype size);
+    Result next() Q_DECL_NOEXCEPT_EXPR(false);
+
+    // valid after Header
+    QString path() const { return m_path; }
+    qint64 targetSize() const { return m_targetSize; }
+    // valid after Copy
+    qint64 copyOffset() const { return m_copyOffset; }
+    qint64 copyLength() const { return m_copyLength; }
+    // valid after Data: a long literal is returned in multiple chunks
+    QByteArray data() const { return m_data; }
+
+private:
+    bool has(qsizetype size) const { return (m_buffer.size() - m_position) >= size; }
+    template <typename T> T take();
+
+    enum State { Magic, PathSize, Path, TargetSize, Operation, CopyRange, DataSize, DataBytes, Finished };
+    State m_state = Magic;
+
+    QByteArray m_buffer;
+    qsizetype m_position = 0;
+
+    quint32 m_pathSize = 0;
+    QString m_path;
+    qint64 m_targetSize = 0;
+    qint64 m_copyOffset = 0;
+    qint64 m_copyLength = 0;
+    qint64 m_dataRemaining = 0;
+    QByteArray m_data;
+};
+
+QT_END_NAMESPACE_AM
+// We mean it. Dummy comment since syncqt needs this also for completely private Qt modules.
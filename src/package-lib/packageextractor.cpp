@@ -9,13 +9,20 @@
 #include <QFile>
 #include <QDir>
 #include <QDataStream>
+#include <QDeadlineTimer>
+#include <QTimer>
 #include <QUrl>
 #include <QDebug>
 #include <QCryptographicHash>
+#include <QtConcurrent/QtConcurrent>
 
 #include <archive.h>
 #include <archive_entry.h>
 
+#if defined(Q_OS_UNIX)
+#  include <unistd.h>
+#endif
+
 #include "packageutilities_p.h"
 #include "packageextractor.h"
 #include "packageextractor_p.h"
@@ -25,6 +32,7 @@
 #include "utilities.h"
 #include "packageinfo.h"
 #include "qtyaml.h"
+#include "logging.h"
 
 // archive.h might #define this for Android
 #ifdef open
@@ -60,6 +68,67 @@ void PackageExtractor::setDestinationDirectory(const QDir &destinationDir)
 void PackageExtractor::setFileExtractedCallback(const std::function<void(const QString &)> &callback)
 {
     d->m_fileExtractedCallback = callback;
+    d->m_synchronousCallbacks = callback ? 1 : 0;
+}
+
+/*! \internal
+  Returns the name of the download checkpoint file or an empty string, if there is none.
+*/
+QString PackageExtractor::downloadCheckpoint() const
+{
+    return d->m_checkpointFileName;
+}
+
+/*! \internal
+  All the data received during an http(s) download is written to \a fileName. If the download
+  fails due to a network error, this file is kept (together with a small \c{.checkpoint} YAML
+  file next to it), so that another PackageExtractor for the same URL can resume the download
+  at this point: the missing part is requested via a HTTP Range request and the already received
+  part is replayed from \a fileName. Both files are removed as soon as the download is complete,
+  or after the extraction was canceled or failed for other than network reasons.
+*/
+void PackageExtractor::setDownloadCheckpoint(const QString &fileName)
+{
+    d->m_checkpointFileName = fileName;
+}
+
+/*! \internal
+  Returns the size the download checkpoint will grow to, if the complete package is downloaded:
+  this is the size of the package (as far as it is known already), or 0 if no checkpoint is
+  written. Needs to be called from the thread calling extract(), e.g. from the file extracted
+  callback.
+*/
+qint64 PackageExtractor::downloadCheckpointSize() const
+{
+    return d->m_checkpointFile.isOpen() ? qMax(qint64(0), d->m_downloadTotal) : 0;
+}
+
+int PackageExtractor::maximumResumeAttempts() const
+{
+    return d->m_maximumResumeAttempts;
+}
+
+/*! \internal
+  Sets the number of times an interrupted http(s) download is resumed within the same extract()
+  call, before giving up with a network error. The default is 3, while 0 disables resuming.
+*/
+void PackageExtractor::setMaximumResumeAttempts(int attempts)
+{
+    d->m_maximumResumeAttempts = qMax(0, attempts);
+}
+
+void PackageExtractor::setDeltaBaseCallback(const std::function<QString(const QString &, const QByteArray &)> &callback)
+{
+    d->m_deltaBaseCallback = callback;
+}
+
+/*! \internal
+  Returns \c true, if the package being extracted is a delta package. This is only known after
+  the package header has been processed.
+*/
+bool PackageExtractor::isDeltaPackage() const
+{
+    return !d->m_deltaBasePath.isEmpty();
 }
 
 const InstallationReport &PackageExtractor::installationReport() const
@@ -67,11 +136,17 @@ const InstallationReport &PackageExtractor::installationReport() const
     return d->m_report;
 }
 
+PackageCompression PackageExtractor::compression() const
+{
+    return PackageCompression(d->m_compression.loadRelaxed());
+}
+
 bool PackageExtractor::extract()
 {
     if (!wasCanceled()) {
-        d->m_failed = false;
+        d->m_failed = 0;
 
+        d->openCheckpoint();
         d->download(d->m_url);
 
         QMetaObject::invokeMethod(d, "extract", Qt::QueuedConnection);
@@ -79,13 +154,19 @@ bool PackageExtractor::extract()
 
         delete d->m_reply;
         d->m_reply = nullptr;
+
+        // only a download that failed due to network problems is worth resuming later on
+        d->closeCheckpoint(errorCode() == Error::Network);
+
+        if (!hasFailed())
+            emit progress(1);
     }
     return !wasCanceled() && !hasFailed();
 }
 
 bool PackageExtractor::hasFailed() const
 {
-    return d->m_failed || wasCanceled();
+    return (d->m_failed != 0) || wasCanceled();
 }
 
 bool PackageExtractor::wasCanceled() const
@@ -95,12 +176,59 @@ bool PackageExtractor::wasCanceled() const
 
 Error PackageExtractor::errorCode() const
 {
-    return wasCanceled() ? Error::Canceled : (d->m_failed ? d->m_errorCode : Error::None);
+    return wasCanceled() ? Error::Canceled : ((d->m_failed != 0) ? d->m_errorCode : Error::None);
 }
 
 QString PackageExtractor::errorString() const
 {
-    return wasCanceled() ? qSL("canceled") : (d->m_failed ? d->m_errorString : QString());
+    return wasCanceled() ? qSL("canceled") : ((d->m_failed != 0) ? d->m_errorString : QString());
+}
+
+/*! \internal
+  Returns the throughput and the stall times of the extraction pipeline. A stage is stalled, if
+  it has to wait for either input from the previous or for room in the queue to the next stage.
+  All times are in msec, the throughput is in bytes/sec. The number of bytes read includes the
+  ones replayed from a download checkpoint. This function can be called from another
+  thread while extract() is running.
+*/
+QVariantMap PackageExtractor::statistics() const
+{
+    auto nsecToMsec = [](qint64 nsec) { return nsec / 1000000; };
+
+    qint64 elapsed = d->m_elapsedTotal.loadRelaxed();
+    if (!elapsed) {
+        if (const qint64 startTime = d->m_startTime.loadAcquire()) {
+            QElapsedTimer now;
+            now.start();
+            elapsed = now.msecsSinceReference() - startTime;
+        }
+    }
+    const qint64 bytesRead = d->m_bytesReadTotal.loadRelaxed();
+    const qint64 bytesExtracted = d->m_bytesExtractedTotal.loadRelaxed();
+
+    qint64 writerStall = 0;
+    qint64 decodeStall = d->m_inputQueue.popStallTime() + d->m_digestQueue.pushStallTime();
+    for (const auto &writer : d->m_writers) {
+        writerStall += writer->queue.popStallTime();
+        decodeStall += writer->queue.pushStallTime();
+    }
+
+    return QVariantMap {
+        { qSL("elapsed"), elapsed },
+        { qSL("bytesRead"), bytesRead },
+        { qSL("bytesExtracted"), bytesExtracted },
+        { qSL("readThroughput"), elapsed ? (bytesRead * 1000 / elapsed) : 0 },
+        { qSL("extractThroughput"), elapsed ? (bytesExtracted * 1000 / elapsed) : 0 },
+        { qSL("writerCount"), int(d->m_writers.size()) },
+        { qSL("compression"), PackageUtilities::compressionName(q->compression()) },
+        { qSL("readerStall"), nsecToMsec(d->m_inputQueue.pushStallTime()) },
+        { qSL("decodeStall"), nsecToMsec(decodeStall) },
+        { qSL("digestStall"), nsecToMsec(d->m_digestQueue.popStallTime()) },
+        { qSL("writerStall"), nsecToMsec(writerStall) },
+        { qSL("resumeCount"), d->m_resumeCount.loadRelaxed() },
+        { qSL("bytesReplayed"), d->m_bytesReplayed.loadRelaxed() },
+        { qSL("bytesFromDeltaBase"), d->m_bytesFromDeltaBase.loadRelaxed() },
+    };
 }
 
 /*! \internal
@@ -109,6 +237,7 @@ QString PackageExtractor::errorString() const
 void PackageExtractor::cancel()
 {
     if (!d->m_canceled.fetchAndStoreOrdered(1)) {
+        d->abortPipeline();
         if (d->m_loop.isRunning())
             d->m_loop.wakeUp();
     }
@@ -124,70 +253,187 @@ PackageExtractorPrivate::PackageExtractorPrivate(PackageExtractor *extractor, co
     , q(extractor)
     , m_url(downloadUrl)
     , m_nam(new QNetworkAccessManager(this))
+    , m_isHttp((downloadUrl.scheme() == qL1S("http")) || (downloadUrl.scheme() == qL1S("https")))
     , m_report(QString())
 {
-    m_buffer.resize(64 * 1024);
+    // one thread for decoding, one for the digest and the rest for writing
+    const int writerCount = qBound(1, QThread::idealThreadCount() - 2, MaximumWriterCount);
+    for (int i = 0; i < writerCount; ++i)
+        m_writers.emplace_back(new Writer);
+    m_pool.setMaxThreadCount(2 + writerCount);
 }
 
-qint64 PackageExtractorPrivate::readTar(struct archive *ar, const void **archiveBuffer)
+PackageExtractorPrivate::~PackageExtractorPrivate()
+{
+    abortPipeline();
+    m_pool.waitForDone();
+}
+
+/*! \internal
+  This function can be called from any thread
+*/
+void PackageExtractorPrivate::abortPipeline()
+{
+    m_inputQueue.abort();
+    m_digestQueue.abort();
+    for (const auto &writer : m_writers)
+        writer->queue.abort();
+
+    QMutexLocker locker(&m_callbackMutex);
+    m_callbackDelivered.wakeAll();
+}
+
+template <typename T>
+void PackageExtractorPrivate::push(BoundedQueue<T> &queue, T &&item) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    // the pipeline only gets aborted after an error was set or when being canceled, so the
+    // actual error message does not matter
+    if (!queue.push(std::move(item)))
+        throw Exception(Error::Canceled, "extraction pipeline aborted");
+}
+
+void PackageExtractorPrivate::extract()
+{
+    QElapsedTimer elapsed;
+    elapsed.start();
+    m_startTime.storeRelease(elapsed.msecsSinceReference());
+
+    m_digestFuture = QtConcurrent::run(&m_pool, [this]() { calculateDigest(); });
+    for (const auto &writer : m_writers) {
+        Writer *w = writer.get();
+        w->future = QtConcurrent::run(&m_pool, [this, w]() { write(w); });
+    }
+    m_decodeFuture = QtConcurrent::run(&m_pool, [this]() { decode(); });
+
+    readInput();
+
+    // the decode stage will tell us when it is done, after all the other stages have finished
+    while (!m_decodeFinished)
+        m_loop.processEvents(QEventLoop::WaitForMoreEvents);
+
+    m_elapsedTotal = qMax(qint64(1), elapsed.elapsed());
+    m_loop.quit();
+}
+
+// reader stage: runs in the PackageExtractor's thread
+void PackageExtractorPrivate::readInput()
 {
     forever {
-        // the event loop is gone
-        if (!m_loop.isRunning()) {
-            archive_set_error(ar, -1, "no eventlopp");
-            return -1;
-        }
-        // we have been canceled
-        if (q->wasCanceled()) {
-            archive_set_error(ar, -1, "canceled");
-            return -1;
+        // we have been canceled or one of the other stages failed
+        if (q->wasCanceled() || m_inputQueue.isAborted())
+            break;
+
+        // the status of a HTTP reply needs to be checked, before any of its data can be used
+        if (!m_replyChecked && m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).isValid()) {
+            if (!checkReply())
+                break;
+            continue;
         }
-        qint64 bytesAvailable = m_reply->bytesAvailable();
+
+        qint64 bytesAvailable = m_replyHasPackageData ? m_reply->bytesAvailable() : 0;
 
         // there is something to read
         // (or this is a FIFO and we need this ugly hack - for testing only though!)
         if ((bytesAvailable > 0) || m_downloadingFromFIFO) {
-            qint64 bytesRead = m_reply->read(m_buffer.data(), m_buffer.size());
+            QByteArray chunk(InputChunkSize, Qt::Uninitialized);
+            qint64 bytesRead = m_reply->read(chunk.data(), chunk.size());
 
             if (bytesRead < 0) {
                 // another FIFO hack: if the writer dies, we will get an -1 return from read()
-                if (m_downloadingFromFIFO && m_reply->atEnd()) {
-                    return 0;
-                } else {
-                    archive_set_error(ar, -1, "could not read from tar archive");
-                    return -1;
-                }
+                if (!m_downloadingFromFIFO || !m_reply->atEnd())
+                    m_inputErrorString = qSL("could not read from tar archive");
+                break;
+            } else if (bytesRead == 0) {
+                break;
             }
 
-            m_bytesReadTotal += bytesRead;
-            *archiveBuffer = m_buffer.constData();
+            chunk.truncate(int(bytesRead));
 
-            qint64 progress = m_downloadTotal ? (100 * m_bytesReadTotal / m_downloadTotal) : 0;
-            if (progress != m_lastProgress) {
-                emit q->progress(qreal(progress) / 100);
-                m_lastProgress = progress;
+            // not being able to write the checkpoint is not fatal: we just cannot resume later on
+            if (m_checkpointFile.isOpen() && (m_checkpointFile.write(chunk) != bytesRead)) {
+                qCWarning(LogInstaller) << "Could not write to the download checkpoint"
+                                        << m_checkpointFileName << ":" << m_checkpointFile.errorString();
+                closeCheckpoint(false);
             }
 
-            return bytesRead;
+            if (!pushInput(std::move(chunk)))
+                break;
+            continue;
         }
 
-        // got an error while reading
+        // got an error while reading: any data received before has already been consumed above
         if (m_reply->error() != QNetworkReply::NoError) {
-            archive_set_error(ar, -1, "%s", m_reply->errorString().toLocal8Bit().constData());
-            return -1;
+            if (resumeDownload())
+                continue;
+            setError(Error::Network, m_reply->errorString());
+            abortPipeline();
+            break;
         }
 
-        // we're done
-        if (m_reply->isFinished())
-            return 0;
+        // we're done: the complete package is in the pipeline, so there is nothing left to
+        // resume and the copy in the checkpoint would just waste space until the end of extract()
+        if (m_reply->isFinished()) {
+            closeCheckpoint(false);
+            break;
+        }
 
         m_loop.processEvents(QEventLoop::WaitForMoreEvents);
     }
+    m_inputQueue.close();
 }
 
-void PackageExtractorPrivate::extract()
+// hands a chunk of the package over to the decode stage: blocks, if it cannot keep up
+bool PackageExtractorPrivate::pushInput(QByteArray &&chunk)
+{
+    m_bytesReadTotal += chunk.size();
+
+    qint64 progress = m_downloadTotal ? (100 * m_bytesReadTotal / m_downloadTotal) : 0;
+    if (progress != m_lastProgress) {
+        emit q->progress(qreal(progress) / 100);
+        m_lastProgress = progress;
+    }
+
+    // While the decode stage waits for a file extracted callback, this thread's event loop is
+    // needed to deliver it: we cannot block indefinitely on a full input queue in this case.
+    while (m_fileExtractedCallback) {
+        if (m_inputQueue.push(std::move(chunk), 10))
+            return true;
+        if (m_inputQueue.isAborted())
+            return false;
+        m_loop.processEvents();
+    }
+    return m_inputQueue.push(std::move(chunk));
+}
+
+// called by libarchive in the decode stage
+qint64 PackageExtractorPrivate::readTar(struct archive *ar, const void **archiveBuffer)
+{
+    // m_decodeChunk needs to stay valid until the next call
+    if (m_inputQueue.pop(m_decodeChunk)) {
+        if (m_leadingBytes.size() < PackageUtilities::SignatureSize)
+            m_leadingBytes.append(m_decodeChunk.left(PackageUtilities::SignatureSize - m_leadingBytes.size()));
+        *archiveBuffer = m_decodeChunk.constData();
+        return m_decodeChunk.size();
+    }
+
+    if (q->wasCanceled()) {
+        archive_set_error(ar, -1, "canceled");
+        return -1;
+    } else if (m_inputQueue.isAborted()) {
+        archive_set_error(ar, -1, "aborted");
+        return -1;
+    } else if (!m_inputErrorString.isEmpty()) {
+        archive_set_error(ar, -1, "%s", m_inputErrorString.toLocal8Bit().constData());
+        return -1;
+    }
+    return 0; // EOF
+}
+
+// decode stage: runs in a worker thread
+void PackageExtractorPrivate::decode()
 {
     struct archive *ar = nullptr;
+    int entryIndex = 0;
 
     try {
         ar = archive_read_new();
@@ -195,11 +441,7 @@ void PackageExtractorPrivate::extract()
             throw Exception("[libarchive] could not create a new archive object");
         if (archive_read_support_format_tar(ar) != ARCHIVE_OK)
             throw ArchiveException(ar, "could not enable TAR support");
-// disabled for now -- see libarchive.pro
-//        if (archive_read_support_filter_xz(ar) != ARCHIVE_OK)
-//            throw ArchiveException(ar, "could not enable XZ support");
-        if (archive_read_support_filter_gzip(ar) != ARCHIVE_OK)
-            throw ArchiveException(ar, "could not enable GZIP support");
+        PackageUtilities::enableReadCompressionFilters(ar);
 #if !defined(Q_OS_ANDROID)
         if (archive_read_set_options(ar, "hdrcharset=UTF-8") != ARCHIVE_OK)
             throw ArchiveException(ar, "could not set the HDRCHARSET option");
@@ -209,20 +451,23 @@ void PackageExtractorPrivate::extract()
         auto readCallback = [](archive *ar, void *user, const void **buffer)
         { return static_cast<__LA_SSIZE_T>(static_cast<PackageExtractorPrivate *>(user)->readTar(ar, buffer)); };
 
-        if (archive_read_open(ar, this, dummyCallback, readCallback, dummyCallback) != ARCHIVE_OK)
+        if (archive_read_open(ar, this, dummyCallback, readCallback, dummyCallback) != ARCHIVE_OK) {
+            // libarchive cannot tell an unsupported compression from garbage
+            PackageUtilities::checkCompressionSupported(m_leadingBytes);
             throw ArchiveException(ar, "could not open archive");
+        }
 
         bool seenHeader = false;
         bool seenFooter = false;
         QByteArray header;
         QByteArray footer;
-
-        QCryptographicHash digest(QCryptographicHash::Sha256);
+        QByteArray deltaCopies;
+        std::unique_ptr<DeltaPatch> deltaPatch;
 
         // Iterate over all entries in the archive
         for (bool finished = false; !finished; ) {
             archive_entry *entry = nullptr;
-            QFile f;
+            Writer *writer = nullptr;
 
             // Try to read the next entry from the archive
 
@@ -233,9 +478,14 @@ void PackageExtractorPrivate::extract()
             case ARCHIVE_OK:
                 break;
             default:
+                if (!seenHeader)
+                    PackageUtilities::checkCompressionSupported(m_leadingBytes);
                 throw ArchiveException(ar, "could not read header");
             }
 
+            if (!seenHeader)
+                m_compression.storeRelaxed(int(PackageUtilities::readCompression(ar)));
+
             // Make sure to quit if we get something funky, i.e. something other than files or dirs
 
             __LA_MODE_T entryMode = archive_entry_mode(entry);
@@ -260,6 +510,10 @@ void PackageExtractorPrivate::extract()
                 packageEntryType = PackageEntry_Header;
             else if (entryPath.startsWith(qL1S("--PACKAGE-FOOTER--")))
                 packageEntryType = PackageEntry_Footer;
+            else if (!m_deltaBasePath.isEmpty() && (entryPath == qL1S("--PACKAGE-DELTA-COPY--")))
+                packageEntryType = PackageEntry_DeltaCopy;
+            else if (!m_deltaBasePath.isEmpty() && (entryPath == qL1S("--PACKAGE-DELTA-PATCH--")))
+                packageEntryType = PackageEntry_DeltaPatch;
             else if (entryPath.startsWith(qL1S("--")))
                 throw Exception(Error::Package, "filename %1 in the archive starts with the reserved characters '--'").arg(entryPath);
 
@@ -280,17 +534,7 @@ void PackageExtractorPrivate::extract()
                 Q_FALLTHROUGH();
 
             case PackageEntry_File: {
-                // get the directory, where the new entry will be created
-                QDir entryDir(QString(m_destinationPath + entryPath).section(qL1C('/'), 0, -2));
-                if (!entryDir.exists())
-                    throw Exception(Error::Package, "invalid archive entry '%1': parent directory is missing").arg(entryPath);
-
-                QString entryCanonicalPath = entryDir.canonicalPath() + qL1C('/');
-                QString baseCanonicalPath = QDir(m_destinationPath).canonicalPath() + qL1C('/');
-
-                // security check: make sure that entryCanonicalPath is NOT outside of baseCanonicalPath
-                if (!entryCanonicalPath.startsWith(baseCanonicalPath))
-                    throw Exception(Error::Package, "invalid archive entry '%1': pointing outside of extraction directory").arg(entryPath);
+                QDir entryDir = checkedEntryDirectory(entryPath);
 
                 if (packageEntryType == PackageEntry_Dir) {
                     QString entryName = entryPath.section(qL1C('/'), -1, -1);
@@ -301,12 +545,14 @@ void PackageExtractorPrivate::extract()
                     archive_read_data_skip(ar);
 
                 } else { // PackageEntry_File
-                    f.setFileName(m_destinationPath + entryPath);
-                    if (!f.open(QFile::WriteOnly | QFile::Truncate))
-                        throw Exception(f, "could not create file");
-
-                    if (entryMode & S_IEXEC)
-                        f.setPermissions(f.permissions() | QFile::ExeUser);
+                    writer = writerForEntry(entryPath);
+
+                    WriteJob job;
+                    job.type = WriteJob::Open;
+                    job.entryPath = entryPath;
+                    job.filePath = m_destinationPath + entryPath;
+                    job.executable = (entryMode & S_IEXEC);
+                    push(writer->queue, std::move(job));
                 }
 
                 m_report.addFile(entryPath);
@@ -318,6 +564,13 @@ void PackageExtractorPrivate::extract()
             case PackageEntry_Header:
                 seenHeader = true;
                 break;
+            case PackageEntry_DeltaCopy:
+                deltaCopies.clear();
+                break;
+            case PackageEntry_DeltaPatch:
+                deltaPatch = std::make_unique<DeltaPatch>();
+                deltaPatch->executable = (entryMode & S_IEXEC);
+                break;
             default:
                 archive_read_data_skip(ar);
                 continue;
@@ -325,9 +578,9 @@ void PackageExtractorPrivate::extract()
 
             // Read in the entry's data (which can be a normal file or header/footer metadata)
 
-            if (archive_entry_size(entry)) {
-                __LA_INT64_T readPosition = 0;
+            __LA_INT64_T readPosition = 0;
 
+            if (archive_entry_size(entry)) {
                 for (bool fileFinished = false; !fileFinished; ) {
                     const char *buffer;
                     size_t bytesRead;
@@ -350,10 +603,16 @@ void PackageExtractorPrivate::extract()
 
                     switch (packageEntryType) {
                     case PackageEntry_File:
-                        digest.addData({ buffer, qsizetype(bytesRead) });
-
-                        if (!f.write(buffer, bytesRead))
-                            throw Exception(f, "could not write to file");
+                        // libarchive re-uses its buffer, so we need a copy: this copy is then
+                        // shared between the digest and the writer stage
+                        addFileData(writer, QByteArray(buffer, qsizetype(bytesRead)));
+                        break;
+                    case PackageEntry_DeltaCopy:
+                        deltaCopies.append(buffer, qsizetype(bytesRead));
+                        break;
+                    case PackageEntry_DeltaPatch:
+                        deltaPatch->reader.addData(buffer, qsizetype(bytesRead));
+                        processDeltaPatch(*deltaPatch);
                         break;
                     case PackageEntry_Header:
                         header.append(buffer, int(bytesRead));
@@ -372,50 +631,371 @@ void PackageExtractorPrivate::extract()
 
             switch (packageEntryType) {
             case PackageEntry_Header:
-                processMetaData(header, digest, true /*header*/);
+                processMetaData(header, true /*header*/);
                 break;
 
             case PackageEntry_File:
-                f.close();
-                Q_FALLTHROUGH();
+            case PackageEntry_Dir:
+                // The sequential implementation used the size of the written file here, which
+                // is exactly the number of bytes we have read.
+                finishEntry(entryPath, (packageEntryType == PackageEntry_Dir), readPosition, writer,
+                            entryIndex);
+                break;
 
-            case PackageEntry_Dir: {
-                // Just to be on the safe side, we also add the file's meta-data to the digest
-                PackageUtilities::addFileMetadataToDigest(entryPath, QFileInfo(m_destinationPath + entryPath), digest);
+            case PackageEntry_DeltaCopy:
+                applyDeltaCopies(deltaCopies, entryIndex);
+                break;
 
-                // Finally call the user's code to post-process whatever was extracted right now
-                if (m_fileExtractedCallback)
-                    m_fileExtractedCallback(entryPath);
+            case PackageEntry_DeltaPatch:
+                if (!deltaPatch->finished || (deltaPatch->size != deltaPatch->reader.targetSize()))
+                    throw Exception(Error::Package, "the delta patch for '%1' is incomplete").arg(deltaPatch->entryPath);
+                m_report.addFile(deltaPatch->entryPath);
+                finishEntry(deltaPatch->entryPath, false, deltaPatch->size, deltaPatch->writer,
+                            entryIndex);
+                deltaPatch.reset();
                 break;
-            }
+
             default:
                 break;
             }
         }
 
-        // Finished extracting
+        // Finished extracting: make sure that all the files are safely on disk
+        for (const auto &w : m_writers) {
+            w->queue.close();
+            w->future.waitForFinished();
+            if (w->queue.isAborted())
+                throw Exception(Error::Canceled, "extraction pipeline aborted");
+        }
 
         // We are only post-processing the footer now, because we allow for multiple --PACKAGE-FOOTER--
         // files in the archive, so we can only start processing them, when we are sure that there
         // are no more. This makes it easier for 3rd party tools like e.g. app-stores to add the required
         // signature metadata
-        processMetaData(footer, digest, false /*footer*/);
-
-        emit q->progress(1);
+        processMetaData(footer, false /*footer*/);
 
     } catch (const Exception &e) {
         if (!q->wasCanceled())
             setError(e.errorCode(), e.errorString());
+        abortPipeline();
+    } catch (...) {
+        // anything escaping here would leave extract() waiting for m_decodeFinished forever
+        setError(Error::System, qSL("unexpected exception in the decode stage"));
+        abortPipeline();
+    }
+
+    // make sure that all the other stages are done, before we report back. libarchive might
+    // not have consumed all of the input, so the reader stage needs to be stopped explicitly.
+    m_inputQueue.abort();
+    m_digestQueue.close();
+    m_digestFuture.waitForFinished();
+    for (const auto &w : m_writers) {
+        w->queue.close();
+        w->future.waitForFinished();
     }
 
     if (ar)
         archive_read_free(ar);
 
-    m_loop.quit();
+    QMetaObject::invokeMethod(this, [this]() { m_decodeFinished = true; }, Qt::QueuedConnection);
+}
+
+// digest stage: runs in a worker thread
+void PackageExtractorPrivate::calculateDigest()
+{
+    QByteArray data;
+    while (m_digestQueue.pop(data))
+        m_digest.addData(data);
+}
+
+// writer stage: runs in a worker thread
+void PackageExtractorPrivate::write(Writer *writer)
+{
+    QFile f;
+
+    try {
+        WriteJob job;
+        while (writer->queue.pop(job)) {
+            switch (job.type) {
+            case WriteJob::Open:
+                f.setFileName(job.filePath);
+                if (!job.sourcePath.isEmpty()) {
+                    // unchanged files of delta packages share the inode with the base version,
+                    // if possible. The permissions are also the same.
+                    bool linked = false;
+#if defined(Q_OS_UNIX)
+                    linked = (::link(QFile::encodeName(job.sourcePath).constData(),
+                                     QFile::encodeName(job.filePath).constData()) == 0);
+#endif
+                    if (!linked && !QFile::copy(job.sourcePath, job.filePath)) {
+                        throw Exception(Error::IO, "could not copy '%1' from the delta base to '%2'")
+                                .arg(job.sourcePath).arg(job.filePath);
+                    }
+                    break;
+                }
+                if (!f.open(QFile::WriteOnly | QFile::Truncate))
+                    throw Exception(f, "could not create file");
+
+                if (job.executable)
+                    f.setPermissions(f.permissions() | QFile::ExeUser);
+                break;
+
+            case WriteJob::Data:
+                if (f.write(job.data) != job.data.size())
+                    throw Exception(f, "could not write to file");
+                break;
+
+            case WriteJob::Close: {
+                f.close();
+                const int index = job.index;
+                const QString entryPath = job.entryPath;
+                QMetaObject::invokeMethod(this, [this, index, entryPath]() {
+                    entryExtracted(index, entryPath);
+                }, Qt::QueuedConnection);
+                break;
+            }
+            }
+        }
+    } catch (const Exception &e) {
+        if (!q->wasCanceled())
+            setError(e.errorCode(), e.errorString());
+        abortPipeline();
+    } catch (...) {
+        // QFuture would re-throw this in the decode stage, outside of its error handling
+        setError(Error::System, qSL("unexpected exception in the writer stage"));
+        abortPipeline();
+    }
+}
+
+// runs in the decode stage
+QDir PackageExtractorPrivate::checkedEntryDirectory(const QString &entryPath) const Q_DECL_NOEXCEPT_EXPR(false)
+{
+    // get the directory, where the new entry will be created
+    QDir entryDir(QString(m_destinationPath + entryPath).section(qL1C('/'), 0, -2));
+    if (!entryDir.exists())
+        throw Exception(Error::Package, "invalid archive entry '%1': parent directory is missing").arg(entryPath);
+
+    QString entryCanonicalPath = entryDir.canonicalPath() + qL1C('/');
+    QString baseCanonicalPath = QDir(m_destinationPath).canonicalPath() + qL1C('/');
+
+    // security check: make sure that entryCanonicalPath is NOT outside of baseCanonicalPath
+    if (!entryCanonicalPath.startsWith(baseCanonicalPath))
+        throw Exception(Error::Package, "invalid archive entry '%1': pointing outside of extraction directory").arg(entryPath);
+
+    return entryDir;
+}
+
+PackageExtractorPrivate::Writer *PackageExtractorPrivate::writerForEntry(const QString &entryPath) const
+{
+    // all writes to the same path need to go through the same writer
+    return m_writers.at(qHash(entryPath) % m_writers.size()).get();
+}
+
+// runs in the decode stage
+void PackageExtractorPrivate::addFileData(Writer *writer, QByteArray &&block) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    m_bytesExtractedTotal += block.size();
+
+    WriteJob job;
+    job.data = block;
+    push(m_digestQueue, std::move(block));
+    push(writer->queue, std::move(job));
 }
 
-void PackageExtractorPrivate::processMetaData(const QByteArray &metadata, QCryptographicHash &digest,
-                                              bool isHeader) Q_DECL_NOEXCEPT_EXPR(false)
+// runs in the decode stage
+void PackageExtractorPrivate::finishEntry(const QString &entryPath, bool isDir, qint64 size,
+                                          Writer *writer, int &entryIndex) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    // Just to be on the safe side, we also add the file's meta-data to the digest.
+    push(m_digestQueue, PackageUtilities::fileMetadataForDigest(entryPath, isDir, size));
+
+    // Finally call the user's code to post-process whatever was extracted right now:
+    // files need to be closed by their writer first.
+    const int index = entryIndex++;
+    if (isDir) {
+        QMetaObject::invokeMethod(this, [this, index, entryPath]() {
+            entryExtracted(index, entryPath);
+        }, Qt::QueuedConnection);
+    } else {
+        WriteJob job;
+        job.type = WriteJob::Close;
+        job.index = index;
+        job.entryPath = entryPath;
+        push(writer->queue, std::move(job));
+    }
+
+    // the callback might change the destination directory for the following entries
+    if (m_synchronousCallbacks.loadAcquire())
+        waitForEntryExtracted(index);
+}
+
+// runs in the decode stage
+QString PackageExtractorPrivate::deltaBaseFilePath(const QString &entryPath) const Q_DECL_NOEXCEPT_EXPR(false)
+{
+    if (entryPath.isEmpty() || entryPath.startsWith(qL1S("--")) || entryPath.endsWith(qL1C('/')))
+        throw Exception(Error::Package, "invalid delta entry '%1'").arg(entryPath);
+
+    const QFileInfo fi(m_deltaBasePath + entryPath);
+    const QString baseCanonicalPath = QDir(m_deltaBasePath).canonicalPath() + qL1C('/');
+
+    // security check: only regular files inside the base directory can be referenced
+    if (!fi.isFile() || fi.isSymLink() || !fi.canonicalFilePath().startsWith(baseCanonicalPath))
+        throw Exception(Error::Package, "the file '%1' is missing in the base version of the delta package").arg(entryPath);
+
+    return fi.absoluteFilePath();
+}
+
+// runs in the decode stage
+void PackageExtractorPrivate::applyDeltaCopies(const QByteArray &fileList, int &entryIndex) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    QVariantList entryPaths;
+    try {
+        const QVector<QVariant> docs = YamlParser::parseAllDocuments(fileList);
+        if (docs.size() == 1)
+            entryPaths = docs.constFirst().toList();
+    } catch (const Exception &) {
+    }
+    if (entryPaths.isEmpty())
+        throw Exception(Error::Package, "--PACKAGE-DELTA-COPY-- is not a valid list of files");
+
+    for (const QVariant &v : std::as_const(entryPaths)) {
+        const QString entryPath = v.toString().normalized(QString::NormalizationForm_C);
+        const QString basePath = deltaBaseFilePath(entryPath);
+        checkedEntryDirectory(entryPath);
+
+        Writer *writer = writerForEntry(entryPath);
+
+        WriteJob job;
+        job.type = WriteJob::Open;
+        job.entryPath = entryPath;
+        job.filePath = m_destinationPath + entryPath;
+        job.sourcePath = basePath;
+        push(writer->queue, std::move(job));
+
+        m_report.addFile(entryPath);
+
+        // the digest covers the content of the full package, so the base file has to be read
+        QFile f(basePath);
+        if (!f.open(QIODevice::ReadOnly))
+            throw Exception(f, "could not open the delta base file");
+
+        qint64 size = 0;
+        while (!f.atEnd()) {
+            QByteArray block = f.read(InputChunkSize);
+            if (block.isEmpty())
+                throw Exception(f, "could not read from the delta base file");
+            size += block.size();
+            m_bytesExtractedTotal += block.size();
+            m_bytesFromDeltaBase += block.size();
+            push(m_digestQueue, std::move(block));
+        }
+
+        finishEntry(entryPath, false, size, writer, entryIndex);
+    }
+}
+
+// runs in the decode stage
+void PackageExtractorPrivate::processDeltaPatch(DeltaPatch &patch) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    forever {
+        switch (patch.reader.next()) {
+        case DeltaPatchReader::NeedMoreData:
+            return;
+
+        case DeltaPatchReader::Header: {
+            patch.entryPath = patch.reader.path().normalized(QString::NormalizationForm_C);
+            patch.baseFile.setFileName(deltaBaseFilePath(patch.entryPath));
+            checkedEntryDirectory(patch.entryPath);
+            if (!patch.baseFile.open(QIODevice::ReadOnly))
+                throw Exception(patch.baseFile, "could not open the delta base file");
+
+            patch.writer = writerForEntry(patch.entryPath);
+
+            WriteJob job;
+            job.type = WriteJob::Open;
+            job.entryPath = patch.entryPath;
+            job.filePath = m_destinationPath + patch.entryPath;
+            job.executable = patch.executable;
+            push(patch.writer->queue, std::move(job));
+            break;
+        }
+        case DeltaPatchReader::Copy: {
+            const qint64 offset = patch.reader.copyOffset();
+            qint64 length = patch.reader.copyLength();
+
+            const qint64 baseSize = patch.baseFile.size();
+
+            // written without additions, so that huge values cannot overflow
+            if ((offset < 0) || (length < 0) || (offset > baseSize) || (length > baseSize - offset)
+                    || (length > patch.reader.targetSize() - patch.size)
+                    || !patch.baseFile.seek(offset)) {
+                throw Exception(Error::Package, "the delta patch for '%1' has an invalid copy range").arg(patch.entryPath);
+            }
+            while (length > 0) {
+                QByteArray block = patch.baseFile.read(qMin(length, qint64(InputChunkSize)));
+                if (block.isEmpty())
+                    throw Exception(patch.baseFile, "could not read from the delta base file");
+                length -= block.size();
+                patch.size += block.size();
+                m_bytesFromDeltaBase += block.size();
+                addFileData(patch.writer, std::move(block));
+            }
+            break;
+        }
+        case DeltaPatchReader::Data: {
+            QByteArray block = patch.reader.data();
+            patch.size += block.size();
+            if (patch.size > patch.reader.targetSize())
+                throw Exception(Error::Package, "the delta patch for '%1' is too big").arg(patch.entryPath);
+            addFileData(patch.writer, std::move(block));
+            break;
+        }
+        case DeltaPatchReader::End:
+            patch.finished = true;
+            break;
+        }
+    }
+}
+
+// runs in the PackageExtractor's thread, but the entries can arrive in any order
+void PackageExtractorPrivate::entryExtracted(int index, const QString &entryPath)
+{
+    m_extractedEntries.insert(index, entryPath);
+
+    for (auto it = m_extractedEntries.begin();
+         (it != m_extractedEntries.end()) && (it.key() == m_nextExtractedEntry);
+         it = m_extractedEntries.erase(it)) {
+        ++m_nextExtractedEntry;
+
+        if (!m_fileExtractedCallback || q->hasFailed())
+            continue;
+
+        try {
+            m_fileExtractedCallback(it.value());
+        } catch (const Exception &e) {
+            setError(e.errorCode(), e.errorString());
+            abortPipeline();
+        }
+    }
+
+    QMutexLocker locker(&m_callbackMutex);
+    m_deliveredEntryCount = m_nextExtractedEntry;
+    m_callbackDelivered.wakeAll();
+}
+
+// runs in the decode stage
+void PackageExtractorPrivate::waitForEntryExtracted(int index) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    QMutexLocker locker(&m_callbackMutex);
+    while (m_deliveredEntryCount <= index) {
+        if (m_inputQueue.isAborted())
+            throw Exception(Error::Canceled, "extraction pipeline aborted");
+        m_callbackDelivered.wait(&m_callbackMutex);
+    }
+}
+
+// runs in the decode stage
+void PackageExtractorPrivate::processMetaData(const QByteArray &metadata, bool isHeader) Q_DECL_NOEXCEPT_EXPR(false)
 {
     QVector<QVariant> docs;
     try {
@@ -428,8 +1008,14 @@ void PackageExtractorPrivate::processMetaData(const QByteArray &metadata, QCrypt
     const QString formatType = isHeader ? qSL("am-package-header") : qSL("am-package-footer");
     int formatVersion = 0;
     try {
-        formatVersion = checkYamlFormat(docs, -2 /*at least 2 docs*/, { { formatType, 2 },
-                                                                        { formatType, 1 } }).second;
+        if (isHeader) {
+            formatVersion = checkYamlFormat(docs, -2 /*at least 2 docs*/, { { formatType, 3 },
+                                                                            { formatType, 2 },
+                                                                            { formatType, 1 } }).second;
+        } else {
+            formatVersion = checkYamlFormat(docs, -2 /*at least 2 docs*/, { { formatType, 2 },
+                                                                            { formatType, 1 } }).second;
+        }
     } catch (const Exception &e) {
         throw Exception(Error::Package, "metadata has an invalid format specification: %1").arg(e.errorString());
     }
@@ -450,10 +1036,33 @@ void PackageExtractorPrivate::processMetaData(const QByteArray &metadata, QCrypt
             throw Exception(Error::Package, "metadata has an invalid diskSpaceUsed field (%1)").arg(diskSpaceUsed);
         m_report.setDiskSpaceUsed(diskSpaceUsed);
 
+        if (formatVersion >= 3) {
+            const QString compression = map.value(qSL("compression")).toString();
+            const QString packageCompression = PackageUtilities::compressionName(q->compression());
+            if (compression != packageCompression) {
+                throw Exception(Error::Package, "metadata has a compression field (%1) that does not match the package's compression (%2)")
+                        .arg(compression).arg(packageCompression);
+            }
+        }
+
+        const QVariantMap delta = map.value(qSL("delta")).toMap();
+        if (!delta.isEmpty()) {
+            const QByteArray baseDigest = QByteArray::fromHex(delta.value(qSL("baseDigest")).toString().toLatin1());
+            if ((formatVersion < 3) || baseDigest.isEmpty())
+                throw Exception(Error::Package, "metadata has an invalid delta field");
+            if (!m_deltaBaseCallback)
+                throw Exception(Error::Package, "%1 is a delta package, which can only be installed as an update").arg(packageId);
+
+            const QString basePath = m_deltaBaseCallback(packageId, baseDigest);
+            if (basePath.isEmpty() || !QDir(basePath).exists())
+                throw Exception(Error::Package, "the base version of the delta package %1 is not available").arg(packageId);
+            m_deltaBasePath = QDir(basePath).absolutePath() + qL1C('/');
+        }
+
         m_report.setExtraMetaData(map.value(qSL("extra")).toMap());
         m_report.setExtraSignedMetaData(map.value(qSL("extraSigned")).toMap());
 
-        PackageUtilities::addHeaderDataToDigest(map, digest);
+        push(m_digestQueue, PackageUtilities::headerMetadataForDigest(map));
 
     } else { // footer(s)
         for (int i = 2; i < docs.size(); ++i)
@@ -465,7 +1074,13 @@ void PackageExtractorPrivate::processMetaData(const QByteArray &metadata, QCrypt
             throw Exception(Error::Package, "metadata is missing the digest field");
         m_report.setDigest(packageDigest);
 
-        QByteArray calculatedDigest = digest.result();
+        // wait for the digest stage to process everything that has been queued up to now
+        m_digestQueue.close();
+        m_digestFuture.waitForFinished();
+        if (m_digestQueue.isAborted())
+            throw Exception(Error::Canceled, "extraction pipeline aborted");
+
+        QByteArray calculatedDigest = m_digest.result();
         if (calculatedDigest != packageDigest)
             throw Exception(Error::Package, "package digest mismatch (is %1, but should be %2").arg(calculatedDigest.toHex()).arg(packageDigest.toHex());
 
@@ -476,7 +1091,8 @@ void PackageExtractorPrivate::processMetaData(const QByteArray &metadata, QCrypt
 
 void PackageExtractorPrivate::setError(Error errorCode, const QString &errorString)
 {
-    m_failed = true;
+    QMutexLocker locker(&m_errorMutex);
+    m_failed = 1;
 
     // only the first error is the one that counts!
     if (m_errorCode == Error::None) {
@@ -488,8 +1104,8 @@ void PackageExtractorPrivate::setError(Error errorCode, const QString &errorStri
 
 void PackageExtractorPrivate::download(const QUrl &url)
 {
-    QNetworkRequest request(url);
-    m_reply = m_nam->get(request);
+    // a valid download checkpoint lets us start in the middle of the package
+    startRequest(url, m_replyOffset);
 
 #if defined(Q_OS_UNIX)
     // This is an ugly hack, but it allows us to use FIFOs in the unit tests.
@@ -504,19 +1120,145 @@ void PackageExtractorPrivate::download(const QUrl &url)
         }
     }
 #endif
+}
+
+void PackageExtractorPrivate::startRequest(const QUrl &url, qint64 offset)
+{
+    QNetworkRequest request(url);
+    if (m_isHttp) {
+        // the byte offsets need to refer to the package file itself, not to a compressed transfer
+        request.setRawHeader("Accept-Encoding", "identity");
+
+        if (offset > 0) {
+            request.setRawHeader("Range", "bytes=" + QByteArray::number(offset) + '-');
+            // the server will send the complete package instead, if it changed in the meantime
+            request.setRawHeader("If-Range", m_entityTag.isEmpty() ? m_lastModified : m_entityTag);
+        }
+    }
+    m_reply = m_nam->get(request);
+    m_replyOffset = offset;
+
+    // only HTTP replies have a status that needs to be checked first
+    m_replyChecked = !m_isHttp;
+    m_replyHasPackageData = !m_isHttp;
 
-    connect(m_reply, &QNetworkReply::errorOccurred,
-            this, &PackageExtractorPrivate::networkError);
     connect(m_reply, &QNetworkReply::metaDataChanged,
             this, &PackageExtractorPrivate::handleRedirect);
     connect(m_reply, &QNetworkReply::downloadProgress,
             this, &PackageExtractorPrivate::downloadProgressChanged);
 }
 
-void PackageExtractorPrivate::networkError(QNetworkReply::NetworkError)
+/*! \internal
+  Checks the status of a HTTP reply, before any of its data is used. Returns \c false, if the
+  download cannot continue.
+*/
+bool PackageExtractorPrivate::checkReply()
+{
+    m_replyChecked = true;
+
+    const int status = m_reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    const qint64 bytesRead = m_bytesReadTotal;
+
+    if (status == 206) { // Partial Content
+        // Content-Range: bytes <first>-<last>/<size>
+        const QByteArray contentRange = m_reply->rawHeader("Content-Range");
+        const qsizetype dash = contentRange.indexOf('-');
+        bool ok = contentRange.startsWith("bytes ") && (dash > 6);
+        const qint64 first = ok ? contentRange.mid(6, dash - 6).trimmed().toLongLong(&ok) : -1;
+
+        if (!ok || (first != m_replyOffset)) {
+            setError(Error::Network, qSL("the server sent an unexpected range (%1) when resuming the download at byte %2")
+                     .arg(QString::fromLatin1(contentRange)).arg(m_replyOffset));
+            abortPipeline();
+            return false;
+        }
+        m_replyHasPackageData = true;
+
+        // the start of the package is in the download checkpoint
+        return (bytesRead < m_replyOffset) ? replayCheckpoint() : true;
+
+    } else if ((status == 416) && (m_replyOffset > 0) && (bytesRead == 0)) { // Range Not Satisfiable
+        // the checkpoint does not fit the package on the server anymore: start from scratch
+        resetCheckpoint();
+        m_reply->disconnect(this);
+        m_reply->deleteLater();
+        startRequest(m_url, 0);
+        return true;
+
+    } else if ((status >= 200) && (status < 300)) {
+        if (bytesRead > 0) {
+            // the server either ignored the Range request or the If-Range condition did not
+            // match, but the first part of the old package already went through the pipeline
+            setError(Error::Network, qSL("could not resume the download, because the package on the server has changed"));
+            abortPipeline();
+            return false;
+        }
+        // a download checkpoint, if any, is outdated
+        if (m_replyOffset > 0) {
+            resetCheckpoint();
+            m_replyOffset = 0;
+        }
+
+        m_entityTag = m_reply->rawHeader("ETag");
+        if (m_entityTag.startsWith("W/")) // weak entity tags cannot be used with If-Range
+            m_entityTag.clear();
+        m_lastModified = m_reply->rawHeader("Last-Modified");
+        m_replyHasPackageData = true;
+        saveCheckpoint();
+        return true;
+    }
+
+    // anything else is an error, which is handled in readInput()
+    return true;
+}
+
+/*! \internal
+  Restarts an interrupted HTTP download after a short delay. The new request starts at the
+  first byte that was not yet received.
+*/
+bool PackageExtractorPrivate::resumeDownload()
 {
-    setError(Error::Network, qobject_cast<QNetworkReply *>(sender())->errorString());
-    QMetaObject::invokeMethod(&m_loop, "quit", Qt::QueuedConnection);
+    if (!m_isHttp || q->wasCanceled() || (m_resumeCount.loadRelaxed() >= m_maximumResumeAttempts))
+        return false;
+
+    // without a validator, we cannot make sure that the rest belongs to the same package
+    const qint64 offset = qMax(qint64(m_bytesReadTotal), m_replyOffset);
+    if ((offset > 0) && m_entityTag.isEmpty() && m_lastModified.isEmpty())
+        return false;
+
+    switch (m_reply->error()) {
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+    case QNetworkReply::UnknownNetworkError:
+    case QNetworkReply::ProxyConnectionClosedError:
+    case QNetworkReply::ProxyTimeoutError:
+    case QNetworkReply::InternalServerError:
+    case QNetworkReply::ServiceUnavailableError:
+    case QNetworkReply::UnknownServerError:
+        break;
+    default:
+        return false; // not a transient problem
+    }
+
+    qCDebug(LogInstaller) << "Resuming the download of" << m_url << "at byte" << offset
+                          << "after error:" << m_reply->errorString();
+
+    m_reply->disconnect(this);
+    m_reply->deleteLater();
+    m_reply = nullptr;
+
+    const int delay = ResumeDelay << m_resumeCount.fetchAndAddRelaxed(1);
+    QDeadlineTimer deadline(delay);
+    QTimer::singleShot(delay, this, []() { }); // just wakes up the event loop
+    while (!deadline.hasExpired() && !q->wasCanceled())
+        m_loop.processEvents(QEventLoop::WaitForMoreEvents);
+
+    startRequest(m_url, offset);
+    return true;
 }
 
 void PackageExtractorPrivate::handleRedirect()
@@ -526,15 +1268,139 @@ void PackageExtractorPrivate::handleRedirect()
         QUrl url = m_reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toUrl();
         m_reply->disconnect();
         m_reply->deleteLater();
-        QNetworkRequest request(url);
-        m_reply = m_nam->get(request);
+        startRequest(url, m_replyOffset);
     }
 }
 
 void PackageExtractorPrivate::downloadProgressChanged(qint64 downloaded, qint64 total)
 {
     Q_UNUSED(downloaded)
-    m_downloadTotal = total;
+    // a resumed reply only reports the size of the remaining part
+    m_downloadTotal = (total > 0) ? (m_replyOffset + total) : total;
+}
+
+/*! \internal
+  Opens the download checkpoint file. If it contains the beginning of the same package from an
+  earlier attempt, the download will start where that attempt stopped.
+*/
+void PackageExtractorPrivate::openCheckpoint()
+{
+    if (!m_isHttp || m_checkpointFileName.isEmpty() || m_checkpointFile.isOpen())
+        return;
+
+    m_checkpointFile.setFileName(m_checkpointFileName);
+    if (!m_checkpointFile.open(QIODevice::ReadWrite)) {
+        qCWarning(LogInstaller) << "Could not open the download checkpoint" << m_checkpointFileName
+                                << ":" << m_checkpointFile.errorString();
+        return;
+    }
+
+    try {
+        QFile f(m_checkpointFileName + qSL(".checkpoint"));
+        if ((m_checkpointFile.size() > 0) && f.open(QIODevice::ReadOnly)) {
+            const auto docs = YamlParser::parseAllDocuments(f.readAll());
+            checkYamlFormat(docs, 2, { { qSL("am-download-checkpoint"), 1 } });
+            const QVariantMap map = docs.at(1).toMap();
+
+            if (QUrl(map.value(qSL("url")).toString()) == m_url) {
+                m_entityTag = map.value(qSL("entityTag")).toString().toLatin1();
+                m_lastModified = map.value(qSL("lastModified")).toString().toLatin1();
+                if (!m_entityTag.isEmpty() || !m_lastModified.isEmpty()) {
+                    m_replyOffset = m_checkpointFile.size();
+                    m_checkpointFile.seek(m_replyOffset);
+                    return;
+                }
+            }
+        }
+    } catch (const Exception &e) {
+        qCDebug(LogInstaller) << "Ignoring the invalid download checkpoint" << m_checkpointFileName
+                              << ":" << e.errorString();
+    }
+    resetCheckpoint();
+}
+
+void PackageExtractorPrivate::resetCheckpoint()
+{
+    m_entityTag.clear();
+    m_lastModified.clear();
+    if (!m_checkpointFileName.isEmpty())
+        QFile::remove(m_checkpointFileName + qSL(".checkpoint"));
+    if (m_checkpointFile.isOpen()) {
+        m_checkpointFile.resize(0);
+        m_checkpointFile.seek(0);
+    }
+}
+
+void PackageExtractorPrivate::saveCheckpoint()
+{
+    if (!m_checkpointFile.isOpen())
+        return;
+
+    // there is no way to resume, if the server does not identify the package version
+    if (m_entityTag.isEmpty() && m_lastModified.isEmpty()) {
+        closeCheckpoint(false);
+        return;
+    }
+
+    const QVariantMap formatHeader {
+        { qSL("formatType"), qSL("am-download-checkpoint") },
+        { qSL("formatVersion"), 1 }
+    };
+    const QVariantMap checkpoint {
+        { qSL("url"), m_url.toString() },
+        { qSL("entityTag"), QString::fromLatin1(m_entityTag) },
+        { qSL("lastModified"), QString::fromLatin1(m_lastModified) }
+    };
+    const QByteArray yaml = QtYaml::yamlFromVariantDocuments({ formatHeader, checkpoint });
+
+    QFile f(m_checkpointFileName + qSL(".checkpoint"));
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || (f.write(yaml) != yaml.size())) {
+        qCWarning(LogInstaller) << "Could not write the download checkpoint" << f.fileName()
+                                << ":" << f.errorString();
+        closeCheckpoint(false);
+    }
+}
+
+/*! \internal
+  Feeds the already received part of the package from the download checkpoint into the pipeline.
+*/
+bool PackageExtractorPrivate::replayCheckpoint()
+{
+    if (!m_checkpointFile.isOpen() || !m_checkpointFile.seek(m_bytesReadTotal)) {
+        setError(Error::IO, qSL("could not replay the download checkpoint %1").arg(m_checkpointFileName));
+        abortPipeline();
+        return false;
+    }
+
+    while (m_bytesReadTotal < m_replyOffset) {
+        if (q->wasCanceled())
+            return false;
+
+        QByteArray chunk = m_checkpointFile.read(qMin(qint64(InputChunkSize), m_replyOffset - m_bytesReadTotal));
+        if (chunk.isEmpty()) {
+            setError(Error::IO, qSL("could not read from the download checkpoint %1: %2")
+                     .arg(m_checkpointFileName, m_checkpointFile.errorString()));
+            abortPipeline();
+            return false;
+        }
+        m_bytesReplayed += chunk.size();
+        if (!pushInput(std::move(chunk)))
+            return false;
+    }
+    // the rest of the package gets appended to the checkpoint file again
+    return true;
+}
+
+void PackageExtractorPrivate::closeCheckpoint(bool keep)
+{
+    if (!m_checkpointFile.isOpen())
+        return;
+
+    m_checkpointFile.close();
+    if (!keep || (m_checkpointFile.size() == 0)) {
+        m_checkpointFile.remove();
+        QFile::remove(m_checkpointFileName + qSL(".checkpoint"));
+    }
 }
 
 QT_END_NAMESPACE_AM
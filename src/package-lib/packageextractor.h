@@ -6,10 +6,12 @@
 #pragma once
 
 #include <QtCore/QObject>
+#include <QtCore/QVariantMap>
 
 #include <functional>
 
 #include <QtAppManCommon/error.h>
+#include <QtAppManPackage/packageutilities.h>
 
 QT_FORWARD_DECLARE_CLASS(QUrl)
 QT_FORWARD_DECLARE_CLASS(QDir)
@@ -32,9 +34,25 @@ public:
 
     void setFileExtractedCallback(const std::function<void(const QString &)> &callback);
 
+    // Delta packages can only be extracted on top of the package version they were created for.
+    // The callback gets the package id and the digest of this base version and returns the
+    // directory where the base version is installed. It is called from a worker thread and can
+    // throw an Exception to reject the delta package.
+    void setDeltaBaseCallback(const std::function<QString(const QString &, const QByteArray &)> &callback);
+    bool isDeltaPackage() const;
+
+    // only used for http(s) downloads
+    QString downloadCheckpoint() const;
+    void setDownloadCheckpoint(const QString &fileName);
+    qint64 downloadCheckpointSize() const;
+    int maximumResumeAttempts() const;
+    void setMaximumResumeAttempts(int attempts);
+
     bool extract();
 
     const InstallationReport &installationReport() const;
+    // auto-detected while extracting
+    PackageCompression compression() const;
 
     bool hasFailed() const;
     bool wasCanceled() const;
@@ -42,6 +60,9 @@ public:
     Error errorCode() const;
     QString errorString() const;
 
+    // throughput and stall times of the extraction pipeline's stages
+    QVariantMap statistics() const;
+
 public slots:
     void cancel();
 
@@ -8,37 +8,141 @@
 #include <QObject>
 #include <QNetworkReply>
 #include <QEventLoop>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QDir>
+#include <QFuture>
+#include <QMap>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QThreadPool>
 
 #include <archive.h>
 
+#include <memory>
+#include <vector>
+
 #include <QtAppManPackage/packageextractor.h>
+#include "boundedqueue_p.h"
+#include "packagedelta_p.h"
 #include <QtAppManApplication/installationreport.h>
 
-QT_FORWARD_DECLARE_CLASS(QCryptographicHash)
-
 QT_BEGIN_NAMESPACE_AM
 
 
+// The extraction is done in a pipeline of stages connected by bounded queues:
+//  * the reader stage pulls the data out of the QNetworkReply. This has to happen in the thread
+//    the PackageExtractor lives in, as this is where the network reply's events are delivered.
+//  * the decode stage runs libarchive (decompression and tar parsing) on a worker thread. It also
+//    does all the sanity checks and creates the directories, so that the order of operations
+//    in the file-system is the same as in a purely sequential extraction.
+//  * the digest stage calculates the package digest on a worker thread. It receives the exact
+//    same byte sequence as the sequential implementation did, so the digest is unchanged.
+//  * a pool of writer stages writes the file contents to disk. All data for a specific path is
+//    always written by the same writer, so the order of writes to the same file is preserved.
+// The file extracted callback is always called in the PackageExtractor's thread, in archive
+// order, after the file has been completely written and closed. As long as a callback is set,
+// the decode stage waits for it after each entry, because the callback is allowed to change the
+// destination directory for all following entries (the InstallationTask does exactly that after
+// the first two files). Afterwards, the pipeline runs unhindered.
+//
+// Delta packages are handled in the decode stage as well: the files that are unchanged compared
+// to the base version are read from the base directory, so that the digest stage sees the same
+// data as for the full package, while the writer just hard-links (or copies) them. Patches are
+// applied on the fly, by feeding the patched data into the digest and writer stages.
+//
+// HTTP downloads can be resumed: if the connection breaks, the reader stage re-requests the
+// remaining bytes via a Range request, guarded by an If-Range header, so that a package that
+// changed on the server in the meantime is never spliced together with the old data. The rest of
+// the pipeline does not notice anything, apart from the delay.
+// The state of libarchive and of the digest cannot be saved, but a download checkpoint can still
+// survive the PackageExtractor: all the bytes received are stored in the checkpoint file. On the
+// next attempt, only the missing bytes are requested from the server, while the ones already
+// received are replayed from the checkpoint file through the complete pipeline. Reading from
+// the local disk is orders of magnitude faster than downloading over a flaky connection.
+
 class PackageExtractorPrivate : public QObject
 {
     Q_OBJECT
 
 public:
     PackageExtractorPrivate(PackageExtractor *extractor, const QUrl &downloadUrl);
+    ~PackageExtractorPrivate() override;
 
     Q_INVOKABLE void extract();
 
     void download(const QUrl &url);
+    void abortPipeline();
+
+    static constexpr qsizetype InputChunkSize = 64 * 1024;
+    static constexpr qsizetype InputQueueSize = 32; // chunks
+    static constexpr qsizetype DigestQueueSize = 64; // blocks
+    static constexpr qsizetype WriterQueueSize = 64; // blocks
+    static constexpr int MaximumWriterCount = 4;
+    static constexpr int DefaultMaximumResumeAttempts = 3;
+    static constexpr int ResumeDelay = 500; // msec, doubled for each subsequent attempt
 
 private slots:
-    void networkError(QNetworkReply::NetworkError);
     void handleRedirect();
     void downloadProgressChanged(qint64 downloaded, qint64 total);
 
 private:
+    struct WriteJob
+    {
+        enum Type { Open, Data, Close } type = Data;
+        int index = -1;
+        QString entryPath;
+        QString filePath; // Open only: the destination can change while the job is queued
+        QString sourcePath; // Open only: link or copy this file instead of writing the data
+        bool executable = false;
+        QByteArray data;
+    };
+
+    struct Writer
+    {
+        BoundedQueue<WriteJob> queue { WriterQueueSize };
+        QFuture<void> future;
+    };
+
+    struct DeltaPatch
+    {
+        DeltaPatchReader reader;
+        QFile baseFile;
+        QString entryPath;
+        Writer *writer = nullptr;
+        bool executable = false;
+        bool finished = false;
+        qint64 size = 0;
+    };
+
     void setError(Error errorCode, const QString &errorString);
+    void startRequest(const QUrl &url, qint64 offset);
+    bool checkReply();
+    bool resumeDownload();
+    bool pushInput(QByteArray &&chunk);
+    void openCheckpoint();
+    void resetCheckpoint();
+    void saveCheckpoint();
+    bool replayCheckpoint();
+    void closeCheckpoint(bool keep);
+    void readInput();
+    void decode();
+    void calculateDigest();
+    void write(Writer *writer);
+    QDir checkedEntryDirectory(const QString &entryPath) const Q_DECL_NOEXCEPT_EXPR(false);
+    Writer *writerForEntry(const QString &entryPath) const;
+    void addFileData(Writer *writer, QByteArray &&block) Q_DECL_NOEXCEPT_EXPR(false);
+    void finishEntry(const QString &entryPath, bool isDir, qint64 size, Writer *writer,
+                     int &entryIndex) Q_DECL_NOEXCEPT_EXPR(false);
+    QString deltaBaseFilePath(const QString &entryPath) const Q_DECL_NOEXCEPT_EXPR(false);
+    void applyDeltaCopies(const QByteArray &fileList, int &entryIndex) Q_DECL_NOEXCEPT_EXPR(false);
+    void processDeltaPatch(DeltaPatch &patch) Q_DECL_NOEXCEPT_EXPR(false);
+    void entryExtracted(int index, const QString &entryPath);
+    void waitForEntryExtracted(int index) Q_DECL_NOEXCEPT_EXPR(false);
     qint64 readTar(struct archive *ar, const void **archiveBuffer);
-    void processMetaData(const QByteArray &metadata, QCryptographicHash &digest, bool isHeader) Q_DECL_NOEXCEPT_EXPR(false);
+    void processMetaData(const QByteArray &metadata, bool isHeader) Q_DECL_NOEXCEPT_EXPR(false);
+    template <typename T> void push(BoundedQueue<T> &queue, T &&item) Q_DECL_NOEXCEPT_EXPR(false);
 
 private:
     PackageExtractor *q;
@@ -46,22 +150,67 @@ private:
     QUrl m_url;
     QString m_destinationPath;
     std::function<void(const QString &)> m_fileExtractedCallback;
-    bool m_failed = false;
+    std::function<QString(const QString &, const QByteArray &)> m_deltaBaseCallback;
+    QString m_deltaBasePath; // only set for delta packages
+    QAtomicInt m_synchronousCallbacks;
+    QAtomicInt m_failed;
     QAtomicInt m_canceled;
     Error m_errorCode = Error::None;
     QString m_errorString;
+    QMutex m_errorMutex;
 
     QEventLoop m_loop;
     QNetworkAccessManager *m_nam;
     QNetworkReply *m_reply = nullptr;
     bool m_downloadingFromFIFO = false;
-    QByteArray m_buffer;
+    bool m_isHttp = false;
+    bool m_replyChecked = false;
+    bool m_replyHasPackageData = false;
+    qint64 m_replyOffset = 0; // the position of the current reply's first byte in the package
+
+    // resuming
+    QByteArray m_entityTag;
+    QByteArray m_lastModified;
+    int m_maximumResumeAttempts = DefaultMaximumResumeAttempts;
+    QAtomicInt m_resumeCount;
+    QString m_checkpointFileName;
+    QFile m_checkpointFile;
+    QAtomicInteger<qint64> m_bytesReplayed;
+
     InstallationReport m_report;
+    QAtomicInt m_compression { int(PackageCompression::Gzip) }; // set by the decode stage
 
     qint64 m_downloadTotal = 0;
-    qint64 m_bytesReadTotal = 0;
+    QAtomicInteger<qint64> m_bytesReadTotal;
+    QAtomicInteger<qint64> m_bytesExtractedTotal;
+    QAtomicInteger<qint64> m_bytesFromDeltaBase;
     qint64 m_lastProgress = 0;
 
+    // pipeline
+    BoundedQueue<QByteArray> m_inputQueue { InputQueueSize };
+    QString m_inputErrorString;
+    QByteArray m_decodeChunk;
+    QByteArray m_leadingBytes; // only the first few bytes, to detect the compression
+    QFuture<void> m_decodeFuture;
+    bool m_decodeFinished = false;
+
+    BoundedQueue<QByteArray> m_digestQueue { DigestQueueSize };
+    QCryptographicHash m_digest { QCryptographicHash::Sha256 };
+    QFuture<void> m_digestFuture;
+
+    std::vector<std::unique_ptr<Writer>> m_writers;
+
+    QMap<int, QString> m_extractedEntries;
+    int m_nextExtractedEntry = 0;
+    int m_deliveredEntryCount = 0; // protected by m_callbackMutex
+    QMutex m_callbackMutex;
+    QWaitCondition m_callbackDelivered;
+
+    QAtomicInteger<qint64> m_startTime; // QElapsedTimer::msecsSinceReference(), 0 if not started
+    QAtomicInteger<qint64> m_elapsedTotal;
+
+    QThreadPool m_pool; // needs to be destroyed first, as its jobs are accessing the members above
+
     friend class PackageExtractor;
 };
 
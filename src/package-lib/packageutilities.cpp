@@ -19,6 +19,13 @@
 
 #include <clocale>
 
+// The bundled libarchive does not contain the zstd filters, so zstd packages are not supported
+// in this case. AM_LIBARCHIVE_HAS_ZSTD is set by the build system when linking against a system
+// libarchive.
+#if defined(AM_LIBARCHIVE_HAS_ZSTD) && (ARCHIVE_VERSION_NUMBER >= 3003003)
+#  define AM_NATIVE_ZSTD_FILTER
+#endif
+
 
 QT_BEGIN_NAMESPACE_AM
 
@@ -105,6 +112,185 @@ bool PackageUtilities::checkCorrectLocale()
 }
 
 
+QString PackageUtilities::compressionName(PackageCompression compression)
+{
+    switch (compression) {
+    case PackageCompression::None: return qSL("none");
+    case PackageCompression::Gzip: return qSL("gzip");
+    case PackageCompression::Xz:   return qSL("xz");
+    case PackageCompression::Zstd: return qSL("zstd");
+    }
+    return { };
+}
+
+PackageCompression PackageUtilities::compressionFromName(const QString &name, bool *ok)
+{
+    for (auto compression : { PackageCompression::None, PackageCompression::Gzip,
+                              PackageCompression::Xz, PackageCompression::Zstd }) {
+        if (name == compressionName(compression)) {
+            if (ok)
+                *ok = true;
+            return compression;
+        }
+    }
+    if (ok)
+        *ok = false;
+    return PackageCompression::Gzip;
+}
+
+std::pair<int, int> PackageUtilities::compressionLevelRange(PackageCompression compression)
+{
+    switch (compression) {
+    case PackageCompression::Gzip:
+    case PackageCompression::Xz:   return { 0, 9 };
+    case PackageCompression::Zstd: return { 1, 22 };
+    default:                       return { -1, -1 };
+    }
+}
+
+bool PackageUtilities::isCompressionSupported(PackageCompression compression)
+{
+    switch (compression) {
+    case PackageCompression::None:
+    case PackageCompression::Gzip:
+        return true;
+    case PackageCompression::Xz:
+    case PackageCompression::Zstd: {
+        struct archive *ar = archive_write_new();
+        if (!ar)
+            return false;
+        int result = (compression == PackageCompression::Xz) ? archive_write_add_filter_xz(ar)
+#if defined(AM_NATIVE_ZSTD_FILTER)
+                                                             : archive_write_add_filter_zstd(ar);
+#else
+                                                             : ARCHIVE_WARN;
+#endif
+        archive_write_free(ar);
+
+        // ARCHIVE_WARN and ARCHIVE_FATAL both mean: no built-in support in libarchive. We never
+        // use libarchive's fallbacks to external programs: the installer must not depend on
+        // (or even run) whatever is found in the PATH.
+        return (result == ARCHIVE_OK);
+    }
+    }
+    return false;
+}
+
+// the magic numbers at the start of compressed streams
+static const char xzMagic[] = { '\xfd', '7', 'z', 'X', 'Z', '\x00' };
+static const char zstdMagic[] = { '\x28', '\xb5', '\x2f', '\xfd' };
+
+void PackageUtilities::enableReadCompressionFilters(archive *ar) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    // uncompressed archives are always supported by libarchive
+    if (archive_read_support_filter_gzip(ar) != ARCHIVE_OK)
+        throw ArchiveException(ar, "could not enable GZIP support");
+
+    // if libarchive was built without liblzma or libzstd, these would silently fall back to
+    // running external programs, so they are only enabled if they are built in (packages using
+    // them are then rejected via checkCompressionSupported())
+    if (isCompressionSupported(PackageCompression::Xz)
+            && (archive_read_support_filter_xz(ar) != ARCHIVE_OK)) {
+        throw ArchiveException(ar, "could not enable XZ support");
+    }
+#if defined(AM_NATIVE_ZSTD_FILTER)
+    if (isCompressionSupported(PackageCompression::Zstd)
+            && (archive_read_support_filter_zstd(ar) != ARCHIVE_OK)) {
+        throw ArchiveException(ar, "could not enable ZSTD support");
+    }
+#endif
+}
+
+void PackageUtilities::checkCompressionSupported(const QByteArray &leadingBytes) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    const auto compression = compressionFromSignature(leadingBytes);
+    if (!isCompressionSupported(compression)) {
+        throw Exception(Error::Package, "%1 compressed packages are not supported by this build")
+                .arg(compressionName(compression));
+    }
+}
+
+void PackageUtilities::enableWriteCompressionFilter(archive *ar, PackageCompression compression,
+                                                    int level, int threadCount) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    const auto levelRange = compressionLevelRange(compression);
+    if ((level != -1) && ((level < levelRange.first) || (level > levelRange.second))) {
+        throw Exception(Error::Package, "invalid %1 compression level %2 (valid levels are %3 to %4)")
+                .arg(compressionName(compression)).arg(level)
+                .arg(levelRange.first).arg(levelRange.second);
+    }
+
+    const char *filterName = nullptr;
+
+    switch (compression) {
+    case PackageCompression::None:
+        return;
+    case PackageCompression::Gzip:
+        if (archive_write_add_filter_gzip(ar) != ARCHIVE_OK)
+            throw ArchiveException(ar, "could not enable GZIP compression");
+        filterName = "gzip";
+        // libarchive stores the current time in the gzip header by default, which makes it
+        // impossible to reproduce a package byte by byte (ParallelGzipWriter does not do that)
+        if (archive_write_set_filter_option(ar, filterName, "timestamp", nullptr) != ARCHIVE_OK)
+            archive_clear_error(ar);
+        break;
+    case PackageCompression::Xz:
+    case PackageCompression::Zstd:
+        // libarchive would fall back to external programs, if it was built without liblzma or
+        // libzstd: isCompressionSupported() only reports the built-in filters
+        if (!isCompressionSupported(compression)) {
+            throw Exception(Error::Package, "%1 compression is not supported by this build")
+                    .arg(compressionName(compression));
+        }
+        if (compression == PackageCompression::Xz) {
+            if (archive_write_add_filter_xz(ar) != ARCHIVE_OK)
+                throw ArchiveException(ar, "could not enable XZ compression");
+            filterName = "xz";
+        } else {
+#if defined(AM_NATIVE_ZSTD_FILTER)
+            if (archive_write_add_filter_zstd(ar) != ARCHIVE_OK)
+                throw ArchiveException(ar, "could not enable ZSTD compression");
+            filterName = "zstd";
+#endif
+        }
+        break;
+    }
+
+    if ((level != -1) && (archive_write_set_filter_option(ar, filterName, "compression-level",
+                                                          QByteArray::number(level).constData()) != ARCHIVE_OK)) {
+        throw ArchiveException(ar, "could not set the compression level");
+    }
+    // gzip has no threads option and older libarchive versions do not support it for zstd:
+    // this is just a hint, so any errors are ignored (0 selects one thread per CPU core)
+    if ((threadCount != 1) && (compression != PackageCompression::Gzip)) {
+        const QByteArray threads = QByteArray::number(qMax(0, threadCount));
+        if (archive_write_set_filter_option(ar, filterName, "threads", threads.constData()) != ARCHIVE_OK)
+            archive_clear_error(ar);
+    }
+}
+
+PackageCompression PackageUtilities::readCompression(archive *ar)
+{
+    switch (archive_filter_code(ar, 0)) {
+    case ARCHIVE_FILTER_GZIP: return PackageCompression::Gzip;
+    case ARCHIVE_FILTER_XZ:   return PackageCompression::Xz;
+    case ARCHIVE_FILTER_ZSTD: return PackageCompression::Zstd;
+    default:                  return PackageCompression::None;
+    }
+}
+
+PackageCompression PackageUtilities::compressionFromSignature(const QByteArray &leadingBytes)
+{
+    if (leadingBytes.startsWith(QByteArray::fromRawData(zstdMagic, sizeof(zstdMagic))))
+        return PackageCompression::Zstd;
+    if (leadingBytes.startsWith(QByteArray::fromRawData(xzMagic, sizeof(xzMagic))))
+        return PackageCompression::Xz;
+    if (leadingBytes.startsWith("\x1f\x8b"))
+        return PackageCompression::Gzip;
+    return PackageCompression::None;
+}
+
+
 ArchiveException::ArchiveException(struct ::archive *ar, const char *errorString)
     : Exception(Error::Archive, qSL("[libarchive] ") + qL1S(errorString) + qSL(": ") + QString::fromLocal8Bit(::archive_error_string(ar)))
 { }
@@ -115,16 +301,27 @@ QVariantMap PackageUtilities::headerDataForDigest = QVariantMap {
 };
 
 void PackageUtilities::addFileMetadataToDigest(const QString &entryFilePath, const QFileInfo &fi, QCryptographicHash &digest)
+{
+    digest.addData(fileMetadataForDigest(entryFilePath, fi.isDir(), fi.isDir() ? 0 : fi.size()));
+}
+
+QByteArray PackageUtilities::fileMetadataForDigest(const QString &entryFilePath, bool isDir, qint64 size)
 {
     // (using QDataStream would be more readable, but it would make the algorithm Qt dependent)
-    QByteArray addToDigest = ((fi.isDir()) ? "D/" : "F/")
-            + QByteArray::number(fi.isDir() ? 0 : fi.size())
+    return (isDir ? "D/" : "F/")
+            + QByteArray::number(isDir ? 0 : size)
             + '/' + entryFilePath.toUtf8();
-    digest.addData(addToDigest);
 }
 
 void PackageUtilities::addHeaderDataToDigest(const QVariantMap &header, QCryptographicHash &digest) Q_DECL_NOEXCEPT_EXPR(false)
 {
+    digest.addData(headerMetadataForDigest(header));
+}
+
+QByteArray PackageUtilities::headerMetadataForDigest(const QVariantMap &header) Q_DECL_NOEXCEPT_EXPR(false)
+{
+    QByteArray result;
+
     for (auto it = headerDataForDigest.constBegin(); it != headerDataForDigest.constEnd(); ++it) {
         if (header.contains(it.key())) {
             QByteArray ba;
@@ -136,9 +333,10 @@ void PackageUtilities::addHeaderDataToDigest(const QVariantMap &header, QCryptog
                     .arg(it.key()).arg(header.value(it.key()).metaType().name()).arg(it.value().metaType().name());
             ds << v;
 
-            digest.addData(ba);
+            result.append(ba);
         }
     }
+    return result;
 }
 
 QT_END_NAMESPACE_AM
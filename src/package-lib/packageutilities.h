@@ -6,13 +6,30 @@
 #pragma once
 
 #include <QtAppManCommon/global.h>
+#include <QtCore/QString>
+
+#include <utility>
 
 QT_BEGIN_NAMESPACE_AM
 
+enum class PackageCompression {
+    None,
+    Gzip,
+    Xz,
+    Zstd,
+};
+
 namespace PackageUtilities
 {
 bool ensureCorrectLocale();
 bool checkCorrectLocale();
+
+QString compressionName(PackageCompression compression);
+PackageCompression compressionFromName(const QString &name, bool *ok = nullptr);
+// the valid levels for a compression algorithm: -1 always selects the algorithm's default
+std::pair<int, int> compressionLevelRange(PackageCompression compression);
+// false, if libarchive was built without support for this compression
+bool isCompressionSupported(PackageCompression compression);
 }
 
 QT_END_NAMESPACE_AM
@@ -7,6 +7,7 @@
 
 #include <QtAppManCommon/global.h>
 #include <QtAppManCommon/exception.h>
+#include <QtAppManPackage/packageutilities.h>
 #include <QVariantMap>
 
 struct archive;
@@ -20,15 +21,34 @@ namespace PackageUtilities
 void addFileMetadataToDigest(const QString &entryFilePath, const QFileInfo &fi, QCryptographicHash &digest);
 void addHeaderDataToDigest(const QVariantMap &header, QCryptographicHash &digest) Q_DECL_NOEXCEPT_EXPR(false);
 
+// the raw data that the two functions above are adding to the digest
+QByteArray fileMetadataForDigest(const QString &entryFilePath, bool isDir, qint64 size);
+QByteArray headerMetadataForDigest(const QVariantMap &header) Q_DECL_NOEXCEPT_EXPR(false);
+
 // key == field name, value == type to choose correct hashing algorithm
 extern QVariantMap headerDataForDigest;
+
+// all the compression filters supported by PackageExtractor
+void enableReadCompressionFilters(struct ::archive *ar) Q_DECL_NOEXCEPT_EXPR(false);
+// throws, if leadingBytes (see below) start with the signature of an unsupported compression
+void checkCompressionSupported(const QByteArray &leadingBytes) Q_DECL_NOEXCEPT_EXPR(false);
+// threadCount is only a hint for the xz and zstd filters: 0 selects one thread per CPU core
+void enableWriteCompressionFilter(struct ::archive *ar, PackageCompression compression,
+                                  int level = -1, int threadCount = 1) Q_DECL_NOEXCEPT_EXPR(false);
+// only valid after the first header has been read
+PackageCompression readCompression(struct ::archive *ar);
+// leadingBytes are the first (at least SignatureSize) bytes of the archive
+constexpr int SignatureSize = 6;
+PackageCompression compressionFromSignature(const QByteArray &leadingBytes);
 };
 
 enum PackageEntryType {
     PackageEntry_Header,
     PackageEntry_File,
     PackageEntry_Dir,
-    PackageEntry_Footer
+    PackageEntry_Footer,
+    PackageEntry_DeltaCopy,
+    PackageEntry_DeltaPatch
 };
 
 class ArchiveException : public Exception
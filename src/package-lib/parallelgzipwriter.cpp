@@ -0,0 +1,191 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QIODevice>
+#include <QThread>
+#include <QtConcurrent/QtConcurrent>
+
+#include "parallelgzipwriter_p.h"
+
+// either the system's or Qt's bundled zlib: see CMakeLists.txt
+#include <zlib.h>
+
+#include <utility>
+
+QT_BEGIN_NAMESPACE_AM
+
+ParallelGzipWriter::ParallelGzipWriter(QIODevice *output, int level, int threadCount)
+    : m_output(output)
+    , m_level(level)
+{
+    if (threadCount <= 0)
+        threadCount = QThread::idealThreadCount();
+    m_pool.setMaxThreadCount(qMax(1, threadCount));
+    // enough blocks to keep all threads busy, while the oldest one is being written
+    m_maximumPendingBlocks = 2 * m_pool.maxThreadCount();
+    m_input.reserve(BlockSize);
+}
+
+ParallelGzipWriter::~ParallelGzipWriter()
+{
+    m_pool.waitForDone();
+}
+
+bool ParallelGzipWriter::write(const char *data, qsizetype size)
+{
+    if (!m_errorString.isEmpty() || m_finished)
+        return false;
+
+    while (size > 0) {
+        const qsizetype chunk = qMin(size, BlockSize - m_input.size());
+        m_input.append(data, chunk);
+        data += chunk;
+        size -= chunk;
+
+        if ((m_input.size() == BlockSize) && !submitBlock(false))
+            return false;
+    }
+    return true;
+}
+
+bool ParallelGzipWriter::finish()
+{
+    if (!m_errorString.isEmpty() || m_finished)
+        return false;
+
+    // the last block might be empty, but it still needs to be submitted to terminate the stream
+    if (!submitBlock(true))
+        return false;
+
+    while (!m_pendingBlocks.empty()) {
+        QFuture<Block> future = std::move(m_pendingBlocks.front());
+        m_pendingBlocks.pop_front();
+        if (!writeBlock(future.result()))
+            return false;
+    }
+    m_finished = true;
+
+    // the gzip trailer: CRC32 and the uncompressed size modulo 2^32, both in little endian
+    QByteArray trailer(8, 0);
+    for (int i = 0; i < 4; ++i) {
+        trailer[i] = char((m_crc >> (8 * i)) & 0xff);
+        trailer[4 + i] = char((m_totalSize >> (8 * i)) & 0xff);
+    }
+    return writeOutput(trailer);
+}
+
+QString ParallelGzipWriter::errorString() const
+{
+    return m_errorString;
+}
+
+bool ParallelGzipWriter::submitBlock(bool isLast)
+{
+    QByteArray block = std::exchange(m_input, QByteArray());
+    m_input.reserve(BlockSize);
+
+    QByteArray dictionary = m_dictionary;
+    if (block.size() >= DictionarySize)
+        m_dictionary = block.right(DictionarySize);
+    else
+        m_dictionary = (m_dictionary + block).right(DictionarySize);
+
+    m_pendingBlocks.push_back(QtConcurrent::run(&m_pool, &ParallelGzipWriter::compressBlock,
+                                                block, dictionary, m_level, isLast));
+
+    // write out the oldest blocks, if too many are in flight: this also throttles the producer
+    while (qsizetype(m_pendingBlocks.size()) > m_maximumPendingBlocks) {
+        QFuture<Block> future = std::move(m_pendingBlocks.front());
+        m_pendingBlocks.pop_front();
+        if (!writeBlock(future.result()))
+            return false;
+    }
+    return true;
+}
+
+bool ParallelGzipWriter::writeBlock(const Block &block)
+{
+    if (!block.errorString.isEmpty()) {
+        m_errorString = block.errorString;
+        return false;
+    }
+
+    if (!m_headerWritten) {
+        // magic, deflate, no flags, no mtime, no extra flags, OS: Unix
+        static const char header[] = { '\x1f', '\x8b', '\x08', '\x00', '\x00', '\x00', '\x00',
+                                       '\x00', '\x00', '\x03' };
+        if (!writeOutput(QByteArray::fromRawData(header, sizeof(header))))
+            return false;
+        m_headerWritten = true;
+    }
+
+    m_crc = quint32(crc32_combine(m_crc, block.crc, z_off_t(block.size)));
+    m_totalSize += quint64(block.size);
+    return writeOutput(block.compressed);
+}
+
+bool ParallelGzipWriter::writeOutput(const QByteArray &data)
+{
+    // this could be simpler, if we had an event loop ... but we do not
+    if (m_output->write(data) != data.size()) {
+        m_errorString = qSL("could not write to the output device: ") + m_output->errorString();
+        return false;
+    }
+    m_output->waitForBytesWritten(-1);
+    return true;
+}
+
+// runs in a worker thread
+ParallelGzipWriter::Block ParallelGzipWriter::compressBlock(const QByteArray &data,
+                                                            const QByteArray &dictionary,
+                                                            int level, bool isLast)
+{
+    Block result;
+    result.size = data.size();
+    result.crc = quint32(crc32(0, reinterpret_cast<const Bytef *>(data.constData()), uInt(data.size())));
+
+    z_stream zs { };
+    // negative window bits: raw deflate without a zlib or gzip wrapper
+    if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        result.errorString = qSL("could not initialize the deflate compressor");
+        return result;
+    }
+    if (!dictionary.isEmpty()
+            && (deflateSetDictionary(&zs, reinterpret_cast<const Bytef *>(dictionary.constData()),
+                                     uInt(dictionary.size())) != Z_OK)) {
+        deflateEnd(&zs);
+        result.errorString = qSL("could not set the deflate dictionary");
+        return result;
+    }
+
+    // the sync flush aligns the end of the block to a byte boundary, so that the next block can
+    // simply be appended. Only the last block is marked as final
+    const int flush = isLast ? Z_FINISH : Z_SYNC_FLUSH;
+
+    result.compressed.resize(qsizetype(deflateBound(&zs, uLong(data.size()))) + 64);
+    zs.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.constData()));
+    zs.avail_in = uInt(data.size());
+    qsizetype written = 0;
+
+    forever {
+        zs.next_out = reinterpret_cast<Bytef *>(result.compressed.data() + written);
+        zs.avail_out = uInt(result.compressed.size() - written);
+
+        const int ret = deflate(&zs, flush);
+        written = result.compressed.size() - zs.avail_out;
+
+        if ((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR)) {
+            result.errorString = qSL("deflate failed (%1)").arg(ret);
+            break;
+        }
+        if (isLast ? (ret == Z_STREAM_END) : ((zs.avail_in == 0) && (zs.avail_out != 0)))
+            break;
+        result.compressed.resize(result.compressed.size() * 2);
+    }
+    deflateEnd(&zs);
+
+    result.compressed.truncate(written);
+    return result;
+}
+
+QT_END_NAMESPACE_AM
@@ -0,0 +1,74 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFuture>
+#include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtAppManCommon/global.h>
+
+#include <deque>
+
+QT_FORWARD_DECLARE_CLASS(QIODevice)
+
+QT_BEGIN_NAMESPACE_AM
+
+// Compresses a data stream into a gzip file using a pool of worker threads, the same way pigz
+// does: the input is split into blocks, which are deflated independently. Each block is primed
+// with the last 32 KiB of the block before it, so the compression ratio is nearly the same as
+// with a single stream. The raw deflate blocks are then concatenated in order and the CRCs of
+// the blocks are combined, resulting in one standard gzip member that any decompressor can read.
+// The write() and finish() functions must be called from the same thread.
+
+class ParallelGzipWriter
+{
+public:
+    static constexpr qsizetype BlockSize = 256 * 1024;
+    static constexpr qsizetype DictionarySize = 32 * 1024;
+
+    // level -1 is zlib's default compression level, threadCount 0 is one thread per CPU core
+    ParallelGzipWriter(QIODevice *output, int level, int threadCount);
+    ~ParallelGzipWriter();
+
+    bool write(const char *data, qsizetype size);
+    bool finish();
+
+    QString errorString() const;
+
+private:
+    struct Block
+    {
+        QByteArray compressed;
+        quint32 crc = 0;
+        qsizetype size = 0;
+        QString errorString;
+    };
+
+    bool submitBlock(bool isLast);
+    bool writeBlock(const Block &block);
+    bool writeOutput(const QByteArray &data);
+    static Block compressBlock(const QByteArray &data, const QByteArray &dictionary, int level,
+                               bool isLast);
+
+    QIODevice *m_output;
+    int m_level;
+    int m_maximumPendingBlocks;
+    bool m_headerWritten = false;
+    bool m_finished = false;
+    QString m_errorString;
+
+    QByteArray m_input;
+    QByteArray m_dictionary;
+    quint32 m_crc = 0;
+    quint64 m_totalSize = 0;
+
+    std::deque<QFuture<Block>> m_pendingBlocks;
+    QThreadPool m_pool; // waits for all running jobs when destroyed
+
+    Q_DISABLE_COPY_MOVE(ParallelGzipWriter)
+};
+
+QT_END_NAMESPACE_AM
+// We mean it. Dummy comment since syncqt needs this also for completely private Qt modules.
@@ -5,12 +5,28 @@
 
 #include "containerinterface.h"
 
+#include <stdexcept>
+
 ContainerInterface::~ContainerInterface() { }
 
 ContainerManagerInterface::~ContainerManagerInterface() { }
 
 bool ContainerManagerInterface::initialize(ContainerHelperFunctions *) { return true; }
 
+void ContainerHelperFunctions::bindMountFileSystems(const QVector<BindMount> &mounts, quint64 namespacePid)
+{
+    QStringList errors;
+    for (const BindMount &mount : mounts) {
+        try {
+            bindMountFileSystem(mount.from, mount.to, mount.readOnly, namespacePid);
+        } catch (const std::exception &e) {
+            errors << QString::fromLocal8Bit(e.what());
+        }
+    }
+    if (!errors.isEmpty())
+        throw std::runtime_error(errors.join(QLatin1Char('\n')).toLocal8Bit().toStdString());
+}
+
 /*! \class ContainerInterface
     \inmodule QtApplicationManager
     \brief An interface for custom container instances.
@@ -93,6 +93,18 @@ public:
     // this function will run with root privileges and throw std::execptions on error:
     virtual void bindMountFileSystem(const QString &from, const QString &to, bool readOnly,
                                      quint64 namespacePid) = 0;
+
+    // batched variant of bindMountFileSystem: all mounts are handed to the root helper process
+    // in one go, instead of one round-trip per mount. All mounts are attempted, even if some
+    // of them fail: the std::exception thrown in this case lists all the errors.
+    // The default implementation just calls bindMountFileSystem for each mount.
+    struct BindMount
+    {
+        QString from;
+        QString to;
+        bool readOnly = false;
+    };
+    virtual void bindMountFileSystems(const QVector<BindMount> &mounts, quint64 namespacePid);
 };
 
 class ContainerManagerInterface
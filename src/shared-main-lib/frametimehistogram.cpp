@@ -0,0 +1,76 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QtCore/QtAlgorithms>
+#include <cmath>
+
+#include "frametimehistogram.h"
+
+
+QT_BEGIN_NAMESPACE_AM
+
+void FrameTimeHistogram::record(quint32 value)
+{
+    m_counts[size_t(bucketIndex(value))].fetch_add(1, std::memory_order_relaxed);
+}
+
+FrameTimeHistogram::Snapshot FrameTimeHistogram::takeSnapshot()
+{
+    // Not an atomic snapshot of all buckets, but every recorded value ends up in exactly one
+    // snapshot, which is all we need.
+    Snapshot snapshot;
+    for (size_t i = 0; i < m_counts.size(); ++i) {
+        snapshot.m_counts[i] = m_counts[i].exchange(0, std::memory_order_relaxed);
+        snapshot.m_count += snapshot.m_counts[i];
+    }
+    return snapshot;
+}
+
+int FrameTimeHistogram::bucketIndex(quint32 value)
+{
+    value = qMin(value, MaximumValue);
+    if (value < quint32(SubBucketCount))
+        return int(value);
+
+    int shift = 31 - qCountLeadingZeroBits(value) - SubBucketBits;
+    return (shift + 1) * SubBucketCount + int((value >> shift) & (SubBucketCount - 1));
+}
+
+quint32 FrameTimeHistogram::bucketLowerBound(int index)
+{
+    if (index < SubBucketCount)
+        return quint32(index);
+
+    int shift = index / SubBucketCount - 1;
+    return quint32(SubBucketCount + index % SubBucketCount) << shift;
+}
+
+quint32 FrameTimeHistogram::bucketUpperBound(int index)
+{
+    int shift = qMax(0, index / SubBucketCount - 1);
+    return bucketLowerBound(index) + (quint32(1) << shift) - 1;
+}
+
+quint64 FrameTimeHistogram::Snapshot::count() const
+{
+    return m_count;
+}
+
+quint32 FrameTimeHistogram::Snapshot::valueAtPercentile(qreal percentile) const
+{
+    if (!m_count)
+        return 0;
+
+    const qreal clamped = qBound(qreal(0), percentile, qreal(100));
+    const quint64 rank = qMax(quint64(1), quint64(std::ceil(clamped / 100 * qreal(m_count))));
+
+    quint64 seen = 0;
+    for (int i = 0; i < BucketCount; ++i) {
+        seen += m_counts[size_t(i)];
+        if (seen >= rank) // the middle of the bucket halves the worst case error
+            return bucketLowerBound(i) + (bucketUpperBound(i) - bucketLowerBound(i)) / 2;
+    }
+    return MaximumValue;
+}
+
+QT_END_NAMESPACE_AM
@@ -0,0 +1,55 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <QtCore/QtGlobal>
+#include <QtAppManCommon/global.h>
+
+
+QT_BEGIN_NAMESPACE_AM
+
+// A fixed-size, log-linear histogram of frame times in microseconds (similar to HdrHistogram):
+// each power-of-two range is split into SubBucketCount linear buckets, which limits the relative
+// error of any reported value to 1/SubBucketCount. Recording a value is a single relaxed atomic
+// increment, so it is safe to record from the render thread without any locking and the cost
+// per frame is constant.
+
+class FrameTimeHistogram
+{
+public:
+    static constexpr int SubBucketBits = 4;
+    static constexpr int SubBucketCount = 1 << SubBucketBits;
+    static constexpr int ValueBits = 24; // up to ~16.7sec
+    static constexpr quint32 MaximumValue = (quint32(1) << ValueBits) - 1;
+    static constexpr int BucketCount = (ValueBits - SubBucketBits + 1) * SubBucketCount;
+
+    class Snapshot
+    {
+    public:
+        quint64 count() const;
+        // the value below which percentile % of all values fall, or 0 if empty
+        quint32 valueAtPercentile(qreal percentile) const;
+
+    private:
+        std::array<quint32, BucketCount> m_counts { };
+        quint64 m_count = 0;
+        friend class FrameTimeHistogram;
+    };
+
+    void record(quint32 value);
+
+    // returns all values recorded since the last call and resets the histogram
+    Snapshot takeSnapshot();
+
+    static int bucketIndex(quint32 value);
+    static quint32 bucketLowerBound(int index);
+    static quint32 bucketUpperBound(int index);
+
+private:
+    std::array<std::atomic<quint32>, BucketCount> m_counts { };
+};
+
+QT_END_NAMESPACE_AM
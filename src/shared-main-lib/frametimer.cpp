@@ -60,6 +60,19 @@
 
     Please note that when using FrameTimer as a MonitorModel data source there's no need to set it
     to \l{FrameTimer::running}{running} as MonitorModel will already call update() as needed.
+
+    Average frame rates hide the occasional slow frame that users perceive as stutter. For this
+    reason FrameTimer also keeps a histogram of all frame times within a sampling period, which is
+    used to report the \l{FrameTimer::frameTimeP95}{95th} and \l{FrameTimer::frameTimeP99}{99th}
+    percentile frame times, as well as the number of frames that took considerably longer than
+    expected (see \l jankCount and \l longFrameCount). The cost of recording a frame is constant,
+    regardless of the frame rate and the \l interval.
+
+    \note Frame times are measured as the time between two consecutive frame swaps of the
+    \l window. FrameTimer has no way of knowing whether the window did not render because it was
+    busy or simply because nothing changed, so these statistics are only meaningful while the
+    window is rendering continuously, e.g. during animations. The first frame after an idle
+    period is recorded with the whole idle time as its frame time.
 */
 
 QT_BEGIN_NAMESPACE_AM
@@ -136,6 +149,153 @@ qreal FrameTimer::jitterFps() const
     return m_jitterFps;
 }
 
+/*!
+    \qmlproperty real FrameTimer::frameTimeP50
+    \readonly
+
+    The median frame time of the given \l window, in milliseconds, since update() was last called.
+    Frame times are measured with a relative precision of about 3%.
+
+    \sa frameTimePercentile()
+*/
+qreal FrameTimer::frameTimeP50() const
+{
+    return frameTimePercentile(50);
+}
+
+/*!
+    \qmlproperty real FrameTimer::frameTimeP95
+    \readonly
+
+    The 95th percentile of the frame times of the given \l window, in milliseconds, since update()
+    was last called: 95% of all frames took at most this long to render.
+
+    \sa frameTimePercentile()
+*/
+qreal FrameTimer::frameTimeP95() const
+{
+    return frameTimePercentile(95);
+}
+
+/*!
+    \qmlproperty real FrameTimer::frameTimeP99
+    \readonly
+
+    The 99th percentile of the frame times of the given \l window, in milliseconds, since update()
+    was last called: 99% of all frames took at most this long to render.
+
+    \sa frameTimePercentile()
+*/
+qreal FrameTimer::frameTimeP99() const
+{
+    return frameTimePercentile(99);
+}
+
+/*!
+    \qmlmethod real FrameTimer::frameTimePercentile(real percentile)
+
+    Returns the frame time in milliseconds that \a percentile percent of the frames rendered
+    between the last two update() calls did not exceed. Returns \c 0 if no frames were rendered.
+
+    \sa frameTimeP50 frameTimeP95 frameTimeP99
+*/
+qreal FrameTimer::frameTimePercentile(qreal percentile) const
+{
+    return m_lastHistogram.valueAtPercentile(percentile) / qreal(1000);
+}
+
+/*!
+    \qmlproperty int FrameTimer::jankCount
+    \readonly
+
+    The number of frames of the given \l window that took longer than \l jankThreshold times the
+    ideal frame time (one vsync interval at 60Hz) to render, since update() was last called.
+
+    Since frame times are measured from one frame swap to the next, the first frame after the
+    window has been idle is always counted as well.
+
+    \sa jankThreshold
+*/
+int FrameTimer::jankCount() const
+{
+    return m_jankCount;
+}
+
+/*!
+    \qmlproperty int FrameTimer::longFrameCount
+    \readonly
+
+    The number of frames of the given \l window that took longer than \l longFrameThreshold
+    milliseconds to render, since update() was last called.
+
+    Since frame times are measured from one frame swap to the next, the first frame after the
+    window has been idle for longer than \l longFrameThreshold is counted as well.
+
+    \sa longFrameThreshold longFrame()
+*/
+int FrameTimer::longFrameCount() const
+{
+    return m_longFrameCount;
+}
+
+/*!
+    \qmlproperty real FrameTimer::jankThreshold
+
+    A frame is counted in \l jankCount, if it took longer than this factor times the ideal frame
+    time to render. The default value is \c 1.5, meaning that every frame that missed at least one
+    vsync is counted.
+
+    \sa jankCount
+*/
+qreal FrameTimer::jankThreshold() const
+{
+    return m_jankThreshold;
+}
+
+void FrameTimer::setJankThreshold(qreal factor)
+{
+    if (!qFuzzyCompare(factor, m_jankThreshold)) {
+        m_jankThreshold = factor;
+        emit jankThresholdChanged();
+    }
+}
+
+/*!
+    \qmlproperty int FrameTimer::longFrameThreshold
+
+    A frame that took longer than this number of milliseconds to render is counted in
+    \l longFrameCount and additionally reported via the longFrame() signal. Setting it to \c 0
+    disables this check. The default value is \c 100.
+
+    The time a window did not render, because nothing changed, cannot be told apart from the time
+    it took to render a frame: an application that only updates occasionally will trigger long
+    frames after each idle period. Monitor such windows only while they are animating, or use a
+    threshold that is larger than the expected idle periods.
+
+    \sa longFrameCount longFrame()
+*/
+int FrameTimer::longFrameThreshold() const
+{
+    return m_longFrameThreshold;
+}
+
+void FrameTimer::setLongFrameThreshold(int msecs)
+{
+    if (msecs != m_longFrameThreshold) {
+        m_longFrameThreshold = msecs;
+        emit longFrameThresholdChanged();
+    }
+}
+
+/*!
+    \qmlsignal FrameTimer::longFrame(real frameTime)
+
+    This signal is emitted immediately for every frame of the given \l window, that took longer
+    than \l longFrameThreshold milliseconds to render. The \a frameTime is given in milliseconds.
+
+    \sa longFrameThreshold longFrameCount
+*/
+
 /*!
     \qmlproperty Object FrameTimer::window
 
@@ -160,6 +320,8 @@ void FrameTimer::setWindow(QObject *window)
         disconnect(m_frameSwapConnection);
 
     m_window = window;
+    // the time since the last swap of the old window is not a frame time of the new one
+    m_timer.invalidate();
 
     if (m_window) {
         bool connected = false;
@@ -189,13 +351,16 @@ void FrameTimer::setWindow(QObject *window)
 */
 QStringList FrameTimer::roleNames() const
 {
-    return { qSL("averageFps"), qSL("minimumFps"), qSL("maximumFps"), qSL("jitterFps") };
+    return { qSL("averageFps"), qSL("minimumFps"), qSL("maximumFps"), qSL("jitterFps"),
+             qSL("frameTimeP50"), qSL("frameTimeP95"), qSL("frameTimeP99"), qSL("jankCount"),
+             qSL("longFrameCount") };
 }
 
 /*!
     \qmlmethod FrameTimer::update
 
-    Updates the properties averageFps, minimumFps, maximumFps and jitterFps. Then resets internal
+    Updates the properties averageFps, minimumFps, maximumFps, jitterFps, frameTimeP50,
+    frameTimeP95, frameTimeP99, jankCount and longFrameCount. Then resets internal
     counters so that new numbers can be taken for the new time period starting from the moment
     this method is called.
 
@@ -210,12 +375,16 @@ void FrameTimer::update()
     m_minimumFps = m_max ? MicrosInSec / m_max : qreal(0);
     m_maximumFps = m_min ? MicrosInSec / m_min : qreal(0);
     m_jitterFps = m_count ? m_jitter / m_count :  qreal(0);
+    m_jankCount = m_jankCounter;
+    m_longFrameCount = m_longFrameCounter;
+    m_lastHistogram = m_histogram.takeSnapshot();
 
     // Start counting again for the next sampling period but keep m_timer running because
     // we still need the diff between the last rendered frame and the upcoming one.
     m_count = m_sum = m_max = 0;
     m_jitter = 0;
     m_min = std::numeric_limits<int>::max();
+    m_jankCounter = m_longFrameCounter = 0;
 
     emit updated();
 }
@@ -276,6 +445,14 @@ void FrameTimer::reportFrameSwap()
     m_min = qMin(m_min, frameTime);
     m_max = qMax(m_max, frameTime);
     m_jitter += qAbs(MicrosInSec / IdealFrameTime - MicrosInSec / frameTime);
+
+    m_histogram.record(quint32(frameTime));
+    if (frameTime > m_jankThreshold * IdealFrameTime)
+        ++m_jankCounter;
+    if ((m_longFrameThreshold > 0) && (frameTime > m_longFrameThreshold * 1000)) {
+        ++m_longFrameCounter;
+        emit longFrame(frameTime / qreal(1000));
+    }
 }
 
 FrameTimerImpl *FrameTimer::implementation()
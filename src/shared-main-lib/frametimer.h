@@ -11,6 +11,7 @@
 #include <QtCore/QPointer>
 #include <QtCore/QTimer>
 #include <QtAppManCommon/global.h>
+#include <QtAppManSharedMain/frametimehistogram.h>
 #include <limits>
 
 
@@ -27,6 +28,14 @@ class FrameTimer : public QObject
     Q_PROPERTY(qreal minimumFps READ minimumFps NOTIFY updated FINAL)
     Q_PROPERTY(qreal maximumFps READ maximumFps NOTIFY updated FINAL)
     Q_PROPERTY(qreal jitterFps READ jitterFps NOTIFY updated FINAL)
+    Q_PROPERTY(qreal frameTimeP50 READ frameTimeP50 NOTIFY updated FINAL)
+    Q_PROPERTY(qreal frameTimeP95 READ frameTimeP95 NOTIFY updated FINAL)
+    Q_PROPERTY(qreal frameTimeP99 READ frameTimeP99 NOTIFY updated FINAL)
+    Q_PROPERTY(int jankCount READ jankCount NOTIFY updated FINAL)
+    Q_PROPERTY(int longFrameCount READ longFrameCount NOTIFY updated FINAL)
+
+    Q_PROPERTY(qreal jankThreshold READ jankThreshold WRITE setJankThreshold NOTIFY jankThresholdChanged FINAL)
+    Q_PROPERTY(int longFrameThreshold READ longFrameThreshold WRITE setLongFrameThreshold NOTIFY longFrameThresholdChanged FINAL)
 
     Q_PROPERTY(QObject* window READ window WRITE setWindow NOTIFY windowChanged FINAL)
 
@@ -48,6 +57,23 @@ public:
     qreal minimumFps() const;
     qreal maximumFps() const;
     qreal jitterFps() const;
+    qreal frameTimeP50() const;
+    qreal frameTimeP95() const;
+    qreal frameTimeP99() const;
+    int jankCount() const;
+    int longFrameCount() const;
+
+    Q_INVOKABLE qreal frameTimePercentile(qreal percentile) const;
+
+    qreal jankThreshold() const;
+    void setJankThreshold(qreal factor);
+    Q_SIGNAL void jankThresholdChanged();
+
+    int longFrameThreshold() const;
+    void setLongFrameThreshold(int msecs);
+    Q_SIGNAL void longFrameThresholdChanged();
+
+    Q_SIGNAL void longFrame(qreal frameTime);
 
     QObject *window() const;
     void setWindow(QObject *window);
@@ -76,6 +102,9 @@ private:
     int m_min = std::numeric_limits<int>::max();
     int m_max = 0;
     qreal m_jitter = 0.0;
+    int m_jankCounter = 0;
+    int m_longFrameCounter = 0;
+    FrameTimeHistogram m_histogram;
 
     QElapsedTimer m_timer;
 
@@ -85,6 +114,12 @@ private:
     qreal m_minimumFps;
     qreal m_maximumFps;
     qreal m_jitterFps;
+    int m_jankCount = 0;
+    int m_longFrameCount = 0;
+    FrameTimeHistogram::Snapshot m_lastHistogram;
+
+    qreal m_jankThreshold = 1.5;
+    int m_longFrameThreshold = 100; // msec
 
     QMetaObject::Connection m_frameSwapConnection;
 
@@ -14,6 +14,8 @@
 #include <QJSValue>
 #include <QQmlEngine>
 
+#include <algorithm>
+
 /*!
     \qmltype MonitorModel
     \inqmlmodule QtApplicationManager
@@ -118,10 +120,34 @@
     is discarded whenever a new row comes in, so that \l{MonitorModel::count}{count} doesn't exceed
     \l{MonitorModel::maximumCount}{maximumCount}. New rows are always appended to the model, so rows are
     ordered chronologically from oldest (index 0) to newest (index count-1).
+
+    The history of numeric roles is stored compactly: graphs that need many values at once
+    should fetch them in bulk via \l{MonitorModel::valuesForRole}{valuesForRole()} instead of
+    querying the model row by row.
 */
 
 QT_USE_NAMESPACE_AM
 
+MonitorModel::Column::Storage MonitorModel::Column::storageForType(QMetaType type)
+{
+    switch (type.id()) {
+    case QMetaType::Double:
+    case QMetaType::Float:
+        return Double;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::ULong:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+        return Int64;
+    default:
+        return Variant;
+    }
+}
+
 MonitorModel::MonitorModel(QObject *parent)
     : QAbstractListModel(parent)
 {
@@ -131,7 +157,7 @@ MonitorModel::MonitorModel(QObject *parent)
 
 MonitorModel::~MonitorModel()
 {
-    qDeleteAll(m_rows);
+    qDeleteAll(m_dataSources);
 }
 
 /*!
@@ -181,6 +207,7 @@ void MonitorModel::clearDataSources()
     m_dataSources.clear();
     m_roleNamesList.clear();
     m_roleNameToIndex.clear();
+    m_columns.clear();
 
     clear();
 }
@@ -194,6 +221,13 @@ void MonitorModel::appendDataSource(QObject *dataSourceObj)
     if (!extractRoleNamesFromJsArray(dataSource)
             && !extractRoleNamesFromStringList(dataSource))
         qmlWarning(this) << "Could not find a roleNames property containing an array or list of strings.";
+
+    const QMetaObject *metaObj = dataSourceObj->metaObject();
+    int updateIndex = metaObj->indexOfMethod("update()");
+    if (updateIndex >= 0)
+        dataSource->updateMethod = metaObj->method(updateIndex);
+    else
+        qmlWarning(this) << "Data source does not have an update() function.";
 }
 
 bool MonitorModel::extractRoleNamesFromJsArray(DataSource *dataSource)
@@ -246,7 +280,86 @@ void MonitorModel::addRoleName(QByteArray roleName, DataSource *dataSource)
         qmlWarning(this) << "roleName" << roleName << "already exists. Model won't function correctly.";
 
     m_roleNamesList.append(dataSource->roleNames.last());
-    m_roleNameToIndex[dataSource->roleNames.last()] = m_roleNamesList.count() - 1;
+    int roleIndex = m_roleNamesList.count() - 1;
+    m_roleNameToIndex[dataSource->roleNames.last()] = roleIndex;
+
+    // resolve the property once, instead of looking it up by name on every update
+    const QMetaObject *metaObj = dataSource->obj->metaObject();
+    int propertyIndex = metaObj->indexOfProperty(roleName.constData());
+    QMetaProperty property = (propertyIndex >= 0) ? metaObj->property(propertyIndex) : QMetaProperty();
+
+    dataSource->roleIndexes.append(roleIndex);
+    dataSource->properties.append(property);
+
+    Column column;
+    column.type = property.metaType();
+    column.storage = Column::storageForType(column.type);
+    column.resize(m_maximumCount);
+    m_columns.append(column);
+}
+
+void MonitorModel::Column::resize(int size)
+{
+    switch (storage) {
+    case Double: doubles.resize(size); break;
+    case Int64: ints.resize(size); break;
+    case Variant: variants.resize(size); break;
+    }
+}
+
+void MonitorModel::Column::clear()
+{
+    // only the variants hold on to any resources
+    variants.fill(QVariant());
+}
+
+QVariant MonitorModel::Column::value(int slot) const
+{
+    QVariant v;
+    switch (storage) {
+    case Double:
+        v = doubles.at(slot);
+        break;
+    case Int64:
+        v = ints.at(slot);
+        break;
+    case Variant:
+        return variants.at(slot);
+    }
+    // hand out the same type as the data source's property
+    if (v.metaType() != type)
+        v.convert(type);
+    return v;
+}
+
+void MonitorModel::Column::setValue(int slot, const QVariant &value)
+{
+    switch (storage) {
+    case Double: doubles[slot] = value.toDouble(); break;
+    case Int64: ints[slot] = value.toLongLong(); break;
+    case Variant: variants[slot] = value; break;
+    }
+}
+
+double MonitorModel::Column::toDouble(int slot) const
+{
+    switch (storage) {
+    case Double:
+        return doubles.at(slot);
+    case Int64:
+        if (type.id() == QMetaType::ULongLong || type.id() == QMetaType::ULong)
+            return double(quint64(ints.at(slot)));
+        return double(ints.at(slot));
+    case Variant:
+        break;
+    }
+    return variants.at(slot).toDouble();
+}
+
+int MonitorModel::slotForRow(int row) const
+{
+    int slot = m_head + row;
+    return (slot >= m_maximumCount) ? slot - m_maximumCount : slot;
 }
 
 /*!
@@ -259,7 +372,7 @@ void MonitorModel::addRoleName(QByteArray roleName, DataSource *dataSource)
 */
 int MonitorModel::count() const
 {
-    return m_rows.count();
+    return m_count;
 }
 
 int MonitorModel::rowCount(const QModelIndex &parent) const
@@ -274,10 +387,12 @@ int MonitorModel::rowCount(const QModelIndex &parent) const
 
 QVariant MonitorModel::data(const QModelIndex &index, int role) const
 {
-    if (index.parent().isValid() || !index.isValid() || index.row() < 0 || index.row() >= m_rows.count())
+    if (index.parent().isValid() || !index.isValid() || index.row() < 0 || index.row() >= m_count
+            || role < 0 || role >= m_columns.count()) {
         return QVariant();
+    }
 
-    return m_rows.at(index.row())->dataFromRoleIndex[role];
+    return m_columns.at(role).value(slotForRow(index.row()));
 }
 
 QHash<int, QByteArray> MonitorModel::roleNames() const
@@ -339,50 +454,53 @@ void MonitorModel::setInterval(int value)
 
 void MonitorModel::readDataSourcesAndAddRow()
 {
-    if (m_dataSources.count() == 0)
+    if (m_dataSources.isEmpty() || (m_maximumCount <= 0))
         return;
 
-    if (m_rows.count() < m_maximumCount) {
-        // create a new row
-        DataRow *dataRow = new DataRow;
-        fillDataRow(dataRow);
-        beginInsertRows(QModelIndex(), /* first */ m_rows.count(), /* last */ m_rows.count());
-        m_rows.append(dataRow);
+    if (m_count < m_maximumCount) {
+        // fill the next free slot
+        fillRow(slotForRow(m_count));
+        beginInsertRows(QModelIndex(), /* first */ m_count, /* last */ m_count);
+        ++m_count;
         endInsertRows();
         emit countChanged();
     } else {
-        // recycle the oldest row
-        beginMoveRows(QModelIndex(), /* sourceFirst */ 0, /* sourceLast */ 0,
-                QModelIndex(), /* destination */ m_rows.count());
-        m_rows.append(m_rows.takeFirst());
-        endMoveRows();
+        // recycle the oldest row: advancing the head turns its slot into the newest row
+        if (m_count > 1) {
+            beginMoveRows(QModelIndex(), /* sourceFirst */ 0, /* sourceLast */ 0,
+                    QModelIndex(), /* destination */ m_count);
+            m_head = slotForRow(1);
+            endMoveRows();
+        }
 
         {
-            fillDataRow(m_rows.last());
-            QModelIndex modelIndex = index(m_rows.count() - 1 /* row */, 0 /* column */);
+            fillRow(slotForRow(m_count - 1));
+            QModelIndex modelIndex = index(m_count - 1 /* row */, 0 /* column */);
             emit dataChanged(modelIndex, modelIndex);
         }
     }
 }
 
-void MonitorModel::fillDataRow(DataRow *dataRow)
+void MonitorModel::fillRow(int slot)
 {
     for (int i = 0; i < m_dataSources.count(); ++i) {
-        readDataSource(m_dataSources[i], dataRow);
+        readDataSource(m_dataSources[i], slot);
     }
 }
 
-void MonitorModel::readDataSource(DataSource *dataSource, DataRow *dataRow)
+void MonitorModel::readDataSource(DataSource *dataSource, int slot)
 {
-    // TODO: check if successful
-    QMetaObject::invokeMethod(dataSource->obj, "update", Qt::DirectConnection);
+    if (dataSource->updateMethod.isValid())
+        dataSource->updateMethod.invoke(dataSource->obj, Qt::DirectConnection);
 
     for (int i = 0; i < dataSource->roleNames.count(); i++) {
-        // TODO: check index exists
-        int roleIndex = m_roleNameToIndex[dataSource->roleNames[i]];
+        const QMetaProperty &property = dataSource->properties.at(i);
 
-        QVariant variant = QQmlProperty::read(dataSource->obj, QLatin1String(dataSource->roleNames[i]));
-        dataRow->dataFromRoleIndex[roleIndex] = variant;
+        // properties that are not part of the meta-object (e.g. attached ones) need a QML lookup
+        QVariant variant = property.isValid()
+                ? property.read(dataSource->obj)
+                : QQmlProperty::read(dataSource->obj, QLatin1String(dataSource->roleNames[i]));
+        m_columns[dataSource->roleIndexes.at(i)].setValue(slot, variant);
     }
 }
 
@@ -401,26 +519,58 @@ int MonitorModel::maximumCount() const
 
 void MonitorModel::setMaximumCount(int value)
 {
+    value = qMax(0, value);
     if (m_maximumCount == value)
         return;
 
+    trimHistory(value);
+    resizeHistory(value);
     m_maximumCount = value;
-    trimHistory();
     emit maximumCountChanged();
 }
 
-void MonitorModel::trimHistory()
+void MonitorModel::trimHistory(int maximumCount)
 {
-    int excess = m_rows.count() - m_maximumCount;
+    int excess = m_count - maximumCount;
     if (excess <= 0)
         return;
 
     beginRemoveRows(QModelIndex(), /* first */ 0, /* last */ excess - 1);
 
-    while (m_rows.count() > m_maximumCount)
-        delete m_rows.takeFirst();
+    for (int row = 0; row < excess; ++row) {
+        const int slot = slotForRow(row);
+        for (Column &column : m_columns) {
+            if (column.storage == Column::Variant)
+                column.variants[slot] = QVariant();
+        }
+    }
+    m_head = slotForRow(excess);
+    m_count -= excess;
 
     endRemoveRows();
+    emit countChanged();
+}
+
+void MonitorModel::resizeHistory(int maximumCount)
+{
+    // re-allocate all columns, with the oldest row in the first slot
+    for (Column &column : m_columns) {
+        Column resized;
+        resized.type = column.type;
+        resized.storage = column.storage;
+        resized.resize(maximumCount);
+
+        for (int row = 0; row < m_count; ++row) {
+            const int slot = slotForRow(row);
+            switch (column.storage) {
+            case Column::Double: resized.doubles[row] = column.doubles.at(slot); break;
+            case Column::Int64: resized.ints[row] = column.ints.at(slot); break;
+            case Column::Variant: resized.variants[row] = std::move(column.variants[slot]); break;
+            }
+        }
+        column = std::move(resized);
+    }
+    m_head = 0;
 }
 
 /*!
@@ -433,8 +583,10 @@ void MonitorModel::trimHistory()
 void MonitorModel::clear()
 {
     beginResetModel();
-    qDeleteAll(m_rows);
-    m_rows.clear();
+    for (Column &column : m_columns)
+        column.clear();
+    m_head = 0;
+    m_count = 0;
     endResetModel();
 
     emit countChanged();
@@ -461,4 +613,48 @@ QVariantMap MonitorModel::get(int row) const
     return map;
 }
 
+/*!
+    \qmlmethod list<real> MonitorModel::valuesForRole(string roleName, int from, int count)
+
+    Returns the values of the role \a roleName for \a count rows, starting at row \a from, as a
+    list of numbers. If \a count is \c -1 (the default), all rows from \a from up to the newest
+    one are returned. Values that are not numeric are converted like JavaScript's \c Number()
+    would do.
+
+    This is a lot more efficient than calling \l get() for each row, e.g. when a graph needs to
+    be redrawn.
+*/
+QList<qreal> MonitorModel::valuesForRole(const QString &roleName, int from, int count) const
+{
+    int role = m_roleNameToIndex.value(roleName.toLatin1(), -1);
+    if (role < 0) {
+        qCWarning(LogSystem) << "MonitorModel::valuesForRole invalid role:" << roleName;
+        return { };
+    }
+    return valuesForRole(role, from, count);
+}
+
+QList<qreal> MonitorModel::valuesForRole(int role, int from, int count) const
+{
+    if (role < 0 || role >= m_columns.count() || from < 0 || from >= m_count)
+        return { };
+    if (count < 0 || count > (m_count - from))
+        count = m_count - from;
+
+    QList<qreal> result(count);
+    const Column &column = m_columns.at(role);
+    const int slot = slotForRow(from);
+
+    if (column.storage == Column::Double) {
+        // at most two contiguous blocks, as the ring buffer might wrap around
+        const int firstBlock = qMin(count, m_maximumCount - slot);
+        std::copy_n(column.doubles.constData() + slot, firstBlock, result.data());
+        std::copy_n(column.doubles.constData(), count - firstBlock, result.data() + firstBlock);
+    } else {
+        for (int i = 0; i < count; ++i)
+            result[i] = column.toDouble(slotForRow(from + i));
+    }
+    return result;
+}
+
 #include "moc_monitormodel.cpp"
@@ -11,6 +11,8 @@
 #include <QtCore/QList>
 #include <QtCore/QStringList>
 #include <QtCore/QTimer>
+#include <QtCore/QMetaProperty>
+#include <QtCore/QMetaMethod>
 
 QT_BEGIN_NAMESPACE_AM
 
@@ -56,6 +58,9 @@ public:
 
     Q_INVOKABLE void clear();
     Q_INVOKABLE QVariantMap get(int row) const;
+    Q_INVOKABLE QList<qreal> valuesForRole(const QString &roleName, int from = 0, int count = -1) const;
+
+    QList<qreal> valuesForRole(int role, int from = 0, int count = -1) const;
 
 signals:
     void countChanged();
@@ -68,32 +73,56 @@ private slots:
     void readDataSourcesAndAddRow();
 
 private:
-    struct DataRow {
-        QHash<int, QVariant> dataFromRoleIndex;
+    // The history is stored column-wise in a ring buffer of maximumCount rows: each role gets
+    // its own preallocated array, so adding a row doesn't allocate anything. Numeric roles are
+    // stored unboxed, everything else (e.g. maps) falls back to QVariants.
+    struct Column {
+        enum Storage { Double, Int64, Variant };
+
+        QMetaType type;
+        Storage storage = Variant;
+        QVector<double> doubles;
+        QVector<qint64> ints;
+        QVector<QVariant> variants;
+
+        static Storage storageForType(QMetaType type);
+
+        void resize(int size);
+        void clear();
+        QVariant value(int slot) const;
+        void setValue(int slot, const QVariant &value);
+        double toDouble(int slot) const;
     };
 
     struct DataSource {
         QObject *obj;
         QVector<QByteArray> roleNames;
+        QVector<int> roleIndexes;
+        QVector<QMetaProperty> properties; // resolved once, invalid if only accessible via QML
+        QMetaMethod updateMethod;
     };
 
     void clearDataSources();
     void appendDataSource(QObject *dataSource);
-    void fillDataRow(DataRow *dataRow);
-    void readDataSource(DataSource *dataSource, DataRow *dataRow);
-    void trimHistory();
+    void fillRow(int slot);
+    void readDataSource(DataSource *dataSource, int slot);
+    void trimHistory(int maximumCount);
+    void resizeHistory(int maximumCount);
     bool extractRoleNamesFromJsArray(DataSource *dataSource);
     bool extractRoleNamesFromStringList(DataSource *dataSource);
     void addRoleName(QByteArray roleName, DataSource *dataSource);
+    int slotForRow(int row) const;
 
     QList<DataSource*> m_dataSources;
     QList<QByteArray> m_roleNamesList; // also maps a role index to its name
     QHash<QByteArray, int> m_roleNameToIndex;
 
-    QList<DataRow*> m_rows;
+    QVector<Column> m_columns; // indexed by role
+    int m_head = 0; // slot of the oldest row
+    int m_count = 0;
 
     QTimer m_timer;
-    int m_maximumCount = 10;
+    int m_maximumCount = 10; // also the number of slots allocated in each column
 };
 
 QT_END_NAMESPACE_AM
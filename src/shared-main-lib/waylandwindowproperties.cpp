@@ -0,0 +1,90 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QDataStream>
+
+#include "waylandwindowproperties.h"
+#include "logging.h"
+
+
+QT_BEGIN_NAMESPACE_AM
+
+static QByteArray serializePair(const QString &name, const QVariant &value)
+{
+    QByteArray pair;
+    QDataStream ds(&pair, QDataStream::WriteOnly);
+    ds << name << value;
+
+    // a Wayland message bigger than 4KB would make the receiver disconnect us
+    if (pair.size() > WaylandWindowProperties::MaximumBatchSize) {
+        qCWarning(LogGraphics).nospace() << "Window property " << name << " is too big to be sent via Wayland ("
+                                         << pair.size() << " bytes, but at most "
+                                         << WaylandWindowProperties::MaximumBatchSize << " bytes are supported)";
+        return { };
+    }
+    return pair;
+}
+
+QList<QByteArray> WaylandWindowProperties::serialize(const QVariantMap &properties)
+{
+    QList<QByteArray> batches;
+    QByteArray batch;
+
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        const QByteArray pair = serializePair(it.key(), it.value());
+        if (pair.isEmpty())
+            continue;
+
+        if (!batch.isEmpty() && ((batch.size() + pair.size()) > MaximumBatchSize)) {
+            batches << batch;
+            batch.clear();
+        }
+        batch.append(pair);
+    }
+    if (!batch.isEmpty())
+        batches << batch;
+    return batches;
+}
+
+QVariantMap WaylandWindowProperties::deserialize(const QByteArray &data)
+{
+    QDataStream ds(data);
+    QVariantMap map;
+
+    while (!ds.atEnd()) {
+        QString name;
+        QVariant value;
+        ds >> name >> value;
+        if (ds.status() != QDataStream::Ok)
+            break;
+        map.insert(name, value);
+    }
+    return map;
+}
+
+QList<std::pair<QString, QByteArray>> WaylandWindowProperties::serializeSingle(const QVariantMap &properties)
+{
+    QList<std::pair<QString, QByteArray>> messages;
+    messages.reserve(properties.size());
+
+    for (auto it = properties.cbegin(); it != properties.cend(); ++it) {
+        if (serializePair(it.key(), it.value()).isEmpty())
+            continue;
+
+        QByteArray byteValue;
+        QDataStream ds(&byteValue, QDataStream::WriteOnly);
+        ds << it.value();
+        messages.append({ it.key(), byteValue });
+    }
+    return messages;
+}
+
+QVariant WaylandWindowProperties::deserializeSingle(const QByteArray &value)
+{
+    QDataStream ds(value);
+    QVariant variantValue;
+    ds >> variantValue;
+    return variantValue;
+}
+
+QT_END_NAMESPACE_AM
@@ -0,0 +1,37 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <utility>
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QVariantMap>
+#include <QtAppManCommon/global.h>
+
+
+QT_BEGIN_NAMESPACE_AM
+
+// The wire format of window properties in the qtam Wayland extension, shared by the client
+// (application) and the server (System UI) side. Version 2 of the extension sends batches of
+// QDataStream serialized name/value pairs, while version 1 can only send a single property per
+// message.
+
+class WaylandWindowProperties
+{
+public:
+    // Wayland messages are limited to 4KB, so bigger batches are split up
+    static constexpr qsizetype MaximumBatchSize = 3072;
+    // pending changes are sent after one frame interval at the latest, even if nothing is rendered
+    static constexpr int MaximumCoalescingDelay = 16;
+
+    // version 2: properties that do not fit into a single message are dropped with a warning
+    static QList<QByteArray> serialize(const QVariantMap &properties);
+    static QVariantMap deserialize(const QByteArray &data);
+
+    // version 1: one (name, serialized value) pair per message
+    static QList<std::pair<QString, QByteArray>> serializeSingle(const QVariantMap &properties);
+    static QVariant deserializeSingle(const QByteArray &value);
+};
+
+QT_END_NAMESPACE_AM
@@ -47,6 +47,10 @@ void PSConfiguration::parse(const QStringList &args)
         { { u"sp"_s /*, u"store-sign-password"_s*/ },
          u"The password for the store signing certificate"_s, u"password"_s
         },
+        { { u"cs"_s /*, u"signed-package-cache-size"_s*/ },
+         u"The maximum size of the store-signed package cache in MiB. (default: "_s
+                + QString::number(DefaultSignedPackageCacheSize / 1024 / 1024) + u')', u"size"_s
+        },
         { { u"dc"_s /*, u"developer-verification-ca-certificate"_s*/ },
          u"The CA certificate files to verify developer signatures on upload."_s, u"files..."_s
         },
@@ -109,6 +113,13 @@ void PSConfiguration::parse(const QStringList &args)
                 { "storeSignPassword", false, YamlParser::Scalar, [this](YamlParser *p) {
                      storeSignPassword = p->parseString();
                  } },
+                { "signedPackageCacheSize", false, YamlParser::Scalar, [this](YamlParser *p) {
+                     bool ok = false;
+                     const qint64 size = p->parseScalar().toLongLong(&ok);
+                     if (!ok || (size < 0))
+                         throw YamlParserException(p, "the signedPackageCacheSize field needs to be a positive number");
+                     signedPackageCacheSize = size * 1024 * 1024;
+                 } },
                 { "developerVerificationCaCertificates", false, YamlParser::Scalar | YamlParser::List, [this](YamlParser *p) {
                      developerVerificationCaCertificateFiles = p->parseStringOrStringList();
                  } },
@@ -132,6 +143,13 @@ void PSConfiguration::parse(const QStringList &args)
         storeSignCertificateFile = clp.value(u"sc"_s);
     if (clp.isSet(u"sp"_s))
         storeSignPassword = clp.value(u"sp"_s);
+    if (clp.isSet(u"cs"_s)) {
+        bool ok = false;
+        const qint64 size = clp.value(u"cs"_s).toLongLong(&ok);
+        if (!ok || (size < 0))
+            throw Exception("the option --cs needs to be a positive number");
+        signedPackageCacheSize = size * 1024 * 1024;
+    }
     if (clp.isSet(u"dc"_s))
         developerVerificationCaCertificateFiles = clp.values(u"dc"_s);
 
@@ -177,6 +195,8 @@ void PSConfiguration::parse(const QStringList &args)
             config.insert(u"storeSignCertificate"_s, storeSignCertificateFile);
         if (!storeSignPassword.isEmpty())
             config.insert(u"storeSignPassword"_s, storeSignPassword);
+        if (signedPackageCacheSize != DefaultSignedPackageCacheSize)
+            config.insert(u"signedPackageCacheSize"_s, signedPackageCacheSize / 1024 / 1024);
         if (!developerVerificationCaCertificateFiles.isEmpty())
             config.insert(u"developerVerificationCaCertificates"_s, developerVerificationCaCertificateFiles);
 
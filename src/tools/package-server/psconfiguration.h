@@ -23,10 +23,12 @@ public:
     QString storeSignPassword;
     QByteArray storeSignCertificate;
     QByteArrayList developerVerificationCaCertificates;
+    qint64 signedPackageCacheSize = DefaultSignedPackageCacheSize; // in bytes
 
     static const QString DefaultListenAddress;
     static const QString DefaultConfigFile;
     static const QString DefaultProjectId;
+    static constexpr qint64 DefaultSignedPackageCacheSize = 1024 * 1024 * 1024;
 
 public:
     void parse(const QStringList &args);
@@ -1,13 +1,16 @@
 // Copyright (C) 2023 The Qt Company Ltd.
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
 
+#include <algorithm>
 #include <cstdio>
+#include <memory>
 
 #include <QHttpServer>
+#include <QHttpServerResponder>
 #include <QJsonArray>
 #include <QJsonObject>
 #include <QTemporaryFile>
-#include <QBuffer>
+#include <QFile>
 #include <QtAppManCommon/exception.h>
 
 #include "psconfiguration.h"
@@ -30,6 +33,146 @@ static QJsonObject asJson(const QMap<QString, QString> &map)
 }
 
 
+// A read-only view of a byte range of a file. The HTTP server streams this device to the client in
+// chunks, so that packages never have to be loaded into memory completely.
+class FileRange : public QIODevice
+{
+public:
+    explicit FileRange(const QString &filePath)
+        : m_file(filePath)
+    { }
+
+    bool openFile() { return m_file.open(QIODevice::ReadOnly); }
+    qint64 fileSize() const { return m_file.size(); }
+
+    // restricts the device to [offset, offset + length) and opens it for reading
+    bool openRange(qint64 offset, qint64 length)
+    {
+        m_offset = offset;
+        m_length = length;
+        return m_file.seek(offset) && QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    qint64 size() const override { return m_length; }
+    bool seek(qint64 pos) override { return QIODevice::seek(pos) && m_file.seek(m_offset + pos); }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override
+    {
+        return m_file.read(data, qMin(maxSize, m_length - pos()));
+    }
+    qint64 writeData(const char *, qint64) override { return -1; }
+
+private:
+    QFile m_file;
+    qint64 m_offset = 0;
+    qint64 m_length = 0;
+};
+
+
+static bool matchesETag(const QByteArray &header, const QByteArray &etag)
+{
+    const QByteArrayList tags = header.split(',');
+    for (QByteArray tag : tags) {
+        tag = tag.trimmed();
+        if (tag.startsWith("W/"))
+            tag = tag.mid(2);
+        if ((tag == "*") || (tag == etag))
+            return true;
+    }
+    return false;
+}
+
+// Streams the package file from disk, honoring If-None-Match, Range and If-Range headers, so that
+// clients can revalidate their cached copies and resume interrupted downloads. Only single ranges
+// are supported, as this is all that download clients ever need.
+// The file is opened before the response is started: packages (or cached store-signed variants)
+// being replaced or removed while the download is running do not affect the transfer.
+static void sendPackage(const QHttpServerRequest &req, QHttpServerResponder &responder,
+                        const QString &filePath, const QByteArray &etag)
+{
+    const QByteArray ifNoneMatch = req.value("If-None-Match").trimmed();
+    if (!ifNoneMatch.isEmpty() && matchesETag(ifNoneMatch, etag)) {
+        responder.write({ { "ETag", etag } }, QHttpServerResponder::StatusCode::NotModified);
+        return;
+    }
+
+    auto file = std::make_unique<FileRange>(filePath);
+    if (!file->openFile()) {
+        responder.write(QHttpServerResponder::StatusCode::NotFound);
+        return;
+    }
+
+    const QByteArray range = req.value("Range").trimmed();
+    const QByteArray ifRange = req.value("If-Range").trimmed();
+    const qint64 size = file->fileSize();
+
+    qint64 first = 0;
+    qint64 last = size - 1;
+    bool partial = range.startsWith("bytes=") && !range.contains(',')
+            && (ifRange.isEmpty() || (ifRange == etag));
+
+    // QByteArray::toLongLong() would also accept signs and surrounding whitespace
+    auto parsePosition = [](const QByteArray &str, bool *ok) -> qint64 {
+        *ok = !str.isEmpty() && std::all_of(str.cbegin(), str.cend(), [](char c) {
+            return (c >= '0') && (c <= '9');
+        });
+        return *ok ? str.toLongLong(ok) : -1;
+    };
+
+    if (partial) {
+        const QByteArray spec = range.mid(6).trimmed();
+        const qsizetype dash = spec.indexOf('-');
+        bool ok = (dash >= 0);
+
+        if (ok && (dash == 0)) { // "-<n>": the last n bytes (n == 0 is valid, but unsatisfiable)
+            const qint64 suffixLength = parsePosition(spec.mid(1), &ok);
+            first = suffixLength ? qMax(qint64(0), size - suffixLength) : size;
+        } else if (ok) {
+            first = parsePosition(spec.left(dash), &ok);
+            if (ok && (dash < (spec.size() - 1))) {
+                const qint64 lastPosition = parsePosition(spec.mid(dash + 1), &ok);
+                // a range ending before it starts is syntactically invalid (RFC 9110, 14.1.1)
+                ok = ok && (lastPosition >= first);
+                last = qMin(last, lastPosition);
+            }
+        }
+        // invalid ranges are ignored, as if there was no Range header at all
+        partial = ok;
+    }
+
+    // only valid ranges that do not overlap the package at all are unsatisfiable
+    if (partial && (first >= size)) {
+        responder.write({ { "Content-Range", QByteArray("bytes */" + QByteArray::number(size)) } },
+                        QHttpServerResponder::StatusCode::RequestRangeNotSatisfiable);
+        return;
+    }
+
+    if (!file->openRange(first, last - first + 1)) {
+        responder.write(QHttpServerResponder::StatusCode::InternalServerError);
+        return;
+    }
+
+    // the Content-Length header is added by the responder, based on the size of the FileRange
+    if (partial) {
+        responder.write(file.release(), {
+                            { "Content-Type", "application/octet-stream" },
+                            { "Accept-Ranges", "bytes" },
+                            { "ETag", etag },
+                            { "Content-Range", QByteArray("bytes " + QByteArray::number(first) + '-'
+                                                          + QByteArray::number(last) + '/'
+                                                          + QByteArray::number(size)) } },
+                        QHttpServerResponder::StatusCode::PartialContent);
+    } else {
+        responder.write(file.release(), {
+                            { "Content-Type", "application/octet-stream" },
+                            { "Accept-Ranges", "bytes" },
+                            { "ETag", etag } },
+                        QHttpServerResponder::StatusCode::Ok);
+    }
+}
+
+
 PSHttpInterface::PSHttpInterface(PSConfiguration *cfg, QObject *parent)
     : QObject(parent)
     , d(new PSHttpInterfacePrivate)
@@ -130,7 +273,8 @@ void PSHttpInterface::setupRouting(PSPackages *packages)
         return QHttpServerResponse(QHttpServerResponse::StatusCode::NotFound);
     });
 
-    d->server->route(u"/package/download"_s, GetOrPost, [=](const QHttpServerRequest &req) {
+    d->server->route(u"/package/download"_s, GetOrPost, [=](const QHttpServerRequest &req,
+                                                           QHttpServerResponder &&responder) {
         const auto query = req.query();
         QString id = query.queryItemValue(u"id"_s);
         const QString architecture = query.queryItemValue(u"architecture"_s);
@@ -139,25 +283,20 @@ void PSHttpInterface::setupRouting(PSPackages *packages)
         if (auto *sp = packages->byIdAndArchitecture(id, architecture)) {
             if (!d->cfg->storeSignCertificate.isEmpty()) {
                 try {
-                    QBuffer buffer;
-                    buffer.open(QIODevice::WriteOnly);
-                    packages->storeSign(sp, hardwareId, &buffer);
-
-                    return QHttpServerResponse("application/octet-stream", buffer.data());
+                    const auto [filePath, etag] = packages->storeSigned(sp, hardwareId);
+                    sendPackage(req, responder, filePath, etag);
                 } catch (const Exception &e) {
                     colorOut() << ColorPrint::red << " x failed" << ColorPrint::reset << ": "
                                << e.errorString();
-                    return QHttpServerResponse { QHttpServerResponse::StatusCode::InternalServerError };
+                    responder.write(QHttpServerResponder::StatusCode::InternalServerError);
                 }
-
             } else {
-                QFile f(sp->filePath);
-                if (f.open(QIODevice::ReadOnly))
-                    return QHttpServerResponse("application/octet-stream", f.readAll());
+                sendPackage(req, responder, sp->filePath, '"' + sp->sha1.toHex() + '"');
             }
+            return;
         }
 
-        return QHttpServerResponse(QHttpServerResponse::StatusCode::NotFound);
+        responder.write(QHttpServerResponder::StatusCode::NotFound);
     });
 
     d->server->route(u"/package/upload"_s, QHttpServerRequest::Method::Put, [=](const QHttpServerRequest &req) {
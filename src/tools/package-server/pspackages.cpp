@@ -5,6 +5,7 @@
 #include <QFileSystemWatcher>
 #include <QDirIterator>
 #include <QTemporaryDir>
+#include <QSaveFile>
 #include <QCryptographicHash>
 #include <QMessageAuthenticationCode>
 #include <QtAppManCommon/exception.h>
@@ -30,6 +31,7 @@ static const QString UploadDir   = u"upload"_s;
 static const QString RemoveDir   = u"remove"_s;
 static const QString PackagesDir = u".packages"_s;
 static const QString LockFile    = u".lock"_s;
+static const QString SignedCacheDir = u".signed-cache"_s;
 
 
 PSPackages::PSPackages(PSConfiguration *cfg, QObject *parent)
@@ -87,6 +89,12 @@ void PSPackages::initialize()
         throw Exception("could not create an '%1' directory inside the data directory %2")
             .arg(RemoveDir).arg(dd.absolutePath());
     }
+    if (!dd.mkpath(SignedCacheDir)) {
+        throw Exception("could not create a '%1' directory inside the data directory %2")
+            .arg(SignedCacheDir).arg(dd.absolutePath());
+    }
+    // the signed packages from a previous run cannot be matched to the packages anymore
+    d->clearSignedCache();
 
     d->scanPackages();
     d->scanUploads();
@@ -146,9 +154,9 @@ PSPackage *PSPackages::scan(const QString &filePath)
     if (!pe.extract())
         throw Exception("could not extract package: %1").arg(pe.errorString());
 
-    if (!d->cfg->developerVerificationCaCertificates.isEmpty()) {
-        InstallationReport report = pe.installationReport();
+    const InstallationReport report = pe.installationReport();
 
+    if (!d->cfg->developerVerificationCaCertificates.isEmpty()) {
         // check signatures
         if (report.developerSignature().isEmpty()) {
             throw Exception("no developer signature");
@@ -164,6 +172,7 @@ PSPackage *PSPackages::scan(const QString &filePath)
     auto sp = new PSPackage;
     sp->id = pi->id();
     sp->sha1 = sha1;
+    sp->digest = report.digest();
     sp->filePath = filePath;
     sp->architecture = architecture;
     sp->packageInfo.reset(pi.release());
@@ -224,6 +233,7 @@ int PSPackages::removeIf(std::function<bool(PSPackage *)> pred)
                 colorOut() << ColorPrint::red << " - removing " << ColorPrint::bcyan << sp->id
                            << ColorPrint::reset << " [" << sp->architectureOrAll() << "]";
                 QFile::remove(sp->filePath);
+                d->removeFromSignedCache(sp);
                 delete sp;
                 ait = iit->erase(ait);
                 ++count;
@@ -270,6 +280,7 @@ std::pair<PSPackages::UploadResult, PSPackage *> PSPackages::upload(const QStrin
                 scannedSp->filePath = finalPath;
                 d->packages[id][architecture] = result.second = scannedSp.release();
                 result.first = UploadResult::Updated;
+                d->removeFromSignedCache(existingSp);
                 delete existingSp;
             }
         } else {
@@ -314,6 +325,12 @@ std::pair<PSPackages::UploadResult, PSPackage *> PSPackages::upload(const QStrin
     }
 }
 
+QByteArray PSPackages::signedCacheKey(const PSPackage *sp, const QString &hardwareId)
+{
+    return sp->digest.toHex() + '_'
+            + QCryptographicHash::hash(hardwareId.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
 void PSPackages::storeSign(PSPackage *sp, const QString &hardwareId, QIODevice *destination)
 {
     // extract to temp dir, store-sign and re-create at destination
@@ -328,17 +345,27 @@ void PSPackages::storeSign(PSPackage *sp, const QString &hardwareId, QIODevice *
 
     InstallationReport report = pe.installationReport();
 
-    QByteArray sigDigest = report.digest();
-    if (!hardwareId.isEmpty()) {
-        sigDigest = QMessageAuthenticationCode::hash(sigDigest, hardwareId.toUtf8(),
-                                                     QCryptographicHash::Sha256);
-    }
+    // A PKCS#7 signature contains the signing time, so signing the same package twice would
+    // result in two different files. Re-using the signature makes the store-signed variant
+    // reproducible (PackageCreator's output only depends on its input), which keeps its ETag
+    // stable, even if it had to be re-created in the meantime.
+    const QByteArray key = signedCacheKey(sp, hardwareId);
+    QByteArray signature = d->storeSignatures.value(key);
+
+    if (signature.isEmpty()) {
+        QByteArray sigDigest = report.digest();
+        if (!hardwareId.isEmpty()) {
+            sigDigest = QMessageAuthenticationCode::hash(sigDigest, hardwareId.toUtf8(),
+                                                         QCryptographicHash::Sha256);
+        }
 
-    Signature sig(sigDigest);
-    QByteArray signature = sig.create(d->cfg->storeSignCertificate, d->cfg->storeSignPassword.toUtf8());
+        Signature sig(sigDigest);
+        signature = sig.create(d->cfg->storeSignCertificate, d->cfg->storeSignPassword.toUtf8());
 
-    if (signature.isEmpty())
-        throw Exception("could not create store signature: %1").arg(sig.errorString());
+        if (signature.isEmpty())
+            throw Exception("could not create store signature: %1").arg(sig.errorString());
+        d->storeSignatures.insert(key, signature);
+    }
     report.setStoreSignature(signature);
 
     PackageCreator pc(tempDir.path(), destination, report);
@@ -347,9 +374,108 @@ void PSPackages::storeSign(PSPackage *sp, const QString &hardwareId, QIODevice *
 }
 
 
+// Returns the path and the ETag of the store-signed variant of the package for the given
+// hardware-id. The variant is created on first use and then kept in the signed package cache
+// until the package is updated or removed, or until the cache runs out of space.
+std::pair<QString, QByteArray> PSPackages::storeSigned(PSPackage *sp, const QString &hardwareId)
+{
+    const QByteArray key = signedCacheKey(sp, hardwareId);
+
+    auto it = d->signedCache.find(key);
+    if (it != d->signedCache.end()) {
+        if (QFile::exists(it->filePath)) {
+            it->lastUsed = ++d->signedCacheUseCounter;
+            return { it->filePath, it->etag };
+        }
+        d->signedCache.erase(it);
+    }
+
+    const QString filePath = d->cfg->dataDirectory.absoluteFilePath(SignedCacheDir) + u'/'
+                             + QString::fromLatin1(key) + u".ampkg"_s;
+
+    QSaveFile f(filePath);
+    if (!f.open(QIODevice::WriteOnly))
+        throw Exception(f, "could not create the store-signed package");
+    storeSign(sp, hardwareId, &f);
+    if (!f.commit())
+        throw Exception(f, "could not write the store-signed package");
+
+    // the variant is reproducible (see storeSign()), but the ETag is still based on the actual
+    // content, so that a client can never combine parts of two different files when resuming
+    QFile cf(filePath);
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!cf.open(QIODevice::ReadOnly) || !hash.addData(&cf))
+        throw Exception(cf, "could not read the store-signed package");
+
+    PSSignedPackage &spp = d->signedCache[key];
+    spp.filePath = filePath;
+    spp.etag = '"' + hash.result().toHex() + '"';
+    spp.size = cf.size();
+    spp.lastUsed = ++d->signedCacheUseCounter;
+
+    const auto result = std::make_pair(spp.filePath, spp.etag);
+    d->pruneSignedCache(key);
+    return result;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+void PSPackagesPrivate::clearSignedCache()
+{
+    signedCache.clear();
+    storeSignatures.clear();
+
+    QDirIterator dit(cfg->dataDirectory.absoluteFilePath(SignedCacheDir), QDir::Files | QDir::Hidden);
+    while (dit.hasNext())
+        QFile::remove(dit.next());
+}
+
+void PSPackagesPrivate::removeFromSignedCache(const PSPackage *sp)
+{
+    const QByteArray prefix = sp->digest.toHex() + '_';
+
+    for (auto it = storeSignatures.begin(); it != storeSignatures.end(); ) {
+        if (it.key().startsWith(prefix))
+            it = storeSignatures.erase(it);
+        else
+            ++it;
+    }
+
+    for (auto it = signedCache.begin(); it != signedCache.end(); ) {
+        if (it.key().startsWith(prefix)) {
+            // downloads that are still in progress keep their open file handle
+            QFile::remove(it->filePath);
+            it = signedCache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void PSPackagesPrivate::pruneSignedCache(const QByteArray &keepKey)
+{
+    qint64 cacheSize = 0;
+    for (const auto &spp : std::as_const(signedCache))
+        cacheSize += spp.size;
+
+    // evict the least recently used variants, but never the one that was just requested
+    while (cacheSize > cfg->signedPackageCacheSize) {
+        auto lru = signedCache.end();
+        for (auto it = signedCache.begin(); it != signedCache.end(); ++it) {
+            if ((it.key() != keepKey) && ((lru == signedCache.end()) || (it->lastUsed < lru->lastUsed)))
+                lru = it;
+        }
+        if (lru == signedCache.end())
+            break;
+
+        QFile::remove(lru->filePath);
+        cacheSize -= lru->size;
+        signedCache.erase(lru);
+    }
+}
+
 void PSPackagesPrivate::scanRemoves()
 {
     int fileCount = 0;
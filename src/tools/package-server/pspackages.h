@@ -20,6 +20,7 @@ public:
     QString filePath;
     QString architecture;
     QByteArray sha1;
+    QByteArray digest; // the package digest, independent of any store signature
     std::unique_ptr<QT_PREPEND_NAMESPACE_AM(PackageInfo)> packageInfo;
 
     QString architectureOrAll() const;
@@ -50,6 +51,8 @@ public:
 
     std::pair<UploadResult, PSPackage *> upload(const QString &filePath);
     void storeSign(PSPackage *sp, const QString &hardwareId, QIODevice *destination);
+    std::pair<QString, QByteArray> storeSigned(PSPackage *sp, const QString &hardwareId);
+    static QByteArray signedCacheKey(const PSPackage *sp, const QString &hardwareId);
     int removeIf(std::function<bool (PSPackage *)> pred);
 
 private:
@@ -5,6 +5,7 @@
 
 #include <memory>
 #include <QMap>
+#include <QHash>
 #include <QLockFile>
 #include "psconfiguration.h"
 
@@ -13,16 +14,32 @@ class PSPackages;
 class PSPackage;
 
 
+class PSSignedPackage
+{
+public:
+    QString filePath;
+    QByteArray etag;
+    qint64 size = 0;
+    quint64 lastUsed = 0;
+};
+
+
 class PSPackagesPrivate
 {
 public:
     void scanPackages();
     void scanUploads();
     void scanRemoves();
+    void clearSignedCache();
+    void removeFromSignedCache(const PSPackage *sp);
+    void pruneSignedCache(const QByteArray &keepKey);
 
     PSPackages *q = nullptr;
     PSConfiguration *cfg = nullptr;
     QMap<QString, QMap<QString, PSPackage *>> packages; // by-id, by-architecture
     std::unique_ptr<QLockFile> lockFile;
     QByteArray lockFilePath; // for the signal handler
+    QHash<QByteArray, PSSignedPackage> signedCache; // by-digest_hardware-id-hash
+    QHash<QByteArray, QByteArray> storeSignatures; // by-digest_hardware-id-hash, never pruned
+    quint64 signedCacheUseCounter = 0;
 };
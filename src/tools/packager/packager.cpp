@@ -26,6 +26,7 @@ QT_USE_NAMESPACE_AM
 enum Command {
     NoCommand,
     CreatePackage,
+    CreateDeltaPackage,
     DevSignPackage,
     DevVerifyPackage,
     StoreSignPackage,
@@ -40,6 +41,7 @@ static struct {
     const char *description;
 } commandTable[] = {
     { CreatePackage,      "create-package",       "Create a new package." },
+    { CreateDeltaPackage, "create-delta-package", "Create a delta package to update between two packages." },
     { DevSignPackage,     "dev-sign-package",     "Add developer signature to package." },
     { DevVerifyPackage,   "dev-verify-package",   "Verify developer signature on package." },
     { StoreSignPackage,   "store-sign-package",   "Add store signature to package." },
@@ -132,6 +134,9 @@ int main(int argc, char *argv[])
         case CreatePackage: {
             clp.addOption({ qSL("verbose"), qSL("Dump the package's meta-data header and footer information to stdout.") });
             clp.addOption({ qSL("json"),    qSL("Output in JSON format instead of YAML.") });
+            clp.addOption({ qSL("compression"), qSL("The compression algorithm: gzip (default), xz, zstd or none."), qSL("algorithm"), qSL("gzip") });
+            clp.addOption({ qSL("compression-level"), qSL("The compression level (default: the algorithm's default)."), qSL("level") });
+            clp.addOption({{ qSL("compression-threads"), qSL("j") }, qSL("Compress using this many threads (0: one per CPU core)."), qSL("count"), qSL("1") });
             clp.addOption({{ qSL("extra-metadata"),      qSL("m") }, qSL("Add extra meta-data to the package, supplied on the command line."), qSL("yaml-snippet") });
             clp.addOption({{ qSL("extra-metadata-file"), qSL("M") }, qSL("Add extra meta-data to the package, read from file."), qSL("yaml-file") });
             clp.addOption({{ qSL("extra-signed-metadata"),      qSL("s") }, qSL("Add extra, digitally signed, meta-data to the package, supplied on the command line."), qSL("yaml-snippet") });
@@ -143,6 +148,29 @@ int main(int argc, char *argv[])
             if (clp.positionalArguments().size() != 3)
                 clp.showHelp(1);
 
+            bool compressionOk = false;
+            const auto compression = PackageUtilities::compressionFromName(clp.value(qSL("compression")),
+                                                                           &compressionOk);
+            if (!compressionOk)
+                throw Exception("Unknown compression algorithm: %1").arg(clp.value(qSL("compression")));
+            int compressionLevel = -1;
+            if (clp.isSet(qSL("compression-level"))) {
+                const auto levelRange = PackageUtilities::compressionLevelRange(compression);
+                bool levelOk = false;
+                compressionLevel = clp.value(qSL("compression-level")).toInt(&levelOk);
+                if (!levelOk || (compressionLevel < levelRange.first) || (compressionLevel > levelRange.second)) {
+                    throw Exception("Invalid compression level for %1: %2 (valid levels are %3 to %4)")
+                            .arg(clp.value(qSL("compression"))).arg(clp.value(qSL("compression-level")))
+                            .arg(levelRange.first).arg(levelRange.second);
+                }
+            }
+            bool threadsOk = false;
+            const int compressionThreadCount = clp.value(qSL("compression-threads")).toInt(&threadsOk);
+            if (!threadsOk || (compressionThreadCount < 0))
+                throw Exception("Invalid number of compression threads: %1").arg(clp.value(qSL("compression-threads")));
+            if (!PackageUtilities::isCompressionSupported(compression))
+                throw Exception("Compression algorithm %1 is not supported on this system").arg(clp.value(qSL("compression")));
+
             auto parseYamlMetada = [](const QStringList &metadataSnippets, const QStringList &metadataFiles, bool isSigned) -> QVariantMap {
                 QVariantMap result;
                 QVector<QPair<QByteArray, QString>> metadata;
@@ -188,9 +216,28 @@ int main(int argc, char *argv[])
                                          clp.positionalArguments().at(2),
                                          extraMetaDataMap,
                                          extraSignedMetaDataMap,
+                                         compression, compressionLevel,
+                                         compressionThreadCount,
                                          clp.isSet(qSL("json"))));
             break;
         }
+        case CreateDeltaPackage:
+            clp.addOption({ qSL("verbose"), qSL("Dump the package's meta-data header and footer information to stdout.") });
+            clp.addOption({ qSL("json"),    qSL("Output in JSON format instead of YAML.") });
+            clp.addPositionalArgument(qSL("old-package"),   qSL("File name of the currently installed package (input)."));
+            clp.addPositionalArgument(qSL("new-package"),   qSL("File name of the updated package (input)."));
+            clp.addPositionalArgument(qSL("delta-package"), qSL("File name of the delta package (output)."));
+            clp.process(a);
+
+            if (clp.positionalArguments().size() != 4)
+                clp.showHelp(1);
+
+            p.reset(PackagingJob::createDelta(clp.positionalArguments().at(1),
+                                              clp.positionalArguments().at(2),
+                                              clp.positionalArguments().at(3),
+                                              clp.isSet(qSL("json"))));
+            break;
+
         case DevSignPackage:
             clp.addOption({ qSL("verbose"), qSL("Dump the package's meta-data header and footer information to stdout.") });
             clp.addOption({ qSL("json"),    qSL("Output in JSON format instead of YAML.") });
@@ -36,7 +36,9 @@ static const int Ext2BlockSize = 1024;
 
 PackagingJob *PackagingJob::create(const QString &destinationName, const QString &sourceDir,
                                    const QVariantMap &extraMetaData,
-                                   const QVariantMap &extraSignedMetaData, bool asJson)
+                                   const QVariantMap &extraSignedMetaData,
+                                   PackageCompression compression, int compressionLevel,
+                                   int compressionThreadCount, bool asJson)
 {
     PackagingJob *p = new PackagingJob();
     p->m_mode = Create;
@@ -45,6 +47,21 @@ PackagingJob *PackagingJob::create(const QString &destinationName, const QString
     p->m_sourceDir = sourceDir;
     p->m_extraMetaData = extraMetaData;
     p->m_extraSignedMetaData = extraSignedMetaData;
+    p->m_compression = compression;
+    p->m_compressionLevel = compressionLevel;
+    p->m_compressionThreadCount = compressionThreadCount;
+    return p;
+}
+
+PackagingJob *PackagingJob::createDelta(const QString &baseName, const QString &sourceName,
+                                        const QString &destinationName, bool asJson)
+{
+    PackagingJob *p = new PackagingJob();
+    p->m_mode = CreateDelta;
+    p->m_asJson = asJson;
+    p->m_baseName = baseName;
+    p->m_sourceName = sourceName;
+    p->m_destinationName = destinationName;
     return p;
 }
 
@@ -226,6 +243,8 @@ void PackagingJob::execute() Q_DECL_NOEXCEPT_EXPR(false)
 
         // finally create the package
         PackageCreator creator(source, &destination, report);
+        creator.setCompression(m_compression, m_compressionLevel);
+        creator.setCompressionThreadCount(m_compressionThreadCount);
         if (!creator.create())
             throw Exception(Error::Package, "could not create package %1: %2").arg(package->id()).arg(creator.errorString());
         destination.commit();
@@ -235,6 +254,56 @@ void PackagingJob::execute() Q_DECL_NOEXCEPT_EXPR(false)
                                               : QtYaml::yamlFromVariantDocuments({ md }));
         break;
     }
+    case CreateDelta: {
+        if (m_destinationName.isEmpty())
+            throw Exception(Error::Package, "no destination package name given");
+
+        for (const QString &name : { m_baseName, m_sourceName }) {
+            if (!QFile::exists(name))
+                throw Exception(Error::Package, "package file %1 does not exist").arg(name);
+        }
+
+        // both packages need to be extracted: the delta is calculated between the file trees
+        QTemporaryDir baseTmp;
+        QTemporaryDir sourceTmp;
+        if (!baseTmp.isValid() || !sourceTmp.isValid())
+            throw Exception(Error::Package, "could not create temporary directories");
+
+        PackageExtractor baseExtractor(QUrl::fromLocalFile(m_baseName), baseTmp.path());
+        if (!baseExtractor.extract())
+            throw Exception(Error::Package, "could not extract package %1: %2").arg(m_baseName).arg(baseExtractor.errorString());
+        PackageExtractor extractor(QUrl::fromLocalFile(m_sourceName), sourceTmp.path());
+        if (!extractor.extract())
+            throw Exception(Error::Package, "could not extract package %1: %2").arg(m_sourceName).arg(extractor.errorString());
+
+        const InstallationReport &baseReport = baseExtractor.installationReport();
+        const InstallationReport &report = extractor.installationReport();
+
+        if (baseReport.packageId() != report.packageId()) {
+            throw Exception(Error::Package, "the packages %1 and %2 have different ids (%3 and %4)")
+                    .arg(m_baseName).arg(m_sourceName).arg(baseReport.packageId()).arg(report.packageId());
+        }
+
+        QFileInfo(m_destinationName).absoluteDir().mkpath(qSL("."));
+
+        QSaveFile destination(m_destinationName);
+        if (!destination.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            throw Exception(destination, "could not create package file");
+
+        // the report contains the digest and the signatures of the new package: the creator
+        // makes sure that the delta package reproduces exactly this digest
+        PackageCreator creator(sourceTmp.path(), &destination, report);
+        creator.setCompression(extractor.compression());
+        creator.setDeltaBase(baseTmp.path(), baseReport);
+        if (!creator.create())
+            throw Exception(Error::Package, "could not create delta package %1: %2").arg(m_destinationName).arg(creator.errorString());
+        destination.commit();
+
+        QVariantMap md = creator.metaData();
+        m_output = QString::fromUtf8(m_asJson ? QJsonDocument::fromVariant(md).toJson()
+                                              : QtYaml::yamlFromVariantDocuments({ md }));
+        break;
+    }
     case DeveloperSign:
     case DeveloperVerify:
     case StoreSign:
@@ -309,6 +378,7 @@ void PackagingJob::execute() Q_DECL_NOEXCEPT_EXPR(false)
             throw Exception(destination, "could not create package file");
 
         PackageCreator creator(tmp.path(), &destination, report);
+        creator.setCompression(extractor.compression());
 
         if (certificates.size() != 1)
             throw Exception(Error::Package, "cannot sign packages with more than one certificate");
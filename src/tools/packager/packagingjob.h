@@ -6,6 +6,7 @@
 #pragma once
 
 #include <QtAppManCommon/global.h>
+#include <QtAppManPackage/packageutilities.h>
 #include <QByteArray>
 #include <QString>
 #include <QStringList>
@@ -17,8 +18,13 @@ public:
     static PackagingJob *create(const QString &destinationName, const QString &sourceDir,
                                 const QVariantMap &extraMetaData = QVariantMap(),
                                 const QVariantMap &extraSignedMetaData = QVariantMap(),
+                                PackageCompression compression = PackageCompression::Gzip,
+                                int compressionLevel = -1, int compressionThreadCount = 1,
                                 bool asJson = false);
 
+    static PackagingJob *createDelta(const QString &baseName, const QString &sourceName,
+                                     const QString &destinationName, bool asJson = false);
+
     static PackagingJob *developerSign(const QString &sourceName, const QString &destinationName,
                                        const QString &certificateFile, const QString &passPhrase,
                                        bool asJson = false);
@@ -40,6 +46,7 @@ private:
 
     enum Mode {
         Create,
+        CreateDelta,
         DeveloperSign,
         DeveloperVerify,
         StoreSign,
@@ -51,6 +58,7 @@ private:
     int m_resultCode = 0;
     bool m_asJson = false;
 
+    QString m_baseName; // delta only
     QString m_sourceName;
     QString m_destinationName; // create and signing only
     QString m_sourceDir; // create only
@@ -59,4 +67,7 @@ private:
     QString m_hardwareId; // store sign/verify only
     QVariantMap m_extraMetaData;
     QVariantMap m_extraSignedMetaData;
+    PackageCompression m_compression = PackageCompression::Gzip; // create only
+    int m_compressionLevel = -1; // create only
+    int m_compressionThreadCount = 1; // create only
 };
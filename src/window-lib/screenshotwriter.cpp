@@ -0,0 +1,304 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#include <QFile>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QtEndian>
+
+#include "screenshotwriter.h"
+
+
+QT_BEGIN_NAMESPACE_AM
+
+namespace {
+
+// QImageWriter maps the quality to zlib's compression levels: 80 results in the fastest one
+static constexpr int FastPngQuality = 80;
+
+// Reads pixels directly from the formats that a window grab or a back-buffer readback produce,
+// instead of converting the whole image first.
+class PixelReader
+{
+public:
+    explicit PixelReader(const QImage &image)
+    {
+        switch (image.format()) {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+            m_image = image;
+            break;
+        case QImage::Format_ARGB32_Premultiplied:
+            m_image = image;
+            m_premultiplied = true;
+            break;
+        case QImage::Format_RGBX8888:
+        case QImage::Format_RGBA8888:
+            m_image = image;
+            m_rgbaByteOrder = true;
+            break;
+        case QImage::Format_RGBA8888_Premultiplied:
+            m_image = image;
+            m_rgbaByteOrder = true;
+            m_premultiplied = true;
+            break;
+        default:
+            m_image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+            m_premultiplied = true;
+            break;
+        }
+    }
+
+    int width() const { return m_image.width(); }
+    int height() const { return m_image.height(); }
+    bool isPremultiplied() const { return m_premultiplied; }
+
+    const uchar *scanLine(int y, bool flipped) const
+    {
+        return m_image.constScanLine(flipped ? m_image.height() - 1 - y : y);
+    }
+
+    QRgb pixel(const uchar *line, int x) const
+    {
+        if (m_rgbaByteOrder) {
+            const uchar *p = line + 4 * x;
+            return qRgba(p[0], p[1], p[2], p[3]);
+        }
+        return reinterpret_cast<const QRgb *>(line)[x];
+    }
+
+private:
+    QImage m_image;
+    bool m_premultiplied = false;
+    bool m_rgbaByteOrder = false;
+};
+
+// A small, fixed-size write buffer, so the encoders can stream byte by byte
+class BufferedFile
+{
+public:
+    explicit BufferedFile(const QString &fileName)
+        : m_file(fileName)
+    { }
+
+    bool open()
+    {
+        return m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered);
+    }
+
+    inline void put(uchar c)
+    {
+        if (m_size == sizeof(m_buffer))
+            flush();
+        m_buffer[m_size++] = char(c);
+    }
+
+    void put(const char *data, qsizetype size)
+    {
+        while (size--)
+            put(uchar(*data++));
+    }
+
+    bool close()
+    {
+        flush();
+        m_file.close();
+        return !m_failed;
+    }
+
+    QString errorString() const
+    {
+        return m_file.errorString();
+    }
+
+private:
+    void flush()
+    {
+        if (m_size && !m_failed && (m_file.write(m_buffer, m_size) != m_size))
+            m_failed = true;
+        m_size = 0;
+    }
+
+    QFile m_file;
+    char m_buffer[64 * 1024];
+    qsizetype m_size = 0;
+    bool m_failed = false;
+};
+
+} // anonymous namespace
+
+
+ScreenshotWriter::Format ScreenshotWriter::formatForFileName(const QString &fileName)
+{
+    const QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix == qL1S("ppm"))
+        return Ppm;
+    else if (suffix == qL1S("qoi"))
+        return Qoi;
+    else if (suffix == qL1S("png"))
+        return Png;
+    else
+        return Other;
+}
+
+bool ScreenshotWriter::write(const QImage &image, const QString &fileName, bool flipped, QString *errorString)
+{
+    if (image.isNull()) {
+        if (errorString)
+            *errorString = qSL("could not grab an image for %1").arg(fileName);
+        return false;
+    }
+
+    switch (Format format = formatForFileName(fileName)) {
+    case Ppm:
+        return writePpm(image, fileName, flipped, errorString);
+    case Qoi:
+        return writeQoi(image, fileName, flipped, errorString);
+    default:
+        return writeWithImageWriter(image, fileName, flipped, format, errorString);
+    }
+}
+
+bool ScreenshotWriter::writePpm(const QImage &image, const QString &fileName, bool flipped, QString *errorString)
+{
+    // PPM has no alpha channel: premultiplied colors are the image composited onto black
+    PixelReader reader(image);
+    BufferedFile out(fileName);
+    if (!out.open()) {
+        if (errorString)
+            *errorString = qSL("could not open %1 for writing: %2").arg(fileName, out.errorString());
+        return false;
+    }
+
+    const QByteArray header = "P6\n" + QByteArray::number(reader.width()) + ' '
+            + QByteArray::number(reader.height()) + "\n255\n";
+    out.put(header.constData(), header.size());
+
+    for (int y = 0; y < reader.height(); ++y) {
+        const uchar *line = reader.scanLine(y, flipped);
+        for (int x = 0; x < reader.width(); ++x) {
+            const QRgb px = reader.pixel(line, x);
+            out.put(uchar(qRed(px)));
+            out.put(uchar(qGreen(px)));
+            out.put(uchar(qBlue(px)));
+        }
+    }
+    if (!out.close()) {
+        if (errorString)
+            *errorString = qSL("could not write %1: %2").arg(fileName, out.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool ScreenshotWriter::writeQoi(const QImage &image, const QString &fileName, bool flipped, QString *errorString)
+{
+    PixelReader reader(image);
+    BufferedFile out(fileName);
+    if (!out.open()) {
+        if (errorString)
+            *errorString = qSL("could not open %1 for writing: %2").arg(fileName, out.errorString());
+        return false;
+    }
+
+    char header[14] = { 'q', 'o', 'i', 'f' };
+    qToBigEndian<quint32>(quint32(reader.width()), header + 4);
+    qToBigEndian<quint32>(quint32(reader.height()), header + 8);
+    header[12] = 4; // RGBA
+    header[13] = 0; // sRGB with linear alpha
+    out.put(header, sizeof(header));
+
+    QRgb index[64] = { };
+    QRgb prev = qRgba(0, 0, 0, 255);
+    int run = 0;
+    const qint64 pixelCount = qint64(reader.width()) * reader.height();
+    qint64 pos = 0;
+
+    for (int y = 0; y < reader.height(); ++y) {
+        const uchar *line = reader.scanLine(y, flipped);
+        for (int x = 0; x < reader.width(); ++x) {
+            QRgb px = reader.pixel(line, x);
+            if (reader.isPremultiplied() && (qAlpha(px) != 255))
+                px = qUnpremultiply(px);
+            ++pos;
+
+            if (px == prev) {
+                if ((++run == 62) || (pos == pixelCount)) {
+                    out.put(uchar(0xc0 | (run - 1))); // QOI_OP_RUN
+                    run = 0;
+                }
+                continue;
+            }
+            if (run) {
+                out.put(uchar(0xc0 | (run - 1))); // QOI_OP_RUN
+                run = 0;
+            }
+
+            const int r = qRed(px);
+            const int g = qGreen(px);
+            const int b = qBlue(px);
+            const int a = qAlpha(px);
+            const int hash = (r * 3 + g * 5 + b * 7 + a * 11) % 64;
+
+            if (index[hash] == px) {
+                out.put(uchar(hash)); // QOI_OP_INDEX
+            } else {
+                index[hash] = px;
+
+                if (a == qAlpha(prev)) {
+                    const int vr = qint8(r - qRed(prev));
+                    const int vg = qint8(g - qGreen(prev));
+                    const int vb = qint8(b - qBlue(prev));
+                    const int vgr = vr - vg;
+                    const int vgb = vb - vg;
+
+                    if ((vr > -3) && (vr < 2) && (vg > -3) && (vg < 2) && (vb > -3) && (vb < 2)) {
+                        out.put(uchar(0x40 | ((vr + 2) << 4) | ((vg + 2) << 2) | (vb + 2))); // QOI_OP_DIFF
+                    } else if ((vgr > -9) && (vgr < 8) && (vg > -33) && (vg < 32) && (vgb > -9) && (vgb < 8)) {
+                        out.put(uchar(0x80 | (vg + 32))); // QOI_OP_LUMA
+                        out.put(uchar(((vgr + 8) << 4) | (vgb + 8)));
+                    } else {
+                        out.put(0xfe); // QOI_OP_RGB
+                        out.put(uchar(r));
+                        out.put(uchar(g));
+                        out.put(uchar(b));
+                    }
+                } else {
+                    out.put(0xff); // QOI_OP_RGBA
+                    out.put(uchar(r));
+                    out.put(uchar(g));
+                    out.put(uchar(b));
+                    out.put(uchar(a));
+                }
+            }
+            prev = px;
+        }
+    }
+
+    static const char padding[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+    out.put(padding, sizeof(padding));
+
+    if (!out.close()) {
+        if (errorString)
+            *errorString = qSL("could not write %1: %2").arg(fileName, out.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool ScreenshotWriter::writeWithImageWriter(const QImage &image, const QString &fileName, bool flipped,
+                                            Format format, QString *errorString)
+{
+    QImageWriter writer(fileName);
+    if (format == Png)
+        writer.setQuality(FastPngQuality);
+
+    if (!writer.write(flipped ? image.mirrored() : image)) {
+        if (errorString)
+            *errorString = qSL("could not write %1: %2").arg(fileName, writer.errorString());
+        return false;
+    }
+    return true;
+}
+
+QT_END_NAMESPACE_AM
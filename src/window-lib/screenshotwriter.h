@@ -0,0 +1,43 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only
+
+#pragma once
+
+#include <QtCore/QString>
+#include <QtGui/QImage>
+#include <QtAppManCommon/global.h>
+
+
+QT_BEGIN_NAMESPACE_AM
+
+// Encodes screenshots and writes them to disk. This is meant to be run in worker threads, so
+// WindowManager::makeScreenshot() doesn't stall the System UI's rendering.
+// The format is chosen by the file's suffix: besides everything QImageWriter supports, raw
+// binary PPM (.ppm) and QOI (.qoi, see https://qoiformat.org) can be streamed directly from the
+// image data without any intermediate buffers. PNGs are written with the fastest compression.
+
+class ScreenshotWriter
+{
+public:
+    enum Format {
+        Ppm,
+        Qoi,
+        Png,
+        Other
+    };
+
+    static Format formatForFileName(const QString &fileName);
+
+    // If flipped is set, the image's rows are stored in reverse order, as e.g. needed for
+    // back-buffer readbacks on OpenGL.
+    static bool write(const QImage &image, const QString &fileName, bool flipped = false,
+                      QString *errorString = nullptr);
+
+private:
+    static bool writePpm(const QImage &image, const QString &fileName, bool flipped, QString *errorString);
+    static bool writeQoi(const QImage &image, const QString &fileName, bool flipped, QString *errorString);
+    static bool writeWithImageWriter(const QImage &image, const QString &fileName, bool flipped,
+                                     Format format, QString *errorString);
+};
+
+QT_END_NAMESPACE_AM
@@ -5,19 +5,42 @@
 
 #include "waylandqtamserverextension_p.h"
 
-#include <QDataStream>
 #include <QtWaylandCompositor/QWaylandCompositor>
+#include <QtWaylandCompositor/QWaylandOutput>
 #include <QtWaylandCompositor/QWaylandResource>
 #include <QtWaylandCompositor/QWaylandSurface>
+#include <QtQuick/QQuickWindow>
 
 #include <QtAppManCommon/logging.h>
+#include <QtAppManSharedMain/waylandwindowproperties.h>
 
 QT_BEGIN_NAMESPACE_AM
 
 WaylandQtAMServerExtension::WaylandQtAMServerExtension(QWaylandCompositor *compositor)
     : QWaylandCompositorExtensionTemplate(compositor)
-    , QtWaylandServer::qtam_extension(compositor->display(), 1)
-{ }
+    , QtWaylandServer::qtam_extension(compositor->display(), 2)
+    , m_compositor(compositor)
+{
+    m_flushTimer.setSingleShot(true);
+    m_flushTimer.setInterval(WaylandWindowProperties::MaximumCoalescingDelay);
+    connect(&m_flushTimer, &QTimer::timeout, this, &WaylandQtAMServerExtension::flushWindowProperties);
+
+    connect(compositor, &QWaylandCompositor::defaultOutputChanged,
+            this, &WaylandQtAMServerExtension::onDefaultOutputChanged);
+    onDefaultOutputChanged();
+}
+
+void WaylandQtAMServerExtension::onDefaultOutputChanged()
+{
+    disconnect(m_frameConnection);
+
+    QWaylandOutput *output = m_compositor->defaultOutput();
+    if (auto *window = qobject_cast<QQuickWindow *>(output ? output->window() : nullptr)) {
+        // send all pending changes right before the System UI renders its next frame
+        m_frameConnection = connect(window, &QQuickWindow::afterAnimating,
+                                    this, &WaylandQtAMServerExtension::flushWindowProperties);
+    }
+}
 
 QVariantMap WaylandQtAMServerExtension::windowProperties(const QWaylandSurface *surface) const
 {
@@ -27,16 +50,51 @@ QVariantMap WaylandQtAMServerExtension::windowProperties(const QWaylandSurface *
 void WaylandQtAMServerExtension::setWindowProperty(QWaylandSurface *surface, const QString &name, const QVariant &value)
 {
     if (setWindowPropertyHelper(surface, name, value)) {
-        QByteArray byteValue;
-        QDataStream ds(&byteValue, QDataStream::WriteOnly);
-        ds << value;
+        m_pendingWindowProperties[surface].insert(name, value);
+        if (!m_flushTimer.isActive())
+            m_flushTimer.start();
+    }
+}
+
+void WaylandQtAMServerExtension::flushWindowProperties()
+{
+    if (m_pendingWindowProperties.isEmpty())
+        return;
+    m_flushTimer.stop();
+
+    for (auto it = m_pendingWindowProperties.cbegin(); it != m_pendingWindowProperties.cend(); ++it) {
+        QWaylandSurface *surface = it.key();
+        const QVariantMap &properties = it.value();
 
         Resource *target = resourceMap().value(surface->waylandClient());
-        if (target) {
-            qDebug(LogWaylandDebug) << "window property: server send" << surface << name << value;
-            send_window_property_changed(target->handle, surface->resource(), name, byteValue);
+        if (!target)
+            continue;
+
+        if (target->version() >= QTAM_EXTENSION_WINDOW_PROPERTIES_CHANGED_SINCE_VERSION) {
+            qCDebug(LogWaylandDebug) << "window properties: server send" << surface << properties;
+            const auto batches = WaylandWindowProperties::serialize(properties);
+            for (const QByteArray &batch : batches)
+                send_window_properties_changed(target->handle, surface->resource(), batch);
+        } else {
+            // version 1 clients only understand single property updates
+            qCDebug(LogWaylandDebug) << "window property: server send" << surface << properties;
+            const auto messages = WaylandWindowProperties::serializeSingle(properties);
+            for (const auto &[name, byteValue] : messages)
+                send_window_property_changed(target->handle, surface->resource(), name, byteValue);
         }
     }
+    m_pendingWindowProperties.clear();
+}
+
+void WaylandQtAMServerExtension::discardPendingWindowProperty(QWaylandSurface *surface, const QString &name)
+{
+    // the client's value wins over a change that we have not sent yet
+    auto it = m_pendingWindowProperties.find(surface);
+    if (it != m_pendingWindowProperties.end()) {
+        it.value().remove(name);
+        if (it.value().isEmpty())
+            m_pendingWindowProperties.erase(it);
+    }
 }
 
 bool WaylandQtAMServerExtension::setWindowPropertyHelper(QWaylandSurface *surface, const QString &name, const QVariant &value)
@@ -47,6 +105,7 @@ bool WaylandQtAMServerExtension::setWindowPropertyHelper(QWaylandSurface *surfac
             m_windowProperties[surface].insert(name, value);
             connect(surface, &QWaylandSurface::surfaceDestroyed, this, [this, surface]() {
                 m_windowProperties.remove(surface);
+                m_pendingWindowProperties.remove(surface);
             });
         } else {
             it.value().insert(name, value);
@@ -61,15 +120,28 @@ void WaylandQtAMServerExtension::qtam_extension_set_window_property(QtWaylandSer
 {
     Q_UNUSED(resource);
     QWaylandSurface *surface = QWaylandSurface::fromResource(surface_resource);
-    const QByteArray byteValue(static_cast<const char *>(value->data), static_cast<int>(value->size));
-    QDataStream ds(byteValue);
-    QVariant variantValue;
-    ds >> variantValue;
+    const QVariant variantValue = WaylandWindowProperties::deserializeSingle(
+                QByteArray::fromRawData(static_cast<const char *>(value->data), qsizetype(value->size)));
 
     qCDebug(LogWaylandDebug) << "window property: server receive" << surface << name << variantValue;
+    discardPendingWindowProperty(surface, name);
     setWindowPropertyHelper(surface, name, variantValue);
 }
 
+void WaylandQtAMServerExtension::qtam_extension_set_window_properties(QtWaylandServer::qtam_extension::Resource *resource, wl_resource *surface_resource, wl_array *properties)
+{
+    Q_UNUSED(resource);
+    QWaylandSurface *surface = QWaylandSurface::fromResource(surface_resource);
+    const QVariantMap map = WaylandWindowProperties::deserialize(
+                QByteArray::fromRawData(static_cast<const char *>(properties->data), qsizetype(properties->size)));
+
+    qCDebug(LogWaylandDebug) << "window properties: server receive" << surface << map;
+    for (auto it = map.cbegin(); it != map.cend(); ++it) {
+        discardPendingWindowProperty(surface, it.key());
+        setWindowPropertyHelper(surface, it.key(), it.value());
+    }
+}
+
 QT_END_NAMESPACE_AM
 
 #include "moc_waylandqtamserverextension_p.cpp"
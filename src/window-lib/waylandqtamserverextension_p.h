@@ -7,6 +7,7 @@
 
 #include <QtWaylandCompositor/QWaylandCompositorExtensionTemplate>
 #include <QtCore/QVariant>
+#include <QtCore/QTimer>
 #include "private/qwayland-server-qtam-extension.h"
 
 #include <QtAppManCommon/global.h>
@@ -43,9 +44,18 @@ signals:
 
 private:
     bool setWindowPropertyHelper(QWaylandSurface *surface, const QString &name, const QVariant &value);
+    void discardPendingWindowProperty(QWaylandSurface *surface, const QString &name);
+    void flushWindowProperties();
+    void onDefaultOutputChanged();
     void qtam_extension_set_window_property(Resource *resource, wl_resource *surface_resource, const QString &name, wl_array *value) override;
+    void qtam_extension_set_window_properties(Resource *resource, wl_resource *surface_resource, wl_array *properties) override;
 
+    QWaylandCompositor *m_compositor;
     QMap<const QWaylandSurface *, QVariantMap> m_windowProperties;
+    // changes that have not been sent to the clients yet: coalesced until the next frame
+    QMap<QWaylandSurface *, QVariantMap> m_pendingWindowProperties;
+    QTimer m_flushTimer;
+    QMetaObject::Connection m_frameConnection;
 };
 
 QT_END_NAMESPACE_AM
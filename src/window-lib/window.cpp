@@ -31,6 +31,10 @@
     surface Wayland extension. Changes from the client side are notified by the
     windowPropertyChanged() signal.
 
+    In multi-process mode, all changes made in between two frames are coalesced and sent to the
+    client in one batch, right before the System UI renders its next frame. The value returned by
+    windowProperty() is updated immediately though.
+
     See ApplicationManagerWindow for the client side API.
 
     \sa windowProperty(), windowProperties(), windowPropertyChanged()
@@ -36,6 +36,7 @@
 #include "qml-utilities.h"
 #include "qmlinprocapplicationmanagerwindowimpl.h"
 #include "systemframetimerimpl.h"
+#include "screenshotwriter.h"
 
 
 /*!
@@ -337,6 +338,35 @@ void WindowManager::setAllowUnknownUiClients(bool enable)
     d->allowUnknownUiClients = enable;
 }
 
+/*!
+    \qmlproperty bool WindowManager::reuseScreenshotBuffers
+
+    If set to \c true, full-screen screenshots made via makeScreenshot() are read back directly
+    from the compositor view's back buffer after the next frame has been rendered, re-using the
+    same buffer for every screenshot. This avoids allocating a new image for each screenshot, which
+    helps when taking screenshots at a high rate, e.g. for automated UI tests. Screenshots requested
+    while a readback is in progress share the same image.
+
+    This only works for views rendered via the Qt Quick scene graph's hardware accelerated
+    backends: for all other views, the screenshots are taken as if this property were \c false.
+
+    The default value is \c false.
+
+    \sa makeScreenshot()
+*/
+bool WindowManager::reuseScreenshotBuffers() const
+{
+    return d->reuseScreenshotBuffers;
+}
+
+void WindowManager::setReuseScreenshotBuffers(bool reuse)
+{
+    if (reuse != d->reuseScreenshotBuffers) {
+        d->reuseScreenshotBuffers = reuse;
+        emit reuseScreenshotBuffersChanged(reuse);
+    }
+}
+
 void WindowManager::updateViewSlowMode(QQuickWindow *view)
 {
     // QUnifiedTimer are thread-local. To also slow down animations running in the SG thread
@@ -377,12 +407,25 @@ WindowManager::WindowManager(QQmlEngine *qmlEngine, const QString &waylandSocket
 
     connect(AbstractRuntime::signaler(), &RuntimeSignaler::inProcessSurfaceItemReady,
             this, &WindowManager::inProcessSurfaceItemCreated);
+
+    // encoding screenshots should neither compete with the render thread nor use up all cores
+    d->screenshotPool.setMaxThreadCount(qBound(1, QThread::idealThreadCount() / 2, 4));
+    d->screenshotPool.setThreadPriority(QThread::LowPriority);
 }
 
 WindowManager::~WindowManager()
 {
     qApp->removeEventFilter(this);
 
+    // The readbacks are leaked on purpose: the render threads might still be using them
+    for (auto *readback : std::as_const(d->screenshotReadbacks)) {
+        disconnect(readback->connection);
+        QMutexLocker locker(&readback->mutex);
+        readback->pending.clear();
+        readback->inFlight.clear();
+    }
+    d->screenshotPool.waitForDone();
+
 #if defined(AM_MULTI_PROCESS)
     delete d->waylandCompositor;
 #endif
@@ -858,6 +901,17 @@ void WindowManager::waylandSurfaceMapped(WindowSurface *surface)
     \sa ApplicationManagerWindow::setWindowProperty()
 */
 
+/*!
+    \qmlsignal WindowManager::screenshotFinished(string filename, string selector, list<string> files, bool success)
+
+    This signal is emitted after all the images of a successful makeScreenshot() call with the
+    same \a filename and \a selector have been written. The \a files that could be written
+    successfully are listed in \a files, while \a success is only \c true if all of them could
+    be written.
+
+    \sa makeScreenshot()
+*/
+
 /*!
     \qmlmethod bool WindowManager::makeScreenshot(string filename, string selector)
 
@@ -904,12 +958,20 @@ void WindowManager::waylandSurfaceMapped(WindowSurface *surface)
     com.pelagicore.*[type=cluster]:1
     \endcode
 
+    The image format is chosen based on the file name's suffix: besides all the formats supported by
+    QImageWriter, the uncompressed \c .ppm and the \l{https://qoiformat.org}{QOI} (\c .qoi) formats
+    are supported. These are by far the fastest to encode and thus a good choice when taking
+    screenshots at a high rate. PNG images are written using the fastest compression level.
+
     Returns \c true on success and \c false otherwise.
 
-    \note This call will be handled asynchronously, so even a positive return value does not mean
-          that all screenshot images have been created already.
+    \note This call will be handled asynchronously: the images are encoded and written in
+          background threads, so even a positive return value does not mean that all screenshot
+          images have been created already. The screenshotFinished() signal is emitted as soon as
+          all images of this request have been written.
+
+    \sa reuseScreenshotBuffers
 */
-//TODO: either change return value to list of to-be-created filenames or add a 'finished' signal
 bool WindowManager::makeScreenshot(const QString &filename, const QString &selector)
 {
     // filename:
@@ -966,15 +1028,30 @@ bool WindowManager::makeScreenshot(const QString &filename, const QString &selec
     bool result = true;
     bool foundAtLeastOne = false;
 
+    auto request = QSharedPointer<ScreenshotRequest>::create();
+    request->filename = filename;
+    request->selector = selector;
+
     if (appId.isEmpty() && attributeName.isEmpty()) {
         // fullscreen screenshot
 
         for (int i = 0; i < d->views.count(); ++i) {
             if (screenId.isEmpty() || screenId.toInt() == i) {
-                QImage img = d->views.at(i)->grabWindow();
+                QQuickWindow *view = d->views.at(i);
+                QString saveTo = substituteFilename(QString::number(i), QString());
 
                 foundAtLeastOne = true;
-                result &= img.save(substituteFilename(QString::number(i), QString()));
+                ++request->pending;
+
+                if (d->reuseScreenshotBuffers && view->rhi()) {
+                    d->readBackView(view, [this, request, saveTo](const QImage &image, bool flipped) {
+                        d->saveScreenshot(this, request, image, flipped, saveTo);
+                    });
+                } else {
+                    QImage image = view->grabWindow();
+                    result &= !image.isNull();
+                    d->saveScreenshot(this, request, image, false, saveTo);
+                }
             }
         }
     } else {
@@ -1017,9 +1094,10 @@ bool WindowManager::makeScreenshot(const QString &filename, const QString &selec
                                 }
 
                                 QString saveTo = substituteFilename(QString::number(i), w->application()->id());
+                                ++request->pending;
                                 grabbers->append(grabber);
-                                connect(grabber.data(), &QQuickItemGrabResult::ready, this, [grabbers, grabber, saveTo]() {
-                                    grabber->saveToFile(saveTo);
+                                connect(grabber.data(), &QQuickItemGrabResult::ready, this, [this, request, grabbers, grabber, saveTo]() {
+                                    d->saveScreenshot(this, request, grabber->image(), false, saveTo);
                                     grabbers->removeOne(grabber);
                                     if (grabbers->isEmpty())
                                         delete grabbers;
@@ -1035,6 +1113,105 @@ bool WindowManager::makeScreenshot(const QString &filename, const QString &selec
     return foundAtLeastOne && result;
 }
 
+void WindowManagerPrivate::saveScreenshot(WindowManager *q, const QSharedPointer<ScreenshotRequest> &request,
+                                          const QImage &image, bool flipped, const QString &fileName)
+{
+    // this might be called from the render thread, but the request is only touched in the main thread
+    screenshotPool.start([q, request, image, flipped, fileName]() {
+        QString errorString;
+        bool saved = ScreenshotWriter::write(image, fileName, flipped, &errorString);
+        if (!saved)
+            qCWarning(LogSystem) << "Failed to create a screenshot:" << errorString;
+
+        QMetaObject::invokeMethod(q, [q, request, fileName, saved]() {
+            if (saved)
+                request->files << fileName;
+            else
+                request->success = false;
+
+            if (--request->pending == 0)
+                emit q->screenshotFinished(request->filename, request->selector, request->files, request->success);
+        }, Qt::QueuedConnection);
+    });
+}
+
+static QImage imageFromReadback(const QRhiReadbackResult &result)
+{
+    QImage::Format format;
+    switch (result.format) {
+    case QRhiTexture::RGBA8: format = QImage::Format_RGBA8888_Premultiplied; break;
+    case QRhiTexture::BGRA8: format = QImage::Format_ARGB32_Premultiplied; break;
+    default: return { };
+    }
+    const QSize size = result.pixelSize;
+    if (size.isEmpty() || (result.data.size() < qsizetype(size.width()) * size.height() * 4))
+        return { };
+
+    // the image holds on to a shallow copy of the buffer, until it has been written
+    auto *buffer = new QByteArray(result.data);
+    return QImage(reinterpret_cast<const uchar *>(buffer->constData()), size.width(), size.height(),
+                  format, [](void *buffer) { delete static_cast<QByteArray *>(buffer); }, buffer);
+}
+
+void WindowManagerPrivate::readBackView(QQuickWindow *view, const ScreenshotReadback::Consumer &consumer)
+{
+    ScreenshotReadback *&readback = screenshotReadbacks[view];
+
+    if (!readback) {
+        readback = new ScreenshotReadback;
+        ScreenshotReadback *rb = readback;
+
+        rb->result.completed = [rb]() {
+            QVector<ScreenshotReadback::Consumer> consumers;
+            QImage image;
+            bool flipped;
+            {
+                QMutexLocker locker(&rb->mutex);
+                consumers.swap(rb->inFlight);
+                image = imageFromReadback(rb->result);
+                flipped = rb->flipped;
+            }
+            for (const auto &consumer : std::as_const(consumers))
+                consumer(image, flipped);
+        };
+
+        // we need to record the readback on the render thread, after the scene has been rendered
+        rb->connection = QObject::connect(view, &QQuickWindow::afterRendering, view, [view, rb]() {
+            QMutexLocker locker(&rb->mutex);
+
+            if (rb->inFlight.isEmpty() && !rb->pending.isEmpty()) {
+                QRhi *rhi = view->rhi();
+                QRhiSwapChain *swapChain = view->swapChain();
+                QRhiCommandBuffer *cb = swapChain ? swapChain->currentFrameCommandBuffer() : nullptr;
+
+                if (!rhi || !cb) {
+                    QVector<ScreenshotReadback::Consumer> consumers;
+                    consumers.swap(rb->pending);
+                    locker.unlock();
+                    for (const auto &consumer : std::as_const(consumers))
+                        consumer(QImage(), false);
+                    return;
+                }
+                rb->inFlight.swap(rb->pending);
+                rb->flipped = rhi->isYUpInFramebuffer();
+
+                QRhiResourceUpdateBatch *batch = rhi->nextResourceUpdateBatch();
+                batch->readBackTexture(QRhiReadbackDescription(), &rb->result); // the back buffer
+                cb->resourceUpdate(batch);
+            }
+            // Depending on the backend, readbacks might only complete when rendering one of the
+            // next frames. The same goes for requests coming in while a readback is in flight.
+            if (!rb->inFlight.isEmpty() || !rb->pending.isEmpty())
+                QMetaObject::invokeMethod(view, &QQuickWindow::update, Qt::QueuedConnection);
+        }, Qt::DirectConnection);
+    }
+
+    QMutexLocker locker(&readback->mutex);
+    readback->pending.append(consumer);
+    locker.unlock();
+    view->update();
+}
+
 int WindowManagerPrivate::findWindowBySurfaceItem(QQuickItem *quickItem) const
 {
     for (int i = 0; i < allWindows.count(); ++i) {
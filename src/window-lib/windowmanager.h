@@ -7,6 +7,7 @@
 
 #include <functional>
 #include <QtCore/QAbstractListModel>
+#include <QtCore/QStringList>
 #include <QtAppManCommon/global.h>
 
 #if defined(Q_MOC_RUN) && !defined(__attribute__) && !defined(__declspec)
@@ -59,6 +60,7 @@ class WindowManager : public QAbstractListModel
     Q_PROPERTY(bool runningOnDesktop READ isRunningOnDesktop CONSTANT FINAL)
     Q_PROPERTY(bool slowAnimations READ slowAnimations WRITE setSlowAnimations NOTIFY slowAnimationsChanged FINAL)
     Q_PROPERTY(bool allowUnknownUiClients READ allowUnknownUiClients CONSTANT FINAL)
+    Q_PROPERTY(bool reuseScreenshotBuffers READ reuseScreenshotBuffers WRITE setReuseScreenshotBuffers NOTIFY reuseScreenshotBuffersChanged FINAL)
 
 public:
     ~WindowManager() override;
@@ -73,6 +75,8 @@ public:
     void setSlowAnimations(bool slowAnimations);
     bool allowUnknownUiClients() const;
     void setAllowUnknownUiClients(bool enable);
+    bool reuseScreenshotBuffers() const;
+    void setReuseScreenshotBuffers(bool reuse);
     void enableWatchdog(bool enable);
 
     bool addWaylandSocket(QLocalServer *waylandSocket);
@@ -97,6 +101,9 @@ protected:
 signals:
     Q_SCRIPTABLE void countChanged();
     Q_SCRIPTABLE void slowAnimationsChanged(bool);
+    Q_SCRIPTABLE void screenshotFinished(const QString &filename, const QString &selector,
+                                         const QStringList &files, bool success);
+    void reuseScreenshotBuffersChanged(bool);
 
     void raiseApplicationWindow(const QString &applicationId, const QString &applicationAliasId);
 
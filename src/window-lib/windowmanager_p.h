@@ -5,9 +5,14 @@
 
 #pragma once
 
+#include <functional>
 #include <QVector>
 #include <QMap>
 #include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+#include <QImage>
+#include <rhi/qrhi.h>
 
 #include <QtAppManWindow/windowmanager.h>
 
@@ -15,11 +20,41 @@ QT_FORWARD_DECLARE_CLASS(QQmlEngine)
 
 QT_BEGIN_NAMESPACE_AM
 
+// One makeScreenshot() call, which might result in several files. Only used in the main thread.
+struct ScreenshotRequest
+{
+    QString filename;
+    QString selector;
+    QStringList files;
+    int pending = 0;
+    bool success = true;
+};
+
+// Persistent state for reading back a compositor view's back buffer via QRhi. QRhi re-uses the
+// result's buffer for the next readback, as soon as all images referencing it have been written,
+// so taking screenshots regularly doesn't allocate new multi-megabyte images every time.
+// The consumers are called on the render thread.
+struct ScreenshotReadback
+{
+    using Consumer = std::function<void(const QImage &image, bool flipped)>;
+
+    QMutex mutex;
+    QVector<Consumer> pending;  // waiting for the next frame
+    QVector<Consumer> inFlight; // waiting for the readback recorded in a previous frame
+    QRhiReadbackResult result;
+    bool flipped = false;
+    QMetaObject::Connection connection;
+};
+
 class WindowManagerPrivate
 {
 public:
     int findWindowBySurfaceItem(QQuickItem *quickItem) const;
 
+    void readBackView(QQuickWindow *view, const ScreenshotReadback::Consumer &consumer);
+    void saveScreenshot(WindowManager *q, const QSharedPointer<ScreenshotRequest> &request,
+                        const QImage &image, bool flipped, const QString &fileName);
+
 #if defined(AM_MULTI_PROCESS)
     int findWindowByWaylandSurface(QWaylandSurface *waylandSurface) const;
 
@@ -42,10 +77,14 @@ public:
     bool shuttingDown = false;
     bool slowAnimations = false;
     bool allowUnknownUiClients = false;
+    bool reuseScreenshotBuffers = false;
 
     QList<QQuickWindow *> views;
     QString waylandSocketName;
     QQmlEngine *qmlEngine;
+
+    QHash<QQuickWindow *, ScreenshotReadback *> screenshotReadbacks;
+    QThreadPool screenshotPool; // encodes and writes the screenshots
 };
 
 QT_END_NAMESPACE_AM
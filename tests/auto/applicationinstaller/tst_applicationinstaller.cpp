@@ -96,6 +96,7 @@ private slots:
 
     void parallelPackageInstallation();
     void doublePackageInstallation();
+    void concurrentPackageInstallation();
 
     void validateDnsName_data();
     void validateDnsName();
@@ -693,6 +694,48 @@ void tst_PackageManager::doublePackageInstallation()
     clearSignalSpies();
 }
 
+void tst_PackageManager::concurrentPackageInstallation()
+{
+    m_pm->setMaximumConcurrentInstallations(2);
+    QCOMPARE(m_pm->maximumConcurrentInstallations(), 2);
+
+    // two different packages are extracted in parallel and then installed one after the other
+    QString task1Id = m_pm->startPackageInstallation(QUrl::fromLocalFile(qL1S(AM_TESTDATA_DIR "packages/test-dev-signed.appkg")));
+    QString task2Id = m_pm->startPackageInstallation(QUrl::fromLocalFile(qL1S(AM_TESTDATA_DIR "packages/bigtest-dev-signed.appkg")));
+    QVERIFY(!task1Id.isEmpty());
+    QVERIFY(!task2Id.isEmpty());
+    m_pm->acknowledgePackageInstallation(task1Id);
+    m_pm->acknowledgePackageInstallation(task2Id);
+
+    QTRY_COMPARE_WITH_TIMEOUT(m_finishedSpy->size(), 2, spyTimeout);
+    QVERIFY(m_failedSpy->isEmpty());
+    QCOMPARE(QSet<QString>({ m_finishedSpy->at(0).at(0).toString(), m_finishedSpy->at(1).at(0).toString() }),
+             QSet<QString>({ task1Id, task2Id }));
+
+    clearSignalSpies();
+
+    // the same package cannot be installed twice at the same time, even if the tasks are
+    // extracting concurrently
+    task1Id = m_pm->startPackageInstallation(QUrl::fromLocalFile(qL1S(AM_TESTDATA_DIR "packages/test-update-dev-signed.appkg")));
+    task2Id = m_pm->startPackageInstallation(QUrl::fromLocalFile(qL1S(AM_TESTDATA_DIR "packages/test-dev-signed.appkg")));
+    QVERIFY(!task1Id.isEmpty());
+    QVERIFY(!task2Id.isEmpty());
+
+    // whichever task gets to the package id first wins
+    QVERIFY(m_failedSpy->wait(spyTimeout));
+    QCOMPARE(m_failedSpy->first()[2].toString(), qL1S("Cannot install the same package com.pelagicore.test multiple times in parallel"));
+    const QString failedTaskId = m_failedSpy->first()[0].toString();
+    QVERIFY((failedTaskId == task1Id) || (failedTaskId == task2Id));
+    const QString remainingTaskId = (failedTaskId == task1Id) ? task2Id : task1Id;
+
+    m_pm->acknowledgePackageInstallation(remainingTaskId);
+    QVERIFY(m_finishedSpy->wait(spyTimeout));
+    QCOMPARE(m_finishedSpy->first()[0].toString(), remainingTaskId);
+
+    clearSignalSpies();
+    m_pm->setMaximumConcurrentInstallations(1);
+}
+
 void tst_PackageManager::validateDnsName_data()
 {
     QTest::addColumn<QString>("dnsName");
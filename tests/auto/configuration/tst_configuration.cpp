@@ -111,6 +111,9 @@ void tst_Configuration::defaultConfig()
     QCOMPARE(c.managerCrashAction(), QVariantMap {});
 
     QCOMPARE(c.caCertificates(), {});
+    QCOMPARE(c.maximumConcurrentInstallations(), 1);
+    QCOMPARE(c.deduplicateInstalledFiles(), false);
+    QCOMPARE(c.asynchronousPackageRemoval(), false);
 
     QCOMPARE(c.pluginFilePaths("container"), {});
     QCOMPARE(c.pluginFilePaths("startup"), {});
@@ -240,6 +243,9 @@ void tst_Configuration::simpleConfig()
               }));
 
     QCOMPARE(c.caCertificates(), QStringList({ qSL("cert1"), qSL("cert2") }));
+    QCOMPARE(c.maximumConcurrentInstallations(), 4);
+    QCOMPARE(c.deduplicateInstalledFiles(), true);
+    QCOMPARE(c.asynchronousPackageRemoval(), true);
 
     QCOMPARE(c.pluginFilePaths("startup"), QStringList({ qSL("s1"), qSL("s2") }));
     QCOMPARE(c.pluginFilePaths("container"), QStringList({ qSL("c1"), qSL("c2") }));
@@ -389,6 +395,9 @@ void tst_Configuration::mergedConfig()
               }));
 
     QCOMPARE(c.caCertificates(), QStringList({ qSL("cert1"), qSL("cert2"), qSL("cert3") }));
+    QCOMPARE(c.maximumConcurrentInstallations(), 2);
+    QCOMPARE(c.deduplicateInstalledFiles(), true);
+    QCOMPARE(c.asynchronousPackageRemoval(), true);
 
     QCOMPARE(c.pluginFilePaths("container"), QStringList({ qSL("c1"), qSL("c2"), qSL("c3"), qSL("c4") }));
     QCOMPARE(c.pluginFilePaths("startup"), QStringList({ qSL("s1"), qSL("s2"), qSL("s3") }));
@@ -498,6 +507,9 @@ void tst_Configuration::commandLineConfig()
     QCOMPARE(c.managerCrashAction(), QVariantMap {});
 
     QCOMPARE(c.caCertificates(), {});
+    QCOMPARE(c.maximumConcurrentInstallations(), 1);
+    QCOMPARE(c.deduplicateInstalledFiles(), false);
+    QCOMPARE(c.asynchronousPackageRemoval(), false);
 
     QCOMPARE(c.pluginFilePaths("container"), {});
     QCOMPARE(c.pluginFilePaths("startup"), {});
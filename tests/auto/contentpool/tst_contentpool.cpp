@@ -0,0 +1,215 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+
+#include <sys/stat.h>
+#include <string.h>
+
+#include "contentpool.h"
+
+QT_USE_NAMESPACE_AM
+
+class tst_ContentPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_ContentPool();
+
+private slots:
+    void init();
+    void cleanup();
+
+    void smallFiles();
+    void deduplicate();
+    void executables();
+    void addTwice();
+    void collectGarbage();
+    void collectGarbageKeys();
+
+private:
+    QString createFile(const QString &name, const QByteArray &content, bool executable = false);
+    static struct ::stat fileStat(const QString &path);
+    static int linkCount(const QString &path);
+
+    QTemporaryDir *m_tmp = nullptr;
+};
+
+
+tst_ContentPool::tst_ContentPool()
+{ }
+
+void tst_ContentPool::init()
+{
+    m_tmp = new QTemporaryDir;
+    QVERIFY(m_tmp->isValid());
+}
+
+void tst_ContentPool::cleanup()
+{
+    delete m_tmp;
+    m_tmp = nullptr;
+}
+
+QString tst_ContentPool::createFile(const QString &name, const QByteArray &content, bool executable)
+{
+    const QString path = m_tmp->filePath(name);
+    QDir().mkpath(QFileInfo(path).path());
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || (f.write(content) != content.size()))
+        return { };
+    f.close();
+    if (executable)
+        f.setPermissions(f.permissions() | QFileDevice::ExeOwner);
+    return path;
+}
+
+struct ::stat tst_ContentPool::fileStat(const QString &path)
+{
+    struct ::stat st;
+    if (::lstat(path.toLocal8Bit().constData(), &st) != 0)
+        memset(&st, 0, sizeof(st));
+    return st;
+}
+
+int tst_ContentPool::linkCount(const QString &path)
+{
+    return int(fileStat(path).st_nlink);
+}
+
+void tst_ContentPool::smallFiles()
+{
+    ContentPool pool(m_tmp->path());
+    QCOMPARE(pool.path(), m_tmp->path() + qSL("/.content-pool"));
+
+    const QString file = createFile(qSL("a/small"), QByteArray(100, 'x'));
+    QVERIFY(!file.isEmpty());
+    QVERIFY(pool.add(file).isEmpty());
+    QCOMPARE(linkCount(file), 1);
+    QVERIFY(!QDir(pool.path()).exists());
+}
+
+void tst_ContentPool::deduplicate()
+{
+    ContentPool pool(m_tmp->path());
+    const QByteArray content(8192, 'a');
+    const QString key = QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex());
+    const QString entry = pool.path() + qL1C('/') + key.left(2) + qL1C('/') + key;
+
+    const QString file1 = createFile(qSL("a/file"), content);
+    const QString file2 = createFile(qSL("b/file"), content);
+    const QString other = createFile(qSL("c/file"), QByteArray(8192, 'b'));
+
+    QCOMPARE(pool.add(file1), key);
+    QCOMPARE(linkCount(entry), 2);
+    QCOMPARE(fileStat(entry).st_ino, fileStat(file1).st_ino);
+    // pooled files are shared, so they must not be writable anymore
+    QVERIFY(!(fileStat(entry).st_mode & 0222));
+
+    QCOMPARE(pool.add(file2), key);
+    QCOMPARE(linkCount(entry), 3);
+    QCOMPARE(fileStat(file2).st_ino, fileStat(entry).st_ino);
+    QVERIFY(!QFile::exists(file2 + qSL(".pooled")));
+
+    QFile f(file2);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QCOMPARE(f.readAll(), content);
+    f.close();
+
+    const QString otherKey = pool.add(other);
+    QVERIFY(!otherKey.isEmpty());
+    QVERIFY(otherKey != key);
+    QVERIFY(fileStat(other).st_ino != fileStat(entry).st_ino);
+    QCOMPARE(linkCount(entry), 3);
+}
+
+void tst_ContentPool::executables()
+{
+    ContentPool pool(m_tmp->path());
+    const QByteArray content(8192, 'e');
+
+    const QString plain = createFile(qSL("a/plain"), content);
+    const QString exe = createFile(qSL("a/exe"), content, true);
+
+    const QString plainKey = pool.add(plain);
+    const QString exeKey = pool.add(exe);
+    QVERIFY(!plainKey.isEmpty());
+    QCOMPARE(exeKey, plainKey + qSL("x"));
+
+    // all hard links share the same permissions, so the same content is pooled twice
+    QVERIFY(fileStat(plain).st_ino != fileStat(exe).st_ino);
+    QVERIFY(fileStat(exe).st_mode & S_IXUSR);
+    QVERIFY(!(fileStat(plain).st_mode & S_IXUSR));
+}
+
+void tst_ContentPool::addTwice()
+{
+    ContentPool pool(m_tmp->path());
+    const QString file = createFile(qSL("a/file"), QByteArray(8192, 't'));
+
+    const QString key = pool.add(file);
+    QVERIFY(!key.isEmpty());
+    QCOMPARE(linkCount(file), 2);
+
+    // files that are already linked to the pool (e.g. copied from the base version of a delta
+    // package) must not gain another link
+    QCOMPARE(pool.add(file), key);
+    QCOMPARE(linkCount(file), 2);
+}
+
+void tst_ContentPool::collectGarbage()
+{
+    ContentPool pool(m_tmp->path());
+    const QString used = createFile(qSL("a/used"), QByteArray(8192, 'u'));
+    const QString unused1 = createFile(qSL("a/unused1"), QByteArray(8192, '1'));
+    const QString unused2 = createFile(qSL("a/unused2"), QByteArray(8192, '2'), true);
+
+    const QString usedKey = pool.add(used);
+    const QString unusedKey1 = pool.add(unused1);
+    const QString unusedKey2 = pool.add(unused2);
+    QVERIFY(!usedKey.isEmpty());
+    QVERIFY(!unusedKey1.isEmpty());
+    QVERIFY(!unusedKey2.isEmpty());
+
+    QCOMPARE(pool.collectGarbage(), 0);
+
+    QVERIFY(QFile::remove(unused1));
+    QVERIFY(QFile::remove(unused2));
+
+    QCOMPARE(pool.collectGarbage(), 2);
+    QCOMPARE(linkCount(used), 2);
+
+    // a new copy of removed content becomes a new pool entry
+    const QString again = createFile(qSL("b/unused1"), QByteArray(8192, '1'));
+    QCOMPARE(pool.add(again), unusedKey1);
+    QCOMPARE(linkCount(again), 2);
+
+    QCOMPARE(pool.collectGarbage(), 0);
+}
+
+void tst_ContentPool::collectGarbageKeys()
+{
+    ContentPool pool(m_tmp->path());
+    const QString file1 = createFile(qSL("a/file1"), QByteArray(8192, '1'));
+    const QString file2 = createFile(qSL("a/file2"), QByteArray(8192, '2'));
+
+    const QString key1 = pool.add(file1);
+    const QString key2 = pool.add(file2);
+    QVERIFY(!key1.isEmpty());
+    QVERIFY(!key2.isEmpty());
+
+    QVERIFY(QFile::remove(file1));
+    QVERIFY(QFile::remove(file2));
+
+    // only the given entries are checked, unknown keys are ignored
+    QCOMPARE(pool.collectGarbage({ key2, qSL("0000") }), 1);
+    QCOMPARE(pool.collectGarbage({ key2 }), 0);
+    QCOMPARE(pool.collectGarbage({ key1 }), 1);
+    QCOMPARE(pool.collectGarbage(), 0);
+}
+
+QTEST_APPLESS_MAIN(tst_ContentPool)
+
+#include "tst_contentpool.moc"
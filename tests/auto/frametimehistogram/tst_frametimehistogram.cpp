@@ -0,0 +1,98 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+
+#include <thread>
+#include <vector>
+
+#include "frametimehistogram.h"
+
+QT_USE_NAMESPACE_AM
+
+class tst_FrameTimeHistogram : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void buckets();
+    void percentiles();
+    void concurrentRecording();
+};
+
+void tst_FrameTimeHistogram::buckets()
+{
+    int lastIndex = -1;
+    for (quint32 value = 0; value <= FrameTimeHistogram::MaximumValue; value += (value < 100000) ? 1 : 997) {
+        int index = FrameTimeHistogram::bucketIndex(value);
+        QVERIFY(index >= lastIndex);
+        QVERIFY(index < FrameTimeHistogram::BucketCount);
+        QVERIFY(FrameTimeHistogram::bucketLowerBound(index) <= value);
+        QVERIFY(FrameTimeHistogram::bucketUpperBound(index) >= value);
+
+        // the precision is relative to the value
+        quint32 width = FrameTimeHistogram::bucketUpperBound(index) - FrameTimeHistogram::bucketLowerBound(index);
+        QVERIFY(width <= value / FrameTimeHistogram::SubBucketCount);
+        lastIndex = index;
+    }
+    // out of range values end up in the last bucket
+    QCOMPARE(FrameTimeHistogram::bucketIndex(std::numeric_limits<quint32>::max()),
+             FrameTimeHistogram::BucketCount - 1);
+}
+
+void tst_FrameTimeHistogram::percentiles()
+{
+    FrameTimeHistogram histogram;
+    QCOMPARE(histogram.takeSnapshot().valueAtPercentile(50), 0u);
+
+    for (int i = 0; i < 90; ++i)
+        histogram.record(16667);
+    for (int i = 0; i < 9; ++i)
+        histogram.record(33333);
+    histogram.record(100000);
+
+    auto snapshot = histogram.takeSnapshot();
+    QCOMPARE(snapshot.count(), 100u);
+
+    auto verifyClose = [](quint32 value, quint32 expected) {
+        return qAbs(qint64(value) - qint64(expected)) <= qint64(expected / 32);
+    };
+    QVERIFY(verifyClose(snapshot.valueAtPercentile(0), 16667));
+    QVERIFY(verifyClose(snapshot.valueAtPercentile(50), 16667));
+    QVERIFY(verifyClose(snapshot.valueAtPercentile(90), 16667));
+    QVERIFY(verifyClose(snapshot.valueAtPercentile(95), 33333));
+    QVERIFY(verifyClose(snapshot.valueAtPercentile(99), 33333));
+    QVERIFY(verifyClose(snapshot.valueAtPercentile(100), 100000));
+
+    // taking a snapshot resets the histogram
+    QCOMPARE(histogram.takeSnapshot().count(), 0u);
+}
+
+void tst_FrameTimeHistogram::concurrentRecording()
+{
+    FrameTimeHistogram histogram;
+    const int threadCount = 4;
+    const int valuesPerThread = 100000;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t) {
+        threads.emplace_back([&histogram, t]() {
+            for (int i = 0; i < valuesPerThread; ++i)
+                histogram.record(quint32(1000 * (t + 1)));
+        });
+    }
+    quint64 count = 0;
+    while (count < quint64(threadCount * valuesPerThread / 2))
+        count += histogram.takeSnapshot().count();
+    for (auto &thread : threads)
+        thread.join();
+    count += histogram.takeSnapshot().count();
+
+    // nothing gets lost or counted twice
+    QCOMPARE(count, quint64(threadCount * valuesPerThread));
+}
+
+QTEST_APPLESS_MAIN(tst_FrameTimeHistogram)
+
+#include "tst_frametimehistogram.moc"
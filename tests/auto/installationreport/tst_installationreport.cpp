@@ -21,6 +21,7 @@ public:
 
 private slots:
     void test();
+    void dataStream();
 };
 
 tst_InstallationReport::tst_InstallationReport()
@@ -41,6 +42,8 @@ void tst_InstallationReport::test()
     ir.addFiles(files.mid(1));
     ir.setDeveloperSignature("%%dev-sig%%");
     ir.setStoreSignature("$$store-sig$$");
+    const QMap<QString, QString> pooledFiles { { qSL("more/test"), qSL("0123abcdx") } };
+    ir.setPooledFiles(pooledFiles);
 
     QVERIFY(ir.isValid());
     QCOMPARE(ir.packageId(), qSL("com.pelagicore.test"));
@@ -70,6 +73,7 @@ void tst_InstallationReport::test()
     QCOMPARE(ir2.digest().constData(), "##digest##");
     QCOMPARE(ir2.developerSignature().constData(), "%%dev-sig%%");
     QCOMPARE(ir2.storeSignature().constData(), "$$store-sig$$");
+    QCOMPARE(ir2.pooledFiles(), pooledFiles);
 
     QByteArray &yaml = buffer.buffer();
     QVERIFY(!yaml.isEmpty());
@@ -88,6 +92,46 @@ void tst_InstallationReport::test()
     }
 }
 
+void tst_InstallationReport::dataStream()
+{
+    InstallationReport ir(qSL("com.pelagicore.test"));
+    ir.addFiles({ qSL("test"), qSL("more/test") });
+    ir.setDiskSpaceUsed(42);
+    ir.setDigest("##digest##");
+    ir.setStoreSignature("$$store-sig$$");
+    ir.setExtraMetaData({ { qSL("foo"), qSL("bar") } });
+    ir.setPooledFiles({ { qSL("test"), qSL("0123abcd") } });
+    QVERIFY(ir.isValid());
+
+    QByteArray ba;
+    {
+        QDataStream ds(&ba, QIODevice::WriteOnly);
+        ir.writeToDataStream(ds);
+        QCOMPARE(ds.status(), QDataStream::Ok);
+    }
+    {
+        QDataStream ds(ba);
+        std::unique_ptr<InstallationReport> ir2(InstallationReport::readFromDataStream(ds));
+        QVERIFY(ir2);
+        QVERIFY(ir2->isValid());
+        QCOMPARE(ir2->packageId(), ir.packageId());
+        QCOMPARE(ir2->files(), ir.files());
+        QCOMPARE(ir2->pooledFiles(), ir.pooledFiles());
+        QCOMPARE(ir2->diskSpaceUsed(), ir.diskSpaceUsed());
+        QCOMPARE(ir2->digest(), ir.digest());
+        QCOMPARE(ir2->developerSignature(), ir.developerSignature());
+        QCOMPARE(ir2->storeSignature(), ir.storeSignature());
+        QCOMPARE(ir2->extraMetaData(), ir.extraMetaData());
+        QCOMPARE(ir2->extraSignedMetaData(), ir.extraSignedMetaData());
+    }
+    {
+        // truncated data
+        QDataStream ds(ba.left(ba.size() / 2));
+        std::unique_ptr<InstallationReport> ir3(InstallationReport::readFromDataStream(ds));
+        QVERIFY(!ir3);
+    }
+}
+
 QTEST_APPLESS_MAIN(tst_InstallationReport)
 
 #include "tst_installationreport.moc"
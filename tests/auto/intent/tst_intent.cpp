@@ -0,0 +1,246 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+
+#include "global.h"
+#include "intent.h"
+#include "intentserver.h"
+#include "intentserverrequest.h"
+#include "intentserversysteminterface.h"
+
+QT_USE_NAMESPACE_AM
+
+class tst_Intent : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parameterMatch_data();
+    void parameterMatch();
+    void rearmRequestTimeout();
+};
+
+// A system without any real applications: every app is "running" as soon as it is started
+class TestSystemInterface : public IntentServerSystemInterface // clazy:exclude=missing-qobject-macro
+{
+public:
+    QSet<QString> runningApps { qSL("requester") };
+    QVector<IntentServerRequest *> sentToApp;
+    struct Reply
+    {
+        bool succeeded;
+        QVariantMap result;
+    };
+    QVector<Reply> repliesFromSystem;
+
+    IpcConnection *findClientIpc(const QString &appId) override
+    {
+        // the server never dereferences this pointer
+        return runningApps.contains(appId) ? reinterpret_cast<IpcConnection *>(this) : nullptr;
+    }
+
+    void startApplication(const QString &appId) override
+    {
+        QTimer::singleShot(0, this, [this, appId]() {
+            runningApps.insert(appId);
+            emit applicationWasStarted(appId);
+        });
+    }
+
+    bool checkApplicationCapabilities(const QString &, const QStringList &) override
+    {
+        return true;
+    }
+
+    void replyFromSystem(IpcConnection *, IntentServerRequest *isr) override
+    {
+        repliesFromSystem.append({ isr->succeeded(), isr->result() });
+    }
+
+    void requestToApplication(IpcConnection *, IntentServerRequest *isr) override
+    {
+        sentToApp.append(isr);
+    }
+};
+
+QT_BEGIN_NAMESPACE_AM
+
+// Intent's constructor is private, but this class is a friend "for auto tests only"
+class TestPackageLoader
+{
+public:
+    static Intent *createIntent(const QVariantMap &parameterMatch)
+    {
+        return new Intent(qSL("intent"), qSL("package"), qSL("application"), { }, Intent::Public,
+                          parameterMatch, { }, { }, { }, { }, false);
+    }
+};
+
+QT_END_NAMESPACE_AM
+
+// This is the parameter matching, as it was done on every request before the matchers were
+// compiled at registration time. The compiled matchers have to give exactly the same results.
+static bool legacyCheckParameterMatch(const QVariantMap &parameterMatch, const QVariantMap &parameters)
+{
+    for (auto rit = parameterMatch.cbegin(); rit != parameterMatch.cend(); ++rit) {
+        const QString &paramName = rit.key();
+        auto pit = parameters.find(paramName);
+        if (pit == parameters.cend())
+            return false;
+
+        const QVariant requiredValue = rit.value();
+        const QVariant actualValue = pit.value();
+
+        switch (requiredValue.metaType().id()) {
+        case QMetaType::QString: {
+            QRegularExpression regexp(requiredValue.toString());
+            auto match = regexp.match(actualValue.toString());
+            if (!match.hasMatch())
+                return false;
+            break;
+        }
+        case QMetaType::QVariantList: {
+            bool foundMatch = false;
+            const QVariantList rvlist = requiredValue.toList();
+            for (const QVariant &rv2 : rvlist) {
+                if (actualValue.canConvert(rv2.metaType()) && actualValue == rv2) {
+                    foundMatch = true;
+                    break;
+                }
+            }
+            if (!foundMatch)
+                return false;
+            break;
+        }
+        default: {
+            if (requiredValue != actualValue)
+                return false;
+            break;
+        }
+        }
+    }
+    return true;
+}
+
+void tst_Intent::parameterMatch_data()
+{
+    QTest::addColumn<QVariantMap>("parameterMatch");
+    QTest::addColumn<QVariantMap>("parameters");
+    QTest::addColumn<bool>("matches");
+
+    const QVariantMap regexp { { qSL("mimeType"), qSL("^image/.*\\.(png|jpg)$") } };
+    QTest::newRow("regexp-match") << regexp << QVariantMap { { qSL("mimeType"), qSL("image/a.png") } } << true;
+    QTest::newRow("regexp-mismatch") << regexp << QVariantMap { { qSL("mimeType"), qSL("image/a.gif") } } << false;
+    QTest::newRow("regexp-missing") << regexp << QVariantMap { { qSL("other"), qSL("image/a.png") } } << false;
+    QTest::newRow("regexp-extra") << regexp << QVariantMap { { qSL("mimeType"), qSL("image/a.jpg") },
+                                                             { qSL("other"), 1 } } << true;
+
+    const QVariantMap unanchored { { qSL("text"), qSL("foo") } };
+    QTest::newRow("unanchored-match") << unanchored << QVariantMap { { qSL("text"), qSL("xfoox") } } << true;
+    QTest::newRow("unanchored-int") << QVariantMap { { qSL("number"), qSL("^4") } }
+                                    << QVariantMap { { qSL("number"), 42 } } << true;
+    QTest::newRow("empty-regexp") << QVariantMap { { qSL("any"), QString() } }
+                                  << QVariantMap { { qSL("any"), qSL("whatever") } } << true;
+    QTest::newRow("invalid-regexp") << QVariantMap { { qSL("broken"), qSL("(unclosed") } }
+                                    << QVariantMap { { qSL("broken"), qSL("(unclosed") } } << false;
+
+    const QVariantList mixedList { qSL("one"), qSL("two"), 3, 4.5, true };
+    const QVariantMap list { { qSL("value"), mixedList } };
+    QTest::newRow("list-string") << list << QVariantMap { { qSL("value"), qSL("two") } } << true;
+    QTest::newRow("list-string-mismatch") << list << QVariantMap { { qSL("value"), qSL("three") } } << false;
+    QTest::newRow("list-string-no-regexp") << list << QVariantMap { { qSL("value"), qSL("^o") } } << false;
+    QTest::newRow("list-int") << list << QVariantMap { { qSL("value"), 3 } } << true;
+    QTest::newRow("list-int-as-double") << list << QVariantMap { { qSL("value"), 3.0 } } << true;
+    QTest::newRow("list-double") << list << QVariantMap { { qSL("value"), 4.5 } } << true;
+    QTest::newRow("list-bool") << list << QVariantMap { { qSL("value"), true } } << true;
+    QTest::newRow("list-int-as-string") << list << QVariantMap { { qSL("value"), qSL("3") } } << false;
+    QTest::newRow("list-string-as-bytearray") << list << QVariantMap { { qSL("value"), QByteArray("one") } } << false;
+    QTest::newRow("list-empty") << QVariantMap { { qSL("value"), QVariantList { } } }
+                                << QVariantMap { { qSL("value"), qSL("one") } } << false;
+
+    QTest::newRow("value-int") << QVariantMap { { qSL("size"), 42 } }
+                               << QVariantMap { { qSL("size"), 42 } } << true;
+    QTest::newRow("value-int-as-double") << QVariantMap { { qSL("size"), 42 } }
+                                         << QVariantMap { { qSL("size"), 42.0 } } << true;
+    QTest::newRow("value-int-mismatch") << QVariantMap { { qSL("size"), 42 } }
+                                        << QVariantMap { { qSL("size"), 43 } } << false;
+    QTest::newRow("value-bool") << QVariantMap { { qSL("flag"), false } }
+                                << QVariantMap { { qSL("flag"), false } } << true;
+    QTest::newRow("value-map") << QVariantMap { { qSL("map"), QVariantMap { { qSL("a"), 1 } } } }
+                               << QVariantMap { { qSL("map"), QVariantMap { { qSL("a"), 1 } } } } << true;
+
+    const QVariantMap combined { { qSL("mimeType"), qSL("^text/") },
+                                 { qSL("size"), 1 },
+                                 { qSL("encoding"), QVariantList { qSL("utf-8"), qSL("latin1") } } };
+    QTest::newRow("combined-match") << combined << QVariantMap { { qSL("mimeType"), qSL("text/plain") },
+                                                                 { qSL("size"), 1 },
+                                                                 { qSL("encoding"), qSL("latin1") } } << true;
+    QTest::newRow("combined-mismatch") << combined << QVariantMap { { qSL("mimeType"), qSL("text/plain") },
+                                                                    { qSL("size"), 1 },
+                                                                    { qSL("encoding"), qSL("utf-16") } } << false;
+    QTest::newRow("no-match-rules") << QVariantMap { } << QVariantMap { { qSL("any"), 1 } } << true;
+}
+
+void tst_Intent::parameterMatch()
+{
+    QFETCH(QVariantMap, parameterMatch);
+    QFETCH(QVariantMap, parameters);
+    QFETCH(bool, matches);
+
+    // invalid regular expressions are reported once at registration time
+    if (QByteArray(QTest::currentDataTag()) == "invalid-regexp")
+        QTest::ignoreMessage(QtWarningMsg, QRegularExpression(qSL(".*invalid regular expression.*")));
+
+    std::unique_ptr<Intent> intent(TestPackageLoader::createIntent(parameterMatch));
+    QCOMPARE(intent->parameterMatch(), parameterMatch);
+
+    QCOMPARE(legacyCheckParameterMatch(parameterMatch, parameters), matches);
+    QCOMPARE(intent->checkParameterMatch(parameters), matches);
+
+    // the compiled matchers do not depend on the order or number of requests
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(intent->checkParameterMatch(parameters), matches);
+}
+
+void tst_Intent::rearmRequestTimeout()
+{
+    auto *systemInterface = new TestSystemInterface;
+    std::unique_ptr<IntentServer> intentServer(IntentServer::createInstance(systemInterface));
+
+    QVERIFY(intentServer->addPackage(qSL("handler.pkg")));
+    QVERIFY(intentServer->addApplication(qSL("handler"), qSL("handler.pkg")));
+    QVERIFY(intentServer->addPackage(qSL("requester.pkg")));
+    QVERIFY(intentServer->addApplication(qSL("requester"), qSL("requester.pkg")));
+    QVERIFY(intentServer->addIntent(qSL("intent"), qSL("handler.pkg"), qSL("handler"), { },
+                                    Intent::Public, { }, { }, { }, { }, { }, false));
+
+    // the start timeout is re-armed as the reply timeout, once the handler is running
+    const int startTimeout = 50;
+    const int replyTimeout = 500;
+    intentServer->setStartApplicationTimeout(startTimeout);
+    intentServer->setReplyFromApplicationTimeout(replyTimeout);
+
+    QElapsedTimer timer;
+    timer.start();
+    QVERIFY(systemInterface->requestToSystem(qSL("requester"), qSL("intent"), qSL("handler"), { }));
+    QTRY_COMPARE(systemInterface->sentToApp.size(), 1);
+
+    // the start timeout must not fire anymore, while the handler is working on the request
+    QTest::qWait(startTimeout * 4);
+    QVERIFY(systemInterface->repliesFromSystem.isEmpty());
+
+    // ... but the reply timeout does, exactly once
+    QTRY_COMPARE_WITH_TIMEOUT(systemInterface->repliesFromSystem.size(), 1, replyTimeout * 10);
+    QVERIFY(timer.elapsed() >= replyTimeout);
+    QVERIFY(!systemInterface->repliesFromSystem.constFirst().succeeded);
+    QVERIFY(systemInterface->repliesFromSystem.constFirst().result.value(qSL("errorMessage")).toString()
+            .startsWith(qSL("Waiting for reply from handler application timed out")));
+    QTest::qWait(startTimeout * 2);
+    QCOMPARE(systemInterface->repliesFromSystem.size(), 1);
+}
+
+QTEST_GUILESS_MAIN(tst_Intent)
+
+#include "tst_intent.moc"
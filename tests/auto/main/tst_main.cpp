@@ -36,6 +36,7 @@ private slots:
     void cleanup();
     void installAndRemoveUpdateForBuiltIn();
     void updateForBuiltInAlreadyInstalled();
+    void brokenInstallationReports();
     void loadDatabaseWithUpdatedBuiltInApp();
     void mainQmlFile_data();
     void mainQmlFile();
@@ -274,6 +275,42 @@ void tst_Main::updateForBuiltInAlreadyInstalled()
     QCOMPARE(app->names().value(qSL("en")), qSL("Hello Updated Red"));
 }
 
+/*
+   Next to a valid installed package, add one package without and one with a corrupt
+   installation report. Check that both broken packages are skipped, but that the valid
+   one is still loaded.
+ */
+void tst_Main::brokenInstallationReports()
+{
+    copyRecursively(QFINDTESTDATA("dir-with-update-already-installed"), qSL("/tmp/am-test-main"));
+
+    QDir appsDir(qSL("/tmp/am-test-main/apps"));
+    QFile manifest(appsDir.absoluteFilePath(qSL("hello-world.red/info.yaml")));
+    QVERIFY(manifest.open(QIODevice::ReadOnly));
+    const QByteArray manifestContent = manifest.readAll();
+
+    const QStringList brokenIds = { qSL("missing-report"), qSL("corrupt-report") };
+    for (const QString &id : brokenIds) {
+        QVERIFY(appsDir.mkdir(id));
+        QFile f(appsDir.absoluteFilePath(id + qSL("/info.yaml")));
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        QVERIFY(f.write(QByteArray(manifestContent).replace("hello-world.red", id.toUtf8())) > 0);
+    }
+    QFile report(appsDir.absoluteFilePath(qSL("corrupt-report/.installation-report.yaml")));
+    QVERIFY(report.open(QIODevice::WriteOnly));
+    QVERIFY(report.write("formatType: am-installation-report\nformatVersion: 3\n---\n[ broken") > 0);
+    report.close();
+
+    initMain();
+
+    auto appMan = ApplicationManager::instance();
+    QCOMPARE(appMan->count(), 1);
+
+    auto app = appMan->application(0);
+    QCOMPARE(app->id(), qSL("hello-world.red"));
+    QCOMPARE(app->names().value(qSL("en")), qSL("Hello Updated Red"));
+}
+
 /*
    Install an update for a built-in app and quit Main. A database will be generated.
 
@@ -0,0 +1,573 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <memory>
+#include <utility>
+
+#include <QtTest>
+#include <QtNetwork>
+#include <QTemporaryDir>
+#include <qplatformdefs.h>
+
+#include "global.h"
+#include "packageextractor.h"
+#include "packagecreator.h"
+#include "installationreport.h"
+#include "packageutilities.h"
+
+QT_USE_NAMESPACE_AM
+
+static const QString PackageId = qSL("com.pelagicore.test");
+
+
+// Runs the appman-package-server binary on a temporary data directory, which initially only
+// contains a single package (the test package, if none is specified).
+class PackageServer
+{
+public:
+    PackageServer(const QStringList &arguments, const QString &packagePath = QString())
+    {
+        QVERIFY(m_dataDir.isValid());
+        QVERIFY(QDir(m_dataDir.path()).mkpath(qSL("upload")));
+        QVERIFY(QFile::copy(packagePath.isEmpty() ? qL1S(AM_TESTDATA_DIR "packages/test.appkg")
+                                                  : packagePath,
+                            m_dataDir.filePath(qSL("upload/test.appkg"))));
+
+        m_process.setProcessChannelMode(QProcess::MergedChannels);
+        m_process.start(qL1S(AM_PACKAGE_SERVER), QStringList { qSL("--dd"), m_dataDir.path(),
+                                                               qSL("--la"), qSL("localhost:0") }
+                                                 + arguments);
+
+        // the server tells us the port it is listening on, once it is ready
+        static const QRegularExpression listening(qSL("listening on: \\S+:(\\d+)"));
+        QRegularExpressionMatch match;
+        QDeadlineTimer deadline(30000);
+        while (!match.hasMatch() && !deadline.hasExpired()
+               && (m_process.state() != QProcess::NotRunning)) {
+            m_process.waitForReadyRead(100);
+            m_output.append(m_process.readAll());
+            match = listening.match(QString::fromLocal8Bit(m_output));
+        }
+        QVERIFY2(match.hasMatch(), m_output.constData());
+        m_port = quint16(match.captured(1).toUInt());
+    }
+
+    ~PackageServer()
+    {
+        // SIGTERM would make the server kill its whole process group, including us
+        m_process.kill();
+        m_process.waitForFinished();
+    }
+
+    quint16 port() const { return m_port; }
+
+    QUrl downloadUrl(const QString &hardwareId = QString(), quint16 port = 0) const
+    {
+        QUrl url(qSL("http://127.0.0.1:%1/package/download").arg(port ? port : m_port));
+        QUrlQuery query;
+        query.addQueryItem(qSL("id"), PackageId);
+        if (!hardwareId.isEmpty())
+            query.addQueryItem(qSL("hardware-id"), hardwareId);
+        url.setQuery(query);
+        return url;
+    }
+
+    QString signedCacheDir() const { return m_dataDir.filePath(qSL(".signed-cache")); }
+
+    // the store-signed variant for the hardwareId in the signed package cache, if any
+    QString signedCacheFile(const QString &hardwareId) const
+    {
+        const QString suffix = u'_' + QString::fromLatin1(QCryptographicHash::hash(hardwareId.toUtf8(),
+                                                                                   QCryptographicHash::Sha1).toHex())
+                + qSL(".ampkg");
+        const auto entries = QDir(signedCacheDir()).entryInfoList(QDir::Files);
+        for (const QFileInfo &fi : entries) {
+            if (fi.fileName().endsWith(suffix))
+                return fi.absoluteFilePath();
+        }
+        return { };
+    }
+
+    qint64 signedCacheSize() const
+    {
+        qint64 size = 0;
+        const auto entries = QDir(signedCacheDir()).entryInfoList(QDir::Files);
+        for (const QFileInfo &fi : entries)
+            size += fi.size();
+        return size;
+    }
+
+private:
+    QTemporaryDir m_dataDir;
+    QProcess m_process;
+    QByteArray m_output;
+    quint16 m_port = 0;
+};
+
+
+// Forwards connections to the package-server, but is able to cut a response short, in order to
+// simulate an interrupted download
+class BreakingProxy
+{
+public:
+    BreakingProxy(quint16 serverPort)
+    {
+        QVERIFY(m_server.listen(QHostAddress::LocalHost));
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server, [this, serverPort]() {
+            while (QTcpSocket *client = m_server.nextPendingConnection()) {
+                auto upstream = new QTcpSocket(client);
+                qint64 remaining = std::exchange(breakAfter, -1);
+
+                QObject::connect(client, &QTcpSocket::readyRead, client, [this, client, upstream]() {
+                    const QByteArray data = client->readAll();
+                    recordRequests(client, data);
+                    upstream->write(data);
+                });
+                QObject::connect(upstream, &QTcpSocket::readyRead, client, [client, upstream, remaining]() mutable {
+                    QByteArray data = upstream->readAll();
+                    if ((remaining >= 0) && (data.size() >= remaining)) {
+                        data.truncate(remaining);
+                        client->write(data);
+                        client->disconnectFromHost(); // flushes everything written before closing
+                        upstream->abort();
+                        return;
+                    } else if (remaining >= 0) {
+                        remaining -= data.size();
+                    }
+                    client->write(data);
+                });
+                QObject::connect(upstream, &QTcpSocket::disconnected, client, &QTcpSocket::disconnectFromHost);
+                QObject::connect(client, &QTcpSocket::disconnected, client, &QObject::deleteLater);
+
+                upstream->connectToHost(QHostAddress::LocalHost, serverPort);
+            }
+        });
+    }
+
+    quint16 port() const { return m_server.serverPort(); }
+
+    qint64 breakAfter = -1; // bytes of the response, only applies to the next connection
+    QList<QByteArray> ranges; // the Range header of each request received
+
+private:
+    void recordRequests(QTcpSocket *client, const QByteArray &data)
+    {
+        // all requests are GETs without a body
+        QByteArray &pending = m_pending[client];
+        pending.append(data);
+
+        qsizetype end;
+        while ((end = pending.indexOf("\r\n\r\n")) >= 0) {
+            QByteArray range;
+            const auto lines = pending.left(end).split('\n');
+            for (const QByteArray &line : lines) {
+                const qsizetype colon = line.indexOf(':');
+                if (line.left(colon).trimmed().toLower() == "range")
+                    range = line.mid(colon + 1).trimmed();
+            }
+            ranges << range;
+            pending.remove(0, end + 4);
+        }
+    }
+
+    QTcpServer m_server;
+    QHash<QTcpSocket *, QByteArray> m_pending;
+};
+
+
+class tst_PackageServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_PackageServer() = default;
+
+private slots:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void resumeDownload_data();
+    void resumeDownload();
+    void resumeFromCheckpoint_data();
+    void resumeFromCheckpoint();
+    void reproducibleStoreSignedPackage();
+
+    void rangeRequests_data();
+    void rangeRequests();
+    void notModified_data();
+    void notModified();
+    void signedPackageCache();
+
+private:
+    std::unique_ptr<QNetworkReply> get(const QUrl &url, const QList<std::pair<QByteArray, QByteArray>> &headers = { });
+    static QStringList storeSignArguments();
+    static quint64 inode(const QString &filePath);
+
+    QNetworkAccessManager m_nam;
+    std::unique_ptr<QTemporaryDir> m_extractDir;
+    QTemporaryDir m_bigPackageDir;
+    QString m_bigPackage; // ~400KiB, incompressible
+};
+
+
+void tst_PackageServer::initTestCase()
+{
+    if (!QDir(qL1S(AM_TESTDATA_DIR "/packages")).exists())
+        QSKIP("No test packages available in the data/ directory");
+    if (!QFile::exists(qL1S(AM_PACKAGE_SERVER)))
+        QSKIP("The appman-package-server binary is not available");
+
+    QVERIFY(PackageUtilities::checkCorrectLocale());
+
+    // the test package plus random data: big enough to be streamed in more than one chunk and
+    // to have only two store-signed variants fit into a signed package cache of 1MiB
+    QVERIFY(m_bigPackageDir.isValid());
+    const QString sourceDir = m_bigPackageDir.filePath(qSL("source"));
+
+    QVERIFY(QDir().mkpath(sourceDir));
+    PackageExtractor extractor(QUrl::fromLocalFile(qL1S(AM_TESTDATA_DIR "packages/test.appkg")), sourceDir);
+    QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+
+    QFile random(QDir(sourceDir).filePath(qSL("random")));
+    QVERIFY(random.open(QIODevice::WriteOnly));
+    QByteArray data(400 * 1024, Qt::Uninitialized);
+    QRandomGenerator(42).fillRange(reinterpret_cast<quint32 *>(data.data()), data.size() / 4);
+    QCOMPARE(random.write(data), qint64(data.size()));
+    random.close();
+
+    InstallationReport report(PackageId);
+    report.addFiles(extractor.installationReport().files());
+    report.addFile(qSL("random"));
+
+    m_bigPackage = m_bigPackageDir.filePath(qSL("big.appkg"));
+    QFile output(m_bigPackage);
+    QVERIFY(output.open(QIODevice::WriteOnly));
+    PackageCreator creator(QDir(sourceDir), &output, report);
+    QVERIFY2(creator.create(), qPrintable(creator.errorString()));
+}
+
+void tst_PackageServer::init()
+{
+    m_extractDir.reset(new QTemporaryDir());
+    QVERIFY(m_extractDir->isValid());
+}
+
+void tst_PackageServer::cleanup()
+{
+    m_extractDir.reset();
+}
+
+std::unique_ptr<QNetworkReply> tst_PackageServer::get(const QUrl &url, const QList<std::pair<QByteArray, QByteArray>> &headers)
+{
+    QNetworkRequest request(url);
+    for (const auto &[name, value] : headers)
+        request.setRawHeader(name, value);
+
+    std::unique_ptr<QNetworkReply> reply(m_nam.get(request));
+    if (!QTest::qWaitFor([&reply]() { return reply->isFinished(); }, 30000))
+        qWarning() << "Timeout waiting for" << url;
+    return reply;
+}
+
+quint64 tst_PackageServer::inode(const QString &filePath)
+{
+    QT_STATBUF statBuf;
+    return (QT_STAT(QFile::encodeName(filePath).constData(), &statBuf) == 0) ? quint64(statBuf.st_ino) : 0;
+}
+
+QStringList tst_PackageServer::storeSignArguments()
+{
+    return { qSL("--sc"), qL1S(AM_TESTDATA_DIR "certificates/store.p12"),
+             qSL("--sp"), qSL("password") };
+}
+
+void tst_PackageServer::resumeDownload_data()
+{
+    QTest::addColumn<bool>("storeSign");
+
+    QTest::newRow("unsigned") << false;
+    QTest::newRow("store-signed") << true;
+}
+
+void tst_PackageServer::resumeDownload()
+{
+    QFETCH(bool, storeSign);
+
+    PackageServer server(storeSign ? storeSignArguments() : QStringList { });
+    BreakingProxy proxy(server.port());
+    const QUrl url = server.downloadUrl(qSL("foobar"), proxy.port());
+
+    auto reply = get(url);
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    const QByteArray package = reply->readAll();
+    QVERIFY(!package.isEmpty());
+    proxy.ranges.clear();
+
+    proxy.breakAfter = package.size() / 3;
+
+    PackageExtractor extractor(url, m_extractDir->path());
+    QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+
+    // the server honored the Range request, because the If-Range validator still matched
+    QCOMPARE(extractor.statistics().value(qSL("resumeCount")).toInt(), 1);
+    QCOMPARE(proxy.ranges.size(), 2);
+    QVERIFY(proxy.ranges.at(0).isEmpty());
+    QVERIFY(proxy.ranges.at(1).startsWith("bytes="));
+    QVERIFY(proxy.ranges.at(1) != "bytes=0-");
+
+    QCOMPARE(extractor.installationReport().storeSignature().isEmpty(), !storeSign);
+    QVERIFY(QFile::exists(m_extractDir->filePath(qSL("info.yaml"))));
+}
+
+void tst_PackageServer::resumeFromCheckpoint_data()
+{
+    QTest::addColumn<bool>("storeSign");
+
+    QTest::newRow("unsigned") << false;
+    QTest::newRow("store-signed") << true;
+}
+
+void tst_PackageServer::resumeFromCheckpoint()
+{
+    QFETCH(bool, storeSign);
+
+    // with a cache size of 0, only the most recently requested store-signed package is kept
+    PackageServer server(storeSign ? (storeSignArguments() + QStringList { qSL("--cs"), qSL("0") })
+                                   : QStringList { });
+    BreakingProxy proxy(server.port());
+    const QUrl url = server.downloadUrl(qSL("foobar"), proxy.port());
+
+    QTemporaryDir checkpointDir;
+    const QString checkpoint = checkpointDir.filePath(qSL("partial"));
+    proxy.breakAfter = 1024;
+
+    {
+        PackageExtractor extractor(url, m_extractDir->path());
+        extractor.setMaximumResumeAttempts(0);
+        extractor.setDownloadCheckpoint(checkpoint);
+        QVERIFY(!extractor.extract());
+        QVERIFY(extractor.errorCode() == Error::Network);
+    }
+    const qint64 checkpointSize = QFileInfo(checkpoint).size();
+    QVERIFY(checkpointSize > 0);
+
+    if (storeSign) {
+        // requesting a variant for another hardware-id evicts the one we were downloading:
+        // it has to be re-created for the next request, but needs to stay the same
+        auto reply = get(server.downloadUrl(qSL("other")));
+        QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+        QCOMPARE(QDir(server.signedCacheDir()).entryList(QDir::Files).size(), 1);
+    }
+
+    QTemporaryDir extractDir;
+    PackageExtractor extractor(url, extractDir.path());
+    extractor.setDownloadCheckpoint(checkpoint);
+    QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+
+    QCOMPARE(proxy.ranges.size(), 2);
+    QCOMPARE(proxy.ranges.at(1), "bytes=" + QByteArray::number(checkpointSize) + '-');
+    QCOMPARE(extractor.statistics().value(qSL("bytesReplayed")).toLongLong(), checkpointSize);
+    QCOMPARE(extractor.installationReport().storeSignature().isEmpty(), !storeSign);
+    QVERIFY(QFile::exists(extractDir.filePath(qSL("info.yaml"))));
+    QVERIFY(!QFile::exists(checkpoint));
+}
+
+void tst_PackageServer::reproducibleStoreSignedPackage()
+{
+    PackageServer server(storeSignArguments() + QStringList { qSL("--cs"), qSL("0") });
+
+    auto reply = get(server.downloadUrl(qSL("foo")));
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    const QByteArray etag = reply->rawHeader("ETag");
+    const QByteArray package = reply->readAll();
+    QVERIFY(!etag.isEmpty());
+
+    // a different hardware-id results in a different signature
+    reply = get(server.downloadUrl(qSL("bar")));
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    QVERIFY(reply->rawHeader("ETag") != etag);
+
+    // the first variant was evicted from the cache, but is re-created byte by byte
+    reply = get(server.downloadUrl(qSL("foo")));
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    QCOMPARE(reply->rawHeader("ETag"), etag);
+    QVERIFY(reply->readAll() == package);
+}
+
+void tst_PackageServer::rangeRequests_data()
+{
+    QTest::addColumn<QByteArray>("range");
+    QTest::addColumn<QByteArray>("ifRange");
+    QTest::addColumn<int>("status");
+    QTest::addColumn<qint64>("first");
+    QTest::addColumn<qint64>("last"); // -1: the end of the package
+
+    // SIZE is replaced by the size of the package
+    QTest::newRow("none")           << QByteArray() << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("first-bytes")    << QByteArray("bytes=0-99") << QByteArray() << 206 << 0LL << 99LL;
+    QTest::newRow("middle")         << QByteArray("bytes=100000-299999") << QByteArray() << 206 << 100000LL << 299999LL;
+    QTest::newRow("open-ended")     << QByteArray("bytes=1000-") << QByteArray() << 206 << 1000LL << -1LL;
+    QTest::newRow("suffix")         << QByteArray("bytes=-1000") << QByteArray() << 206 << -1000LL << -1LL;
+    QTest::newRow("clipped")        << QByteArray("bytes=1000-999999999") << QByteArray() << 206 << 1000LL << -1LL;
+    QTest::newRow("unsatisfiable")  << QByteArray("bytes=SIZE-") << QByteArray() << 416 << 0LL << 0LL;
+    QTest::newRow("empty-suffix")   << QByteArray("bytes=-0") << QByteArray() << 416 << 0LL << 0LL;
+    // syntactically invalid ranges are ignored
+    QTest::newRow("backwards")      << QByteArray("bytes=100-10") << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("negative-last")  << QByteArray("bytes=5--3") << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("signed-first")   << QByteArray("bytes=+5-") << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("no-dash")        << QByteArray("bytes=5") << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("multiple")       << QByteArray("bytes=0-9,20-29") << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("invalid")        << QByteArray("bytes=abc-") << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("other-unit")     << QByteArray("items=0-9") << QByteArray() << 200 << 0LL << -1LL;
+    QTest::newRow("if-range-match") << QByteArray("bytes=1000-") << QByteArray("ETAG") << 206 << 1000LL << -1LL;
+    QTest::newRow("if-range-stale") << QByteArray("bytes=1000-") << QByteArray("\"stale\"") << 200 << 0LL << -1LL;
+}
+
+void tst_PackageServer::rangeRequests()
+{
+    QFETCH(QByteArray, range);
+    QFETCH(QByteArray, ifRange);
+    QFETCH(int, status);
+    QFETCH(qint64, first);
+    QFETCH(qint64, last);
+
+    QFile f(m_bigPackage);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    const QByteArray package = f.readAll();
+    const qint64 size = package.size();
+
+    PackageServer server({ }, m_bigPackage);
+
+    auto reply = get(server.downloadUrl());
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    QVERIFY(reply->readAll() == package);
+    const QByteArray etag = reply->rawHeader("ETag");
+    QCOMPARE(etag, '"' + QCryptographicHash::hash(package, QCryptographicHash::Sha1).toHex() + '"');
+    QCOMPARE(reply->rawHeader("Accept-Ranges"), QByteArray("bytes"));
+
+    QList<std::pair<QByteArray, QByteArray>> headers;
+    if (!range.isEmpty())
+        headers.append({ "Range", range.replace("SIZE", QByteArray::number(size)) });
+    if (!ifRange.isEmpty())
+        headers.append({ "If-Range", ifRange.replace("ETAG", etag) });
+
+    reply = get(server.downloadUrl(), headers);
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), status);
+
+    if (status == 416) {
+        QCOMPARE(reply->rawHeader("Content-Range"), "bytes */" + QByteArray::number(size));
+        return;
+    }
+
+    if (first < 0)
+        first += size;
+    if (last < 0)
+        last = size - 1;
+    const QByteArray body = reply->readAll();
+    QCOMPARE(qint64(body.size()), last - first + 1);
+    QVERIFY(body == package.mid(first, last - first + 1));
+    QCOMPARE(reply->rawHeader("ETag"), etag);
+
+    if (status == 206) {
+        QCOMPARE(reply->rawHeader("Content-Range"), "bytes " + QByteArray::number(first) + '-'
+                 + QByteArray::number(last) + '/' + QByteArray::number(size));
+    } else {
+        QVERIFY(!reply->hasRawHeader("Content-Range"));
+    }
+}
+
+void tst_PackageServer::notModified_data()
+{
+    QTest::addColumn<QByteArray>("ifNoneMatch");
+    QTest::addColumn<int>("status");
+
+    // ETAG is replaced by the package's actual ETag
+    QTest::newRow("match")          << QByteArray("ETAG") << 304;
+    QTest::newRow("weak")           << QByteArray("W/ETAG") << 304;
+    QTest::newRow("list")           << QByteArray("\"other\", ETAG") << 304;
+    QTest::newRow("wildcard")       << QByteArray("*") << 304;
+    QTest::newRow("mismatch")       << QByteArray("\"other\"") << 200;
+    QTest::newRow("mismatch-list")  << QByteArray("\"other\", W/\"another\"") << 200;
+}
+
+void tst_PackageServer::notModified()
+{
+    QFETCH(QByteArray, ifNoneMatch);
+    QFETCH(int, status);
+
+    PackageServer server(storeSignArguments());
+
+    auto reply = get(server.downloadUrl(qSL("foobar")));
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), 200);
+    const QByteArray package = reply->readAll();
+    const QByteArray etag = reply->rawHeader("ETag");
+    QVERIFY(!etag.isEmpty());
+
+    reply = get(server.downloadUrl(qSL("foobar")), { { "If-None-Match", ifNoneMatch.replace("ETAG", etag) } });
+    QCOMPARE(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt(), status);
+    QCOMPARE(reply->rawHeader("ETag"), etag);
+    if (status == 304)
+        QVERIFY(reply->readAll().isEmpty());
+    else
+        QVERIFY(reply->readAll() == package);
+}
+
+void tst_PackageServer::signedPackageCache()
+{
+    // 1MiB only fits two store-signed variants of the big package
+    PackageServer server(storeSignArguments() + QStringList { qSL("--cs"), qSL("1") }, m_bigPackage);
+    const qint64 limit = 1024 * 1024;
+
+    auto download = [&](const QString &hardwareId) {
+        auto reply = get(server.downloadUrl(hardwareId));
+        QVERIFY(reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 200);
+        QVERIFY(!reply->readAll().isEmpty());
+        QVERIFY(server.signedCacheSize() <= limit);
+    };
+
+    // first request: the variant is created
+    download(qSL("a"));
+    const QString fileA = server.signedCacheFile(qSL("a"));
+    QVERIFY(!fileA.isEmpty());
+    const quint64 inodeA = inode(fileA);
+    QVERIFY(inodeA);
+
+    // second request: the variant is served from the cache, without re-creating the file
+    download(qSL("a"));
+    QCOMPARE(server.signedCacheFile(qSL("a")), fileA);
+    QCOMPARE(inode(fileA), inodeA);
+
+    download(qSL("b"));
+    const QString fileB = server.signedCacheFile(qSL("b"));
+    QVERIFY(!fileB.isEmpty());
+    QCOMPARE(QDir(server.signedCacheDir()).entryList(QDir::Files).size(), 2);
+
+    // a is now used more recently than b ...
+    download(qSL("a"));
+    QCOMPARE(inode(fileA), inodeA);
+
+    // ... so b gets evicted, when c does not fit into the cache anymore
+    download(qSL("c"));
+    QVERIFY(!server.signedCacheFile(qSL("c")).isEmpty());
+    QVERIFY(!QFile::exists(fileB));
+    QCOMPARE(inode(fileA), inodeA);
+    QCOMPARE(QDir(server.signedCacheDir()).entryList(QDir::Files).size(), 2);
+
+    // b has to be re-created now
+    download(qSL("b"));
+    QVERIFY(QFile::exists(fileB));
+    QVERIFY(!QFile::exists(fileA));
+    QCOMPARE(QDir(server.signedCacheDir()).entryList(QDir::Files).size(), 2);
+}
+
+int main(int argc, char *argv[])
+{
+    PackageUtilities::ensureCorrectLocale();
+    QCoreApplication app(argc, argv);
+    tst_PackageServer tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_package-server.moc"
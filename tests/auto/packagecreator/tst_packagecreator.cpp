@@ -9,6 +9,7 @@
 #include "installationreport.h"
 #include "packageutilities.h"
 #include "packagecreator.h"
+#include "packageextractor.h"
 #include "utilities.h"
 
 #include "../error-checking.h"
@@ -29,6 +30,8 @@ private slots:
 
     void createAndVerify_data();
     void createAndVerify();
+    void parallelCompression_data();
+    void parallelCompression();
 
 private:
     QString escapeFilename(const QString &name);
@@ -138,6 +141,86 @@ void tst_PackageCreator::createAndVerify()
     }
 }
 
+void tst_PackageCreator::parallelCompression_data()
+{
+    QTest::addColumn<QString>("compressionName");
+
+    QTest::newRow("gzip") << "gzip";
+    QTest::newRow("xz") << "xz";
+    QTest::newRow("zstd") << "zstd";
+}
+
+void tst_PackageCreator::parallelCompression()
+{
+    QFETCH(QString, compressionName);
+
+    const auto compression = PackageUtilities::compressionFromName(compressionName);
+    if (!PackageUtilities::isCompressionSupported(compression))
+        QSKIP("This compression algorithm is not supported on this system");
+
+    // enough data for a few dozen compression blocks, partly compressible
+    QTemporaryDir source;
+    QVERIFY(source.isValid());
+    QStringList files;
+    QRandomGenerator rand(42);
+    for (int i = 0; i < 8; ++i) {
+        QByteArray data;
+        for (int j = 0; j < 500; ++j) {
+            data.append(QByteArray::number(rand.generate()).repeated(int(rand.bounded(100))));
+            data.append(QByteArray(int(rand.bounded(1000)), char(i)));
+        }
+        const QString fileName = qSL("file%1").arg(i);
+        QFile f(source.filePath(fileName));
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        QCOMPARE(f.write(data), qint64(data.size()));
+        files << fileName;
+    }
+
+    InstallationReport report(qSL("com.pelagicore.test"));
+    report.addFiles(files);
+
+    QByteArray digests[2];
+    QTemporaryFile outputs[2];
+    const int threadCounts[2] = { 1, 4 };
+
+    for (int i = 0; i < 2; ++i) {
+        QVERIFY(outputs[i].open());
+        PackageCreator creator(QDir(source.path()), &outputs[i], report);
+        creator.setCompression(compression);
+        creator.setCompressionThreadCount(threadCounts[i]);
+        QVERIFY2(creator.create(), qPrintable(creator.errorString()));
+        outputs[i].close();
+        digests[i] = creator.createdDigest();
+    }
+    QCOMPARE(digests[1], digests[0]);
+
+    // the parallel one needs to be extractable and has to have the same contents
+    QTemporaryDir destination;
+    QVERIFY(destination.isValid());
+    PackageExtractor extractor(QUrl::fromLocalFile(outputs[1].fileName()), QDir(destination.path()));
+    QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+    QCOMPARE(extractor.compression(), compression);
+    QCOMPARE(extractor.installationReport().digest(), digests[0]);
+
+    for (const QString &file : std::as_const(files)) {
+        QFile src(source.filePath(file));
+        QVERIFY(src.open(QIODevice::ReadOnly));
+        QFile dst(destination.filePath(file));
+        QVERIFY(dst.open(QIODevice::ReadOnly));
+        QVERIFY(src.readAll() == dst.readAll());
+    }
+
+    // gzip should also be readable by the standard tools
+    if ((compression == PackageCompression::Gzip) && m_tarAvailable) {
+        QProcess tar;
+        tar.start(qSL("tar"), { qSL("-tzf"), escapeFilename(outputs[1].fileName()) });
+        QVERIFY2(tar.waitForStarted(processTimeout) &&
+                 tar.waitForFinished(processTimeout) &&
+                 (tar.exitStatus() == QProcess::NormalExit) &&
+                 (tar.exitCode() == 0), qPrintable(tar.errorString()));
+    }
+}
+
 QString tst_PackageCreator::escapeFilename(const QString &name)
 {
     if (!m_isCygwin) {
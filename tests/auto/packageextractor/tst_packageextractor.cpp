@@ -20,6 +20,8 @@
 #include "packageextractor.h"
 #include "installationreport.h"
 #include "packageutilities.h"
+#include "private/packageutilities_p.h"
+#include "private/packagedelta_p.h"
 #include "utilities.h"
 
 #include "../error-checking.h"
@@ -42,9 +44,20 @@ private slots:
     void extractAndVerify();
 
     void cancelExtraction();
+    void failingStage();
 
     void extractFromFifo();
 
+    void compressionSignature_data();
+    void compressionSignature();
+    void unsupportedCompression_data();
+    void unsupportedCompression();
+    void maliciousDeltaPatch();
+
+    void resumeDownload();
+    void resumeFromCheckpoint_data();
+    void resumeFromCheckpoint();
+
 private:
     QString m_taest;
     std::unique_ptr<QTemporaryDir> m_extractDir;
@@ -187,6 +200,17 @@ void tst_PackageExtractor::extractAndVerify()
     reportEntries.sort();
     entries.sort();
     QCOMPARE(reportEntries, entries);
+
+    const QVariantMap stats = extractor.statistics();
+    QVERIFY(stats.value(qSL("elapsed")).toLongLong() > 0);
+    // libarchive might stop reading before the end of the input, as soon as it sees the EOF marker
+    QVERIFY(stats.value(qSL("bytesRead")).toLongLong() > 0);
+    QVERIFY(stats.value(qSL("bytesRead")).toLongLong() <= QFileInfo(qL1S(AM_TESTDATA_DIR) + path).size());
+    qint64 bytesExtracted = 0;
+    for (auto sizeIt = sizes.cbegin(); sizeIt != sizes.cend(); ++sizeIt)
+        bytesExtracted += sizeIt.value();
+    QVERIFY(stats.value(qSL("bytesExtracted")).toLongLong() >= bytesExtracted);
+    QVERIFY(stats.value(qSL("writerCount")).toInt() >= 1);
 }
 
 void tst_PackageExtractor::cancelExtraction()
@@ -263,6 +287,34 @@ private:
     QByteArray m_fifoPath;
 };
 
+void tst_PackageExtractor::failingStage()
+{
+    // the writer stage cannot create a file where a directory already exists
+    QVERIFY(QDir(m_extractDir->path()).mkdir(qSL("bigtest")));
+
+    PackageExtractor extractor(QUrl::fromLocalFile(qL1S(AM_TESTDATA_DIR "packages/bigtest.appkg")),
+                               m_extractDir->path());
+
+    // statistics() is safe to call from another thread while the pipeline is running
+    QAtomicInt done;
+    QThread *poller = QThread::create([&extractor, &done]() {
+        while (!done.loadAcquire())
+            extractor.statistics();
+    });
+    poller->start();
+
+    const bool result = extractor.extract();
+    done.storeRelease(1);
+    QVERIFY(poller->wait(5000));
+    delete poller;
+
+    QVERIFY(!result);
+    QCOMPARE(extractor.errorCode(), Error::IO);
+    QVERIFY(!extractor.wasCanceled());
+    AM_CHECK_ERRORSTRING(extractor.errorString(), qSL("~could not create file.*"));
+    QCOMPARE(extractor.statistics().value(qSL("compression")).toString(), qSL("gzip"));
+}
+
 void tst_PackageExtractor::extractFromFifo()
 {
 #if !defined(Q_OS_UNIX)
@@ -277,6 +329,302 @@ void tst_PackageExtractor::extractFromFifo()
     QTRY_VERIFY_WITH_TIMEOUT(fifo.isFinished(), 5000 * timeoutFactor());
 }
 
+// A minimal HTTP server for a single file, supporting "Range: bytes=<first>-" and If-Range. It can
+// be told to close the connection prematurely, to simulate a flaky network.
+class RangeHttpServer
+{
+public:
+    RangeHttpServer(const QByteArray &data)
+        : m_data(data)
+    {
+        QVERIFY(m_server.listen(QHostAddress::LocalHost));
+        QObject::connect(&m_server, &QTcpServer::newConnection, &m_server, [this]() {
+            while (QTcpSocket *socket = m_server.nextPendingConnection()) {
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                QObject::connect(socket, &QTcpSocket::readyRead, socket, [this, socket]() {
+                    handleRequest(socket);
+                });
+            }
+        });
+    }
+
+    QUrl url() const
+    {
+        return QUrl(qSL("http://localhost:%1/test.appkg").arg(m_server.serverPort()));
+    }
+
+    QByteArray etag = "\"1\"";
+    qint64 breakAfter = -1; // bytes of the response body, only applies to the next response
+    QList<QByteArray> ranges; // the Range header of each request received
+
+private:
+    void handleRequest(QTcpSocket *socket)
+    {
+        QByteArray &request = m_pending[socket];
+        request.append(socket->readAll());
+        if (!request.contains("\r\n\r\n"))
+            return;
+
+        QByteArray range;
+        QByteArray ifRange;
+        const auto lines = request.split('\n');
+        for (const QByteArray &line : lines) {
+            const qsizetype colon = line.indexOf(':');
+            const QByteArray name = line.left(colon).trimmed().toLower();
+            if (name == "range")
+                range = line.mid(colon + 1).trimmed();
+            else if (name == "if-range")
+                ifRange = line.mid(colon + 1).trimmed();
+        }
+        m_pending.remove(socket);
+        ranges << range;
+
+        qint64 first = 0;
+        if (range.startsWith("bytes=") && range.endsWith('-') && (ifRange.isEmpty() || (ifRange == etag)))
+            first = range.mid(6).chopped(1).toLongLong();
+
+        QByteArray body = m_data.mid(first);
+        QByteArray response = first ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+        if (first) {
+            response += "Content-Range: bytes " + QByteArray::number(first) + '-'
+                    + QByteArray::number(m_data.size() - 1) + '/' + QByteArray::number(m_data.size()) + "\r\n";
+        }
+        response += "Content-Type: application/octet-stream\r\nAccept-Ranges: bytes\r\nETag: " + etag
+                + "\r\nConnection: close\r\nContent-Length: " + QByteArray::number(body.size()) + "\r\n\r\n";
+
+        if (breakAfter >= 0)
+            body.truncate(std::exchange(breakAfter, -1));
+        socket->write(response + body);
+        socket->disconnectFromHost(); // flushes everything written before closing
+    }
+
+    QTcpServer m_server;
+    QByteArray m_data;
+    QHash<QTcpSocket *, QByteArray> m_pending;
+};
+
+void tst_PackageExtractor::compressionSignature_data()
+{
+    QTest::addColumn<QByteArray>("leadingBytes");
+    QTest::addColumn<PackageCompression>("compression");
+
+    QTest::newRow("xz") << QByteArray("\xfd" "7zXZ\0" "\0\x04", 8) << PackageCompression::Xz;
+    QTest::newRow("zstd") << QByteArray("\x28\xb5\x2f\xfd\x04\x58") << PackageCompression::Zstd;
+    QTest::newRow("gzip") << QByteArray("\x1f\x8b\x08\x00") << PackageCompression::Gzip;
+    QTest::newRow("xz-truncated") << QByteArray("\xfd" "7zX") << PackageCompression::None;
+    QTest::newRow("tar") << QByteArray("--PACKAGE-HEADER--") << PackageCompression::None;
+    QTest::newRow("empty") << QByteArray() << PackageCompression::None;
+}
+
+void tst_PackageExtractor::compressionSignature()
+{
+    QFETCH(QByteArray, leadingBytes);
+    QFETCH(PackageCompression, compression);
+
+    // this is how packages using an unsupported compression are detected
+    QCOMPARE(PackageUtilities::compressionFromSignature(leadingBytes), compression);
+}
+
+void tst_PackageExtractor::unsupportedCompression_data()
+{
+    QTest::addColumn<PackageCompression>("compression");
+
+    QTest::newRow("xz") << PackageCompression::Xz;
+    QTest::newRow("zstd") << PackageCompression::Zstd;
+}
+
+void tst_PackageExtractor::unsupportedCompression()
+{
+    QFETCH(PackageCompression, compression);
+
+    if (PackageUtilities::isCompressionSupported(compression))
+        QSKIP("this compression is supported by this build");
+
+    // external programs are never used as a fallback: the package has to be rejected cleanly
+    const QByteArray data = (compression == PackageCompression::Xz)
+            ? QByteArray("\xfd" "7zXZ\0" "\0\x04", 8) : QByteArray("\x28\xb5\x2f\xfd\x04\x58");
+    QTemporaryDir packageDir;
+    QVERIFY(packageDir.isValid());
+    QFile f(packageDir.filePath(qSL("unsupported.appkg")));
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    QCOMPARE(f.write(data + QByteArray(1024, 'x')), data.size() + 1024);
+    f.close();
+
+    PackageExtractor extractor(QUrl::fromLocalFile(f.fileName()), m_extractDir->path());
+    QVERIFY(!extractor.extract());
+    QCOMPARE(extractor.errorCode(), Error::Package);
+    AM_CHECK_ERRORSTRING(extractor.errorString(), qSL("~.*compressed packages are not supported by this build"));
+}
+
+// a minimal, uncompressed ustar archive with regular files only
+static QByteArray tarArchive(const QList<std::pair<QByteArray, QByteArray>> &files)
+{
+    QByteArray tar;
+    for (const auto &[name, data] : files) {
+        QByteArray header(512, '\0');
+        auto setField = [&header](int offset, const QByteArray &value) {
+            header.replace(offset, value.size(), value);
+        };
+        setField(0, name);
+        setField(100, "0000644");
+        setField(108, "0000000");
+        setField(116, "0000000");
+        setField(124, QByteArray::number(data.size(), 8).rightJustified(11, '0'));
+        setField(136, "00000000000");
+        setField(148, "        ");
+        setField(156, "0");
+        setField(257, QByteArray("ustar\0" "00", 8));
+
+        uint checksum = 0;
+        for (char c : std::as_const(header))
+            checksum += uchar(c);
+        setField(148, QByteArray::number(checksum, 8).rightJustified(6, '0') + QByteArray("\0 ", 2));
+
+        tar += header + data;
+        tar += QByteArray((512 - data.size() % 512) % 512, '\0');
+    }
+    return tar + QByteArray(1024, '\0');
+}
+
+void tst_PackageExtractor::maliciousDeltaPatch()
+{
+    QTemporaryDir baseDir;
+    QVERIFY(baseDir.isValid());
+    QFile base(baseDir.filePath(qSL("file.bin")));
+    QVERIFY(base.open(QIODevice::WriteOnly));
+    QCOMPARE(base.write(QByteArray(1024, 'b')), 1024);
+    base.close();
+
+    // offset + length overflows qint64, which must not sneak past the range check
+    PackageDelta::Operation copy;
+    copy.type = PackageDelta::Operation::Copy;
+    copy.offset = std::numeric_limits<qint64>::max() - 8;
+    copy.length = 16;
+
+    const QByteArray header = "formatType: am-package-header\n"
+                              "formatVersion: 3\n"
+                              "---\n"
+                              "packageId: com.pelagicore.test\n"
+                              "diskSpaceUsed: 1024\n"
+                              "compression: none\n"
+                              "delta:\n"
+                              "  baseDigest: 0123456789abcdef\n";
+    const QByteArray patch = PackageDelta::encodePatchHeader(qSL("file.bin"), 16)
+            + PackageDelta::encodeOperation(copy) + PackageDelta::encodeEnd();
+
+    QTemporaryDir packageDir;
+    QVERIFY(packageDir.isValid());
+    QFile f(packageDir.filePath(qSL("malicious.delta.appkg")));
+    QVERIFY(f.open(QIODevice::WriteOnly));
+    const QByteArray tar = tarArchive({ { "--PACKAGE-HEADER--", header },
+                                        { "--PACKAGE-DELTA-PATCH--", patch } });
+    QCOMPARE(f.write(tar), tar.size());
+    f.close();
+
+    PackageExtractor extractor(QUrl::fromLocalFile(f.fileName()), m_extractDir->path());
+    extractor.setDeltaBaseCallback([&baseDir](const QString &, const QByteArray &) {
+        return baseDir.path();
+    });
+    QVERIFY(!extractor.extract());
+    QCOMPARE(extractor.errorCode(), Error::Package);
+    AM_CHECK_ERRORSTRING(extractor.errorString(), qSL("~.*has an invalid copy range"));
+}
+
+static QByteArray readTestPackage()
+{
+    QFile f(qL1S(AM_TESTDATA_DIR "packages/test.appkg"));
+    return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+void tst_PackageExtractor::resumeDownload()
+{
+    const QByteArray package = readTestPackage();
+    QVERIFY(!package.isEmpty());
+
+    RangeHttpServer server(package);
+    server.breakAfter = package.size() / 3;
+
+    PackageExtractor extractor(server.url(), m_extractDir->path());
+    QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+
+    QCOMPARE(extractor.statistics().value(qSL("resumeCount")).toInt(), 1);
+    QCOMPARE(server.ranges.size(), 2);
+    QVERIFY(server.ranges.at(0).isEmpty());
+    QVERIFY(server.ranges.at(1).startsWith("bytes="));
+    QVERIFY(server.ranges.at(1) != "bytes=0-");
+
+    // without resuming, the same break is fatal
+    QTemporaryDir extractDir;
+    server.breakAfter = package.size() / 3;
+    PackageExtractor extractor2(server.url(), extractDir.path());
+    extractor2.setMaximumResumeAttempts(0);
+    QVERIFY(!extractor2.extract());
+    QVERIFY(extractor2.errorCode() == Error::Network);
+}
+
+void tst_PackageExtractor::resumeFromCheckpoint_data()
+{
+    QTest::addColumn<bool>("packageChanged");
+
+    QTest::newRow("unchanged") << false;
+    QTest::newRow("changed") << true;
+}
+
+void tst_PackageExtractor::resumeFromCheckpoint()
+{
+    QFETCH(bool, packageChanged);
+
+    const QByteArray package = readTestPackage();
+    QVERIFY(!package.isEmpty());
+
+    QTemporaryDir checkpointDir;
+    const QString checkpoint = checkpointDir.filePath(qSL("partial"));
+
+    RangeHttpServer server(package);
+    server.breakAfter = package.size() / 2;
+
+    {
+        PackageExtractor extractor(server.url(), m_extractDir->path());
+        extractor.setMaximumResumeAttempts(0);
+        extractor.setDownloadCheckpoint(checkpoint);
+        QVERIFY(!extractor.extract());
+        QVERIFY(extractor.errorCode() == Error::Network);
+    }
+    // the checkpoint survives the failed extractor
+    QVERIFY(QFile::exists(checkpoint + qSL(".checkpoint")));
+    const qint64 checkpointSize = QFileInfo(checkpoint).size();
+    QVERIFY(checkpointSize > 0);
+    QVERIFY(checkpointSize <= package.size() / 2);
+
+    if (packageChanged)
+        server.etag = "\"2\"";
+
+    QTemporaryDir extractDir;
+    PackageExtractor extractor(server.url(), extractDir.path());
+    extractor.setDownloadCheckpoint(checkpoint);
+    qint64 reservedCheckpointSize = -1;
+    extractor.setFileExtractedCallback([&extractor, &reservedCheckpointSize](const QString &) {
+        if (reservedCheckpointSize < 0)
+            reservedCheckpointSize = extractor.downloadCheckpointSize();
+    });
+    QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+
+    // the checkpoint grows to the size of the complete package, unless the download has already
+    // finished and the checkpoint is removed
+    QVERIFY((reservedCheckpointSize == package.size()) || (reservedCheckpointSize == 0));
+
+    QCOMPARE(server.ranges.size(), 2);
+    QCOMPARE(server.ranges.at(1), "bytes=" + QByteArray::number(checkpointSize) + '-');
+    const QVariantMap stats = extractor.statistics();
+    QCOMPARE(stats.value(qSL("bytesReplayed")).toLongLong(), packageChanged ? 0 : checkpointSize);
+    QCOMPARE(stats.value(qSL("resumeCount")).toInt(), 0);
+    QVERIFY(QFile::exists(extractDir.filePath(qSL("info.yaml"))));
+
+    // the checkpoint is gone after a successful extraction
+    QVERIFY(!QFile::exists(checkpoint));
+    QVERIFY(!QFile::exists(checkpoint + qSL(".checkpoint")));
+}
+
 int main(int argc, char *argv[])
 {
     PackageUtilities::ensureCorrectLocale();
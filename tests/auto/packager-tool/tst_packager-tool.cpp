@@ -14,6 +14,7 @@
 #include "packagedatabase.h"
 #include "packagemanager.h"
 #include "packagingjob.h"
+#include "packageextractor.h"
 #include "qmlinprocruntime.h"
 #include "runtimefactory.h"
 #include "utilities.h"
@@ -36,6 +37,9 @@ private Q_SLOTS:
     void brokenMetadata_data();
     void brokenMetadata();
     void iconFileName();
+    void compression_data();
+    void compression();
+    void deltaPackage();
 
 private:
     QString pathTo(const char *file)
@@ -315,6 +319,190 @@ void tst_PackagerTool::iconFileName()
     }
 }
 
+void tst_PackagerTool::compression_data()
+{
+    QTest::addColumn<QString>("compressionName");
+    QTest::addColumn<int>("level");
+
+    QTest::newRow("gzip") << "gzip" << -1;
+    QTest::newRow("gzip-9") << "gzip" << 9;
+    QTest::newRow("xz") << "xz" << -1;
+    QTest::newRow("zstd") << "zstd" << -1;
+    QTest::newRow("zstd-19") << "zstd" << 19;
+    QTest::newRow("none") << "none" << -1;
+}
+
+void tst_PackagerTool::compression()
+{
+    QFETCH(QString, compressionName);
+    QFETCH(int, level);
+
+    bool ok = false;
+    const PackageCompression compression = PackageUtilities::compressionFromName(compressionName, &ok);
+    QVERIFY(ok);
+    if (!PackageUtilities::isCompressionSupported(compression))
+        QSKIP("This compression algorithm is not supported on this system");
+
+    QTemporaryDir tmp;
+    QString errorString;
+
+    createInfoYaml(tmp);
+    createIconPng(tmp);
+    createCode(tmp);
+
+    QVERIFY2(packagerCheck(PackagingJob::create(pathTo("test.appkg"), tmp.path(), { }, { },
+                                                compression, level), errorString),
+             qPrintable(errorString));
+
+    // signing needs to keep the compression
+    QVERIFY2(packagerCheck(PackagingJob::developerSign(
+                               pathTo("test.appkg"),
+                               pathTo("test.dev-signed.appkg"),
+                               m_devCertificate,
+                               m_devPassword), errorString), qPrintable(errorString));
+
+    for (const QString &package : { pathTo("test.appkg"), pathTo("test.dev-signed.appkg") }) {
+        QTemporaryDir extractDir;
+        PackageExtractor extractor(QUrl::fromLocalFile(package), extractDir.path());
+        QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+        QCOMPARE(extractor.compression(), compression);
+    }
+
+    installPackage(pathTo("test.dev-signed.appkg"));
+
+    QDir checkDir(pathTo("internal-0"));
+    QVERIFY(checkDir.cd(qSL("com.pelagicore.test")));
+
+    for (const QString &file : { qSL("info.yaml"), qSL("icon.png"), qSL("test.qml") }) {
+        QVERIFY(checkDir.exists(file));
+        QFile src(QDir(tmp.path()).absoluteFilePath(file));
+        QVERIFY(src.open(QFile::ReadOnly));
+        QFile dst(checkDir.absoluteFilePath(file));
+        QVERIFY(dst.open(QFile::ReadOnly));
+        QCOMPARE(src.readAll(), dst.readAll());
+    }
+}
+
+void tst_PackagerTool::deltaPackage()
+{
+    QTemporaryDir tmp;
+    QString errorString;
+
+    createInfoYaml(tmp);
+    createIconPng(tmp);
+    createCode(tmp);
+    createDummyFile(tmp, qSL("unchanged.txt"), "this file does not change");
+
+    // big enough to be patched instead of being stored in full
+    QByteArray library(512 * 1024, Qt::Uninitialized);
+    QRandomGenerator rand(42);
+    rand.fillRange(reinterpret_cast<quint32 *>(library.data()), library.size() / 4);
+    {
+        QFile f(QDir(tmp.path()).absoluteFilePath(qSL("library.so")));
+        QVERIFY(f.open(QFile::WriteOnly));
+        QCOMPARE(f.write(library), qint64(library.size()));
+    }
+
+    QVERIFY2(packagerCheck(PackagingJob::create(pathTo("test-1.appkg"), tmp.path()), errorString),
+             qPrintable(errorString));
+    QVERIFY2(packagerCheck(PackagingJob::developerSign(pathTo("test-1.appkg"), pathTo("test-1.dev-signed.appkg"),
+                                                       m_devCertificate, m_devPassword), errorString),
+             qPrintable(errorString));
+
+    // version 2: a small change in the middle of the library, one changed and one new file
+    library.replace(100 * 1024, 16, "0123456789abcdef");
+    library.append("some more data at the end");
+    {
+        QFile f(QDir(tmp.path()).absoluteFilePath(qSL("library.so")));
+        QVERIFY(f.open(QFile::WriteOnly | QFile::Truncate));
+        QCOMPARE(f.write(library), qint64(library.size()));
+    }
+    createDummyFile(tmp, qSL("test.qml"), "// test version 2");
+    createDummyFile(tmp, qSL("new.txt"), "this file is new");
+
+    QVERIFY2(packagerCheck(PackagingJob::create(pathTo("test-2.appkg"), tmp.path()), errorString),
+             qPrintable(errorString));
+    QVERIFY2(packagerCheck(PackagingJob::developerSign(pathTo("test-2.appkg"), pathTo("test-2.dev-signed.appkg"),
+                                                       m_devCertificate, m_devPassword), errorString),
+             qPrintable(errorString));
+
+    // the packages need to have the same id
+    QTemporaryDir otherTmp;
+    createInfoYaml(otherTmp, qSL("id"), qSL("com.pelagicore.other"));
+    createIconPng(otherTmp);
+    createCode(otherTmp);
+    QVERIFY2(packagerCheck(PackagingJob::create(pathTo("other.appkg"), otherTmp.path()), errorString),
+             qPrintable(errorString));
+    QVERIFY(!packagerCheck(PackagingJob::createDelta(pathTo("other.appkg"), pathTo("test-2.appkg"),
+                                                     pathTo("test.delta.appkg")), errorString));
+    QVERIFY2(errorString.contains(qL1S("have different ids")), qPrintable(errorString));
+
+    QVERIFY2(packagerCheck(PackagingJob::createDelta(pathTo("test-1.dev-signed.appkg"),
+                                                     pathTo("test-2.dev-signed.appkg"),
+                                                     pathTo("test.delta.appkg")), errorString),
+             qPrintable(errorString));
+
+    // the random library data cannot be compressed, so only the patch makes the difference
+    QVERIFY(QFileInfo(pathTo("test.delta.appkg")).size() < (QFileInfo(pathTo("test-2.dev-signed.appkg")).size() / 4));
+
+    // a delta package cannot be extracted without its base
+    {
+        QTemporaryDir extractDir;
+        PackageExtractor extractor(QUrl::fromLocalFile(pathTo("test.delta.appkg")), extractDir.path());
+        QVERIFY(!extractor.extract());
+        QVERIFY2(extractor.errorString().contains(qL1S("can only be installed as an update")),
+                 qPrintable(extractor.errorString()));
+    }
+
+    // the delta package has the same digest and signatures as the full package
+    {
+        QTemporaryDir fullDir;
+        PackageExtractor fullExtractor(QUrl::fromLocalFile(pathTo("test-2.dev-signed.appkg")), fullDir.path());
+        QVERIFY2(fullExtractor.extract(), qPrintable(fullExtractor.errorString()));
+
+        QTemporaryDir baseDir;
+        PackageExtractor baseExtractor(QUrl::fromLocalFile(pathTo("test-1.appkg")), baseDir.path());
+        QVERIFY2(baseExtractor.extract(), qPrintable(baseExtractor.errorString()));
+
+        QTemporaryDir extractDir;
+        PackageExtractor extractor(QUrl::fromLocalFile(pathTo("test.delta.appkg")), extractDir.path());
+        extractor.setDeltaBaseCallback([&](const QString &packageId, const QByteArray &baseDigest) {
+            if ((packageId != qSL("com.pelagicore.test"))
+                    || (baseDigest != baseExtractor.installationReport().digest())) {
+                throw Exception("unexpected delta base");
+            }
+            return baseDir.path();
+        });
+        QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+        QVERIFY(extractor.isDeltaPackage());
+        QVERIFY(extractor.statistics().value(qSL("bytesFromDeltaBase")).toLongLong() > 0);
+
+        const auto &report = extractor.installationReport();
+        const auto &fullReport = fullExtractor.installationReport();
+        QCOMPARE(report.digest(), fullReport.digest());
+        QCOMPARE(report.developerSignature(), fullReport.developerSignature());
+        QCOMPARE(report.files(), fullReport.files());
+    }
+
+    // install version 1 and update it with the delta package
+
+    installPackage(pathTo("test-1.dev-signed.appkg"));
+    installPackage(pathTo("test.delta.appkg"));
+
+    QDir checkDir(pathTo("internal-0"));
+    QVERIFY(checkDir.cd(qSL("com.pelagicore.test")));
+
+    for (const QString &file : { qSL("info.yaml"), qSL("icon.png"), qSL("test.qml"), qSL("unchanged.txt"),
+                                 qSL("library.so"), qSL("new.txt") }) {
+        QVERIFY(checkDir.exists(file));
+        QFile src(QDir(tmp.path()).absoluteFilePath(file));
+        QVERIFY(src.open(QFile::ReadOnly));
+        QFile dst(checkDir.absoluteFilePath(file));
+        QVERIFY(dst.open(QFile::ReadOnly));
+        QCOMPARE(src.readAll(), dst.readAll());
+    }
+}
+
 
 bool tst_PackagerTool::createInfoYaml(QTemporaryDir &tmp, const QString &changeField, const QVariant &toValue)
 {
@@ -7,6 +7,8 @@
 #include <QtTest>
 #include <QtAppManMonitor/processreader.h>
 
+#include <unistd.h>
+
 QT_USE_NAMESPACE_AM
 
 class tst_ProcessReader : public QObject
@@ -22,6 +24,10 @@ private slots:
     void memTestProcess();
     void memBasic();
     void memAdvanced();
+    void memRollupInvalid_data();
+    void memRollupInvalid();
+    void memRollup();
+    void memRollupTestProcess();
 
 private:
     void printMem(const ProcessReader &reader);
@@ -101,6 +107,75 @@ void tst_ProcessReader::memAdvanced()
     QCOMPARE(reader.memory.heapPss, 15740u);
 }
 
+void tst_ProcessReader::memRollupInvalid_data()
+{
+    QTest::addColumn<QString>("rollupFile");
+    QTest::addColumn<QString>("statmFile");
+
+    QTest::newRow("arbitrary") << QFINDTESTDATA("tst_processreader.cpp") << QFINDTESTDATA("basic.statm");
+    QTest::newRow("missingvalue") << QFINDTESTDATA("invalid.smaps_rollup") << QFINDTESTDATA("basic.statm");
+    QTest::newRow("invalidstatm") << QFINDTESTDATA("basic.smaps_rollup") << QFINDTESTDATA("tst_processreader.cpp");
+}
+
+void tst_ProcessReader::memRollupInvalid()
+{
+    QFETCH(QString, rollupFile);
+    QFETCH(QString, statmFile);
+
+    QVERIFY(!reader.testReadSmapsRollup(rollupFile.toLocal8Bit(), statmFile.toLocal8Bit()));
+
+    QCOMPARE(reader.memory.totalVm, 0u);
+    QCOMPARE(reader.memory.totalRss, 0u);
+    QCOMPARE(reader.memory.totalPss, 0u);
+}
+
+void tst_ProcessReader::memRollup()
+{
+    // the rollup only has the totals: the text and heap values are kept from the last full smaps
+    QVERIFY(reader.testReadSmaps(QFINDTESTDATA("advanced.smaps").toLocal8Bit()));
+    QVERIFY(reader.testReadSmapsRollup(QFINDTESTDATA("basic.smaps_rollup").toLocal8Bit(),
+                                       QFINDTESTDATA("basic.statm").toLocal8Bit()));
+    //printMem(reader);
+    QCOMPARE(reader.memory.totalVm, quint32(26846 * (sysconf(_SC_PAGESIZE) / 1024)));
+    QCOMPARE(reader.memory.totalRss, 20352u);
+    QCOMPARE(reader.memory.totalPss, 13814u);
+    QCOMPARE(reader.memory.textVm, 2104u);
+    QCOMPARE(reader.memory.textRss, 1772u);
+    QCOMPARE(reader.memory.textPss, 1707u);
+    QCOMPARE(reader.memory.heapVm, 16032u);
+    QCOMPARE(reader.memory.heapRss, 15740u);
+    QCOMPARE(reader.memory.heapPss, 15740u);
+
+    // a failed smaps parse must not clobber the last known breakdown
+    QVERIFY(!reader.testReadSmaps(QFINDTESTDATA("invalid.smaps").toLocal8Bit()));
+    QVERIFY(reader.testReadSmapsRollup(QFINDTESTDATA("basic.smaps_rollup").toLocal8Bit(),
+                                       QFINDTESTDATA("basic.statm").toLocal8Bit()));
+    QCOMPARE(reader.memory.textVm, 2104u);
+    QCOMPARE(reader.memory.heapPss, 15740u);
+}
+
+void tst_ProcessReader::memRollupTestProcess()
+{
+    const QByteArray procDir = "/proc/" + QByteArray::number(QCoreApplication::applicationPid());
+    if (!QFile::exists(QString::fromLocal8Bit(procDir + "/smaps_rollup")))
+        QSKIP("This kernel does not support smaps_rollup");
+
+    QVERIFY(reader.testReadSmaps(procDir + "/smaps"));
+    const auto smapsMemory = reader.memory;
+
+    QVERIFY(reader.testReadSmapsRollup(procDir + "/smaps_rollup", procDir + "/statm"));
+    //printMem(reader);
+    QVERIFY(reader.memory.totalVm >= reader.memory.totalRss);
+    QVERIFY(reader.memory.totalRss >= reader.memory.totalPss);
+    QVERIFY(reader.memory.totalRss > 0);
+    QCOMPARE(reader.memory.textVm, smapsMemory.textVm);
+    QCOMPARE(reader.memory.heapVm, smapsMemory.heapVm);
+
+    // both are snapshots taken at different times, so we can only check for plausibility
+    QVERIFY(reader.memory.totalVm > smapsMemory.totalVm / 2);
+    QVERIFY(reader.memory.totalVm < smapsMemory.totalVm * 2);
+}
+
 void tst_ProcessReader::printMem(const ProcessReader &reader)
 {
     qDebug() << "totalVm:" << reader.memory.totalVm;
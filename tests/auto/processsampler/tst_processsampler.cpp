@@ -0,0 +1,183 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+#include <QtAppManMonitor/processsampler.h>
+
+QT_USE_NAMESPACE_AM
+
+class tst_ProcessSampler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void cleanup();
+
+    void sharedSample();
+    void memoryReporting();
+    void changePid();
+    void workerThreads();
+    void lifetime();
+
+private:
+    static qint64 ownPid() { return QCoreApplication::applicationPid(); }
+};
+
+void tst_ProcessSampler::cleanup()
+{
+    auto sampler = ProcessSampler::instance();
+    QCOMPARE(sampler->sampledProcessCount(), 0);
+    QCOMPARE(sampler->workerThreadCount(), 0);
+}
+
+void tst_ProcessSampler::sharedSample()
+{
+    auto sampler = ProcessSampler::instance();
+    QObject subscribers[10];
+    int delivered = 0;
+
+    for (auto &subscriber : subscribers) {
+        sampler->subscribe(&subscriber, ownPid(), [&](const ProcessSampler::Reading &reading) {
+            QVERIFY(reading.memory.totalVm > 0);
+            ++delivered;
+        });
+    }
+    QCOMPARE(sampler->sampledProcessCount(), 1);
+    QCOMPARE(sampler->workerThreadCount(), 1);
+
+    const quint64 samplesBefore = sampler->sampleCount();
+    for (auto &subscriber : subscribers) {
+        sampler->requestUpdate(&subscriber);
+        sampler->requestUpdate(&subscriber); // coalesced with the first one
+    }
+    QTRY_COMPARE(delivered, 10);
+    QCOMPARE(sampler->sampleCount(), samplesBefore + 1);
+
+    // a request right after a sample is answered with the cached one
+    sampler->requestUpdate(&subscribers[0]);
+    QTRY_COMPARE(delivered, 11);
+    QCOMPARE(sampler->sampleCount(), samplesBefore + 1);
+
+    // ... but not after MinimumSampleInterval
+    QTest::qWait(ProcessSampler::MinimumSampleInterval + 10);
+    sampler->requestUpdate(&subscribers[1]);
+    QTRY_COMPARE(delivered, 12);
+    QCOMPARE(sampler->sampleCount(), samplesBefore + 2);
+
+    for (auto &subscriber : subscribers)
+        sampler->unsubscribe(&subscriber);
+}
+
+void tst_ProcessSampler::memoryReporting()
+{
+    auto sampler = ProcessSampler::instance();
+    QObject withMemory;
+    QObject withoutMemory;
+    ProcessSampler::Reading readingWithMemory;
+    ProcessSampler::Reading readingWithoutMemory;
+    int delivered = 0;
+
+    sampler->subscribe(&withMemory, ownPid(), [&](const ProcessSampler::Reading &reading) {
+        readingWithMemory = reading;
+        ++delivered;
+    });
+    sampler->subscribe(&withoutMemory, ownPid(), [&](const ProcessSampler::Reading &reading) {
+        readingWithoutMemory = reading;
+        ++delivered;
+    });
+    sampler->setMemoryReporting(&withoutMemory, false, 1);
+
+    sampler->requestUpdate(&withMemory);
+    sampler->requestUpdate(&withoutMemory);
+    QTRY_COMPARE(delivered, 2);
+    QVERIFY(readingWithMemory.memory.totalRss > 0);
+    QCOMPARE(readingWithoutMemory.memory.totalRss, 0u);
+
+    sampler->unsubscribe(&withMemory);
+    sampler->unsubscribe(&withoutMemory);
+}
+
+void tst_ProcessSampler::changePid()
+{
+    auto sampler = ProcessSampler::instance();
+    QObject subscriber;
+    int delivered = 0;
+    ProcessSampler::Reading lastReading;
+    auto callback = [&](const ProcessSampler::Reading &reading) {
+        lastReading = reading;
+        ++delivered;
+    };
+
+    // pid 0 means "no process": there is nothing to sample, but the update is still delivered
+    sampler->subscribe(&subscriber, 0, callback);
+    QCOMPARE(sampler->sampledProcessCount(), 0);
+    sampler->requestUpdate(&subscriber);
+    QTRY_COMPARE(delivered, 1);
+    QCOMPARE(lastReading.memory.totalVm, 0u);
+
+    // a pending request moves over to the new pid
+    sampler->requestUpdate(&subscriber);
+    sampler->subscribe(&subscriber, ownPid(), callback);
+    QCOMPARE(sampler->sampledProcessCount(), 1);
+    QTRY_COMPARE(delivered, 2);
+    QVERIFY(lastReading.memory.totalVm > 0);
+
+    sampler->unsubscribe(&subscriber);
+}
+
+void tst_ProcessSampler::workerThreads()
+{
+    auto sampler = ProcessSampler::instance();
+    const int processCount = 3 * ProcessSampler::ProcessesPerWorkerThread;
+    const int maximumThreadCount = qBound(1, QThread::idealThreadCount() / 2, 4);
+
+    // the pids do not need to exist for this test
+    std::vector<std::unique_ptr<QObject>> subscribers;
+    for (int i = 0; i < processCount; ++i) {
+        subscribers.emplace_back(new QObject);
+        sampler->subscribe(subscribers.back().get(), 0x7ff00000 + i, [](const ProcessSampler::Reading &) { });
+    }
+    QCOMPARE(sampler->sampledProcessCount(), processCount);
+    QCOMPARE(sampler->workerThreadCount(), qMin(3, maximumThreadCount));
+
+    int delivered = 0;
+    for (const auto &subscriber : subscribers) {
+        sampler->subscribe(subscriber.get(), 0x7ff00000 + delivered++, [&](const ProcessSampler::Reading &) {
+            --delivered;
+        });
+        sampler->requestUpdate(subscriber.get());
+    }
+    QTRY_COMPARE(delivered, 0);
+
+    for (const auto &subscriber : subscribers)
+        sampler->unsubscribe(subscriber.get());
+}
+
+void tst_ProcessSampler::lifetime()
+{
+    auto sampler = ProcessSampler::instance();
+    QCOMPARE(ProcessSampler::existingInstance(), sampler);
+    QCOMPARE(sampler->parent(), QCoreApplication::instance());
+
+    QObject subscriber;
+    sampler->subscribe(&subscriber, ownPid(), [](const ProcessSampler::Reading &) { });
+    QCOMPARE(sampler->sampledProcessCount(), 1);
+    QCOMPARE(sampler->workerThreadCount(), 1);
+
+    // destroying the singleton (as the QCoreApplication does on exit) stops all worker threads
+    QPointer<QObject> guard = sampler;
+    delete sampler;
+    QVERIFY(guard.isNull());
+    QCOMPARE(ProcessSampler::existingInstance(), nullptr);
+
+    // a new singleton is created on demand
+    sampler = ProcessSampler::instance();
+    QVERIFY(sampler);
+    QCOMPARE(ProcessSampler::existingInstance(), sampler);
+    QCOMPARE(sampler->sampledProcessCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_ProcessSampler)
+
+#include "tst_processsampler.moc"
@@ -218,6 +218,38 @@ TestCase {
         requestSpy.clear()
     }
 
+    function test_request_queue() {
+        var before = IntentServer.requestQueueStatistics()
+        verify("stateLatencies" in before)
+
+        // send a burst of requests: the replies have to arrive in the order the requests were sent
+        var count = 10
+        var replies = []
+        var requests = []
+        for (var i = 0; i < count; ++i) {
+            let req = IntentClient.sendIntentRequest("only1", "intents1", { "index": i })
+            verify(req)
+            let index = i
+            req.replyReceived.connect(function() { replies.push(index) })
+            requests.push(req)
+        }
+        tryVerify(function() { return replies.length === count }, spyTimeout * 5)
+        for (i = 0; i < count; ++i) {
+            compare(replies[i], i)
+            verify(requests[i].succeeded)
+            compare(requests[i].result.in.index, i)
+        }
+
+        // all requests were queued at once, so the queue has to be drained in batches
+        var after = IntentServer.requestQueueStatistics()
+        verify(after.completedRequests - before.completedRequests >= count)
+        verify(after.processedRequests - before.processedRequests >= 2 * count)
+        verify(after.batches - before.batches < after.processedRequests - before.processedRequests)
+        verify(after.maximumQueueDepth >= count)
+        compare(after.queueDepth, 0)
+        verify(after.stateLatencies.ReceivedRequest.maximumTime >= 0)
+    }
+
     IntentServerHandler {
         id: broadcastReceiver
         intentIds: [ "broadcast/pong" ]
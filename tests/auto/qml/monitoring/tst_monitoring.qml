@@ -25,6 +25,22 @@ TestCase {
         FrameTimer { id: frames }
     }
 
+    MonitorModel {
+        id: counterMonitor
+        running: false
+        interval: 10
+        maximumCount: 3
+
+        QtObject {
+            property var roleNames: [ "counter", "half", "label" ]
+            property int counter: 0
+            property real half: counter / 2
+            property string label: "c" + counter
+
+            function update() { ++counter }
+        }
+    }
+
     function test_cpu() {
         cpu.update()
         verify(cpu.cpuCores >= 1)
@@ -68,7 +84,39 @@ TestCase {
         tryVerify(function() { return monitor.count == monitor.maximumCount }, spyTimeout, "no update received")
         wait(monitor.interval * 5 * AmTest.timeoutFactor)
         compare(monitor.count, monitor.maximumCount)
+        let newest = monitor.get(monitor.count - 1)
+        verify(newest.frameTimeP50 >= 0)
+        verify(newest.frameTimeP99 >= newest.frameTimeP95)
+        verify(newest.frameTimeP95 >= newest.frameTimeP50)
+        verify(newest.jankCount >= newest.longFrameCount)
         monitor.clear()
         compare(monitor.count, 0)
     }
+
+    function test_history() {
+        counterMonitor.running = true
+        tryVerify(function() { return counterMonitor.count === 3 && counterMonitor.get(2).counter >= 5 }, spyTimeout, "no update received")
+        counterMonitor.running = false
+
+        compare(counterMonitor.count, 3)
+        let newest = counterMonitor.get(2).counter
+        compare(counterMonitor.get(0).counter, newest - 2)
+        compare(counterMonitor.get(1).half, (newest - 1) / 2)
+        compare(counterMonitor.get(2).label, "c" + newest)
+
+        compare(counterMonitor.valuesForRole("counter"), [ newest - 2, newest - 1, newest ])
+        compare(counterMonitor.valuesForRole("half", 1, 1), [ (newest - 1) / 2 ])
+        compare(counterMonitor.valuesForRole("counter", 3).length, 0)
+
+        counterMonitor.maximumCount = 2
+        compare(counterMonitor.count, 2)
+        compare(counterMonitor.valuesForRole("counter"), [ newest - 1, newest ])
+        counterMonitor.maximumCount = 4
+        compare(counterMonitor.valuesForRole("counter"), [ newest - 1, newest ])
+        compare(counterMonitor.get(1).label, "c" + newest)
+
+        counterMonitor.clear()
+        compare(counterMonitor.count, 0)
+        compare(counterMonitor.valuesForRole("counter").length, 0)
+    }
 }
@@ -23,6 +23,11 @@ ApplicationManagerWindow {
             case "hide-main": root.visible = false; break;
             case "show-sub": sub.visible = true; break;
             case "hide-sub": sub.visible = false; break;
+            case "set-batch":
+                root.setWindowProperty("batch1", 1);
+                root.setWindowProperty("batch2", "two");
+                root.setWindowProperty("batch1", 3);
+                break;
             }
         }
     }
@@ -271,6 +271,28 @@ TestCase {
         compare(allProps.objectName, 42);
     }
 
+    // Changes made by the client in between two frames are sent as one batch, which only carries
+    // the latest value of each property
+    function test_window_properties_batched() {
+        if (ApplicationManager.singleProcess)
+            skip("Window properties are only sent via Wayland in multi-process mode");
+
+        var app = ApplicationManager.application("test.winmap.amwin");
+
+        app.start("show-main");
+        tryCompare(WindowManager, "count", 1, spyTimeout);
+        tryCompare(lastWindowAdded, "contentState", WindowObject.SurfaceWithContent, spyTimeout);
+
+        windowPropertyChangedSpy.clear();
+        app.start("set-batch");
+        tryCompare(windowPropertyChangedSpy, "count", 2, spyTimeout);
+        wait(100);
+        compare(windowPropertyChangedSpy.count, 2);
+
+        compare(lastWindowAdded.windowProperty("batch1"), 3);
+        compare(lastWindowAdded.windowProperty("batch2"), "two");
+    }
+
     // Checks that window properties survive show/hide cycles
     // Regression test for https://bugreports.qt.io/browse/AUTOSUITE-447
     function test_window_properties_survive_show_hide() {
@@ -0,0 +1,185 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtGui>
+#include <QtTest>
+
+#include "screenshotwriter.h"
+
+QT_USE_NAMESPACE_AM
+
+class tst_ScreenshotWriter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void write_data();
+    void write();
+    void qoi();
+    void failure();
+
+private:
+    static QImage testImage(QImage::Format format);
+    static QImage decodeQoi(const QByteArray &data);
+
+    QTemporaryDir m_tmp;
+};
+
+QImage tst_ScreenshotWriter::testImage(QImage::Format format)
+{
+    // gradients, solid runs and a few random pixels to exercise all QOI ops
+    QImage img(67, 31, QImage::Format_ARGB32);
+    QRandomGenerator rnd(42);
+    for (int y = 0; y < img.height(); ++y) {
+        for (int x = 0; x < img.width(); ++x) {
+            QRgb px;
+            if (y < 10)
+                px = qRgb(x * 3, y * 5, 128);
+            else if (y < 20)
+                px = qRgb(200, 16, 32);
+            else
+                px = qRgb(int(rnd.bounded(256)), int(rnd.bounded(256)), int(rnd.bounded(256)));
+            img.setPixel(x, y, px);
+        }
+    }
+    return img.convertToFormat(format);
+}
+
+QImage tst_ScreenshotWriter::decodeQoi(const QByteArray &data)
+{
+    if (data.size() < 22 || !data.startsWith("qoif"))
+        return { };
+
+    const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+    const int width = int(qFromBigEndian<quint32>(p + 4));
+    const int height = int(qFromBigEndian<quint32>(p + 8));
+    p += 14;
+
+    QImage img(width, height, QImage::Format_ARGB32);
+    QRgb index[64] = { };
+    QRgb px = qRgba(0, 0, 0, 255);
+    int run = 0;
+
+    for (int i = 0; i < width * height; ++i) {
+        if (run) {
+            --run;
+        } else {
+            const uchar b = *p++;
+            if (b == 0xfe) {
+                px = qRgba(p[0], p[1], p[2], qAlpha(px));
+                p += 3;
+            } else if (b == 0xff) {
+                px = qRgba(p[0], p[1], p[2], p[3]);
+                p += 4;
+            } else if ((b >> 6) == 0) {
+                px = index[b];
+            } else if ((b >> 6) == 1) {
+                px = qRgba((qRed(px) + ((b >> 4) & 3) - 2) & 0xff, (qGreen(px) + ((b >> 2) & 3) - 2) & 0xff,
+                           (qBlue(px) + (b & 3) - 2) & 0xff, qAlpha(px));
+            } else if ((b >> 6) == 2) {
+                const int vg = (b & 0x3f) - 32;
+                const uchar b2 = *p++;
+                px = qRgba((qRed(px) + vg - 8 + (b2 >> 4)) & 0xff, (qGreen(px) + vg) & 0xff,
+                           (qBlue(px) + vg - 8 + (b2 & 0xf)) & 0xff, qAlpha(px));
+            } else {
+                run = b & 0x3f;
+            }
+            index[(qRed(px) * 3 + qGreen(px) * 5 + qBlue(px) * 7 + qAlpha(px) * 11) % 64] = px;
+        }
+        img.setPixel(i % width, i / width, px);
+    }
+    if (QByteArray(reinterpret_cast<const char *>(p), 8) != QByteArray("\0\0\0\0\0\0\0\1", 8))
+        return { };
+    return img;
+}
+
+void tst_ScreenshotWriter::initTestCase()
+{
+    QVERIFY(m_tmp.isValid());
+}
+
+void tst_ScreenshotWriter::write_data()
+{
+    QTest::addColumn<QImage::Format>("format");
+    QTest::addColumn<QString>("suffix");
+    QTest::addColumn<bool>("flipped");
+
+    const QVector<QImage::Format> formats = {
+        QImage::Format_RGB32, QImage::Format_ARGB32_Premultiplied,
+        QImage::Format_RGBA8888_Premultiplied, QImage::Format_RGB888
+    };
+    for (auto format : formats) {
+        for (const QString &suffix : { qSL("ppm"), qSL("qoi"), qSL("png") }) {
+            for (bool flipped : { false, true }) {
+                QTest::addRow("%d-%s%s", int(format), qPrintable(suffix), flipped ? "-flipped" : "")
+                        << format << suffix << flipped;
+            }
+        }
+    }
+}
+
+void tst_ScreenshotWriter::write()
+{
+    QFETCH(QImage::Format, format);
+    QFETCH(QString, suffix);
+    QFETCH(bool, flipped);
+
+    const QImage image = testImage(format);
+    const QString fileName = m_tmp.filePath(qSL("shot.") + suffix);
+    QString errorString;
+
+    QVERIFY2(ScreenshotWriter::write(image, fileName, flipped, &errorString), qPrintable(errorString));
+
+    QImage written;
+    if (suffix == qSL("qoi")) {
+        QFile f(fileName);
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        written = decodeQoi(f.readAll());
+    } else {
+        QVERIFY(written.load(fileName));
+    }
+    QVERIFY(!written.isNull());
+
+    QImage expected = testImage(QImage::Format_RGB32);
+    if (flipped)
+        expected = expected.mirrored();
+    QCOMPARE(written.convertToFormat(QImage::Format_RGB32), expected);
+}
+
+void tst_ScreenshotWriter::qoi()
+{
+    // semi-transparent pixels are stored un-premultiplied
+    QImage image(2, 1, QImage::Format_ARGB32);
+    image.setPixel(0, 0, qRgba(255, 0, 0, 128));
+    image.setPixel(1, 0, qRgba(0, 0, 0, 0));
+    image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+    const QString fileName = m_tmp.filePath(qSL("alpha.qoi"));
+    QVERIFY(ScreenshotWriter::write(image, fileName));
+
+    QFile f(fileName);
+    QVERIFY(f.open(QIODevice::ReadOnly));
+    QImage written = decodeQoi(f.readAll());
+    QCOMPARE(written.size(), QSize(2, 1));
+    QCOMPARE(qAlpha(written.pixel(0, 0)), 128);
+    QVERIFY(qRed(written.pixel(0, 0)) >= 254);
+    QCOMPARE(written.pixel(1, 0), qRgba(0, 0, 0, 0));
+}
+
+void tst_ScreenshotWriter::failure()
+{
+    QString errorString;
+    QVERIFY(!ScreenshotWriter::write(QImage(), m_tmp.filePath(qSL("null.ppm")), false, &errorString));
+    QVERIFY(!errorString.isEmpty());
+
+    errorString.clear();
+    QVERIFY(!ScreenshotWriter::write(testImage(QImage::Format_RGB32),
+                                     m_tmp.filePath(qSL("does-not-exist/shot.qoi")), false, &errorString));
+    QVERIFY(errorString.contains(qSL("does-not-exist")));
+}
+
+QTEST_GUILESS_MAIN(tst_ScreenshotWriter)
+
+#include "tst_screenshotwriter.moc"
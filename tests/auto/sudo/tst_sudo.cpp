@@ -12,6 +12,8 @@
 #include "utilities.h"
 #include "sudo.h"
 
+#include <sys/stat.h>
+
 QT_USE_NAMESPACE_AM
 
 static int processTimeout = 3000;
@@ -54,6 +56,9 @@ private slots:
     void cleanupTestCase();
 
     void privileges();
+    void batch();
+    void bigBatch();
+    void setOwnerAndPermissionsSymlinks();
 
 private:
     SudoClient *m_sudo = nullptr;
@@ -82,6 +87,132 @@ void tst_Sudo::privileges()
     ScopedRootPrivileges sudo;
 }
 
+void tst_Sudo::batch()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QDir root(tmp.path());
+    QVERIFY(root.mkpath(qSL("a/b")));
+    QVERIFY(root.mkpath(qSL("c")));
+
+    SudoClient::Batch batch;
+    batch.setOwnerAndPermissionsRecursive(root.absoluteFilePath(qSL("a")), 0, 0, 0700);
+    batch.removeRecursive(root.absoluteFilePath(qSL("a")));
+    batch.removeRecursive(root.absoluteFilePath(qSL("does-not-exist")));
+    batch.removeRecursive(root.absoluteFilePath(qSL("c")));
+    QCOMPARE(batch.size(), 4);
+
+    // submit a second batch, before waiting for the first one
+    SudoClient::Batch emptyBatch;
+    quint32 id1 = m_sudo->submit(batch);
+    quint32 id2 = m_sudo->submit(emptyBatch);
+    QVERIFY(id1 != id2);
+
+    const auto statisticsBefore = m_sudo->latencyStatistics();
+
+    QVERIFY(m_sudo->waitForResults(id2).isEmpty());
+    const auto results = m_sudo->waitForResults(id1);
+    QCOMPARE(results.size(), 4);
+    QVERIFY2(results.at(0).success, qPrintable(results.at(0).errorString));
+    QVERIFY2(results.at(1).success, qPrintable(results.at(1).errorString));
+    QVERIFY(!results.at(2).success);
+    QVERIFY(!results.at(2).errorString.isEmpty());
+    QVERIFY2(results.at(3).success, qPrintable(results.at(3).errorString));
+
+    QVERIFY(!root.exists(qSL("a")));
+    QVERIFY(!root.exists(qSL("c")));
+
+    QCOMPARE(m_sudo->latencyStatistics().calls, statisticsBefore.calls + 2);
+
+    // single calls still work as before
+    QVERIFY(root.mkpath(qSL("d")));
+    QVERIFY(m_sudo->removeRecursive(root.absoluteFilePath(qSL("d"))));
+    QVERIFY(!root.exists(qSL("d")));
+}
+
+void tst_Sudo::bigBatch()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QDir root(tmp.path());
+
+    // this is way too big to be sent as a single datagram
+    const int count = 2000;
+    const QString longName = QString(200, qL1C('x'));
+    SudoClient::Batch batch;
+    for (int i = 0; i < count; ++i) {
+        const QString dirName = longName + QString::number(i);
+        if (i % 100 == 0)
+            QVERIFY(root.mkpath(dirName));
+        batch.removeRecursive(root.absoluteFilePath(dirName));
+    }
+
+    const auto results = m_sudo->execute(batch);
+    QCOMPARE(results.size(), count);
+    for (int i = 0; i < count; ++i) {
+        if (i % 100 == 0) {
+            QVERIFY2(results.at(i).success, qPrintable(results.at(i).errorString));
+            QVERIFY(!root.exists(longName + QString::number(i)));
+        } else {
+            QVERIFY(!results.at(i).success);
+            QVERIFY(!results.at(i).errorString.isEmpty());
+        }
+    }
+}
+
+void tst_Sudo::setOwnerAndPermissionsSymlinks()
+{
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QTemporaryDir outside;
+    QVERIFY(outside.isValid());
+
+    QDir root(tmp.path());
+    QVERIFY(root.mkpath(qSL("a/b")));
+    QFile file(root.absoluteFilePath(qSL("a/b/file")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.close();
+
+    const QString target = outside.filePath(qSL("target"));
+    QFile targetFile(target);
+    QVERIFY(targetFile.open(QIODevice::WriteOnly));
+    targetFile.close();
+    QVERIFY(QFile::setPermissions(target, QFileDevice::ReadOwner | QFileDevice::WriteOwner));
+
+    // symlinks to files and directories outside of the tree must not be followed
+    QVERIFY(QFile::link(target, root.absoluteFilePath(qSL("a/b/link"))));
+    QVERIFY(QFile::link(outside.path(), root.absoluteFilePath(qSL("a/dirlink"))));
+
+    struct stat targetBefore;
+    QCOMPARE(lstat(target.toLocal8Bit().constData(), &targetBefore), 0);
+    struct stat outsideBefore;
+    QCOMPARE(lstat(outside.path().toLocal8Bit().constData(), &outsideBefore), 0);
+
+    QVERIFY2(m_sudo->setOwnerAndPermissionsRecursive(root.absoluteFilePath(qSL("a")), 0, 0, 0644),
+             qPrintable(m_sudo->lastError()));
+
+    struct stat st;
+    QCOMPARE(lstat(root.absoluteFilePath(qSL("a/b/file")).toLocal8Bit().constData(), &st), 0);
+    QCOMPARE(st.st_mode & 07777, mode_t(0644));
+    QCOMPARE(st.st_uid, uid_t(0));
+    QCOMPARE(lstat(root.absoluteFilePath(qSL("a/b")).toLocal8Bit().constData(), &st), 0);
+    QCOMPARE(st.st_mode & 07777, mode_t(0755));
+
+    // the links themselves are owned by root now, but not their targets
+    QCOMPARE(lstat(root.absoluteFilePath(qSL("a/b/link")).toLocal8Bit().constData(), &st), 0);
+    QVERIFY(S_ISLNK(st.st_mode));
+    QCOMPARE(st.st_uid, uid_t(0));
+
+    QCOMPARE(lstat(target.toLocal8Bit().constData(), &st), 0);
+    QCOMPARE(st.st_mode, targetBefore.st_mode);
+    QCOMPARE(st.st_uid, targetBefore.st_uid);
+    QCOMPARE(lstat(outside.path().toLocal8Bit().constData(), &st), 0);
+    QCOMPARE(st.st_mode, outsideBefore.st_mode);
+    QCOMPARE(st.st_uid, outsideBefore.st_uid);
+
+    QVERIFY(m_sudo->removeRecursive(root.absoluteFilePath(qSL("a"))));
+}
+
 void tst_Sudo::cleanupTestCase()
 {
     // the real cleanup happens in ~tst_Installer, since we also need
@@ -21,8 +21,39 @@ private slots:
     void cgroupProcessInfo();
     void memoryReaderReadUsedValue();
     void memoryReaderGroupLimit();
+    void memoryReaderCGroupV2();
+    void memoryReaderProcMemInfo();
+    void memoryThresholdCGroupV2();
+    void memoryThresholdPressure();
+    void memoryWatcherCGroupV2();
 };
 
+// the thresholds need real files, since they write PSI triggers
+static bool copyTree(const QString &from, const QString &to)
+{
+    QDirIterator it(from, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        const QString src = it.next();
+        const QString dst = to + src.mid(from.size());
+        if (!QDir().mkpath(QFileInfo(dst).path()) || !QFile::copy(src, dst))
+            return false;
+        QFile::setPermissions(dst, QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+    }
+    return true;
+}
+
+static bool writeFile(const QString &fileName, const QByteArray &content)
+{
+    QFile f(fileName);
+    return f.open(QIODevice::WriteOnly | QIODevice::Truncate) && (f.write(content) == content.size());
+}
+
+static QByteArray readFile(const QString &fileName)
+{
+    QFile f(fileName);
+    return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
 tst_SystemReader::tst_SystemReader()
 {
     g_systemRootDir = qL1S(":/root");
@@ -48,6 +79,139 @@ void tst_SystemReader::memoryReaderGroupLimit()
     QCOMPARE(value, Q_UINT64_C(524288000));
 }
 
-QTEST_APPLESS_MAIN(tst_SystemReader)
+void tst_SystemReader::memoryReaderCGroupV2()
+{
+    g_systemRootDir = qL1S(":/root-v2");
+    auto cleanup = qScopeGuard([]() { g_systemRootDir = qL1S(":/root"); });
+
+    MemoryReader memoryReader(qSL("/app.slice/app1.scope"));
+    QCOMPARE(memoryReader.readUsedValue(), Q_UINT64_C(104857600));
+    QCOMPARE(memoryReader.groupLimit(), Q_UINT64_C(209715200));
+
+    // no limit means the physical RAM size
+    MemoryReader unlimitedReader(qSL("/app.slice/app2.scope"));
+    QCOMPARE(unlimitedReader.readUsedValue(), Q_UINT64_C(52428800));
+    QCOMPARE(unlimitedReader.groupLimit(), unlimitedReader.totalValue());
+}
+
+void tst_SystemReader::memoryReaderProcMemInfo()
+{
+    g_systemRootDir = qL1S(":/root-v2");
+    auto cleanup = qScopeGuard([]() { g_systemRootDir = qL1S(":/root"); });
+
+    // there is no cgroup v1 memory controller: MemTotal - MemAvailable
+    MemoryReader memoryReader;
+    QCOMPARE(memoryReader.readUsedValue(), Q_UINT64_C(2048000000));
+}
+
+void tst_SystemReader::memoryThresholdCGroupV2()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QVERIFY(copyTree(qSL(":/root-v2"), root.path()));
+    g_systemRootDir = root.path();
+    auto cleanup = qScopeGuard([]() { g_systemRootDir = qL1S(":/root"); });
+
+    const QString group = qSL("/app.slice/app1.scope");
+    const QString groupDir = root.filePath(qSL("sys/fs/cgroup") + group);
+
+    QCOMPARE(MemoryThreshold::detectBackend(group), MemoryThreshold::Backend::CGroupV2);
+
+    MemoryReader reader(group);
+    MemoryThreshold threshold({ 75, 90 });
+    QSignalSpy spy(&threshold, &MemoryThreshold::thresholdTriggered);
+    QVERIFY(threshold.setEnabled(true, group, &reader));
+    QVERIFY(threshold.isEnabled());
+    QCOMPARE(threshold.backend(), MemoryThreshold::Backend::CGroupV2);
+
+    // the PSI trigger for the group was registered as well
+    QVERIFY(readFile(groupDir + qSL("/memory.pressure")).startsWith("some 200000 2000000"));
+
+    // the kernel signals POLLPRI, even if nothing relevant changed
+    QVERIFY(QMetaObject::invokeMethod(&threshold, "readCGroupEvents"));
+    QCOMPARE(spy.count(), 0);
+
+    QVERIFY(writeFile(groupDir + qSL("/memory.events"),
+                      "low 0\nhigh 3\nmax 0\noom 0\noom_kill 0\noom_group_kill 0\n"));
+    QVERIFY(QMetaObject::invokeMethod(&threshold, "readCGroupEvents"));
+    QCOMPARE(spy.count(), 1);
+
+    QVERIFY(QMetaObject::invokeMethod(&threshold, "readPressureEvent"));
+    QCOMPARE(spy.count(), 2);
+
+    // app2 has no memory.pressure file: the PSI trigger is optional for the cgroup v2 backend
+    const QString group2 = qSL("/app.slice/app2.scope");
+    MemoryReader reader2(group2);
+    MemoryThreshold threshold2({ 75, 90 });
+    QVERIFY(threshold2.setEnabled(true, group2, &reader2, MemoryThreshold::Backend::CGroupV2));
+    QCOMPARE(threshold2.backend(), MemoryThreshold::Backend::CGroupV2);
+
+    // but not for the pressure backend
+    MemoryThreshold threshold3({ 75, 90 });
+    QVERIFY(!threshold3.setEnabled(true, group2, &reader2, MemoryThreshold::Backend::Pressure));
+    QVERIFY(!threshold3.isEnabled());
+}
+
+void tst_SystemReader::memoryThresholdPressure()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QVERIFY(copyTree(qSL(":/root-v2"), root.path()));
+    g_systemRootDir = root.path();
+    auto cleanup = qScopeGuard([]() { g_systemRootDir = qL1S(":/root"); });
+
+    // the root group has neither cgroup v1 event control, nor memory.events
+    QCOMPARE(MemoryThreshold::detectBackend(QString()), MemoryThreshold::Backend::Pressure);
+
+    MemoryReader reader;
+    MemoryThreshold threshold({ 75, 90 });
+    QSignalSpy spy(&threshold, &MemoryThreshold::thresholdTriggered);
+    QVERIFY(threshold.setEnabled(true, QString(), &reader));
+    QCOMPARE(threshold.backend(), MemoryThreshold::Backend::Pressure);
+    QVERIFY(readFile(root.filePath(qSL("proc/pressure/memory"))).startsWith("some 200000 2000000"));
+
+    QVERIFY(QMetaObject::invokeMethod(&threshold, "readPressureEvent"));
+    QCOMPARE(spy.count(), 1);
+
+    QVERIFY(threshold.setEnabled(false));
+    QVERIFY(!threshold.isEnabled());
+}
+
+void tst_SystemReader::memoryWatcherCGroupV2()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    QVERIFY(copyTree(qSL(":/root-v2"), root.path()));
+    g_systemRootDir = root.path();
+    auto cleanup = qScopeGuard([]() { g_systemRootDir = qL1S(":/root"); });
+
+    const QString group = qSL("/app.slice/app1.scope");
+    const QString groupDir = root.filePath(qSL("sys/fs/cgroup") + group);
+
+    MemoryWatcher watcher(nullptr);
+    QSignalSpy lowSpy(&watcher, &MemoryWatcher::memoryLow);
+    QSignalSpy criticalSpy(&watcher, &MemoryWatcher::memoryCritical);
+    watcher.setThresholds(75, 90);
+    QVERIFY(watcher.startWatching(group));
+
+    // 50% used
+    watcher.checkMemoryConsumption();
+    QCOMPARE(lowSpy.count(), 0);
+    QCOMPARE(criticalSpy.count(), 0);
+
+    // 80% used
+    QVERIFY(writeFile(groupDir + qSL("/memory.current"), "167772160\n"));
+    watcher.checkMemoryConsumption();
+    QCOMPARE(lowSpy.count(), 1);
+    QCOMPARE(criticalSpy.count(), 0);
+
+    // 95% used
+    QVERIFY(writeFile(groupDir + qSL("/memory.current"), "199229440\n"));
+    watcher.checkMemoryConsumption();
+    QCOMPARE(lowSpy.count(), 1);
+    QCOMPARE(criticalSpy.count(), 1);
+}
+
+QTEST_GUILESS_MAIN(tst_SystemReader)
 
 #include "tst_systemreader.moc"
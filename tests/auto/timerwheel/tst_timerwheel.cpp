@@ -0,0 +1,128 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+
+#include "timerwheel.h"
+
+QT_USE_NAMESPACE_AM
+
+class tst_TimerWheel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void singleShot();
+    void order();
+    void cancel();
+    void context();
+    void cascade();
+    void restartFromCallback();
+};
+
+void tst_TimerWheel::singleShot()
+{
+    TimerWheel tw;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    qint64 firedAfter = -1;
+
+    auto id = tw.start(50, nullptr, [&]() { firedAfter = elapsed.elapsed(); });
+    QVERIFY(id != 0);
+    QVERIFY(tw.isActive(id));
+    QCOMPARE(tw.activeCount(), 1);
+
+    QTRY_VERIFY(firedAfter >= 0);
+    QVERIFY(firedAfter >= 50);
+    QVERIFY(!tw.isActive(id));
+    QCOMPARE(tw.activeCount(), 0);
+}
+
+void tst_TimerWheel::order()
+{
+    TimerWheel tw;
+    QList<int> fired;
+
+    tw.start(120, nullptr, [&]() { fired << 3; });
+    tw.start(10, nullptr, [&]() { fired << 1; });
+    tw.start(60, nullptr, [&]() { fired << 2; });
+    tw.start(120, nullptr, [&]() { fired << 4; }); // same tick: started later, so fired later
+
+    QTRY_COMPARE(fired.size(), 4);
+    QCOMPARE(fired, QList<int>({ 1, 2, 3, 4 }));
+}
+
+void tst_TimerWheel::cancel()
+{
+    TimerWheel tw;
+    int fired = 0;
+
+    auto id1 = tw.start(30, nullptr, [&]() { ++fired; });
+    auto id2 = tw.start(30, nullptr, [&]() { fired += 10; });
+    QVERIFY(tw.cancel(id1));
+    QVERIFY(!tw.cancel(id1));
+    QCOMPARE(tw.activeCount(), 1);
+
+    QTRY_COMPARE(fired, 10);
+    QVERIFY(!tw.cancel(id2));
+
+    // lots of timeouts that are all canceled before they expire
+    QVector<TimerWheel::TimerId> ids;
+    for (int i = 0; i < 10000; ++i)
+        ids << tw.start(20 + i % 1000, nullptr, [&]() { ++fired; });
+    QCOMPARE(tw.activeCount(), 10000);
+    for (auto id : std::as_const(ids))
+        QVERIFY(tw.cancel(id));
+    QCOMPARE(tw.activeCount(), 0);
+    QTest::qWait(100);
+    QCOMPARE(fired, 10);
+}
+
+void tst_TimerWheel::context()
+{
+    TimerWheel tw;
+    bool fired = false;
+    auto context = new QObject;
+
+    tw.start(20, context, [&]() { fired = true; });
+    delete context;
+
+    QTRY_COMPARE(tw.activeCount(), 0);
+    QVERIFY(!fired);
+}
+
+void tst_TimerWheel::cascade()
+{
+    // these end up in higher levels of the wheel and need to be cascaded down
+    const int delays[] = { 700, 1300, 2000 };
+    TimerWheel tw;
+    QElapsedTimer elapsed;
+    elapsed.start();
+    QList<qint64> firedAfter;
+
+    for (int delay : delays)
+        tw.start(delay, nullptr, [&]() { firedAfter << elapsed.elapsed(); });
+
+    QTRY_COMPARE_WITH_TIMEOUT(firedAfter.size(), 3, 5000);
+    for (int i = 0; i < 3; ++i)
+        QVERIFY2(firedAfter.at(i) >= delays[i], qPrintable(QString::number(firedAfter.at(i))));
+}
+
+void tst_TimerWheel::restartFromCallback()
+{
+    TimerWheel tw;
+    int fired = 0;
+    std::function<void()> callback = [&]() {
+        if (++fired < 3)
+            tw.start(10, nullptr, callback);
+    };
+    tw.start(10, nullptr, callback);
+
+    QTRY_COMPARE(fired, 3);
+    QCOMPARE(tw.activeCount(), 0);
+}
+
+QTEST_GUILESS_MAIN(tst_TimerWheel)
+
+#include "tst_timerwheel.moc"
@@ -8,6 +8,12 @@
 
 #include "utilities.h"
 
+#if defined(Q_OS_UNIX)
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/stat.h>
+#endif
+
 QT_USE_NAMESPACE_AM
 
 class tst_Utilities : public QObject
@@ -18,12 +24,111 @@ public:
     tst_Utilities();
 
 private slots:
+    void removeRecursive_data();
+    void removeRecursive();
+    void setPermissionsAtSymlinks();
 };
 
 
 tst_Utilities::tst_Utilities()
 { }
 
+void tst_Utilities::removeRecursive_data()
+{
+    QTest::addColumn<int>("maxThreads");
+
+    QTest::newRow("single-threaded") << 1;
+    QTest::newRow("multi-threaded") << 4;
+}
+
+void tst_Utilities::removeRecursive()
+{
+    QFETCH(int, maxThreads);
+
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QTemporaryDir outside;
+    QVERIFY(outside.isValid());
+
+    QDir root(tmp.filePath(qSL("root")));
+    for (const auto &dirName : { "a/b/c", "d", "e/f", ".hidden" }) {
+        QVERIFY(root.mkpath(qL1S(dirName)));
+        for (int i = 0; i < 10; ++i) {
+            QFile f(root.absoluteFilePath(qL1S(dirName) + qSL("/file%1").arg(i)));
+            QVERIFY(f.open(QIODevice::WriteOnly));
+        }
+    }
+    QFile outsideFile(outside.filePath(qSL("file")));
+    QVERIFY(outsideFile.open(QIODevice::WriteOnly));
+    outsideFile.close();
+
+#if defined(Q_OS_UNIX)
+    // symlinks must not be followed
+    QVERIFY(QFile::link(outside.path(), root.absoluteFilePath(qSL("a/link"))));
+
+    // read-only directories have to be removed as well
+    QVERIFY(QFile::setPermissions(root.absoluteFilePath(qSL("d")), QFileDevice::ReadOwner | QFileDevice::ExeOwner));
+#endif
+
+    QVERIFY(QT_PREPEND_NAMESPACE_AM(removeRecursive)(root.absolutePath(), maxThreads));
+    QVERIFY(!root.exists());
+    QVERIFY(outsideFile.exists());
+
+    // removing something that does not exist is an error
+    QVERIFY(!QT_PREPEND_NAMESPACE_AM(removeRecursive)(root.absolutePath(), maxThreads));
+
+    // single files are fine as well
+    QVERIFY(QT_PREPEND_NAMESPACE_AM(removeRecursive)(outsideFile.fileName(), maxThreads));
+    QVERIFY(!outsideFile.exists());
+}
+
+void tst_Utilities::setPermissionsAtSymlinks()
+{
+#if !defined(Q_OS_UNIX)
+    QSKIP("setPermissionsAt() is only available on Unix");
+#else
+    QTemporaryDir tmp;
+    QVERIFY(tmp.isValid());
+    QTemporaryDir outside;
+    QVERIFY(outside.isValid());
+
+    auto modeOf = [](const QString &path) -> mode_t {
+        struct ::stat st;
+        return (::lstat(path.toLocal8Bit().constData(), &st) == 0) ? (st.st_mode & 07777) : mode_t(-1);
+    };
+
+    QFile outsideFile(outside.filePath(qSL("file")));
+    QVERIFY(outsideFile.open(QIODevice::WriteOnly));
+    outsideFile.close();
+    QCOMPARE(::chmod(outsideFile.fileName().toLocal8Bit().constData(), 0600), 0);
+    QDir outsideDir(outside.filePath(qSL("dir")));
+    QVERIFY(outsideDir.mkpath(qSL(".")));
+    QCOMPARE(::chmod(outsideDir.path().toLocal8Bit().constData(), 0700), 0);
+
+    QDir root(tmp.path());
+    QVERIFY(QFile::link(outsideFile.fileName(), root.absoluteFilePath(qSL("filelink"))));
+    QVERIFY(QFile::link(outsideDir.path(), root.absoluteFilePath(qSL("dirlink"))));
+    QFile insideFile(root.absoluteFilePath(qSL("file")));
+    QVERIFY(insideFile.open(QIODevice::WriteOnly));
+    insideFile.close();
+
+    const QByteArray rootPath = root.absolutePath().toLocal8Bit();
+    int dirFd = ::open(rootPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    QVERIFY(dirFd >= 0);
+
+    // this is what a concurrently replaced entry looks like to a recursive operation: the
+    // link targets outside of the tree must stay untouched
+    QVERIFY(setPermissionsAt(dirFd, "filelink", 0777));
+    QVERIFY(safeRemoveAt(dirFd, "dirlink", RecursiveOperationType::EnterDirectory));
+    QVERIFY(setPermissionsAt(dirFd, "file", 0640));
+    ::close(dirFd);
+
+    QCOMPARE(modeOf(outsideFile.fileName()), mode_t(0600));
+    QCOMPARE(modeOf(outsideDir.path()), mode_t(0700));
+    QCOMPARE(modeOf(insideFile.fileName()), mode_t(0640));
+#endif
+}
+
 QTEST_APPLESS_MAIN(tst_Utilities)
 
 #include "tst_utilities.moc"
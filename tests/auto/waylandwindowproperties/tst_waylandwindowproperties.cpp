@@ -0,0 +1,115 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+
+#include "waylandwindowproperties.h"
+
+QT_USE_NAMESPACE_AM
+
+class tst_WaylandWindowProperties : public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_WaylandWindowProperties();
+
+private slots:
+    void roundTrip();
+    void batches();
+    void tooBig();
+    void singleRoundTrip();
+    void singleTooBig();
+
+private:
+    QVariantMap m_properties;
+};
+
+
+tst_WaylandWindowProperties::tst_WaylandWindowProperties()
+{
+    m_properties = {
+        { qSL("bool"), true },
+        { qSL("int"), 42 },
+        { qSL("string"), qSL("text") },
+        { qSL("list"), QVariantList { 1, qSL("two"), 3.0 } },
+        { qSL("map"), QVariantMap { { qSL("a"), 1 }, { qSL("b"), qSL("c") } } },
+        { qSL("bytes"), QByteArray("\0\1\2", 3) },
+    };
+}
+
+void tst_WaylandWindowProperties::roundTrip()
+{
+    const auto batches = WaylandWindowProperties::serialize(m_properties);
+    QCOMPARE(batches.size(), 1);
+    QCOMPARE(WaylandWindowProperties::deserialize(batches.constFirst()), m_properties);
+
+    QVERIFY(WaylandWindowProperties::serialize({ }).isEmpty());
+    QVERIFY(WaylandWindowProperties::deserialize({ }).isEmpty());
+
+    // truncated data: all complete pairs are still returned
+    QByteArray truncated = batches.constFirst();
+    truncated.chop(1);
+    const QVariantMap partial = WaylandWindowProperties::deserialize(truncated);
+    QCOMPARE(partial.size(), m_properties.size() - 1);
+}
+
+void tst_WaylandWindowProperties::batches()
+{
+    QVariantMap properties;
+    for (int i = 0; i < 100; ++i)
+        properties.insert(qSL("property%1").arg(i), QString(100, QLatin1Char(char('a' + i % 26))));
+
+    const auto batches = WaylandWindowProperties::serialize(properties);
+    QVERIFY(batches.size() > 1);
+
+    QVariantMap received;
+    for (const QByteArray &batch : batches) {
+        QVERIFY(batch.size() <= WaylandWindowProperties::MaximumBatchSize);
+        received.insert(WaylandWindowProperties::deserialize(batch));
+    }
+    QCOMPARE(received, properties);
+}
+
+void tst_WaylandWindowProperties::tooBig()
+{
+    QVariantMap properties = m_properties;
+    properties.insert(qSL("huge"), QByteArray(WaylandWindowProperties::MaximumBatchSize, 'x'));
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression(qSL("Window property \"huge\" is too big.*")));
+    const auto batches = WaylandWindowProperties::serialize(properties);
+    QCOMPARE(batches.size(), 1);
+    QCOMPARE(WaylandWindowProperties::deserialize(batches.constFirst()), m_properties);
+}
+
+void tst_WaylandWindowProperties::singleRoundTrip()
+{
+    // version 1 of the protocol: one message per property
+    const auto messages = WaylandWindowProperties::serializeSingle(m_properties);
+    QCOMPARE(messages.size(), m_properties.size());
+
+    QVariantMap received;
+    for (const auto &[name, value] : messages)
+        received.insert(name, WaylandWindowProperties::deserializeSingle(value));
+    QCOMPARE(received, m_properties);
+
+    QVERIFY(WaylandWindowProperties::serializeSingle({ }).isEmpty());
+    QVERIFY(!WaylandWindowProperties::deserializeSingle({ }).isValid());
+}
+
+void tst_WaylandWindowProperties::singleTooBig()
+{
+    QVariantMap properties = m_properties;
+    properties.insert(qSL("huge"), QByteArray(WaylandWindowProperties::MaximumBatchSize, 'x'));
+
+    QTest::ignoreMessage(QtWarningMsg, QRegularExpression(qSL("Window property \"huge\" is too big.*")));
+    const auto messages = WaylandWindowProperties::serializeSingle(properties);
+    QCOMPARE(messages.size(), m_properties.size());
+    for (const auto &message : messages)
+        QVERIFY(message.first != qSL("huge"));
+}
+
+QTEST_APPLESS_MAIN(tst_WaylandWindowProperties)
+
+#include "tst_waylandwindowproperties.moc"
@@ -26,6 +26,9 @@ private slots:
     void documentParser();
     void cache();
     void mergedCache();
+    void cacheMetaData();
+    void lazyCache();
+    void bigCache();
     void parallel();
 };
 
@@ -226,6 +229,9 @@ struct CacheTest
 // this should simply be:
 // template<> class QT_PREPEND_NAMESPACE_AM(ConfigCacheAdaptor<CacheTest>)
 
+// counts the records that were deserialized from a cache file
+static QAtomicInt cacheRecordsLoaded;
+
 QT_BEGIN_NAMESPACE_AM
 template<> class ConfigCacheAdaptor<CacheTest>
 {
@@ -246,6 +252,7 @@ public:
     }
     CacheTest *loadFromCache(QDataStream &ds)
     {
+        ++cacheRecordsLoaded;
         CacheTest *ct = new CacheTest;
         ds >> ct->name >> ct->file >> ct->value;
         return ct;
@@ -375,6 +382,114 @@ void tst_Yaml::mergedCache()
     CacheTest *ct = brokenCache.takeMergedResult();
     QCOMPARE(ct->value, qSL("foobar"));
     delete ct;
+
+    // the re-written cache has to be usable as-is, with and without a full checksum verification
+
+    for (int step = 0; step < 2; ++step) {
+        AbstractConfigCache::Options options = AbstractConfigCache::MergedResult;
+        if (step == 1)
+            options |= AbstractConfigCache::FullVerify;
+
+        ConfigCache<CacheTest> verifiedCache(files, qSL("cache-test"), { 'M','T','S','T' }, 1, options);
+        verifiedCache.parse();
+        QVERIFY(verifiedCache.parseReadFromCache());
+        QVERIFY(!verifiedCache.parseWroteToCache());
+        ct = verifiedCache.takeMergedResult();
+        QVERIFY(ct);
+        QCOMPARE(ct->value, qSL("foobar"));
+        delete ct;
+    }
+}
+
+void tst_Yaml::cacheMetaData()
+{
+    // files that are not pre-processed and are not in resources can be verified via their
+    // meta-data only, so we need a plain file on disk
+    QTemporaryFile plainFile(qSL("cache-plain"));
+    QVERIFY(plainFile.open());
+    QVERIFY(plainFile.write("name: plain\nfile: plain.yaml\nvalue: \"plain\"\n") > 0);
+    QVERIFY(plainFile.flush());
+
+    const QStringList files = { QFileInfo(plainFile).absoluteFilePath() };
+
+    // the cache file has to be written at least one file-system timestamp tick after the source
+    // file: otherwise the meta-data check would (correctly) consider the source file as racy
+    QTest::qSleep(50);
+
+    for (int step = 0; step < 3; ++step) {
+        AbstractConfigCache::Options options = AbstractConfigCache::None;
+        if (step == 0)
+            options |= AbstractConfigCache::ClearCache;
+        else if (step == 2)
+            options |= AbstractConfigCache::FullVerify;
+
+        ConfigCache<CacheTest> cache(files, qSL("cache-plain-test"), { 'P','T','S','T' }, 1, options);
+        cache.parse();
+        QCOMPARE(cache.parseReadFromCache(), (step > 0));
+        // only the first parse and the full verification need to read and hash the file
+        QCOMPARE(cache.parseHashedFiles(), (step == 1) ? 0 : 1);
+        CacheTest *ct = cache.takeResult(0);
+        QVERIFY(ct);
+        QCOMPARE(ct->value, qSL("plain"));
+        delete ct;
+        AbstractConfigCache::waitForBackgroundWrites();
+    }
+}
+
+void tst_Yaml::lazyCache()
+{
+    // records are only deserialized when the corresponding result is taken
+    const QStringList files = { qSL(":/data/cache1.yaml"), qSL(":/data/cache2.yaml") };
+
+    for (int step = 0; step < 2; ++step) {
+        ConfigCache<CacheTest> cache(files, qSL("cache-lazy-test"), { 'L','T','S','T' }, 1,
+                                     step == 0 ? AbstractConfigCache::ClearCache
+                                               : AbstractConfigCache::None);
+        cacheRecordsLoaded = 0;
+        cache.parse();
+        QCOMPARE(cache.parseReadFromCache(), (step == 1));
+        QCOMPARE(cacheRecordsLoaded.loadAcquire(), 0);
+
+        std::unique_ptr<CacheTest> ct(cache.takeResult(1));
+        QVERIFY(ct);
+        QCOMPARE(ct->name, qSL("cache2"));
+        QCOMPARE(cacheRecordsLoaded.loadAcquire(), step);
+
+        // taking the result again does not deserialize it again
+        QVERIFY(!cache.takeResult(1));
+        QCOMPARE(cacheRecordsLoaded.loadAcquire(), step);
+        AbstractConfigCache::waitForBackgroundWrites();
+    }
+}
+
+void tst_Yaml::bigCache()
+{
+    // the number of cache entries is not limited (appdb-installed needs 2 entries per package)
+    const int fileCount = 1100;
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QStringList files;
+    for (int i = 0; i < fileCount; ++i) {
+        QFile f(dir.filePath(qSL("big-%1.yaml").arg(i)));
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        QVERIFY(f.write("name: big" + QByteArray::number(i) + "\nfile: ${FILE}\n") > 0);
+        files << f.fileName();
+    }
+
+    for (int step = 0; step < 2; ++step) {
+        ConfigCache<CacheTest> cache(files, qSL("cache-big-test"), { 'B','T','S','T' }, 1,
+                                     step == 0 ? AbstractConfigCache::ClearCache
+                                               : AbstractConfigCache::None);
+        cache.parse();
+        QCOMPARE(cache.parseReadFromCache(), (step == 1));
+        QCOMPARE(cache.parseWroteToCache(), (step == 0));
+        for (int i = 0; i < fileCount; i += 99) {
+            std::unique_ptr<CacheTest> ct(cache.takeResult(i));
+            QVERIFY(ct);
+            QCOMPARE(ct->name, qSL("big%1").arg(i));
+        }
+    }
 }
 
 class YamlRunnable : public QRunnable
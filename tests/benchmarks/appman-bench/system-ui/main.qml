@@ -115,6 +115,9 @@ Window {
             var pss = "System UI PSS Max: " + format((max(systemUiMonitor, systemUiMonitor.count, "memoryPss.total")
                                                       / 1e6).toFixed(0)) + " MB";
             var fps = "System UI FPS Avg: " + format(systemFrameTimer.averageFps.toFixed(1)) + " fps";
+            var frameTime = "System UI Frame Time P99 Max: " + format(max(systemUiMonitor, systemUiMonitor.count,
+                                                                          "frameTimeP99").toFixed(1)) + " ms";
+            var jank = "System UI Janky Frames: " + format(sum(systemUiMonitor, systemUiMonitor.count, "jankCount"));
             var cpuLoad = "System UI CPU Load Avg: " + format((load * 100).toFixed(1)) + " %";
             var gpuLoad = "System GPU Load Avg: " + format((avg(systemUiMonitor, systemUiMonitor.count, "gpuLoad")
                                                             * 100).toFixed(0)) + " %";
@@ -122,6 +125,8 @@ Window {
             var totalAppRSS = 0;
             var totalAppPSS = 0;
             var totalAppFPS = 0;
+            var maxAppFrameTime = 0;
+            var totalAppJank = 0;
             var totalCPULoad = load;
             for (var i = 0; i < windows.count; i++) {
                 var chrome = windows.itemAt(i);
@@ -129,6 +134,9 @@ Window {
                 totalAppRSS += max(chrome.processMonitor, chrome.processMonitor.count, "memoryRss.total");
                 totalAppPSS += max(chrome.processMonitor, chrome.processMonitor.count, "memoryPss.total");
                 totalAppFPS += chrome.processMonitor.get(chrome.processMonitor.count - 1).averageFps ;
+                maxAppFrameTime = Math.max(maxAppFrameTime, max(chrome.processMonitor, chrome.processMonitor.count,
+                                                                "frameTimeP99"));
+                totalAppJank += sum(chrome.processMonitor, chrome.processMonitor.count, "jankCount");
                 totalCPULoad += avg(chrome.processMonitor, chrome.processMonitor.count, "cpuLoad");
                 ApplicationManager.stopApplication(ApplicationManager.application(i).id);
             }
@@ -136,6 +144,8 @@ Window {
             var appRSS = "App RSS Max: " + format((totalAppRSS / ApplicationManager.count / 1e6).toFixed(0)) + " MB";
             var appPSS = "App PSS Max: " + format((totalAppPSS / ApplicationManager.count / 1e6).toFixed(0)) + " MB";
             var appFPS = "App FPS Avg: " + format((totalAppFPS / ApplicationManager.count ).toFixed(1)) + " fps";
+            var appFrameTime = "App Frame Time P99 Max: " + format(maxAppFrameTime.toFixed(1)) + " ms";
+            var appJank = "App Janky Frames: " + format(totalAppJank);
 
             var accCpuLoad = "Acc. CPU Load Avg: " + format((totalCPULoad * 100).toFixed(1)) + " %";
 
@@ -143,6 +153,7 @@ Window {
                                          +  windows.itemAt(0).width + "x" + windows.itemAt(0).height);
             console.log(benchCategory, cpuLoad + " | " + accCpuLoad + " | " + gpuLoad + " | " + fps + " | " + rss
                                          + " | " + pss + " | " + appFPS + " | " + appRSS + " | " + appPSS);
+            console.log(benchCategory, frameTime + " | " + jank + " | " + appFrameTime + " | " + appJank);
             Qt.quit();
         }
     }
@@ -158,6 +169,10 @@ Window {
     }
 
     function avg(monitor, size, key) {
+        return sum(monitor, size, key) / size;
+    }
+
+    function sum(monitor, size, key) {
         var sum = 0;
         for (var i = 0; i < size; i++) {
             var val = eval("monitor.get(i)." + key)
@@ -165,7 +180,7 @@ Window {
                 break;
             sum += val;
         }
-        return sum / size;
+        return sum;
     }
 
     function format(n) {
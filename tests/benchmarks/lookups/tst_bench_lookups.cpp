@@ -0,0 +1,220 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+
+#include "global.h"
+#include "packageinfo.h"
+#include "applicationinfo.h"
+#include "package.h"
+#include "application.h"
+#include "applicationmanager.h"
+#include "abstractruntime.h"
+#include "intentserver.h"
+#include "intentserversysteminterface.h"
+
+QT_USE_NAMESPACE_AM
+
+class BenchRuntime : public AbstractRuntime
+{
+    Q_OBJECT
+
+public:
+    explicit BenchRuntime(Application *app, AbstractRuntimeManager *manager)
+        : AbstractRuntime(nullptr, app, manager)
+    { }
+
+    void setSlowAnimations(bool) override {}
+    qint64 applicationProcessId() const override { return 0; }
+
+public slots:
+    bool start() override { return true; }
+    void stop(bool) override {}
+};
+
+class BenchRuntimeManager : public AbstractRuntimeManager
+{
+    Q_OBJECT
+
+public:
+    BenchRuntimeManager(QObject *parent)
+        : AbstractRuntimeManager(qSL("bench"), parent)
+    { }
+
+    BenchRuntime *create(AbstractContainer *, Application *app) override
+    {
+        return new BenchRuntime(app, this);
+    }
+};
+
+class BenchIntentSystemInterface : public IntentServerSystemInterface
+{
+    Q_OBJECT
+
+public:
+    IpcConnection *findClientIpc(const QString &) override { return nullptr; }
+    void startApplication(const QString &) override {}
+    bool checkApplicationCapabilities(const QString &, const QStringList &) override { return true; }
+    void replyFromSystem(IpcConnection *, IntentServerRequest *) override {}
+    void requestToApplication(IpcConnection *, IntentServerRequest *) override {}
+};
+
+class tst_Bench_Lookups : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void applicationFromId_data() { entryCounts(); }
+    void applicationFromId();
+    void applicationFromSecurityToken_data() { entryCounts(); }
+    void applicationFromSecurityToken();
+    void applicationIntent_data() { entryCounts(); }
+    void applicationIntent();
+
+private:
+    void entryCounts();
+    void populateApplications(int count);
+    void populateIntents(int count);
+
+    QTemporaryDir m_manifestDir;
+    BenchRuntimeManager *m_runtimeManager = nullptr;
+    QVector<PackageInfo *> m_packageInfos;
+    QVector<Package *> m_packages;
+    QVector<QByteArray> m_securityTokens;
+    int m_intentCount = 0;
+};
+
+void tst_Bench_Lookups::initTestCase()
+{
+    QVERIFY(m_manifestDir.isValid());
+    QVERIFY(ApplicationManager::createInstance(false));
+    QVERIFY(IntentServer::createInstance(new BenchIntentSystemInterface));
+    m_runtimeManager = new BenchRuntimeManager(this);
+}
+
+void tst_Bench_Lookups::cleanupTestCase()
+{
+    // the runtimes and applications are owned by the ApplicationManager
+    delete IntentServer::instance();
+    delete ApplicationManager::instance();
+    qDeleteAll(m_packages);
+    qDeleteAll(m_packageInfos);
+}
+
+void tst_Bench_Lookups::entryCounts()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+}
+
+void tst_Bench_Lookups::populateApplications(int count)
+{
+    auto am = ApplicationManager::instance();
+
+    for (int i = int(m_packages.size()); i < count; ++i) {
+        const QString manifestPath = m_manifestDir.filePath(qSL("info-%1.yaml").arg(i));
+        QFile f(manifestPath);
+        QVERIFY(f.open(QIODevice::WriteOnly));
+        f.write(QString::fromLatin1("formatType: am-package\n"
+                                    "formatVersion: 1\n"
+                                    "---\n"
+                                    "id: pkg.bench.%1\n"
+                                    "name: { en: 'Bench %1' }\n"
+                                    "icon: icon.png\n"
+                                    "applications:\n"
+                                    "- id: app.bench.%1\n"
+                                    "  runtime: qml\n"
+                                    "  code: main.qml\n").arg(i).toUtf8());
+        f.close();
+
+        auto pi = PackageInfo::fromManifest(manifestPath);
+        QVERIFY(pi);
+        QCOMPARE(pi->applications().size(), 1);
+        auto pkg = new Package(pi);
+        m_packageInfos << pi;
+        m_packages << pkg;
+
+        am->addApplication(pi->applications().constFirst(), pkg);
+        Application *app = am->fromId(pi->applications().constFirst()->id());
+        QVERIFY(app);
+        auto rt = m_runtimeManager->create(nullptr, app);
+        app->setCurrentRuntime(rt);
+        m_securityTokens << rt->securityToken();
+    }
+}
+
+void tst_Bench_Lookups::populateIntents(int count)
+{
+    populateApplications(count);
+
+    auto is = IntentServer::instance();
+
+    for (int i = m_intentCount; i < count; ++i) {
+        const QString packageId = qSL("pkg.bench.%1").arg(i);
+        const QString appId = qSL("app.bench.%1").arg(i);
+        is->addPackage(packageId);
+        is->addApplication(appId, packageId);
+
+        // a few intents per application, some of them shared between all applications
+        for (const QString &intentId : { qSL("share"), qSL("open"), qSL("intent.%1").arg(i) })
+            QVERIFY(is->addIntent(intentId, packageId, appId, { }, Intent::Public, { }, { }, { },
+                                  QUrl(), { }, false));
+    }
+    m_intentCount = count;
+}
+
+void tst_Bench_Lookups::applicationFromId()
+{
+    QFETCH(int, count);
+    populateApplications(count);
+
+    auto am = ApplicationManager::instance();
+    const QString lastId = qSL("app.bench.%1").arg(count - 1);
+    QVERIFY(am->fromId(lastId));
+
+    QBENCHMARK {
+        am->fromId(lastId);
+        am->indexOfApplication(lastId);
+    }
+}
+
+void tst_Bench_Lookups::applicationFromSecurityToken()
+{
+    QFETCH(int, count);
+    populateApplications(count);
+
+    auto am = ApplicationManager::instance();
+    const QByteArray lastToken = m_securityTokens.at(count - 1);
+    QCOMPARE(am->fromSecurityToken(lastToken), am->fromId(qSL("app.bench.%1").arg(count - 1)));
+
+    QBENCHMARK {
+        am->fromSecurityToken(lastToken);
+    }
+}
+
+void tst_Bench_Lookups::applicationIntent()
+{
+    QFETCH(int, count);
+    populateIntents(count);
+
+    auto is = IntentServer::instance();
+    const QString lastAppId = qSL("app.bench.%1").arg(count - 1);
+    const QString lastIntentId = qSL("intent.%1").arg(count - 1);
+    QVERIFY(is->applicationIntent(lastIntentId, lastAppId));
+    QVERIFY(is->applicationIntent(qSL("share"), lastAppId));
+
+    QBENCHMARK {
+        is->applicationIntent(lastIntentId, lastAppId);
+        is->packageIntent(lastIntentId, qSL("pkg.bench.%1").arg(count - 1));
+    }
+}
+
+QTEST_MAIN(tst_Bench_Lookups)
+
+#include "tst_bench_lookups.moc"
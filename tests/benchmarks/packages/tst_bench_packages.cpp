@@ -0,0 +1,201 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+
+#include "global.h"
+#include "installationreport.h"
+#include "packageutilities.h"
+#include "packagecreator.h"
+#include "packageextractor.h"
+#include "utilities.h"
+
+QT_USE_NAMESPACE_AM
+
+// Compares the package size and the extraction time (which is the bulk of the installation time)
+// of the supported package compression algorithms.
+
+class tst_Bench_Packages : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void extract_data();
+    void extract();
+
+private:
+    void addFile(const QString &path, const QByteArray &data);
+    void addDirectory(const QString &path);
+    QString createPackage(PackageCompression compression, int level);
+
+    QTemporaryDir m_dir;
+    QString m_sourcePath;
+    QStringList m_files;
+    qint64 m_sourceSize = 0;
+};
+
+void tst_Bench_Packages::addFile(const QString &path, const QByteArray &data)
+{
+    QFile f(m_sourcePath + path);
+    QVERIFY2(f.open(QIODevice::WriteOnly), qPrintable(f.errorString()));
+    QCOMPARE(f.write(data), qint64(data.size()));
+    m_files << path;
+    m_sourceSize += data.size();
+}
+
+void tst_Bench_Packages::addDirectory(const QString &path)
+{
+    QVERIFY(QDir(m_sourcePath).mkpath(path));
+    m_files << path;
+}
+
+// Creates an app tree that resembles a typical QML application with a native plugin: lots of
+// small text files, a few (already compressed) images and translations and some shared libraries.
+void tst_Bench_Packages::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_sourcePath = m_dir.filePath(qSL("source")) + u'/';
+    QVERIFY(QDir().mkpath(m_sourcePath));
+
+    QRandomGenerator rand(42);
+
+    auto text = [&rand](int size) {
+        static const char *words[] = { "import", "QtQuick", "Item", "property", "int", "string",
+                                       "anchors.fill:", "parent", "onClicked:", "function",
+                                       "id:", "width:", "height:", "Rectangle", "color:", "{",
+                                       "}", "\n", "    ", "Text", "text:", "qsTr(\"label\")" };
+        QByteArray result;
+        result.reserve(size + 32);
+        while (result.size() < size) {
+            result.append(words[rand.bounded(int(sizeof(words) / sizeof(*words)))]);
+            result.append(' ');
+        }
+        result.truncate(size);
+        return result;
+    };
+    auto random = [&rand](int size) {
+        QByteArray result((size + 3) & ~3, Qt::Uninitialized);
+        rand.fillRange(reinterpret_cast<quint32 *>(result.data()), result.size() / 4);
+        result.truncate(size);
+        return result;
+    };
+    auto binary = [&rand, &random](int size) {
+        // machine code is somewhere between text and random data: mix runs of both
+        QByteArray result;
+        result.reserve(size);
+        const QByteArray pattern = random(4096);
+        while (result.size() < size) {
+            const int run = 64 + rand.bounded(1024);
+            if (rand.bounded(2))
+                result.append(random(run));
+            else
+                result.append(pattern.mid(rand.bounded(4096 - 1088), run));
+        }
+        result.truncate(size);
+        return result;
+    };
+
+    addFile(qSL("info.yaml"), "formatVersion: 1\nformatType: am-package\n---\nid: com.example.bench\n");
+    addFile(qSL("icon.png"), random(16 * 1024));
+    addDirectory(qSL("qml"));
+    for (int i = 0; i < 300; ++i)
+        addFile(qSL("qml/Component%1.qml").arg(i), text(1024 + rand.bounded(16 * 1024)));
+    addDirectory(qSL("js"));
+    for (int i = 0; i < 20; ++i)
+        addFile(qSL("js/script%1.js").arg(i), text(4 * 1024 + rand.bounded(64 * 1024)));
+    addDirectory(qSL("images"));
+    for (int i = 0; i < 60; ++i)
+        addFile(qSL("images/image%1.png").arg(i), random(8 * 1024 + rand.bounded(256 * 1024)));
+    addDirectory(qSL("translations"));
+    for (int i = 0; i < 10; ++i)
+        addFile(qSL("translations/app_%1.qm").arg(i), text(64 * 1024));
+    addDirectory(qSL("lib"));
+    for (int i = 0; i < 4; ++i)
+        addFile(qSL("lib/libplugin%1.so").arg(i), binary(2 * 1024 * 1024 + rand.bounded(2 * 1024 * 1024)));
+}
+
+QString tst_Bench_Packages::createPackage(PackageCompression compression, int level)
+{
+    const QString fileName = m_dir.filePath(PackageUtilities::compressionName(compression)
+                                            + u'-' + QString::number(level) + qSL(".appkg"));
+    if (QFile::exists(fileName))
+        return fileName;
+
+    QFile output(fileName);
+    if (!output.open(QIODevice::WriteOnly))
+        return { };
+
+    InstallationReport report(qSL("com.example.bench"));
+    report.addFiles(m_files);
+    report.setDiskSpaceUsed(quint64(m_sourceSize));
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    PackageCreator creator(QDir(m_sourcePath), &output, report);
+    creator.setCompression(compression, level);
+    if (!creator.create()) {
+        qWarning() << "could not create package:" << creator.errorString();
+        output.remove();
+        return { };
+    }
+    output.close();
+
+    qInfo().noquote().nospace() << PackageUtilities::compressionName(compression)
+                                << " (level " << level << "): package size "
+                                << (QFileInfo(fileName).size() * 100 / m_sourceSize) << "% of "
+                                << m_sourceSize << " bytes, created in " << elapsed.elapsed() << " msec";
+    return fileName;
+}
+
+void tst_Bench_Packages::extract_data()
+{
+    QTest::addColumn<QString>("compressionName");
+    QTest::addColumn<int>("level");
+
+    QTest::newRow("none") << "none" << -1;
+    QTest::newRow("gzip") << "gzip" << -1;
+    QTest::newRow("gzip-9") << "gzip" << 9;
+    QTest::newRow("xz") << "xz" << -1;
+    QTest::newRow("zstd") << "zstd" << -1;
+    QTest::newRow("zstd-19") << "zstd" << 19;
+}
+
+void tst_Bench_Packages::extract()
+{
+    QFETCH(QString, compressionName);
+    QFETCH(int, level);
+
+    bool ok = false;
+    const PackageCompression compression = PackageUtilities::compressionFromName(compressionName, &ok);
+    QVERIFY(ok);
+
+    if (!PackageUtilities::isCompressionSupported(compression))
+        QSKIP("This compression algorithm is not supported on this system");
+
+    const QString packageFile = createPackage(compression, level);
+    QVERIFY(!packageFile.isEmpty());
+
+    QBENCHMARK {
+        QTemporaryDir destination(m_dir.filePath(qSL("extract-XXXXXX")));
+        QVERIFY(destination.isValid());
+
+        PackageExtractor extractor(QUrl::fromLocalFile(packageFile), QDir(destination.path()));
+        QVERIFY2(extractor.extract(), qPrintable(extractor.errorString()));
+        QCOMPARE(extractor.compression(), compression);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    PackageUtilities::ensureCorrectLocale();
+    QCoreApplication app(argc, argv);
+    tst_Bench_Packages tc;
+    QTEST_SET_MAIN_SOURCE_PATH
+    return QTest::qExec(&tc, argc, argv);
+}
+
+#include "tst_bench_packages.moc"
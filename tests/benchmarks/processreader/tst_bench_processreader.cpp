@@ -0,0 +1,131 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#include <QtCore>
+#include <QtTest>
+#include <QtAppManMonitor/processreader.h>
+
+QT_USE_NAMESPACE_AM
+
+class tst_Bench_ProcessReader : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void smaps_data();
+    void smaps();
+    void smapsRollup();
+
+private:
+    QByteArray createSmapsFile(int mappingCount);
+
+    QTemporaryDir m_dir;
+};
+
+void tst_Bench_ProcessReader::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+}
+
+// Creates a synthetic smaps file that looks like the one of a big, multi-threaded process:
+// lots of shared libraries, anonymous heap mappings and thread stacks with their guard pages.
+QByteArray tst_Bench_ProcessReader::createSmapsFile(int mappingCount)
+{
+    const QString fileName = m_dir.filePath(qSL("%1.smaps").arg(mappingCount));
+    QFile f(fileName);
+    if (!f.exists()) {
+        if (!f.open(QIODevice::WriteOnly))
+            return { };
+
+        static const char *permissions[] = { "r--p", "r-xp", "r--p", "rw-p", "---p", "rw-p" };
+        quint64 address = 0x7f0000000000;
+
+        for (int i = 0; i < mappingCount; ++i) {
+            const int type = i % 6;
+            const bool isThreadStack = (type == 5) && ((i / 6) % 2);
+            const quint64 size = isThreadStack ? 8192 : (4 * (1 + (i % 97)));
+            const bool isLibrary = (type < 4);
+            QByteArray header = QByteArray::number(address, 16) + '-'
+                    + QByteArray::number(address + size * 1024, 16) + ' ' + permissions[type]
+                    + " 00000000 " + (isLibrary ? "b3:01 " + QByteArray::number(100000 + i / 6)
+                                                : QByteArray("00:00 0"));
+            if (isLibrary)
+                header += "                    /usr/lib/libsomething-" + QByteArray::number(i / 6) + ".so";
+            address += size * 1024;
+
+            const quint64 rss = size / 2;
+            f.write(header + '\n'
+                    + "Size:           " + QByteArray::number(size) + " kB\n"
+                    + "KernelPageSize:        4 kB\n"
+                    + "MMUPageSize:           4 kB\n"
+                    + "Rss:            " + QByteArray::number(rss) + " kB\n"
+                    + "Pss:            " + QByteArray::number(rss / 2) + " kB\n"
+                    + "Pss_Dirty:      " + QByteArray::number(rss / 4) + " kB\n"
+                    "Shared_Clean:          0 kB\n"
+                    "Shared_Dirty:          0 kB\n"
+                    "Private_Clean:         0 kB\n"
+                    "Private_Dirty:         0 kB\n"
+                    "Referenced:            0 kB\n"
+                    "Anonymous:             0 kB\n"
+                    "LazyFree:              0 kB\n"
+                    "AnonHugePages:         0 kB\n"
+                    "ShmemPmdMapped:        0 kB\n"
+                    "FilePmdMapped:         0 kB\n"
+                    "Shared_Hugetlb:        0 kB\n"
+                    "Private_Hugetlb:       0 kB\n"
+                    "Swap:                  0 kB\n"
+                    "SwapPss:               0 kB\n"
+                    "Locked:                0 kB\n"
+                    "THPeligible:           0\n"
+                    "VmFlags: rd mr mw me sd\n");
+        }
+        f.close();
+    }
+    return fileName.toLocal8Bit();
+}
+
+void tst_Bench_ProcessReader::smaps_data()
+{
+    QTest::addColumn<int>("mappingCount");
+
+    QTest::newRow("500") << 500;
+    QTest::newRow("5000") << 5000;
+    QTest::newRow("20000") << 20000;
+}
+
+void tst_Bench_ProcessReader::smaps()
+{
+    QFETCH(int, mappingCount);
+
+    const QByteArray smapsFile = createSmapsFile(mappingCount);
+    QVERIFY(!smapsFile.isEmpty());
+
+    ProcessReader reader;
+    QVERIFY(reader.testReadSmaps(smapsFile));
+    QVERIFY(reader.memory.totalVm > 0);
+    QVERIFY(reader.memory.heapVm > 0);
+
+    QBENCHMARK {
+        reader.testReadSmaps(smapsFile);
+    }
+}
+
+void tst_Bench_ProcessReader::smapsRollup()
+{
+    const QByteArray procDir = "/proc/" + QByteArray::number(QCoreApplication::applicationPid());
+    if (!QFile::exists(QString::fromLocal8Bit(procDir + "/smaps_rollup")))
+        QSKIP("This kernel does not support smaps_rollup");
+
+    ProcessReader reader;
+    QVERIFY(reader.testReadSmapsRollup(procDir + "/smaps_rollup", procDir + "/statm"));
+
+    QBENCHMARK {
+        reader.testReadSmapsRollup(procDir + "/smaps_rollup", procDir + "/statm");
+    }
+}
+
+QTEST_APPLESS_MAIN(tst_Bench_ProcessReader)
+
+#include "tst_bench_processreader.moc"